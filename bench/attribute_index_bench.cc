@@ -0,0 +1,65 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// Compares selecting entries by the exact value of an attribute, alone and
+// together with another predicate, with and without the attribute index.
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+
+#include "bench_utils.hh"
+#include "libjlinkdb.hh"
+
+using libjlinkdb::LinkDatabase;
+using libjlinkdb::query::And;
+using libjlinkdb::query::AttributeQuery;
+using libjlinkdb::query::StringSearchOptions;
+using libjlinkdb::query::TagQuery;
+using std::size_t;
+
+int
+main()
+{
+    constexpr size_t ENTRY_COUNT = 200000;
+    constexpr int REPEAT = 10;
+
+    LinkDatabase database{bench::generate_database(ENTRY_COUNT)};
+    StringSearchOptions exact{true, false};
+    // Each import holds about a twentieth of the entries.
+    AttributeQuery attribute{"source", "import-7", exact};
+    And batch{std::make_shared<AttributeQuery>("source", "import-7", exact),
+        std::make_shared<TagQuery>("tag3", StringSearchOptions{false, true})};
+
+    size_t matches = 0;
+    auto time_count = [&](const libjlinkdb::query::Query& query) {
+        return bench::time_ms(
+            [&]() { matches = database.count(query); }, REPEAT);
+    };
+    bench::report("attribute without index", time_count(attribute));
+    std::cout << "    " << matches << " matches\n";
+    bench::report("batch without index", time_count(batch));
+    std::cout << "    " << matches << " matches\n";
+
+    database.set_attribute_index_enabled(true);
+    bench::report("attribute with index", time_count(attribute));
+    bench::report("batch with index", time_count(batch));
+    return 0;
+}
@@ -0,0 +1,67 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// Compares range and prefix searches of attributes with and without keeping
+// the attributes in order.
+
+#include <cstddef>
+#include <iostream>
+
+#include "bench_utils.hh"
+#include "libjlinkdb.hh"
+
+using libjlinkdb::AttributeBound;
+using libjlinkdb::AttributeOrder;
+using libjlinkdb::LinkDatabase;
+using libjlinkdb::query::AttributePrefixQuery;
+using libjlinkdb::query::AttributeRangeQuery;
+using libjlinkdb::query::Query;
+using std::size_t;
+
+int
+main()
+{
+    constexpr size_t ENTRY_COUNT = 200000;
+    constexpr int REPEAT = 10;
+
+    LinkDatabase database{bench::generate_database(ENTRY_COUNT)};
+    // Priorities go from 0 to 9, so about a tenth of the entries match.
+    AttributeRangeQuery range{"priority", AttributeOrder::INTEGER,
+        AttributeBound::excluding("8"), AttributeBound::none()};
+    // Matches import-1 and import-10 to import-19.
+    AttributePrefixQuery prefix{"source", "import-1"};
+
+    size_t matches = 0;
+    auto time_count = [&](const Query& query) {
+        return bench::time_ms(
+            [&]() { matches = database.count(query); }, REPEAT);
+    };
+    bench::report("range without index", time_count(range));
+    std::cout << "    " << matches << " matches\n";
+    bench::report("prefix without index", time_count(prefix));
+    std::cout << "    " << matches << " matches\n";
+
+    database.add_sorted_attribute_index("priority", AttributeOrder::INTEGER);
+    database.add_sorted_attribute_index(
+        "source", AttributeOrder::LEXICOGRAPHIC);
+    bench::report("range with index", time_count(range));
+    bench::report("prefix with index", time_count(prefix));
+    return 0;
+}
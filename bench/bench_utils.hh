@@ -0,0 +1,144 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_BENCH_BENCH_UTILS_HH_
+#define LIBJLINKDB_BENCH_BENCH_UTILS_HH_
+
+#include <chrono>
+#include <cstddef>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "libjlinkdb.hh"
+
+namespace bench {
+
+// Returns the number of milliseconds it takes to call func repeat times,
+// taking the fastest of a few runs.
+template <typename F>
+double
+time_ms(F func, int repeat = 1)
+{
+    double best = 0.0;
+    for (int run = 0; run < 3; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < repeat; ++i) {
+            func();
+        }
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        if (run == 0 || elapsed.count() < best) {
+            best = elapsed.count();
+        }
+    }
+    return best;
+}
+
+// Prints a line of results with a name and a time.
+inline void
+report(const std::string& name, double ms)
+{
+    std::cout << std::left << std::setw(48) << name << std::right
+              << std::setw(12) << std::fixed << std::setprecision(3) << ms
+              << " ms\n";
+}
+
+// Generates words and sentences from a fixed seed, so that runs are
+// comparable.
+class TextGenerator {
+public:
+    explicit TextGenerator(unsigned seed = 42) : engine_{seed}
+    {
+    }
+
+    // Returns a word of 3 to 9 letters, capitalized half of the time.
+    std::string word()
+    {
+        std::uniform_int_distribution<int> length{3, 9};
+        std::uniform_int_distribution<int> letter{'a', 'z'};
+        std::string result(length(engine_), 'a');
+        for (auto& c : result) {
+            c = static_cast<char>(letter(engine_));
+        }
+        if (engine_() % 2 == 0) {
+            result[0] = static_cast<char>(result[0] - 'a' + 'A');
+        }
+        return result;
+    }
+
+    // Returns count words separated by spaces.
+    std::string sentence(int count)
+    {
+        std::string result;
+        for (int i = 0; i < count; ++i) {
+            if (i > 0) {
+                result += ' ';
+            }
+            result += word();
+        }
+        return result;
+    }
+
+    // Returns a random number in [0, bound).
+    std::size_t below(std::size_t bound)
+    {
+        return std::uniform_int_distribution<std::size_t>{0, bound - 1}(
+            engine_);
+    }
+
+    // Returns an entry with a location, name, description, a few tags and a
+    // couple of attributes.
+    std::shared_ptr<libjlinkdb::LinkEntry> entry()
+    {
+        auto result = std::make_shared<libjlinkdb::LinkEntry>(
+            "https://" + word() + ".example.com/" + word() + "/" + word());
+        result->set_name(sentence(3));
+        result->set_description(sentence(10));
+        for (int i = 0; i < 3; ++i) {
+            result->add_tag("tag" + std::to_string(below(200)));
+        }
+        result->set_attribute("source", "import-" + std::to_string(below(20)));
+        result->set_attribute("priority", std::to_string(below(10)));
+        return result;
+    }
+
+private:
+    std::mt19937 engine_;
+};
+
+// Returns a database holding count generated entries.
+inline libjlinkdb::LinkDatabase
+generate_database(std::size_t count, unsigned seed = 42)
+{
+    TextGenerator generator{seed};
+    libjlinkdb::LinkDatabase database;
+    for (std::size_t i = 0; i < count; ++i) {
+        database.add_entry(generator.entry());
+    }
+    return database;
+}
+
+}  // namespace bench
+
+#endif  // LIBJLINKDB_BENCH_BENCH_UTILS_HH_
@@ -0,0 +1,79 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// Compares counting the entries that match a combination of indexed filters
+// by checking every entry with counting them from the bitmaps of the
+// indexes.
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "bench_utils.hh"
+#include "libjlinkdb.hh"
+
+using libjlinkdb::LinkDatabase;
+using libjlinkdb::query::AndCollection;
+using libjlinkdb::query::AttributeQuery;
+using libjlinkdb::query::OrCollection;
+using libjlinkdb::query::Query;
+using libjlinkdb::query::StringSearchOptions;
+using libjlinkdb::query::TagQuery;
+using std::make_shared;
+using std::shared_ptr;
+using std::size_t;
+using std::vector;
+
+int
+main()
+{
+    constexpr size_t ENTRY_COUNT = 200000;
+    constexpr int REPEAT = 100;
+
+    LinkDatabase database{bench::generate_database(ENTRY_COUNT)};
+    StringSearchOptions exact{true, false};
+    auto tags = make_shared<OrCollection>(vector<shared_ptr<Query>>{
+        make_shared<TagQuery>("tag7", exact),
+        make_shared<TagQuery>("tag42", exact)});
+    auto source = make_shared<AttributeQuery>("source", "import-3", exact);
+    auto priority = make_shared<AttributeQuery>("priority", "5", exact);
+    // Three filters and four.
+    AndCollection three{vector<shared_ptr<Query>>{tags, source, priority}};
+    AndCollection four{vector<shared_ptr<Query>>{tags, source, priority,
+        make_shared<TagQuery>("tag100", exact)}};
+
+    size_t matches = 0;
+    auto time_count = [&](const Query& query, int repeat) {
+        return bench::time_ms(
+            [&]() { matches = database.count(query); }, repeat);
+    };
+    bench::report("three filters without indexes", time_count(three, 1));
+    std::cout << "    " << matches << " matches\n";
+    bench::report("four filters without indexes", time_count(four, 1));
+    std::cout << "    " << matches << " matches\n";
+
+    database.set_tag_index_enabled(true);
+    database.set_attribute_index_enabled(true);
+    bench::report("three filters with indexes, x100",
+        time_count(three, REPEAT));
+    bench::report("four filters with indexes, x100", time_count(four, REPEAT));
+    return 0;
+}
@@ -0,0 +1,80 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// Compares adding entries one at a time to adding them in one batch, with a
+// slot connected to the batched signal, and deleting them the same two ways.
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "bench_utils.hh"
+#include "libjlinkdb.hh"
+
+using libjlinkdb::LinkDatabase;
+using libjlinkdb::LinkEntry;
+using std::size_t;
+
+int
+main()
+{
+    constexpr size_t ENTRY_COUNT = 200000;
+
+    bench::TextGenerator generator;
+    std::vector<std::shared_ptr<LinkEntry>> entries;
+    for (size_t i = 0; i < ENTRY_COUNT; ++i) {
+        entries.push_back(generator.entry());
+    }
+    std::vector<int> ids;
+    for (size_t i = 0; i < ENTRY_COUNT; ++i) {
+        ids.push_back(static_cast<int>(i));
+    }
+
+    size_t signals = 0;
+    bench::report("add_entry for each entry", bench::time_ms([&]() {
+        LinkDatabase database;
+        database.signal_entry_added().connect([&](int) { ++signals; });
+        for (const auto& entry : entries) {
+            database.add_entry(entry);
+        }
+    }));
+    bench::report("add_entries", bench::time_ms([&]() {
+        LinkDatabase database;
+        database.signal_entries_added().connect(
+            [&](int, int) { ++signals; });
+        database.add_entries(entries);
+    }));
+
+    LinkDatabase database;
+    database.add_entries(entries);
+    bench::report("delete_entry for each entry", bench::time_ms([&]() {
+        LinkDatabase copy{database};
+        for (int id : ids) {
+            copy.delete_entry(id);
+        }
+    }));
+    bench::report("delete_entries", bench::time_ms([&]() {
+        LinkDatabase copy{database};
+        copy.delete_entries(ids);
+    }));
+    std::cout << "    " << signals << " signals emitted\n";
+    return 0;
+}
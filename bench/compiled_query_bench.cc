@@ -0,0 +1,101 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// Compares checking every row of a store against a query tree through
+// matches_row to running the compiled program of the same tree.
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench_utils.hh"
+#include "libjlinkdb.hh"
+
+using libjlinkdb::EntryStore;
+using libjlinkdb::query::And;
+using libjlinkdb::query::AttributeQuery;
+using libjlinkdb::query::CompiledQuery;
+using libjlinkdb::query::ContainsQuery;
+using libjlinkdb::query::OrCollection;
+using libjlinkdb::query::Query;
+using libjlinkdb::query::StringSearchOptions;
+using libjlinkdb::query::TagQuery;
+using std::size_t;
+
+namespace {
+
+template <typename Q>
+void
+run(const std::string& name, const Q& query, const EntryStore& store)
+{
+    size_t found = 0;
+    bench::report(name, bench::time_ms([&]() {
+        found = 0;
+        for (size_t row = 0; row < store.rows(); ++row) {
+            found += query.matches_row(store, row) ? 1 : 0;
+        }
+    }));
+    std::cout << "    " << found << " matches\n";
+}
+
+}  // namespace
+
+int
+main()
+{
+    constexpr size_t ENTRY_COUNT = 100000;
+
+    bench::TextGenerator generator;
+    EntryStore store;
+    for (size_t row = 0; row < ENTRY_COUNT; ++row) {
+        store.insert(row, generator.entry());
+    }
+
+    for (size_t terms : {1, 4, 16}) {
+        std::vector<std::string> words;
+        for (size_t i = 0; i < terms; ++i) {
+            words.push_back(generator.word());
+        }
+        auto contains = std::make_shared<ContainsQuery>(
+            words, StringSearchOptions{false, true});
+        And query{contains,
+            std::make_shared<TagQuery>(
+                "tag7", StringSearchOptions{false, false})};
+        CompiledQuery compiled{query};
+
+        std::string suffix = " (" + std::to_string(terms) + " terms)";
+        run("tree" + suffix, query, store);
+        run("compiled" + suffix, compiled, store);
+    }
+
+    // Exact matches are cheap, so the cost of going through the tree shows
+    // more.
+    std::vector<std::shared_ptr<Query>> priorities;
+    for (int i = 0; i < 16; ++i) {
+        priorities.push_back(std::make_shared<AttributeQuery>("priority",
+            std::to_string(10 + i), StringSearchOptions{true, false}));
+    }
+    OrCollection query{priorities};
+    run("tree (16 exact attributes)", query, store);
+    run("compiled (16 exact attributes)", CompiledQuery{query}, store);
+    return 0;
+}
@@ -0,0 +1,157 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// Measures the throughput of a mixed workload of lookups, searches and adds
+// from a growing number of threads, comparing a LinkDatabase behind one
+// mutex to a ConcurrentLinkDatabase. The number of threads goes up to the
+// number of hardware threads, or the number given as the first argument.
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_utils.hh"
+#include "libjlinkdb.hh"
+
+using libjlinkdb::ConcurrentLinkDatabase;
+using libjlinkdb::LinkDatabase;
+using libjlinkdb::LinkEntry;
+using libjlinkdb::query::TagQuery;
+using std::size_t;
+using std::string;
+
+namespace {
+
+constexpr size_t ENTRY_COUNT = 100000;
+constexpr int OPERATIONS = 20000;
+
+// A LinkDatabase that takes one lock for every call.
+class LockedDatabase {
+public:
+    explicit LockedDatabase(LinkDatabase database)
+        : database_{std::move(database)}
+    {
+    }
+
+    std::shared_ptr<LinkEntry> get_entry(int id)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        return database_.get_entry(id);
+    }
+
+    int add_entry(std::shared_ptr<LinkEntry> entry)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        return database_.add_entry(std::move(entry));
+    }
+
+    size_t search_size(const TagQuery& query)
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        return database_.search(query).size();
+    }
+
+private:
+    std::mutex mutex_;
+    LinkDatabase database_;
+};
+
+// Runs OPERATIONS operations on database from each of threads threads, and
+// returns the operations per millisecond. One operation in 100 is a search
+// and one in 10 an add. The rest look up entries.
+template <typename D, typename Search>
+double
+run(D& database, size_t threads, Search search)
+{
+    TagQuery query{"tag7", {true, false}};
+    double ms = bench::time_ms([&]() {
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i < threads; ++i) {
+            workers.emplace_back([&, i]() {
+                bench::TextGenerator generator{static_cast<unsigned>(i)};
+                for (int j = 0; j < OPERATIONS; ++j) {
+                    if (j % 100 == 0) {
+                        search(database, query);
+                    } else if (j % 10 == 0) {
+                        database.add_entry(generator.entry());
+                    } else {
+                        database.get_entry(
+                            static_cast<int>(generator.below(ENTRY_COUNT)));
+                    }
+                }
+            });
+        }
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    });
+    return threads * OPERATIONS / ms;
+}
+
+}  // namespace
+
+int
+main(int argc, char** argv)
+{
+    size_t max_threads = std::thread::hardware_concurrency();
+    if (argc > 1) {
+        max_threads = std::strtoul(argv[1], nullptr, 10);
+    }
+    if (max_threads == 0) {
+        max_threads = 1;
+    }
+
+    LinkDatabase source{bench::generate_database(ENTRY_COUNT)};
+    source.set_tag_index_enabled(true);
+
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        LockedDatabase locked{source};
+        // Added in order, so the entries get the same ids as in source.
+        ConcurrentLinkDatabase concurrent;
+        concurrent.set_tag_index_enabled(true);
+        for (auto it = source.links_cbegin(); it != source.links_cend();
+             ++it) {
+            concurrent.add_entry(it->second);
+        }
+
+        double locked_rate = run(locked, threads,
+            [](LockedDatabase& database, const TagQuery& query) {
+                return database.search_size(query);
+            });
+        double concurrent_rate = run(concurrent, threads,
+            [](ConcurrentLinkDatabase& database, const TagQuery& query) {
+                return database.search(query).size();
+            });
+
+        string label = std::to_string(threads) + " threads";
+        std::cout << label << ": one mutex " << locked_rate
+                  << " ops/ms, sharded " << concurrent_rate << " ops/ms\n";
+        if (threads < max_threads && threads * 2 > max_threads) {
+            threads = max_threads / 2;
+        }
+    }
+
+    return 0;
+}
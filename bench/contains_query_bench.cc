@@ -0,0 +1,79 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// Compares checking every row of a store against a ContainsQuery term by
+// term to scanning each field once for all of the terms.
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_utils.hh"
+#include "libjlinkdb.hh"
+
+using libjlinkdb::EntryStore;
+using libjlinkdb::query::ContainsQuery;
+using libjlinkdb::query::StringSearchOptions;
+using std::size_t;
+
+namespace {
+
+template <typename Q>
+void
+run(const std::string& name, const Q& query, const EntryStore& store)
+{
+    size_t found = 0;
+    bench::report(name, bench::time_ms([&]() {
+        found = 0;
+        for (size_t row = 0; row < store.rows(); ++row) {
+            found += query.matches_row(store, row) ? 1 : 0;
+        }
+    }));
+    std::cout << "    " << found << " matches\n";
+}
+
+}  // namespace
+
+int
+main()
+{
+    constexpr size_t ENTRY_COUNT = 50000;
+
+    bench::TextGenerator generator;
+    EntryStore store;
+    for (size_t row = 0; row < ENTRY_COUNT; ++row) {
+        store.insert(row, generator.entry());
+    }
+
+    for (size_t terms : {1, 2, 4, 8, 20, 50}) {
+        std::vector<std::string> words;
+        for (size_t i = 0; i < terms; ++i) {
+            words.push_back(generator.word() + generator.word());
+        }
+        ContainsQuery query{words, StringSearchOptions{false, true}};
+        std::string suffix = " (" + std::to_string(terms) + " terms)";
+        run("term by term" + suffix, query.underlying_query(), store);
+        if (query.uses_automaton()) {
+            run("automaton" + suffix, query, store);
+        }
+    }
+    return 0;
+}
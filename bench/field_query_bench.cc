@@ -0,0 +1,124 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// Counts the allocations made while matching field queries against entries,
+// comparing an extractor that returns a copy of the field to the built in
+// extractor, which returns a reference.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include "bench_utils.hh"
+#include "libjlinkdb.hh"
+
+using libjlinkdb::LinkEntry;
+using libjlinkdb::query::DescriptionExtractor;
+using libjlinkdb::query::FieldQuery;
+using std::size_t;
+using std::string;
+
+namespace {
+
+std::atomic<size_t> allocations{0};
+
+// Returns the description of an entry by value, like extractors used to.
+struct CopyingExtractor {
+    string operator()(const LinkEntry& entry) const
+    {
+        return entry.description();
+    }
+};
+
+template <typename Q>
+void
+run(const string& name, const Q& query,
+    const std::vector<std::shared_ptr<LinkEntry>>& entries)
+{
+    size_t found = 0;
+    size_t before = allocations;
+    double ms = bench::time_ms([&]() {
+        found = 0;
+        for (const auto& entry : entries) {
+            found += query.matches(*entry);
+        }
+    });
+    // time_ms runs the loop three times.
+    size_t made = (allocations - before) / 3;
+    bench::report(name, ms);
+    std::cout << "    " << found << " matches, " << made
+              << " allocations per scan\n";
+}
+
+}  // namespace
+
+void*
+operator new(size_t size)
+{
+    ++allocations;
+    void* result = std::malloc(size == 0 ? 1 : size);
+    if (result == nullptr) {
+        throw std::bad_alloc{};
+    }
+    return result;
+}
+
+void
+operator delete(void* pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void
+operator delete(void* pointer, size_t /* size */) noexcept
+{
+    std::free(pointer);
+}
+
+int
+main()
+{
+    constexpr size_t ENTRY_COUNT = 1000000;
+
+    bench::TextGenerator generator;
+    std::vector<std::shared_ptr<LinkEntry>> entries;
+    entries.reserve(ENTRY_COUNT);
+    for (size_t i = 0; i < ENTRY_COUNT; ++i) {
+        auto entry = std::make_shared<LinkEntry>();
+        entry->set_description(generator.sentence(10));
+        entries.push_back(entry);
+    }
+
+    for (bool ignore_case : {false, true}) {
+        libjlinkdb::query::StringSearchOptions options{false, ignore_case};
+        string label = ignore_case ? " (ignore case)" : "";
+        run("copying extractor" + label,
+            FieldQuery<CopyingExtractor>{{}, "quiz", options}, entries);
+        run("DescriptionExtractor" + label,
+            FieldQuery<DescriptionExtractor>{{}, "quiz", options}, entries);
+    }
+
+    return 0;
+}
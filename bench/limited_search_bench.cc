@@ -0,0 +1,66 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// Compares fetching the first page of results of a search to fetching all of
+// them, in order of id and in other orders.
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+#include "bench_utils.hh"
+#include "libjlinkdb.hh"
+
+using libjlinkdb::LinkDatabase;
+using libjlinkdb::LinkEntry;
+using libjlinkdb::SearchOrder;
+using libjlinkdb::query::ContainsQuery;
+using libjlinkdb::query::StringSearchOptions;
+using std::size_t;
+
+int
+main()
+{
+    constexpr size_t ENTRY_COUNT = 100000;
+    constexpr size_t PAGE_SIZE = 20;
+    constexpr int REPEAT = 10;
+
+    LinkDatabase database{bench::generate_database(ENTRY_COUNT)};
+    // Matches most entries, like the first search typed in a user interface.
+    ContainsQuery query{{"e"}, StringSearchOptions{false, true}};
+
+    size_t matches = 0;
+    bench::report("all results", bench::time_ms([&]() {
+        matches = database.search(query).size();
+    }, REPEAT));
+    std::cout << "    " << matches << " matches\n";
+    bench::report("first page by id", bench::time_ms([&]() {
+        database.search(query, PAGE_SIZE);
+    }, REPEAT));
+    bench::report("first page by name", bench::time_ms([&]() {
+        database.search(query, PAGE_SIZE, SearchOrder::NAME);
+    }, REPEAT));
+    bench::report("first page by score", bench::time_ms([&]() {
+        database.search(query, PAGE_SIZE, [](const LinkEntry& entry) {
+            return static_cast<double>(entry.description().size());
+        });
+    }, REPEAT));
+    return 0;
+}
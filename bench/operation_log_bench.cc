@@ -0,0 +1,87 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// Compares making one new entry durable by rewriting the whole database to
+// recording it in the operation log, for databases of growing size, and
+// logging several changes to an entry one at a time to logging them in a
+// batch.
+
+#include <cstddef>
+#include <cstdio>
+#include <string>
+
+#include "bench_utils.hh"
+#include "libjlinkdb.hh"
+
+using libjlinkdb::LinkDatabase;
+using std::size_t;
+using std::string;
+
+int
+main()
+{
+    const string json_path{"operation_log_bench.json"};
+    const string log_path{"operation_log_bench.log"};
+
+    for (size_t count : {1000, 10000, 100000}) {
+        LinkDatabase database{bench::generate_database(count)};
+        bench::TextGenerator generator{7};
+        string label = " (" + std::to_string(count) + " entries)";
+
+        bench::report("add and rewrite file" + label, bench::time_ms([&]() {
+            database.add_entry(generator.entry());
+            database.write_to_file(json_path);
+        }));
+
+        std::remove(log_path.c_str());
+        database.open_log(log_path);
+        bench::report("add and sync log" + label, bench::time_ms([&]() {
+            database.add_entry(generator.entry());
+        }));
+
+        auto entry = database.get_entry(0);
+        bench::report("set 3 fields, syncing each" + label,
+            bench::time_ms([&]() {
+                entry->set_name(generator.sentence(2));
+                entry->set_description(generator.sentence(8));
+                entry->add_tag(generator.word());
+            }));
+        bench::report("set 3 fields in a batch" + label, bench::time_ms([&]() {
+            database.begin_log_batch();
+            entry->set_name(generator.sentence(2));
+            entry->set_description(generator.sentence(8));
+            entry->add_tag(generator.word());
+            database.end_log_batch();
+        }));
+
+        database.set_log_sync_interval(100);
+        bench::report("add 100 and sync log once" + label,
+            bench::time_ms([&]() {
+                for (int i = 0; i < 100; ++i) {
+                    database.add_entry(generator.entry());
+                }
+            }));
+        database.close_log();
+    }
+
+    std::remove(json_path.c_str());
+    std::remove(log_path.c_str());
+    return 0;
+}
@@ -0,0 +1,78 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// Measures how searches over a large database scale with the number of
+// search threads, from one up to the number of hardware threads or the
+// number given as the first argument.
+
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "bench_utils.hh"
+#include "libjlinkdb.hh"
+
+using libjlinkdb::query::ContainsQuery;
+using libjlinkdb::query::StringSearchOptions;
+using std::size_t;
+using std::string;
+
+int
+main(int argc, char** argv)
+{
+    constexpr size_t ENTRY_COUNT = 500000;
+
+    size_t max_threads = std::thread::hardware_concurrency();
+    if (argc > 1) {
+        max_threads = std::strtoul(argv[1], nullptr, 10);
+    }
+    if (max_threads == 0) {
+        max_threads = 1;
+    }
+
+    libjlinkdb::LinkDatabase database{bench::generate_database(ENTRY_COUNT)};
+    ContainsQuery query{{"quiz"}, StringSearchOptions{false, true}};
+
+    size_t expected = database.search(query).size();
+    double single = 0.0;
+    for (size_t threads = 1; threads <= max_threads; threads *= 2) {
+        database.set_search_threads(threads);
+        size_t found = 0;
+        double ms = bench::time_ms(
+            [&]() { found = database.search(query).size(); });
+        if (found != expected) {
+            std::cerr << "results differ with " << threads << " threads\n";
+            return 1;
+        }
+        if (threads == 1) {
+            single = ms;
+        }
+        bench::report(std::to_string(threads) + " threads", ms);
+        std::cout << "    " << found << " matches, speedup: " << single / ms
+                  << "x\n";
+        if (threads < max_threads && threads * 2 > max_threads) {
+            threads = max_threads / 2;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,75 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// Compares repeating a few searches over a database that rarely changes with
+// and without the query cache.
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "bench_utils.hh"
+#include "libjlinkdb.hh"
+
+using libjlinkdb::LinkDatabase;
+using libjlinkdb::query::ContainsQuery;
+using libjlinkdb::query::Query;
+using libjlinkdb::query::TagQuery;
+using std::size_t;
+
+int
+main()
+{
+    constexpr size_t ENTRY_COUNT = 100000;
+    constexpr int REPEAT = 20;
+
+    LinkDatabase database{bench::generate_database(ENTRY_COUNT)};
+    std::vector<std::shared_ptr<Query>> queries{
+        std::make_shared<ContainsQuery>(
+            std::vector<std::string>{"quiz", "abc"},
+            libjlinkdb::query::StringSearchOptions{false, true}),
+        std::make_shared<TagQuery>(
+            "tag7", libjlinkdb::query::StringSearchOptions{true, false}),
+    };
+
+    size_t matches = 0;
+    auto run = [&]() {
+        for (const auto& query : queries) {
+            matches += database.search(*query).size();
+        }
+    };
+    bench::report("searches without cache", bench::time_ms(run, REPEAT));
+
+    database.set_query_cache_capacity(1 << 24);
+    bench::report("searches with cache", bench::time_ms(run, REPEAT));
+
+    // A change between each round of searches is patched into the results.
+    bench::TextGenerator generator;
+    bench::report("searches with cache and changes", bench::time_ms([&]() {
+        database.add_entry(generator.entry());
+        run();
+    }, REPEAT));
+
+    const libjlinkdb::QueryCache* cache = database.query_cache();
+    std::cout << "    " << matches << " matches, " << cache->hits()
+              << " hits, " << cache->misses() << " misses\n";
+    return 0;
+}
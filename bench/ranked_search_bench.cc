@@ -0,0 +1,91 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// Compares ranked searches for the best few entries, which skip rows that
+// can't make it, with ranking every entry that contains a word.
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench_utils.hh"
+#include "libjlinkdb.hh"
+
+using libjlinkdb::LinkDatabase;
+using libjlinkdb::LinkEntry;
+using std::size_t;
+
+int
+main()
+{
+    constexpr size_t ENTRY_COUNT = 200000;
+    constexpr size_t VOCABULARY_SIZE = 20000;
+    constexpr size_t LIMIT = 10;
+    constexpr int REPEAT = 20;
+
+    // Words are drawn so that a few are common and most are rare, as in
+    // real text.
+    bench::TextGenerator generator;
+    std::vector<std::string> vocabulary;
+    for (size_t i = 0; i < VOCABULARY_SIZE; ++i) {
+        vocabulary.push_back(generator.word());
+    }
+    std::mt19937 engine{7};
+    std::uniform_real_distribution<double> uniform{0.0, 1.0};
+    auto text = [&](int words) {
+        std::string result;
+        for (int i = 0; i < words; ++i) {
+            double u = uniform(engine);
+            result += vocabulary[static_cast<size_t>(
+                u * u * u * (VOCABULARY_SIZE - 1))];
+            result += ' ';
+        }
+        return result;
+    };
+    LinkDatabase database;
+    for (size_t i = 0; i < ENTRY_COUNT; ++i) {
+        auto entry = std::make_shared<LinkEntry>();
+        entry->set_name(text(3));
+        entry->set_description(text(12));
+        entry->add_tag(text(1));
+        database.add_entry(entry);
+    }
+
+    bench::report("build index", bench::time_ms([&]() {
+        database.set_text_index_enabled(false);
+        database.set_text_index_enabled(true);
+    }, 1));
+
+    // A common word and a rarer one.
+    std::string search{vocabulary[2] + " " + vocabulary[300]};
+    size_t matches = 0;
+    auto time_search = [&](size_t limit) {
+        return bench::time_ms([&]() {
+            matches = database.ranked_search(search, limit).size();
+        }, REPEAT);
+    };
+    bench::report("rank every match", time_search(ENTRY_COUNT));
+    std::cout << "    " << matches << " matches\n";
+    bench::report("best 10 with pruning", time_search(LIMIT));
+    return 0;
+}
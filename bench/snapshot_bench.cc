@@ -0,0 +1,90 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// Compares opening a database saved as JSON to opening a binary snapshot of
+// it, to reading every field of the snapshot straight from the mapping, and
+// to searching a database that reads from the mapping.
+
+#include <cstddef>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+#include "bench_utils.hh"
+#include "libjlinkdb.hh"
+
+using libjlinkdb::LinkDatabase;
+using libjlinkdb::Snapshot;
+using libjlinkdb::query::TagQuery;
+using std::size_t;
+using std::string;
+
+int
+main()
+{
+    constexpr size_t ENTRY_COUNT = 200000;
+    const string json_path{"snapshot_bench.json"};
+    const string snapshot_path{"snapshot_bench.bin"};
+
+    {
+        LinkDatabase database{bench::generate_database(ENTRY_COUNT)};
+        database.write_to_file(json_path);
+        database.write_snapshot_to_file(snapshot_path);
+    }
+
+    size_t loaded = 0;
+    bench::report("load JSON", bench::time_ms([&]() {
+        loaded = LinkDatabase{json_path}.links_count();
+    }));
+    bench::report("open snapshot", bench::time_ms([&]() {
+        loaded = Snapshot{snapshot_path}.size();
+    }));
+
+    size_t chars = 0;
+    bench::report("open snapshot and read every field", bench::time_ms([&]() {
+        Snapshot snapshot{snapshot_path};
+        chars = 0;
+        for (int id = 0; id < snapshot.next_id(); ++id) {
+            chars += snapshot.location(id).size() + snapshot.name(id).size()
+                + snapshot.description(id).size();
+            for (size_t j = 0; j < snapshot.tags_count(id); ++j) {
+                chars += snapshot.tag(id, j).size();
+            }
+            for (size_t j = 0; j < snapshot.attributes_count(id); ++j) {
+                chars += snapshot.attribute_value(id, j).size();
+            }
+        }
+    }));
+    bench::report("load database from snapshot", bench::time_ms([&]() {
+        loaded = LinkDatabase{Snapshot{snapshot_path}}.links_count();
+    }));
+    size_t matches = 0;
+    bench::report("load database from snapshot and search it",
+        bench::time_ms([&]() {
+            LinkDatabase database{Snapshot{snapshot_path}};
+            matches = database.count(TagQuery{"tag7", {true, false}});
+        }));
+    std::cout << "    " << loaded << " entries, " << chars
+              << " characters read, " << matches << " matches\n";
+
+    std::remove(json_path.c_str());
+    std::remove(snapshot_path.c_str());
+    return 0;
+}
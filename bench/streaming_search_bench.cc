@@ -0,0 +1,89 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// Compares counting the matches of a search and forwarding their ids by
+// collecting the results to doing it through search_each and count, and
+// counting the matches of an indexed search with and without a kept plan.
+
+#include <cstddef>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "bench_utils.hh"
+#include "libjlinkdb.hh"
+
+using libjlinkdb::LinkDatabase;
+using libjlinkdb::LinkEntry;
+using libjlinkdb::query::TagQuery;
+using std::size_t;
+
+int
+main()
+{
+    constexpr size_t ENTRY_COUNT = 200000;
+    constexpr int REPEAT = 10;
+
+    LinkDatabase database{bench::generate_database(ENTRY_COUNT)};
+    // Matches most entries.
+    TagQuery query{
+        "tag1", libjlinkdb::query::StringSearchOptions{false, true}};
+
+    size_t matches = 0;
+    bench::report("count with search", bench::time_ms([&]() {
+        matches = database.search(query).size();
+    }, REPEAT));
+    std::cout << "    " << matches << " matches\n";
+    bench::report("count", bench::time_ms([&]() {
+        matches = database.count(query);
+    }, REPEAT));
+
+    std::vector<int> ids;
+    ids.reserve(ENTRY_COUNT);
+    bench::report("ids with search", bench::time_ms([&]() {
+        ids.clear();
+        for (const auto& match : database.search(query)) {
+            ids.push_back(match.first);
+        }
+    }, REPEAT));
+    bench::report("ids with search_each", bench::time_ms([&]() {
+        ids.clear();
+        database.search_each(query, [&](int id, const LinkEntry&) {
+            ids.push_back(id);
+            return true;
+        });
+    }, REPEAT));
+
+    // Both tags are in the index, so planning the query is a large part of
+    // the cost.
+    database.set_tag_index_enabled(true);
+    libjlinkdb::query::StringSearchOptions exact{true, false};
+    libjlinkdb::query::And indexed{std::make_shared<TagQuery>("tag7", exact),
+        std::make_shared<TagQuery>("tag8", exact)};
+    bench::report("count indexed", bench::time_ms([&]() {
+        matches = database.count(indexed);
+    }, 1000 * REPEAT));
+    std::cout << "    " << matches << " matches\n";
+    auto plan = database.plan(indexed);
+    bench::report("count indexed with a kept plan", bench::time_ms([&]() {
+        matches = database.count(plan);
+    }, 1000 * REPEAT));
+    return 0;
+}
@@ -0,0 +1,116 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// Compares the string search used by queries against copying and lowering
+// both strings for every comparison, which is what search_string used to do.
+
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "bench_utils.hh"
+#include "libjlinkdb.hh"
+
+using libjlinkdb::StringMatcher;
+using libjlinkdb::query::StringSearchOptions;
+using std::size_t;
+using std::string;
+using std::vector;
+
+namespace {
+
+bool
+copying_search(const string& str, const string& target,
+    const StringSearchOptions& options)
+{
+    string str_copy{str};
+    string target_copy{target};
+    if (options.ignore_case) {
+        std::transform(str_copy.begin(), str_copy.end(), str_copy.begin(),
+            [](unsigned char c) { return std::tolower(c); });
+        std::transform(target_copy.begin(), target_copy.end(),
+            target_copy.begin(),
+            [](unsigned char c) { return std::tolower(c); });
+    }
+
+    if (options.match_full_string) {
+        return str_copy == target_copy;
+    }
+    return str_copy.find(target_copy) != string::npos;
+}
+
+}  // namespace
+
+int
+main()
+{
+    constexpr size_t STRING_COUNT = 200000;
+
+    bench::TextGenerator generator;
+    vector<string> strings;
+    for (size_t i = 0; i < STRING_COUNT; ++i) {
+        strings.push_back(generator.sentence(10));
+    }
+    const string target{"Quiz"};
+
+    for (bool ignore_case : {false, true}) {
+        for (bool full : {false, true}) {
+            StringSearchOptions options{full, ignore_case};
+            string label = string{full ? "full string" : "substring"}
+                + (ignore_case ? ", ignore case" : "");
+            size_t expected = 0;
+            size_t found = 0;
+
+            double copying = bench::time_ms([&]() {
+                expected = 0;
+                for (const auto& str : strings) {
+                    expected += copying_search(str, target, options);
+                }
+            });
+            double search = bench::time_ms([&]() {
+                found = 0;
+                for (const auto& str : strings) {
+                    found += libjlinkdb::search_string(str, target, options);
+                }
+            });
+            StringMatcher matcher{target, options};
+            double matching = bench::time_ms([&]() {
+                found = 0;
+                for (const auto& str : strings) {
+                    found += matcher.matches(str);
+                }
+            });
+
+            if (found != expected) {
+                std::cerr << "results differ for " << label << "\n";
+                return 1;
+            }
+            bench::report("copy and lower (" + label + ")", copying);
+            bench::report("search_string (" + label + ")", search);
+            bench::report("StringMatcher (" + label + ")", matching);
+            std::cout << "speedup: " << copying / matching << "x\n\n";
+        }
+    }
+
+    return 0;
+}
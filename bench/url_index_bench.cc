@@ -0,0 +1,68 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+// Compares finding the links on one host and under one path with and without
+// the index of locations.
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+
+#include "bench_utils.hh"
+#include "libjlinkdb.hh"
+
+using libjlinkdb::LinkDatabase;
+using libjlinkdb::UrlParts;
+using libjlinkdb::query::HostQuery;
+using libjlinkdb::query::LocationPrefixQuery;
+using libjlinkdb::query::Query;
+using std::size_t;
+
+int
+main()
+{
+    constexpr size_t ENTRY_COUNT = 200000;
+    constexpr int REPEAT = 10;
+
+    LinkDatabase database{bench::generate_database(ENTRY_COUNT)};
+    // Search for the host and the first path segment of an existing link.
+    std::string location{database.get_entry(1234)->location()};
+    UrlParts parts;
+    libjlinkdb::split_url(location, parts);
+    std::string host{parts.host.str()};
+    std::string prefix{location.substr(0, location.rfind('/') + 1)};
+    HostQuery host_query{host};
+    LocationPrefixQuery prefix_query{prefix};
+
+    size_t matches = 0;
+    auto time_count = [&](const Query& query) {
+        return bench::time_ms(
+            [&]() { matches = database.count(query); }, REPEAT);
+    };
+    bench::report("host without index", time_count(host_query));
+    std::cout << "    " << matches << " matches\n";
+    bench::report("prefix without index", time_count(prefix_query));
+    std::cout << "    " << matches << " matches\n";
+
+    database.set_url_index_enabled(true);
+    bench::report("host with index", time_count(host_query));
+    bench::report("prefix with index", time_count(prefix_query));
+    return 0;
+}
@@ -0,0 +1,65 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_ATTRIBUTE_INDEX_HH_
+#define LIBJLINKDB_ATTRIBUTE_INDEX_HH_
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+#include "entry_store.hh"
+#include "row_bitmap.hh"
+
+namespace libjlinkdb {
+
+// An index from each attribute name and value to the bitmap of rows whose
+// entries have an attribute with that name and value. Values are
+// indexed both as they are and converted to lower case. Names are always
+// compared exactly.
+class AttributeIndex {
+public:
+    // Indexes the attributes of the entry in row of store.
+    void add(const EntryStore& store, std::size_t row);
+    // Removes the attributes of the entry in row of store from the index.
+    // The store must still hold the attributes that were added.
+    void remove(const EntryStore& store, std::size_t row);
+
+    // Returns the rows of the entries that have an attribute called name
+    // whose value is equal to value. If ignore_case is true, values are
+    // compared ignoring case.
+    const RowBitmap& find(const std::string& name,
+        const std::string& value, bool ignore_case) const;
+
+private:
+    using PostingMap = std::unordered_map<std::string, RowBitmap>;
+    // The postings of each value, for each attribute name.
+    using AttributeMap = std::unordered_map<std::string, PostingMap>;
+
+    static void remove_posting(AttributeMap& attributes,
+        const std::string& name, const std::string& value, std::size_t row);
+
+    AttributeMap exact_;
+    AttributeMap folded_;
+};
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_ATTRIBUTE_INDEX_HH_
@@ -0,0 +1,142 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_CONCURRENT_LINK_DATABASE_HH_
+#define LIBJLINKDB_CONCURRENT_LINK_DATABASE_HH_
+
+#include <sigc++/sigc++.h>
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "link_database.hh"
+#include "link_entry.hh"
+#include "query/query.hh"
+#include "read_write_lock.hh"
+#include "sorted_attribute_index.hh"
+
+namespace libjlinkdb {
+
+// A database of links that many threads can use at once. The ids are split
+// among shards, each a LinkDatabase behind its own ReadWriteLock, so that
+// searches and lookups run side by side and only wait for changes to the
+// same shard. The entry with id i is kept in shard i % shards().
+//
+// Every call sees each shard either before or after a concurrent change to
+// it, but a search may see a change to one shard and not a change made
+// later to another.
+//
+// The entries handed out are shared with the database and other threads,
+// so they must not be changed. To change an entry, change a copy and pass
+// it to replace_entry.
+//
+// Slots should be connected to the signals before the database is shared
+// between threads. The signals are emitted after the change is made, with
+// no shard locked and one at a time, so slots may call back into the
+// database.
+class ConcurrentLinkDatabase {
+public:
+    // Constructs an empty database with the given number of shards. Zero
+    // uses a shard for each hardware thread.
+    explicit ConcurrentLinkDatabase(std::size_t shards = 0);
+
+    ConcurrentLinkDatabase(const ConcurrentLinkDatabase& other) = delete;
+    ConcurrentLinkDatabase& operator=(
+        const ConcurrentLinkDatabase& other) = delete;
+
+    // Returns the number of shards.
+    std::size_t shards() const;
+
+    // Returns the number of links in the database.
+    std::size_t links_count() const;
+    // Returns whether there exists a link entry with the given id.
+    bool has_entry(int id) const;
+    // Returns the entry with the given id if it exists, and a null pointer
+    // otherwise.
+    std::shared_ptr<LinkEntry> get_entry(int id) const;
+    // Returns the new id.
+    int add_entry(std::shared_ptr<LinkEntry> entry);
+    // Deletes the entry with the given id.
+    void delete_entry(int id);
+    // Replaces the entry with the given id, if it exists, with entry, which
+    // must not be null.
+    void replace_entry(int id, std::shared_ptr<LinkEntry> entry);
+
+    // Returns the collection of entries in the database that match query, in
+    // order of id.
+    std::vector<std::pair<int, std::shared_ptr<LinkEntry>>> search(
+        const query::Query& query) const;
+
+    // Enables or disables the index of entries by tag in every shard.
+    void set_tag_index_enabled(bool enabled);
+    // Enables or disables the index of entries by attribute in every shard.
+    void set_attribute_index_enabled(bool enabled);
+    // Keeps the values of the attribute called name in order in every
+    // shard. See LinkDatabase::add_sorted_attribute_index.
+    void add_sorted_attribute_index(
+        const std::string& name, AttributeOrder order);
+    // Stops keeping the values of the attribute called name in order in
+    // every shard.
+    void remove_sorted_attribute_index(const std::string& name);
+    // Enables or disables the index of locations in every shard.
+    void set_url_index_enabled(bool enabled);
+    // Enables or disables the index of words in every shard.
+    void set_text_index_enabled(bool enabled);
+    // Enables or disables the index of trigrams in every shard.
+    void set_trigram_index_enabled(bool enabled);
+
+    // Signal emitted whenever a link is added to the database.
+    sigc::signal<void, int>& signal_entry_added();
+    // Signal emitted whenever a link is deleted from the database.
+    sigc::signal<void, int>& signal_entry_deleted();
+    // Signal emitted whenever a link in the database is replaced.
+    sigc::signal<void, int>& signal_entry_changed();
+
+private:
+    struct Shard {
+        mutable ReadWriteLock lock;
+        LinkDatabase database;
+    };
+
+    // Returns the shard holding id, or null if it can't hold id.
+    Shard* shard_of(int id) const;
+    // Returns the id within its shard of id.
+    int local_id(int id) const;
+    // Emits signal with id, one signal at a time.
+    void emit(sigc::signal<void, int>& signal, int id);
+
+    std::vector<std::unique_ptr<Shard>> shards_;
+    // The shard the next entry is added to, before taking the remainder.
+    std::atomic<std::size_t> next_shard_{0};
+
+    std::recursive_mutex signals_mutex_;
+    sigc::signal<void, int> entry_added_;
+    sigc::signal<void, int> entry_deleted_;
+    sigc::signal<void, int> entry_changed_;
+};
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_CONCURRENT_LINK_DATABASE_HH_
@@ -0,0 +1,110 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_DATABASE_VERSION_HH_
+#define LIBJLINKDB_DATABASE_VERSION_HH_
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "entry_store.hh"
+#include "link_entry.hh"
+#include "query/query.hh"
+
+namespace libjlinkdb {
+
+// The number of rows in each chunk of a DatabaseVersion.
+constexpr std::size_t VERSION_CHUNK_ROWS = 1024;
+
+// An immutable view of the entries of a database at one point in time. Any
+// number of threads may read a version at once, with no locking, while the
+// database goes on changing.
+//
+// A version holds its own copy of the fields of the entries, in columns
+// split into chunks of rows. Each chunk is an EntryStore that is shared
+// with later versions until a row in it changes, so taking a new version
+// only copies the rows that changed and one pointer for each chunk.
+class DatabaseVersion {
+public:
+    using Entry = std::shared_ptr<const LinkEntry>;
+
+    DatabaseVersion(const DatabaseVersion& other) = delete;
+    DatabaseVersion& operator=(const DatabaseVersion& other) = delete;
+
+    // Returns the number of links in the version.
+    std::size_t links_count() const;
+    // Returns whether there exists a link entry with the given id.
+    bool has_entry(int id) const;
+    // Returns the entry with the given id if it exists, and a null pointer
+    // otherwise. The entry is built from the columns of the version.
+    Entry get_entry(int id) const;
+
+    // Returns the entries that match query, in order of id. The query is
+    // compiled once and checked against the columns of each chunk, as a
+    // search of the database does when no index applies.
+    std::vector<std::pair<int, Entry>> search(const query::Query& query) const;
+
+private:
+    friend class VersionBuilder;
+
+    DatabaseVersion() = default;
+
+    std::vector<std::shared_ptr<const EntryStore>> chunks_;
+    std::size_t size_ = 0;
+};
+
+// Keeps the rows of the next DatabaseVersion of a database. Changes are only
+// marked as they happen, and the rows marked are copied from the store of
+// the database when the next version is built, so changing an entry many
+// times between versions copies it once. Chunks that have been handed to a
+// version are copied before a row in them is changed, even if every version
+// holding them has since been dropped. Telling that from the use count of
+// the chunk would race with a reader on another thread dropping its
+// version, since the count isn't read with acquire ordering.
+class VersionBuilder {
+public:
+    // Marks row as changed since the last version.
+    void mark(std::size_t row);
+
+    // Returns a version holding the rows of store as they are now, copying
+    // the rows marked since the last version. Returns the last version
+    // built if no row has been marked since.
+    std::shared_ptr<const DatabaseVersion> build(const EntryStore& store);
+
+private:
+    // Copies row of store into its chunk.
+    void copy_row(const EntryStore& store, std::size_t row);
+
+    std::vector<std::shared_ptr<EntryStore>> chunks_;
+    // Whether each chunk has been handed to a version since it was copied.
+    std::vector<bool> published_;
+    // The rows marked since the last version, each once.
+    std::vector<std::size_t> marked_rows_;
+    // Whether each row is in marked_rows_.
+    std::vector<bool> marked_;
+    std::size_t size_ = 0;
+    std::shared_ptr<const DatabaseVersion> last_;
+};
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_DATABASE_VERSION_HH_
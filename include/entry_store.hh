@@ -0,0 +1,341 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_ENTRY_STORE_HH_
+#define LIBJLINKDB_ENTRY_STORE_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "link_entry.hh"
+#include "string_ref.hh"
+
+namespace libjlinkdb {
+
+class Snapshot;
+
+// A column holding a list of strings for each row. The characters of every
+// string in the column live in one contiguous buffer, so reading the column
+// row by row walks memory sequentially.
+//
+// The first rows of a column may be mapped: read in place from tables that
+// live elsewhere, such as in a snapshot mapped into memory, which are never
+// written. Rows that are assigned or cleared afterwards are kept in the
+// column's own buffers instead, so a mapped column costs nothing until it
+// is changed, and then only for the rows that change.
+class StringColumn {
+public:
+    // A string in a buffer of characters.
+    struct Slice {
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+
+    // The strings of a row in a table of slices.
+    struct Range {
+        std::uint64_t first;
+        std::uint64_t count;
+    };
+
+    // Returns the number of rows in the column.
+    std::size_t rows() const;
+    // Sets the number of rows in the column, which can't be fewer than the
+    // mapped rows. New rows hold no strings.
+    void resize(std::size_t rows);
+    // Makes room for the given numbers of rows and strings without
+    // reallocating.
+    void reserve(std::size_t rows, std::size_t strings);
+    // Reads the first rows rows of the column, which must be empty, from the
+    // given tables. The strings of each row are given by the range of the
+    // row in ranges, which index into slices, which index into chars. If
+    // ranges is null, each row holds the one string at the same index in
+    // slices. The tables must outlive the column and its copies.
+    void map(const char* chars, std::uint64_t chars_size,
+        const Slice* slices, std::uint64_t slices_size, const Range* ranges,
+        std::size_t rows);
+
+    // Returns the number of strings stored in row.
+    std::size_t count(std::size_t row) const;
+    // Returns the string at index in row. If the row holds no strings and
+    // index is zero, returns the empty string. Throws a JLinkDbError if a
+    // mapped row refers to data outside of its tables.
+    StringRef get(std::size_t row, std::size_t index = 0) const;
+
+    // Replaces the strings stored in row with values.
+    void assign(std::size_t row, const std::vector<StringRef>& values);
+    // Removes all strings stored in row.
+    void clear(std::size_t row);
+
+private:
+    // Returns whether row is read from the mapped tables.
+    bool is_mapped(std::size_t row) const;
+    // Returns the range of a mapped row.
+    Range mapped_range(std::size_t row) const;
+    // Returns the range of a row kept in the column's own buffers, adding
+    // one for a mapped row if it doesn't have one yet.
+    Range& own_range(std::size_t row);
+    // Returns the range of a row kept in the column's own buffers.
+    const Range& own_range(std::size_t row) const;
+    // Discards the unreferenced parts of the buffers once they make up most
+    // of the column.
+    void maybe_compact();
+
+    std::vector<char> chars_;
+    std::vector<Slice> slices_;
+    // The ranges of the rows after the mapped ones.
+    std::vector<Range> ranges_;
+    std::size_t garbage_chars_ = 0;
+    std::size_t garbage_slices_ = 0;
+
+    const char* mapped_chars_ = nullptr;
+    std::uint64_t mapped_chars_size_ = 0;
+    const Slice* mapped_slices_ = nullptr;
+    std::uint64_t mapped_slices_size_ = 0;
+    const Range* mapped_ranges_ = nullptr;
+    std::size_t mapped_rows_ = 0;
+    // Whether each mapped row has since been kept in the column's own
+    // buffers, which is empty until the first one is.
+    std::vector<bool> overridden_;
+    // The ranges of the mapped rows that have been overridden.
+    std::unordered_map<std::size_t, Range> overrides_;
+};
+
+// Storage for the entries of a LinkDatabase. Each id is the offset of a row,
+// and the fields of the entries are kept in columns so that scanning one
+// field of every entry is a linear pass over memory.
+//
+// The columns are the only copy of the fields. A LinkEntry is only built
+// when one is asked for, and the store keeps track of it without owning it
+// for as long as someone else holds it, so that asking for the same row
+// again gives the same entry. Once nobody holds it, the entry is gone, and
+// the next one asked for is built afresh. While a change handler is set,
+// each entry handed out is listened to, and the handler is called with its
+// row whenever it changes, so that the owner of the store can call update.
+//
+// A store opened from a Snapshot reads the fields and the offset tables
+// in place from its mapping, so opening one takes the same time however
+// many entries it holds. Rows are only copied out of the mapping once they
+// change.
+//
+// entry may be called from several threads at once. Everything else needs
+// the store to itself.
+class EntryStore {
+public:
+    using value_type = std::pair<int, std::shared_ptr<LinkEntry>>;
+
+    // Iterates over the occupied rows of a store in order of id. The entry
+    // of a row is only built when the iterator is read, and is held by the
+    // iterator until it moves on.
+    class const_iterator {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = EntryStore::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        const_iterator() = default;
+
+        reference operator*() const;
+        pointer operator->() const;
+        const_iterator& operator++();
+        const_iterator operator++(int);
+
+        bool operator==(const const_iterator& other) const;
+        bool operator!=(const const_iterator& other) const;
+
+    private:
+        friend class EntryStore;
+
+        const_iterator(const EntryStore* store, std::size_t row);
+
+        // Advances to the next occupied row, if the current one is empty.
+        void skip_empty();
+
+        const EntryStore* store_ = nullptr;
+        std::size_t row_ = 0;
+        // The row and its entry, once the iterator has been read.
+        mutable value_type current_;
+    };
+
+    EntryStore();
+    // Reads the entries of snapshot in place, with the same ids. The mapping
+    // is kept for as long as the store or a copy of it reads from it, so the
+    // snapshot itself may go away first.
+    explicit EntryStore(const Snapshot& snapshot);
+    // Copies the fields of other. The entries of other that are held are
+    // shared with the copy, so once the copy has a change handler, changes
+    // to them reach both stores. The change handler isn't copied.
+    EntryStore(const EntryStore& other);
+    // Takes the fields and held entries of other. The change handler isn't
+    // moved.
+    EntryStore(EntryStore&& other);
+
+    // Assigning keeps the change handler of the store assigned to.
+    EntryStore& operator=(const EntryStore& other);
+    EntryStore& operator=(EntryStore&& other);
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    // Returns the number of rows, which is one more than the highest id ever
+    // stored.
+    std::size_t rows() const;
+    // Returns the number of occupied rows.
+    std::size_t size() const;
+    // Returns whether row holds an entry.
+    bool has_row(std::size_t row) const;
+    // Returns the entry in row, or a null pointer if the row is empty. If
+    // nobody holds the entry of the row, a new one is built from the
+    // columns. Throws a JLinkDbError if the location in the row isn't a
+    // valid URL.
+    std::shared_ptr<LinkEntry> entry(std::size_t row) const;
+
+    // Sets the function called with the row of a held entry whenever it
+    // changes. An empty function stops listening to the entries.
+    void set_change_handler(std::function<void(std::size_t)> handler);
+
+    // Makes room for the given number of rows without reallocating.
+    void reserve(std::size_t rows);
+    // Stores the fields of entry in row, growing the store if needed, and
+    // keeps track of entry as the entry of the row. If entry is null, the
+    // row holds an empty entry.
+    void insert(std::size_t row, const std::shared_ptr<LinkEntry>& entry);
+    // Stores the fields of entry in row, growing the store if needed,
+    // without keeping track of entry.
+    void insert(std::size_t row, const LinkEntry& entry);
+    // Stores the fields of the entry in other_row of other in row, growing
+    // the store if needed, without building the entry.
+    void insert(
+        std::size_t row, const EntryStore& other, std::size_t other_row);
+    // Empties row.
+    void erase(std::size_t row);
+    // Refreshes the columns of row from its held entry, if there is one.
+    void update(std::size_t row);
+    // Stops keeping track of the entry of row, so that later changes to it
+    // don't reach the store.
+    void release(std::size_t row);
+
+    // Change one field of the entry in row, which must be occupied, in the
+    // columns. The held entry of the row, if there is one, is released
+    // first, since it no longer matches the row, and it isn't told about
+    // the change.
+    void set_location(std::size_t row, const std::string& location);
+    void set_name(std::size_t row, const std::string& name);
+    void set_description(std::size_t row, const std::string& description);
+    void add_tag(std::size_t row, const std::string& tag);
+    void remove_tag(std::size_t row, const std::string& tag);
+    void set_attribute(std::size_t row, const std::string& attribute,
+        const std::string& value);
+    void remove_attribute(std::size_t row, const std::string& attribute);
+
+    // Returns the location of the entry in row.
+    StringRef location(std::size_t row) const;
+    // Returns the name of the entry in row.
+    StringRef name(std::size_t row) const;
+    // Returns the description of the entry in row.
+    StringRef description(std::size_t row) const;
+
+    // Returns the number of tags of the entry in row.
+    std::size_t tags_count(std::size_t row) const;
+    // Returns the tag at index of the entry in row.
+    StringRef tag(std::size_t row, std::size_t index) const;
+
+    // Returns the number of attributes of the entry in row.
+    std::size_t attributes_count(std::size_t row) const;
+    // Returns the name of the attribute at index of the entry in row.
+    StringRef attribute_name(std::size_t row, std::size_t index) const;
+    // Returns the value of the attribute at index of the entry in row.
+    StringRef attribute_value(std::size_t row, std::size_t index) const;
+
+private:
+    // An entry that was handed out, which the store doesn't own.
+    struct HeldEntry {
+        std::weak_ptr<LinkEntry> entry;
+        // Told apart from earlier entries of the same row, so that a slot
+        // connected to an entry that was since released does nothing.
+        std::uint64_t generation;
+    };
+
+    // Returns the held entry of row, or a null pointer if nobody holds it.
+    // held_mutex_ must be locked.
+    std::shared_ptr<LinkEntry> find_held(std::size_t row) const;
+    // Keeps track of entry as the entry of row, and listens to it if there
+    // is a change handler. held_mutex_ must be locked.
+    void hold(std::size_t row, const std::shared_ptr<LinkEntry>& entry) const;
+    // Listens to the held entry of row under generation.
+    void connect(std::size_t row, LinkEntry& entry,
+        std::uint64_t generation) const;
+    // Listens again to every held entry, under new generations.
+    void connect_held();
+    // Calls the change handler if generation is still the one the entry of
+    // row is held under.
+    void on_entry_changed(std::size_t row, std::uint64_t generation) const;
+    // Builds a new entry from the columns of row.
+    std::shared_ptr<LinkEntry> build_entry(std::size_t row) const;
+    // Replaces the fields of row with those of entry.
+    void assign(std::size_t row, const LinkEntry& entry);
+    // Grows the store to at least the given number of rows.
+    void grow(std::size_t rows);
+    // Marks row as occupied or empty.
+    void set_present(std::size_t row, bool present);
+
+    // A bit for each row telling whether it holds an entry. The bits are
+    // read from the mapping, if there is one, until a row is added or
+    // erased.
+    std::vector<std::uint64_t> present_;
+    const std::uint64_t* mapped_present_ = nullptr;
+    std::size_t rows_ = 0;
+    std::size_t size_ = 0;
+
+    StringColumn locations_;
+    StringColumn names_;
+    StringColumn descriptions_;
+    StringColumn tags_;
+    // Holds the name and value of each attribute next to each other.
+    StringColumn attributes_;
+
+    // The entries handed out, by row. Entries nobody holds any more are
+    // cleared out whenever the map doubles in size.
+    mutable std::unordered_map<std::size_t, HeldEntry> held_;
+    mutable std::mutex held_mutex_;
+    mutable std::size_t sweep_size_;
+    mutable std::uint64_t next_generation_ = 0;
+    std::function<void(std::size_t)> change_handler_;
+    // Points at the store for as long as it lives. The slots connected to
+    // held entries only refer to the store through it, so that entries that
+    // outlive the store don't call into it.
+    std::shared_ptr<const EntryStore*> self_;
+    // Keeps the mapping of the snapshot the store reads from alive, if
+    // there is one.
+    std::shared_ptr<const void> mapping_;
+};
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_ENTRY_STORE_HH_
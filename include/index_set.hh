@@ -0,0 +1,118 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_INDEX_SET_HH_
+#define LIBJLINKDB_INDEX_SET_HH_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "attribute_index.hh"
+#include "entry_store.hh"
+#include "row_set.hh"
+#include "sorted_attribute_index.hh"
+#include "tag_index.hh"
+#include "text_index.hh"
+#include "trigram_index.hh"
+#include "url_index.hh"
+
+namespace libjlinkdb {
+
+// The optional secondary indexes of a database. Each index is absent until
+// it is enabled. Copying an IndexSet copies every enabled index.
+class IndexSet {
+public:
+    IndexSet() = default;
+    IndexSet(const IndexSet& other);
+    IndexSet(IndexSet&& other) = default;
+
+    IndexSet& operator=(const IndexSet& other);
+    IndexSet& operator=(IndexSet&& other) = default;
+
+    // Returns the index of entries by tag, or a null pointer if it isn't
+    // enabled.
+    const TagIndex* tag_index() const;
+    // Builds the index of entries by tag from the entries in store.
+    void enable_tag_index(const EntryStore& store);
+    // Discards the index of entries by tag.
+    void disable_tag_index();
+
+    // Returns the index of entries by attribute, or a null pointer if it
+    // isn't enabled.
+    const AttributeIndex* attribute_index() const;
+    // Builds the index of entries by attribute from the entries in store.
+    void enable_attribute_index(const EntryStore& store);
+    // Discards the index of entries by attribute.
+    void disable_attribute_index();
+
+    // Returns the index of attributes kept in order, or a null pointer if no
+    // attribute is.
+    const SortedAttributeIndex* sorted_attribute_index() const;
+    // Starts keeping the values of the attribute called name in order, from
+    // the entries in store.
+    void enable_sorted_attribute(const EntryStore& store,
+        const std::string& name, AttributeOrder order);
+    // Stops keeping the values of the attribute called name in order.
+    void disable_sorted_attribute(const std::string& name);
+
+    // Returns the index of locations by host, domain and path, or a null
+    // pointer if it isn't enabled.
+    const UrlIndex* url_index() const;
+    // Builds the index of locations from the entries in store.
+    void enable_url_index(const EntryStore& store);
+    // Discards the index of locations.
+    void disable_url_index();
+
+    // Returns the index of words for ranked searches, or a null pointer if
+    // it isn't enabled.
+    const TextIndex* text_index() const;
+    // Builds the index of words from the entries in store.
+    void enable_text_index(const EntryStore& store);
+    // Discards the index of words.
+    void disable_text_index();
+
+    // Returns the index of trigrams in the text fields of entries, or a null
+    // pointer if it isn't enabled.
+    const TrigramIndex* trigram_index() const;
+    // Builds the index of trigrams from the entries in store.
+    void enable_trigram_index(const EntryStore& store);
+    // Discards the index of trigrams.
+    void disable_trigram_index();
+
+    // Adds the entry in row of store to every enabled index.
+    void add(const EntryStore& store, std::size_t row);
+    // Removes the entry in row of store from every enabled index. The store
+    // must still hold the fields that were added.
+    void remove(const EntryStore& store, std::size_t row);
+
+private:
+    std::unique_ptr<TagIndex> tag_index_;
+    std::unique_ptr<AttributeIndex> attribute_index_;
+    std::unique_ptr<SortedAttributeIndex> sorted_attribute_index_;
+    std::unique_ptr<UrlIndex> url_index_;
+    std::unique_ptr<TextIndex> text_index_;
+    std::unique_ptr<TrigramIndex> trigram_index_;
+};
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_INDEX_SET_HH_
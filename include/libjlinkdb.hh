@@ -21,23 +21,49 @@
 #ifndef JLINKDB_JLINKDB_HH_
 #define JLINKDB_JLINKDB_HH_
 
+#include "attribute_index.hh"
+#include "concurrent_link_database.hh"
+#include "database_version.hh"
+#include "entry_store.hh"
+#include "index_set.hh"
 #include "jlinkdb_error.hh"
 #include "link_database.hh"
 #include "link_entry.hh"
+#include "multi_string_matcher.hh"
+#include "operation_log.hh"
 #include "query/and.hh"
 #include "query/and_collection.hh"
 #include "query/attribute_contains_query.hh"
+#include "query/attribute_prefix_query.hh"
 #include "query/attribute_query.hh"
+#include "query/attribute_range_query.hh"
+#include "query/compiled_query.hh"
 #include "query/contains_query.hh"
 #include "query/description_extractor.hh"
 #include "query/field_query.hh"
+#include "query/host_query.hh"
 #include "query/location_extractor.hh"
+#include "query/location_prefix_query.hh"
 #include "query/name_extractor.hh"
 #include "query/or.hh"
 #include "query/or_collection.hh"
 #include "query/query.hh"
+#include "query/query_plan.hh"
 #include "query/string_search_options.hh"
 #include "query/tag_query.hh"
+#include "query_cache.hh"
+#include "read_write_lock.hh"
+#include "row_bitmap.hh"
+#include "row_set.hh"
+#include "snapshot.hh"
+#include "sorted_attribute_index.hh"
+#include "string_ref.hh"
 #include "string_utils.hh"
+#include "tag_index.hh"
+#include "text_index.hh"
+#include "thread_pool.hh"
+#include "trigram_index.hh"
+#include "url_index.hh"
+#include "url_parts.hh"
 
 #endif  // JLINKDB_JLINKDB_HH_
@@ -24,28 +24,69 @@
 #include <sigc++/sigc++.h>
 
 #include <cstddef>
+#include <functional>
 #include <iostream>
 #include <istream>
 #include <memory>
 #include <string>
-#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include <nlohmann/json.hpp>
 
+#include "database_version.hh"
+#include "entry_store.hh"
+#include "index_set.hh"
 #include "link_entry.hh"
+#include "operation_log.hh"
 #include "query/query.hh"
+#include "query/query_plan.hh"
+#include "query_cache.hh"
+#include "snapshot.hh"
+#include "sorted_attribute_index.hh"
+#include "text_index.hh"
+#include "thread_pool.hh"
 
 namespace libjlinkdb {
 
-// A database of links.
+// The default smallest number of rows a search checks before it is split
+// among threads.
+constexpr std::size_t DEFAULT_PARALLEL_SEARCH_THRESHOLD = 16384;
+
+// The orders a limited search can return its results in. Ties are broken by
+// id.
+enum class SearchOrder {
+    // In order of id, the same as an unlimited search.
+    ID,
+    // In order of name.
+    NAME,
+    // In order of location.
+    LOCATION
+};
+
+// An entry found by a ranked search, with its id and score.
+struct RankedEntry {
+    int id;
+    double score;
+    std::shared_ptr<LinkEntry> entry;
+};
+
+// A database of links. The fields of the entries are stored in the columns
+// of an EntryStore, indexed by id, and a LinkEntry is only built when one is
+// asked for. The database listens to the entries it hands out, for as long
+// as they are held, so that changes made through them are seen by later
+// searches.
 class LinkDatabase {
 public:
-    using LinkEntryIterator =
-        typename std::unordered_map<int, std::shared_ptr<LinkEntry>>::iterator;
-    using ConstLinkEntryIterator = typename std::unordered_map<int,
-        std::shared_ptr<LinkEntry>>::const_iterator;
+    // Iterators over pairs of ids and entries, in order of id. The entry of
+    // each id is built when the iterator reaches it. Both are const
+    // iterators: the pair can't be assigned to, because replacing an entry
+    // behind the database's back would leave its columns and indexes stale.
+    // Use replace_entry for that. The entries themselves can still be
+    // changed through the pointers, as before. Code that assigned to the
+    // pointer in the pair no longer compiles.
+    using LinkEntryIterator = EntryStore::const_iterator;
+    using ConstLinkEntryIterator = EntryStore::const_iterator;
 
     // Constructs an empty database.
     LinkDatabase();
@@ -59,11 +100,23 @@ public:
     // Throws a JLinkDbError if the file could not be opened or if there was a
     // parse error.
     explicit LinkDatabase(const std::string& path);
-    LinkDatabase(const LinkDatabase& other) = default;
-    LinkDatabase(LinkDatabase&& other) = default;
+    // Constructs a database holding the entries in snapshot, with the same
+    // ids. The fields are read in place from the mapping of the snapshot,
+    // which the database keeps, so this takes the same time however many
+    // entries there are, and the snapshot may go away first. Entries are
+    // only copied out of the mapping once they change. No index is enabled.
+    // A corrupt snapshot or an invalid location is only reported, with a
+    // JLinkDbError, once the entry is read.
+    explicit LinkDatabase(const Snapshot& snapshot);
+    // Copies share with other the entries held at the time, and changes to
+    // those reach both databases. Entries got afterwards belong to one of
+    // them. The operation log isn't copied, and assigning to a database
+    // closes its log.
+    LinkDatabase(const LinkDatabase& other);
+    LinkDatabase(LinkDatabase&& other);
 
-    LinkDatabase& operator=(const LinkDatabase& other) = default;
-    LinkDatabase& operator=(LinkDatabase&& other) = default;
+    LinkDatabase& operator=(const LinkDatabase& other);
+    LinkDatabase& operator=(LinkDatabase&& other);
 
     LinkEntryIterator links_begin();
     LinkEntryIterator links_end();
@@ -75,40 +128,278 @@ public:
     // Returns whether there exists a link entry with the given id.
     bool has_entry(int id) const;
     // Returns the entry with the given id if it exists, and a null pointer
-    // otherwise.
+    // otherwise. While the entry is held, getting it again returns the same
+    // entry.
     std::shared_ptr<LinkEntry> get_entry(int id) const;
-    // Returns the new id.
+    // Adds entry and returns its new id. A null entry adds an empty entry.
     int add_entry(std::shared_ptr<LinkEntry> entry);
+    // Adds every entry in entries, giving them consecutive ids, and returns
+    // the id of the first. Emits signal_entries_added once for the whole
+    // range, and signal_entry_added for each entry only if it has slots
+    // connected.
+    int add_entries(const std::vector<std::shared_ptr<LinkEntry>>& entries);
     // Deletes the entry with the given id.
     void delete_entry(int id);
+    // Deletes the entries with the given ids. Emits signal_entries_deleted
+    // once with the ids that were deleted, and signal_entry_deleted for each
+    // of them only if it has slots connected.
+    void delete_entries(const std::vector<int>& ids);
+    // Replaces the entry with the given id, if it exists, with entry, which
+    // must not be null. Holders of the old entry don't see the change.
+    void replace_entry(int id, std::shared_ptr<LinkEntry> entry);
 
     // Returns the collection of entries in the database that match query. Each
     // element of the result is a pair containing the id of the entry and the
-    // entry itself.
+    // entry itself. The entries are in order of id. If the query cache is
+    // enabled and query has a key, the ids of the results are cached under
+    // the key of its canonical form.
     std::vector<std::pair<int, std::shared_ptr<LinkEntry>>> search(
         const query::Query& query) const;
+    // Returns the first limit entries that match query in the given order.
+    // In order of id, checking entries stops as soon as limit of them match,
+    // so the time taken grows with limit rather than with the database. In
+    // other orders every entry is checked, but only the best limit are kept.
+    // The results aren't cached.
+    std::vector<std::pair<int, std::shared_ptr<LinkEntry>>> search(
+        const query::Query& query, std::size_t limit,
+        SearchOrder order = SearchOrder::ID) const;
+    // Returns the limit entries that match query with the highest scores,
+    // highest first, and ties in order of id. score is called once for each
+    // entry that matches. The results aren't cached.
+    std::vector<std::pair<int, std::shared_ptr<LinkEntry>>> search(
+        const query::Query& query, std::size_t limit,
+        const std::function<double(const LinkEntry&)>& score) const;
+    // Calls callback with the id and the entry of each entry that matches
+    // query, in order of id, until callback returns false. Nothing is
+    // allocated for each match, so this is cheaper than search for callers
+    // that only look at each match once. callback must not change the
+    // database.
+    void search_each(const query::Query& query,
+        const std::function<bool(int, const LinkEntry&)>& callback) const;
+    // Returns the number of entries that match query, without collecting
+    // them.
+    std::size_t count(const query::Query& query) const;
+    // Returns whether any entry matches query. Checking entries stops at the
+    // first match.
+    bool exists(const query::Query& query) const;
+    // Like the overloads taking a query, but with a plan from plan that the
+    // caller keeps, so that searching for the same query many times doesn't
+    // plan and compile it each time. The candidates of the plan are looked
+    // up again in the same memory first, so it stays correct as the
+    // database changes.
+    void search_each(query::QueryPlan& query_plan,
+        const std::function<bool(int, const LinkEntry&)>& callback) const;
+    std::size_t count(query::QueryPlan& query_plan) const;
+    bool exists(query::QueryPlan& query_plan) const;
+    // Returns the limit entries that best match the words of text, best
+    // first and ties in order of id, ranked by BM25F over the name,
+    // description, tags and attribute values with the weights in options.
+    // Entries that contain none of the words aren't returned. Throws a
+    // JLinkDbError if the text index isn't enabled.
+    std::vector<RankedEntry> ranked_search(const std::string& text,
+        std::size_t limit,
+        const TextSearchOptions& options = TextSearchOptions{}) const;
+    // Returns the plan search uses to evaluate query. The plan refers to
+    // query, so query must outlive it.
+    query::QueryPlan plan(const query::Query& query) const;
+
+    // Returns an immutable view of the database as it is now, which other
+    // threads can read while the database changes. Taking a view copies the
+    // fields of every entry the first time, and afterwards only those of
+    // the entries changed since, once however often they changed, so views
+    // are cheap to take often.
+    std::shared_ptr<const DatabaseVersion> snapshot();
+    // Returns the view from the last call to snapshot, or null if there
+    // hasn't been one. Unlike every other method, this may be called from
+    // any thread while the database changes.
+    std::shared_ptr<const DatabaseVersion> latest_snapshot() const;
+
+    // Sets the number of threads searches use. A search that checks at least
+    // parallel_search_threshold() rows splits them among the threads, and
+    // its results are in the same order as on one thread. Zero uses a thread
+    // for each hardware thread. The default of one searches on the calling
+    // thread. Copies of the database share their threads.
+    void set_search_threads(std::size_t threads);
+    // Returns the number of threads searches use.
+    std::size_t search_threads() const;
+    // Sets the smallest number of rows a search checks before it is split
+    // among threads.
+    void set_parallel_search_threshold(std::size_t rows);
+    // Returns the smallest number of rows a search checks before it is
+    // split among threads.
+    std::size_t parallel_search_threshold() const;
+
+    // Sets the most bytes the cache of search results may hold. Zero, the
+    // default, disables the cache. See QueryCache. Copies of the database
+    // start with an empty cache of the same capacity.
+    void set_query_cache_capacity(std::size_t bytes);
+    // Returns the cache of search results, or null if it is disabled.
+    const QueryCache* query_cache() const;
 
-    // Writes the database to writer.
+    // Enables or disables the index of entries by tag. While it is enabled,
+    // searches for tags that match the full string look up the entries with
+    // that tag instead of checking every entry.
+    void set_tag_index_enabled(bool enabled);
+    // Returns whether the index of entries by tag is enabled.
+    bool tag_index_enabled() const;
+
+    // Enables or disables the index of entries by attribute name and value.
+    // While it is enabled, searches for attribute values that match the full
+    // string look up the entries with that attribute instead of checking
+    // every entry.
+    void set_attribute_index_enabled(bool enabled);
+    // Returns whether the index of entries by attribute is enabled.
+    bool attribute_index_enabled() const;
+
+    // Keeps the values of the attribute called name in the given order, so
+    // that range and prefix searches of the attribute look up the entries
+    // that match instead of checking every entry. Replaces any index of the
+    // attribute in another order.
+    void add_sorted_attribute_index(
+        const std::string& name, AttributeOrder order);
+    // Stops keeping the values of the attribute called name in order.
+    void remove_sorted_attribute_index(const std::string& name);
+    // Returns whether the values of the attribute called name are kept in
+    // order.
+    bool has_sorted_attribute_index(const std::string& name) const;
+
+    // Enables or disables the index of locations by host, registrable domain
+    // and path. While it is enabled, searches for hosts and for prefixes of
+    // locations that reach past the host look up the entries that can match
+    // instead of checking every entry.
+    void set_url_index_enabled(bool enabled);
+    // Returns whether the index of locations is enabled.
+    bool url_index_enabled() const;
+
+    // Enables or disables the index of words in the name, description, tags
+    // and attribute values of entries, which ranked_search requires.
+    void set_text_index_enabled(bool enabled);
+    // Returns whether the index of words is enabled.
+    bool text_index_enabled() const;
+
+    // Enables or disables the index of trigrams in the text fields of
+    // entries. While it is enabled, searches for terms of at least three
+    // characters only check the entries that contain every trigram of the
+    // term.
+    void set_trigram_index_enabled(bool enabled);
+    // Returns whether the index of trigrams is enabled.
+    bool trigram_index_enabled() const;
+
+    // Writes the database to writer. Throws a JLinkDbError if a field isn't
+    // valid UTF-8, which JSON requires, and leaves what was written so far
+    // incomplete.
     void write_to_stream(std::ostream& writer) const;
     // Writes the database to the file at path. Throws a JLinkDbError if the
-    // file could not be opened.
+    // file could not be opened or a field isn't valid UTF-8.
     void write_to_file(const std::string& path) const;
+    // Writes a binary snapshot of the database to writer, which should be
+    // opened in binary mode. The ids of the entries are kept.
+    void write_snapshot_to_stream(std::ostream& writer) const;
+    // Writes a binary snapshot of the database to the file at path, which
+    // can be opened with Snapshot. Throws a JLinkDbError if the file could
+    // not be opened.
+    void write_snapshot_to_file(const std::string& path) const;
+
+    // Replays the changes recorded in the operation log at path on top of
+    // the database, then records every later change to the database in the
+    // log. Replaying doesn't emit signals. This is usually called on a
+    // database constructed from the last checkpoint. Throws a JLinkDbError
+    // if the log could not be opened.
+    void open_log(const std::string& path);
+    // Syncs and stops recording changes in the operation log.
+    void close_log();
+    // Returns whether changes are recorded in an operation log.
+    bool has_log() const;
+    // Waits for the changes recorded in the operation log to reach the disk.
+    void sync_log();
+    // Sets the number of changes recorded between each sync of the
+    // operation log. See OperationLog::set_sync_interval.
+    void set_log_sync_interval(std::size_t records);
+    // Starts a batch of changes. Until the matching call to end_log_batch,
+    // changes are recorded in the operation log without waiting for the
+    // disk, so that they are synced together. Batches may be nested.
+    void begin_log_batch();
+    // Ends a batch of changes, syncing the operation log if it is due once
+    // the outermost batch ends.
+    void end_log_batch();
+    // Writes a snapshot of the database to the file at path, replacing it
+    // atomically, and empties the operation log, if there is one.
+    void checkpoint(const std::string& path);
 
     // Signal emitted whenever a link is added to the database.
     sigc::signal<void, int>& signal_entry_added();
     // Signal emitted whenever a link is deleted from the database.
     sigc::signal<void, int>& signal_entry_deleted();
+    // Signal emitted whenever a link in the database changes.
+    sigc::signal<void, int>& signal_entry_changed();
+    // Signal emitted whenever links are added to the database, with the
+    // first id and one past the last id added. It is emitted for single
+    // additions too, so it sees every new link.
+    sigc::signal<void, int, int>& signal_entries_added();
+    // Signal emitted whenever links are deleted from the database, with the
+    // ids deleted. It is emitted for single deletions too.
+    sigc::signal<void, const std::vector<int>&>& signal_entries_deleted();
 
 private:
     // Sets the contents of the database from the JSON data in reader. Throws a
     // JLinkDbError if the data is invalid.
     void load_from_stream(std::istream& reader);
 
-    std::unordered_map<int, std::shared_ptr<LinkEntry>> links_;
+    // Stores entry with the given id, which must not be in use, without
+    // recording it in the log or emitting a signal.
+    void insert_entry(int id, std::shared_ptr<LinkEntry> entry);
+    // Applies a change read from the operation log to the stored fields,
+    // without recording it or emitting a signal. An entry handed out for a
+    // changed row is let go of, so later changes to it don't reach the
+    // database.
+    void replay(const OperationLog::Record& record);
+    // Runs query over the database without the cache.
+    std::vector<std::pair<int, std::shared_ptr<LinkEntry>>> run_search(
+        const query::Query& query) const;
+    // Calls visit with each row that matches the query of plan, in order,
+    // until it returns false.
+    void scan(const query::QueryPlan& plan,
+        const std::function<bool(std::size_t)>& visit) const;
+    // Updates the next version and the query cache after the entry with the
+    // given id was added, deleted or changed.
+    void record_change(int id);
+    // Marks the entry with the given id to be copied into the next version,
+    // if snapshots are being taken.
+    void update_version(int id);
+
+    // Makes changes to the entries handed out call on_entry_changed.
+    void listen_to_entries();
+    // Refreshes the stored fields of the entry with the given id.
+    void on_entry_changed(int id);
+    // Records in the operation log each field in which entry differs from
+    // the stored fields of the entry with the given id.
+    void log_field_changes(int id, const LinkEntry& entry);
+
+    EntryStore links_;
+    IndexSet indexes_;
     int highest_id_ = 0;
+    // The threads for searches, or null if they run on the calling thread.
+    std::shared_ptr<ThreadPool> search_pool_;
+    std::size_t parallel_search_threshold_ =
+        DEFAULT_PARALLEL_SEARCH_THRESHOLD;
+    // The log of changes, or null if changes aren't recorded.
+    std::unique_ptr<OperationLog> log_;
+    // The number of batches started with begin_log_batch that haven't
+    // ended.
+    int log_batch_depth_ = 0;
+    // The rows of the next version, or null until the first snapshot.
+    std::unique_ptr<VersionBuilder> versions_;
+    // The last version taken. Only accessed with std::atomic_load and
+    // std::atomic_store.
+    std::shared_ptr<const DatabaseVersion> latest_version_;
+    // The cache of search results, or null if it is disabled.
+    std::unique_ptr<QueryCache> query_cache_;
 
     sigc::signal<void, int> entry_added_;
     sigc::signal<void, int> entry_deleted_;
+    sigc::signal<void, int> entry_changed_;
+    sigc::signal<void, int, int> entries_added_;
+    sigc::signal<void, const std::vector<int>&> entries_deleted_;
 };
 
 }  // namespace libjlinkdb
@@ -21,6 +21,8 @@
 #ifndef JLINKDB_LINK_ENTRY_HH_
 #define JLINKDB_LINK_ENTRY_HH_
 
+#include <sigc++/sigc++.h>
+
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
@@ -29,6 +31,9 @@ namespace libjlinkdb {
 
 // A value representing a single link entry. Will contain either an empty URL
 // location or a valid URL.
+//
+// Copying an entry copies its fields but not the slots connected to its
+// signals.
 class LinkEntry {
 public:
     // Constructs a LinkEntry with an empty location.
@@ -37,11 +42,11 @@ public:
     // empty or a valid URL. Otherwise, a JLinkDbError is thrown.
     explicit LinkEntry(const std::string& location);
 
-    LinkEntry(const LinkEntry& other) = default;
-    LinkEntry(LinkEntry&& other) = default;
+    LinkEntry(const LinkEntry& other);
+    LinkEntry(LinkEntry&& other);
 
-    LinkEntry& operator=(const LinkEntry& other) = default;
-    LinkEntry& operator=(LinkEntry&& other) = default;
+    LinkEntry& operator=(const LinkEntry& other);
+    LinkEntry& operator=(LinkEntry&& other);
 
     // Returns true if and only if all fields match other.
     bool operator==(const LinkEntry& other) const;
@@ -90,12 +95,17 @@ public:
     // Removes all attributes from the entry.
     void clear_attributes();
 
+    // Signal emitted whenever a field of the entry changes.
+    sigc::signal<void>& signal_changed();
+
 private:
     std::string location_;
     std::string name_;
     std::string description_;
     std::unordered_set<std::string> tags_;
     std::unordered_map<std::string, std::string> attributes_;
+
+    sigc::signal<void> changed_;
 };
 
 }  // namespace libjlinkdb
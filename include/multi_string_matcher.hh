@@ -0,0 +1,84 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_MULTI_STRING_MATCHER_HH_
+#define LIBJLINKDB_MULTI_STRING_MATCHER_HH_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "query/string_search_options.hh"
+#include "string_ref.hh"
+
+namespace libjlinkdb {
+
+// Searches strings for any of several targets with fixed options, looking
+// at each character once however many targets there are.
+//
+// The targets are compiled into an Aho-Corasick automaton whose transitions
+// are a table over the characters that appear in the targets, so each
+// character of a string costs one lookup. Ignoring case is built into the
+// table, and like the other string functions only applies to ASCII
+// letters.
+class MultiStringMatcher {
+public:
+    // Constructs a matcher with no targets, which matches nothing.
+    MultiStringMatcher();
+    // Constructs a matcher that searches for targets, obeying options.
+    MultiStringMatcher(const std::vector<std::string>& targets,
+        const query::StringSearchOptions& options);
+
+    // Returns whether str contains any of the targets, or equals one of
+    // them if the options match the full string.
+    bool matches(StringRef str) const;
+
+    // Returns the number of states in the automaton.
+    std::size_t states_count() const;
+
+private:
+    std::uint32_t step(std::uint32_t state, char c) const
+    {
+        return transitions_[state * class_count_
+            + classes_[static_cast<unsigned char>(c)]];
+    }
+
+    query::StringSearchOptions options_;
+    bool empty_ = true;
+    // The column of the transition table for each character. Characters
+    // that aren't in any target share column zero.
+    std::array<std::uint16_t, 256> classes_;
+    std::size_t class_count_ = 1;
+    // The state after each state and column.
+    std::vector<std::uint32_t> transitions_;
+    // The length of the prefix of a target each state stands for.
+    std::vector<std::uint32_t> depths_;
+    // Whether a target ends at each state, including the targets that are
+    // suffixes of the state's prefix.
+    std::vector<char> outputs_;
+    // Whether each state's prefix is a whole target.
+    std::vector<char> ends_;
+};
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_MULTI_STRING_MATCHER_HH_
@@ -0,0 +1,128 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_OPERATION_LOG_HH_
+#define LIBJLINKDB_OPERATION_LOG_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+#include "link_entry.hh"
+
+namespace libjlinkdb {
+
+// The version of the operation log format written by OperationLog.
+constexpr std::uint32_t OPERATION_LOG_VERSION = 2;
+
+// An append-only file of changes to a database. The file starts with a
+// header naming the format and its version. Each record after it holds one
+// change: an entry added with all of its fields, an entry deleted, or one
+// field of an entry changed, so that setting a field costs a record about
+// the size of the field rather than of the whole entry. Replaying the
+// records in order on top of the state of the database the log was started
+// from gives its latest state.
+//
+// Records are encoded as soon as they are appended, and kept in memory until
+// they are written together. The file is synced to disk once every
+// sync_interval() changes, so that a batch of changes waits for the disk
+// only once. Records that haven't been synced may be lost if the machine
+// crashes. A record that was only partly written is discarded when the log
+// is replayed.
+class OperationLog {
+public:
+    enum class Operation : std::uint8_t {
+        // Adds an entry, replacing the entry with the same id if there is
+        // one.
+        ADD = 1,
+        DELETE = 2,
+        SET_LOCATION = 3,
+        SET_NAME = 4,
+        SET_DESCRIPTION = 5,
+        ADD_TAG = 6,
+        REMOVE_TAG = 7,
+        SET_ATTRIBUTE = 8,
+        REMOVE_ATTRIBUTE = 9,
+    };
+
+    // A change to the entry with the given id. The entry holds the fields of
+    // an added entry, and is null otherwise. The name is the name of the
+    // attribute changed, and the value is the new value of the field, or the
+    // tag added or removed.
+    struct Record {
+        Operation operation;
+        int id;
+        std::shared_ptr<const LinkEntry> entry;
+        std::string name;
+        std::string value;
+    };
+
+    // Opens the log in the file at path, creating it if it doesn't exist.
+    // Throws a JLinkDbError if the file could not be opened or isn't an
+    // operation log of a supported version.
+    explicit OperationLog(const std::string& path);
+    // Writes and syncs the records not yet synced.
+    ~OperationLog();
+
+    OperationLog(const OperationLog& other) = delete;
+    OperationLog& operator=(const OperationLog& other) = delete;
+
+    // Calls apply with each record in the log, in the order they were
+    // written. Reading stops at the first record that is incomplete or
+    // doesn't match its checksum, and the log is truncated there so that
+    // new records follow the last good one.
+    void replay(const std::function<void(const Record&)>& apply);
+
+    // Adds record to the end of the log. If may_sync is false, the change
+    // waits for a later sync even if one is due, so that a batch of changes
+    // can be synced together with sync_if_due.
+    void append(const Record& record, bool may_sync = true);
+    // Syncs if at least sync_interval() changes haven't been synced.
+    void sync_if_due();
+    // Writes the records not yet written and waits for them to reach the
+    // disk. Throws a JLinkDbError if writing fails.
+    void sync();
+    // Discards every record, for when their changes are in a snapshot.
+    void clear();
+
+    // Sets the number of changes appended between each sync. The default
+    // of one syncs every change. Zero only syncs when sync is called.
+    void set_sync_interval(std::size_t records);
+    // Returns the number of changes appended between each sync.
+    std::size_t sync_interval() const;
+
+private:
+    std::string path_;
+    int fd_ = -1;
+    // Encoded records that haven't been written yet.
+    std::string buffer_;
+    std::size_t unsynced_ = 0;
+    std::size_t sync_interval_ = 1;
+};
+
+// Waits for the contents of the file at path to reach the disk. Throws a
+// JLinkDbError if the file could not be opened or synced.
+void sync_file(const std::string& path);
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_OPERATION_LOG_HH_
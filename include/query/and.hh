@@ -21,8 +21,13 @@
 #ifndef LIBJLINKDB_QUERY_AND_HH_
 #define LIBJLINKDB_QUERY_AND_HH_
 
+#include <cstddef>
 #include <memory>
+#include <string>
+#include <vector>
 
+#include "entry_store.hh"
+#include "index_set.hh"
 #include "link_entry.hh"
 #include "query/query.hh"
 
@@ -36,8 +41,26 @@ public:
     // Constructs a query that matches if and only if q1 and q2 match.
     And(const std::shared_ptr<Query>& q1, const std::shared_ptr<Query>& q2);
 
+    // Returns the first subquery.
+    const std::shared_ptr<Query>& q1() const;
+    // Returns the second subquery.
+    const std::shared_ptr<Query>& q2() const;
+
     // Returns true if and only if both subqueries match entry.
     bool matches(const LinkEntry& entry) const override;
+    bool matches_row(
+        const EntryStore& store, std::size_t row) const override;
+    bool find_candidates(const IndexSet& indexes,
+        std::vector<std::size_t>& rows) const override;
+    bool find_candidate_bitmap(
+        const IndexSet& indexes, RowBitmap& rows) const override;
+    double estimated_cost() const override;
+    double estimated_selectivity() const override;
+    std::string describe() const override;
+    std::string key() const override;
+    std::size_t hash() const override;
+    bool equals(const Query& other) const override;
+    std::shared_ptr<Query> canonical() const override;
 
 private:
     std::shared_ptr<Query> q1_;
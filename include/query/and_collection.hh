@@ -21,9 +21,13 @@
 #ifndef LIBJLINKDB_QUERY_AND_COLLECTION_HH_
 #define LIBJLINKDB_QUERY_AND_COLLECTION_HH_
 
+#include <cstddef>
 #include <memory>
+#include <string>
 #include <vector>
 
+#include "entry_store.hh"
+#include "index_set.hh"
 #include "link_entry.hh"
 #include "query/query.hh"
 
@@ -44,9 +48,25 @@ public:
     // Constructs a collection containing all queries listed in queries.
     explicit AndCollection(const std::vector<std::shared_ptr<Query>>& queries);
 
+    // Returns the queries in the collection.
+    const std::vector<std::shared_ptr<Query>>& queries() const;
+
     // Returns true if and only if every query in the collection matches
     // entry.
     bool matches(const LinkEntry& entry) const override;
+    bool matches_row(
+        const EntryStore& store, std::size_t row) const override;
+    bool find_candidates(const IndexSet& indexes,
+        std::vector<std::size_t>& rows) const override;
+    bool find_candidate_bitmap(
+        const IndexSet& indexes, RowBitmap& rows) const override;
+    double estimated_cost() const override;
+    double estimated_selectivity() const override;
+    std::string describe() const override;
+    std::string key() const override;
+    std::size_t hash() const override;
+    bool equals(const Query& other) const override;
+    std::shared_ptr<Query> canonical() const override;
 
 private:
     std::vector<std::shared_ptr<Query>> queries_;
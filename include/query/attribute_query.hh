@@ -21,11 +21,17 @@
 #ifndef LIBJLINKDB_QUERY_ATTRIBUTE_QUERY_HH_
 #define LIBJLINKDB_QUERY_ATTRIBUTE_QUERY_HH_
 
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <vector>
 
+#include "entry_store.hh"
+#include "index_set.hh"
 #include "link_entry.hh"
 #include "query/query.hh"
 #include "query/string_search_options.hh"
+#include "string_utils.hh"
 
 namespace libjlinkdb {
 
@@ -36,12 +42,34 @@ public:
     AttributeQuery(const std::string& attr_name, const std::string& attr_value,
         const StringSearchOptions& options);
 
+    // Returns the name of the attribute the query searches.
+    const std::string& attr_name() const;
+    // Returns the query's search term.
+    const std::string& attr_value() const;
+    // Returns the query's search options.
+    const StringSearchOptions& options() const;
+
     bool matches(const LinkEntry& entry) const override;
+    bool matches_row(
+        const EntryStore& store, std::size_t row) const override;
+    bool find_candidates(const IndexSet& indexes,
+        std::vector<std::size_t>& rows) const override;
+    bool find_candidate_bitmap(
+        const IndexSet& indexes, RowBitmap& rows) const override;
+    bool candidates_exact(const IndexSet& indexes) const override;
+    double estimated_cost() const override;
+    double estimated_selectivity() const override;
+    std::string describe() const override;
+    std::string key() const override;
+    std::size_t hash() const override;
+    bool equals(const Query& other) const override;
+    std::shared_ptr<Query> canonical() const override;
 
 private:
     std::string attr_name_;
     std::string attr_value_;
     StringSearchOptions options_;
+    StringMatcher matcher_;
 };
 
 }  // namespace query
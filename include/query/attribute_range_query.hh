@@ -0,0 +1,90 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_QUERY_ATTRIBUTE_RANGE_QUERY_HH_
+#define LIBJLINKDB_QUERY_ATTRIBUTE_RANGE_QUERY_HH_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "entry_store.hh"
+#include "index_set.hh"
+#include "link_entry.hh"
+#include "query/query.hh"
+#include "sorted_attribute_index.hh"
+#include "string_ref.hh"
+
+namespace libjlinkdb {
+
+namespace query {
+
+// A query that matches links with an attribute whose value lies in a range,
+// with values compared in the given order. Links without the attribute, or
+// whose value isn't an integer in integer order, don't match. If the
+// database keeps the attribute in the same order, the matching entries are
+// looked up instead of checking every entry.
+class AttributeRangeQuery : public Query {
+public:
+    // Constructs a query for values of the attribute called attr_name from
+    // lower to upper. Throws a JLinkDbError if order is INTEGER and a bound
+    // isn't an integer.
+    AttributeRangeQuery(const std::string& attr_name, AttributeOrder order,
+        const AttributeBound& lower, const AttributeBound& upper);
+
+    // Returns the name of the attribute the query searches.
+    const std::string& attr_name() const;
+    // Returns the order values are compared in.
+    AttributeOrder order() const;
+    // Returns the lower bound of the range, as it was given.
+    const AttributeBound& lower() const;
+    // Returns the upper bound of the range, as it was given.
+    const AttributeBound& upper() const;
+
+    bool matches(const LinkEntry& entry) const override;
+    bool matches_row(
+        const EntryStore& store, std::size_t row) const override;
+    bool find_candidates(const IndexSet& indexes,
+        std::vector<std::size_t>& rows) const override;
+    double estimated_cost() const override;
+    std::string describe() const override;
+    std::string key() const override;
+    std::size_t hash() const override;
+    bool equals(const Query& other) const override;
+
+private:
+    // Returns whether the attribute value is in the range.
+    bool in_range(StringRef value) const;
+
+    std::string attr_name_;
+    AttributeOrder order_;
+    AttributeBound lower_;
+    AttributeBound upper_;
+    // The bounds with sort keys in place of values.
+    AttributeBound lower_key_;
+    AttributeBound upper_key_;
+};
+
+}  // namespace query
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_QUERY_ATTRIBUTE_RANGE_QUERY_HH_
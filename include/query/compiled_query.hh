@@ -0,0 +1,104 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_QUERY_COMPILED_QUERY_HH_
+#define LIBJLINKDB_QUERY_COMPILED_QUERY_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "entry_store.hh"
+#include "query/query.hh"
+#include "string_utils.hh"
+
+namespace libjlinkdb {
+
+namespace query {
+
+// A query tree lowered into a flat program, for checking many rows of a
+// store without a virtual call and a shared_ptr for every node.
+//
+// Each instruction checks one built in leaf query against a row and jumps
+// to one of two instructions depending on the result, so And, Or and the
+// collections turn into jumps that short circuit the same way. Searches
+// that match the full string or ignore case use the same matchers as the
+// leaves. Queries the compiler doesn't know about are kept as they are and
+// called through matches_row.
+class CompiledQuery {
+public:
+    // Compiles query. The compiled query may refer to parts of query, so
+    // query must outlive it.
+    explicit CompiledQuery(const Query& query);
+
+    // Returns whether the query matches the entry in row of store.
+    bool matches_row(const EntryStore& store, std::size_t row) const;
+    // Returns the number of instructions in the program.
+    std::size_t size() const;
+
+private:
+    // What an instruction checks.
+    enum class Op : std::uint8_t {
+        // Always succeeds if argument is 1 and fails if it is 0.
+        CONSTANT,
+        // Matches the location, name or description.
+        LOCATION,
+        NAME,
+        DESCRIPTION,
+        // Matches any tag.
+        TAGS,
+        // Matches the name or value of any attribute.
+        ATTRIBUTES,
+        // Matches the value of the attribute named by attribute_names_ at
+        // name.
+        ATTRIBUTE,
+        // Calls matches_row on queries_ at argument.
+        QUERY
+    };
+
+    struct Instruction {
+        Op op;
+        // The matcher, query or constant the instruction uses.
+        std::uint32_t argument;
+        std::uint32_t name;
+        // The instructions to continue at if the check succeeds or fails.
+        // The size of the program means the query matches, and one more
+        // means it doesn't.
+        std::uint32_t if_true;
+        std::uint32_t if_false;
+    };
+
+    class Compiler;
+
+    bool run(const Instruction& instruction, const EntryStore& store,
+        std::size_t row) const;
+
+    std::vector<Instruction> program_;
+    std::vector<StringMatcher> matchers_;
+    std::vector<std::string> attribute_names_;
+    std::vector<const Query*> queries_;
+};
+
+}  // namespace query
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_QUERY_COMPILED_QUERY_HH_
@@ -21,11 +21,15 @@
 #ifndef LIBJLINKDB_QUERY_CONTAINS_QUERY_HH_
 #define LIBJLINKDB_QUERY_CONTAINS_QUERY_HH_
 
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <vector>
 
+#include "entry_store.hh"
+#include "index_set.hh"
 #include "link_entry.hh"
+#include "multi_string_matcher.hh"
 #include "query/or_collection.hh"
 #include "query/query.hh"
 #include "query/string_search_options.hh"
@@ -34,8 +38,15 @@ namespace libjlinkdb {
 
 namespace query {
 
+// The smallest number of terms for which a ContainsQuery searches every
+// field for all of its terms at once instead of for one term at a time.
+constexpr std::size_t CONTAINS_AUTOMATON_THRESHOLD = 4;
+
 // A query with search terms that matches an entry if it contains one of
-// the search terms in any of its fields.
+// the search terms in any of its fields. With at least
+// CONTAINS_AUTOMATON_THRESHOLD terms, each field is scanned once for all of
+// the terms with a MultiStringMatcher. With fewer, each term is searched
+// for on its own, which is faster for a single term.
 class ContainsQuery : public Query {
 public:
     // Constructs a query with no terms that will match nothing.
@@ -45,14 +56,34 @@ public:
     explicit ContainsQuery(const std::vector<std::string>& terms,
         const StringSearchOptions& options);
 
+    // Returns the collection of queries, one for each term, that this query
+    // is equivalent to.
+    const OrCollection& underlying_query() const;
+    // Returns whether the query scans each field once for all terms,
+    // instead of checking the underlying query.
+    bool uses_automaton() const;
+
     // Returns whether any field in entry contains any of the search terms.
     bool matches(const LinkEntry& entry) const override;
+    bool matches_row(
+        const EntryStore& store, std::size_t row) const override;
+    bool find_candidates(const IndexSet& indexes,
+        std::vector<std::size_t>& rows) const override;
+    double estimated_cost() const override;
+    double estimated_selectivity() const override;
+    std::string describe() const override;
+    std::string key() const override;
+    std::size_t hash() const override;
+    bool equals(const Query& other) const override;
+    std::shared_ptr<Query> canonical() const override;
 
 private:
     std::shared_ptr<Query> query_for_term(
         const std::string& term, const StringSearchOptions& options);
 
     OrCollection underlying_query_;
+    bool uses_automaton_ = false;
+    MultiStringMatcher matcher_;
 };
 
 }  // namespace query
@@ -21,9 +21,15 @@
 #ifndef LIBJLINKDB_QUERY_DESCRIPTION_EXTRACTOR_HH_
 #define LIBJLINKDB_QUERY_DESCRIPTION_EXTRACTOR_HH_
 
+#include <cstddef>
 #include <string>
+#include <vector>
 
+#include "entry_store.hh"
+#include "index_set.hh"
 #include "link_entry.hh"
+#include "query/string_search_options.hh"
+#include "string_ref.hh"
 
 namespace libjlinkdb {
 
@@ -33,7 +39,16 @@ namespace query {
 class DescriptionExtractor {
 public:
     // Returns the description of entry.
-    std::string operator()(const LinkEntry& entry) const;
+    const std::string& operator()(const LinkEntry& entry) const;
+    // Returns the description of the entry in row of store.
+    StringRef operator()(const EntryStore& store, std::size_t row) const;
+    // Sets rows to the rows whose description may contain term using indexes.
+    // Returns false if the indexes can't narrow down the rows.
+    bool find_candidates(const IndexSet& indexes, const std::string& term,
+        const StringSearchOptions& options,
+        std::vector<std::size_t>& rows) const;
+    // Returns the name of the field, for query plans.
+    std::string describe() const;
 };
 
 }  // namespace query
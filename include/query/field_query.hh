@@ -21,21 +21,113 @@
 #ifndef LIBJLINKDB_QUERY_FIELD_QUERY_HH_
 #define LIBJLINKDB_QUERY_FIELD_QUERY_HH_
 
+#include <cstddef>
+#include <memory>
 #include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+#include <vector>
 
+#include "entry_store.hh"
+#include "index_set.hh"
 #include "link_entry.hh"
 #include "query/query.hh"
 #include "query/string_search_options.hh"
+#include "string_ref.hh"
 #include "string_utils.hh"
 
 namespace libjlinkdb {
 
 namespace query {
 
+namespace detail {
+
+// Whether an extractor of type F can also be called with a const EntryStore&
+// and a row to read the field straight from the store's columns.
+template <typename F>
+class ReadsColumns {
+    template <typename G>
+    static auto test(int) -> decltype(std::declval<const G&>()(
+                                          std::declval<const EntryStore&>(),
+                                          std::declval<std::size_t>()),
+        std::true_type{});
+    template <typename G>
+    static std::false_type test(...);
+
+public:
+    static constexpr bool value = decltype(test<F>(0))::value;
+};
+
+// Whether an extractor of type F returns a reference to a string or a
+// StringRef when called with a const LinkEntry&, so the field can be
+// searched where it is stored instead of copying it first.
+template <typename F>
+class ReturnsReference {
+    using Result =
+        decltype(std::declval<const F&>()(std::declval<const LinkEntry&>()));
+
+public:
+    static constexpr bool value = std::is_lvalue_reference<Result>::value
+        || std::is_same<typename std::decay<Result>::type, StringRef>::value;
+};
+
+// Whether an extractor of type F can find the rows that may match a term
+// using the indexes of a database.
+template <typename F>
+class UsesIndexes {
+    template <typename G>
+    static auto test(int)
+        -> decltype(std::declval<const G&>().find_candidates(
+                        std::declval<const IndexSet&>(),
+                        std::declval<const std::string&>(),
+                        std::declval<const StringSearchOptions&>(),
+                        std::declval<std::vector<std::size_t>&>()),
+            std::true_type{});
+    template <typename G>
+    static std::false_type test(...);
+
+public:
+    static constexpr bool value = decltype(test<F>(0))::value;
+};
+
+// Whether an extractor of type F can describe the field it extracts.
+template <typename F>
+class Describes {
+    template <typename G>
+    static auto test(int)
+        -> decltype(std::declval<const G&>().describe(), std::true_type{});
+    template <typename G>
+    static std::false_type test(...);
+
+public:
+    static constexpr bool value = decltype(test<F>(0))::value;
+};
+
+template <typename F>
+constexpr bool ReadsColumns<F>::value;
+template <typename F>
+constexpr bool ReturnsReference<F>::value;
+template <typename F>
+constexpr bool UsesIndexes<F>::value;
+template <typename F>
+constexpr bool Describes<F>::value;
+
+}  // namespace detail
+
 // A Query that matches if some particular field of an entry matches a
 // search term. The particular field depends on the extractor. The type F
 // must be a callabe type that takes a const LinkEntry& and returns a
-// string.
+// string. If it returns a reference to a string or a StringRef, the field
+// is searched without being copied. If F can also be called with a const
+// EntryStore& and a row, returning something convertible to StringRef, then
+// searches over a database read the field from the store's columns. If F
+// has a find_candidates method like the built in extractors, then searches
+// use it to narrow down the rows to check. If F has a describe method, it
+// names the field in query plans and in the query's key, so extractors of
+// different fields must describe them differently. Two FieldQuery objects
+// are only equal if F is an empty class, like the built in extractors, so
+// that every F extracts the same field.
 template <typename F>
 class FieldQuery : public Query {
 public:
@@ -53,17 +145,51 @@ public:
     // Returns true if and only if the string extracted from entry contains
     // the search term, according to options.
     bool matches(const LinkEntry& entry) const override;
+    bool matches_row(
+        const EntryStore& store, std::size_t row) const override;
+    bool find_candidates(const IndexSet& indexes,
+        std::vector<std::size_t>& rows) const override;
+    double estimated_cost() const override;
+    double estimated_selectivity() const override;
+    std::string describe() const override;
+    std::string key() const override;
+    std::size_t hash() const override;
+    bool equals(const Query& other) const override;
+    std::shared_ptr<Query> canonical() const override;
 
 private:
+    bool matches_impl(const LinkEntry& entry, std::true_type) const;
+    bool matches_impl(const LinkEntry& entry, std::false_type) const;
+    bool matches_row_impl(
+        const EntryStore& store, std::size_t row, std::true_type) const;
+    bool matches_row_impl(
+        const EntryStore& store, std::size_t row, std::false_type) const;
+    bool find_candidates_impl(const IndexSet& indexes,
+        std::vector<std::size_t>& rows, std::true_type) const;
+    bool find_candidates_impl(const IndexSet& indexes,
+        std::vector<std::size_t>& rows, std::false_type) const;
+    std::string describe_field(std::true_type) const;
+    std::string describe_field(std::false_type) const;
+    std::string key_impl(std::true_type) const;
+    std::string key_impl(std::false_type) const;
+    std::size_t hash_impl(std::true_type) const;
+    std::size_t hash_impl(std::false_type) const;
+    bool same_extractor(const FieldQuery<F>& other, std::true_type) const;
+    bool same_extractor(const FieldQuery<F>& other, std::false_type) const;
+
     F extractor_;
     std::string term_;
     StringSearchOptions options_;
+    StringMatcher matcher_;
 };
 
 template <typename F>
 FieldQuery<F>::FieldQuery(const F& extractor, const std::string& term,
     const StringSearchOptions& options)
-    : extractor_{extractor}, term_{term}, options_{options}
+    : extractor_{extractor},
+      term_{term},
+      options_{options},
+      matcher_{term, options}
 {
 }
 
@@ -71,8 +197,213 @@ template <typename F>
 bool
 FieldQuery<F>::matches(const LinkEntry& entry) const
 {
-    std::string field{extractor_(entry)};
-    return search_string(field, term_, options_);
+    return matches_impl(entry,
+        std::integral_constant<bool, detail::ReturnsReference<F>::value>{});
+}
+
+template <typename F>
+bool
+FieldQuery<F>::matches_impl(const LinkEntry& entry, std::true_type) const
+{
+    return matcher_.matches(StringRef{extractor_(entry)});
+}
+
+template <typename F>
+bool
+FieldQuery<F>::matches_impl(const LinkEntry& entry, std::false_type) const
+{
+    const std::string field{extractor_(entry)};
+    return matcher_.matches(field);
+}
+
+template <typename F>
+bool
+FieldQuery<F>::matches_row(const EntryStore& store, std::size_t row) const
+{
+    return matches_row_impl(store, row,
+        std::integral_constant<bool, detail::ReadsColumns<F>::value>{});
+}
+
+template <typename F>
+bool
+FieldQuery<F>::matches_row_impl(
+    const EntryStore& store, std::size_t row, std::true_type) const
+{
+    return matcher_.matches(StringRef{extractor_(store, row)});
+}
+
+template <typename F>
+bool
+FieldQuery<F>::matches_row_impl(
+    const EntryStore& store, std::size_t row, std::false_type) const
+{
+    return Query::matches_row(store, row);
+}
+
+template <typename F>
+bool
+FieldQuery<F>::find_candidates(
+    const IndexSet& indexes, std::vector<std::size_t>& rows) const
+{
+    return find_candidates_impl(indexes, rows,
+        std::integral_constant<bool, detail::UsesIndexes<F>::value>{});
+}
+
+template <typename F>
+bool
+FieldQuery<F>::find_candidates_impl(const IndexSet& indexes,
+    std::vector<std::size_t>& rows, std::true_type) const
+{
+    return extractor_.find_candidates(indexes, term_, options_, rows);
+}
+
+template <typename F>
+bool
+FieldQuery<F>::find_candidates_impl(const IndexSet& indexes,
+    std::vector<std::size_t>& rows, std::false_type) const
+{
+    return Query::find_candidates(indexes, rows);
+}
+
+template <typename F>
+double
+FieldQuery<F>::estimated_cost() const
+{
+    double cost = estimated_search_cost(options_);
+    // Without columns or a reference, the field is copied out of the entry
+    // first.
+    if (!detail::ReadsColumns<F>::value
+        && !detail::ReturnsReference<F>::value) {
+        cost += 2.0;
+    }
+    return cost;
+}
+
+template <typename F>
+double
+FieldQuery<F>::estimated_selectivity() const
+{
+    return estimated_search_selectivity(options_);
+}
+
+template <typename F>
+std::string
+FieldQuery<F>::describe() const
+{
+    return "FieldQuery("
+        + describe_field(
+            std::integral_constant<bool, detail::Describes<F>::value>{})
+        + ") " + describe_search(term_, options_);
+}
+
+template <typename F>
+std::string
+FieldQuery<F>::describe_field(std::true_type) const
+{
+    return extractor_.describe();
+}
+
+template <typename F>
+std::string
+FieldQuery<F>::describe_field(std::false_type) const
+{
+    return "field";
+}
+
+// The key uses the extractor's description to tell fields apart, so queries
+// with extractors that can't describe themselves aren't cached.
+template <typename F>
+std::string
+FieldQuery<F>::key() const
+{
+    return key_impl(
+        std::integral_constant<bool, detail::Describes<F>::value>{});
+}
+
+template <typename F>
+std::string
+FieldQuery<F>::key_impl(std::true_type) const
+{
+    return "field(" + extractor_.describe() + "):"
+        + search_key(term_, options_);
+}
+
+template <typename F>
+std::string
+FieldQuery<F>::key_impl(std::false_type) const
+{
+    return {};
+}
+
+// Like the key, extractors that can describe themselves are told apart by
+// their descriptions. Other extractors are only the same if they hold no
+// state.
+template <typename F>
+std::size_t
+FieldQuery<F>::hash() const
+{
+    return hash_impl(
+        std::integral_constant<bool, detail::Describes<F>::value>{});
+}
+
+template <typename F>
+std::size_t
+FieldQuery<F>::hash_impl(std::true_type) const
+{
+    std::size_t seed = hash_combine(typeid(*this).hash_code(),
+        std::hash<std::string>{}(extractor_.describe()));
+    return hash_combine(seed, search_hash(term_, options_));
+}
+
+template <typename F>
+std::size_t
+FieldQuery<F>::hash_impl(std::false_type) const
+{
+    if (!std::is_empty<F>::value) {
+        return Query::hash();
+    }
+    return hash_combine(
+        typeid(*this).hash_code(), search_hash(term_, options_));
+}
+
+template <typename F>
+bool
+FieldQuery<F>::equals(const Query& other) const
+{
+    if (typeid(other) != typeid(*this)) {
+        return false;
+    }
+    const auto& query = static_cast<const FieldQuery<F>&>(other);
+    return same_extractor(query,
+               std::integral_constant<bool, detail::Describes<F>::value>{})
+        && term_ == query.term_ && options_ == query.options_;
+}
+
+template <typename F>
+bool
+FieldQuery<F>::same_extractor(
+    const FieldQuery<F>& other, std::true_type) const
+{
+    return extractor_.describe() == other.extractor_.describe();
+}
+
+template <typename F>
+bool
+FieldQuery<F>::same_extractor(
+    const FieldQuery<F>& other, std::false_type) const
+{
+    return std::is_empty<F>::value || this == &other;
+}
+
+template <typename F>
+std::shared_ptr<Query>
+FieldQuery<F>::canonical() const
+{
+    std::string term = detail::canonical_term(term_, options_);
+    if (term == term_) {
+        return {};
+    }
+    return std::make_shared<FieldQuery<F>>(extractor_, term, options_);
 }
 
 template <typename F>
@@ -0,0 +1,72 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_QUERY_LOCATION_PREFIX_QUERY_HH_
+#define LIBJLINKDB_QUERY_LOCATION_PREFIX_QUERY_HH_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "entry_store.hh"
+#include "index_set.hh"
+#include "link_entry.hh"
+#include "query/query.hh"
+#include "string_ref.hh"
+
+namespace libjlinkdb {
+
+namespace query {
+
+// A query that matches links whose location starts with a prefix, such as
+// https://example.com/docs/, comparing case. If the URL index is enabled
+// and the prefix reaches past the host, only the entries under the prefix
+// in the trie of paths are checked.
+class LocationPrefixQuery : public Query {
+public:
+    explicit LocationPrefixQuery(const std::string& prefix);
+
+    // Returns the prefix locations must start with.
+    const std::string& prefix() const;
+
+    bool matches(const LinkEntry& entry) const override;
+    bool matches_row(
+        const EntryStore& store, std::size_t row) const override;
+    bool find_candidates(const IndexSet& indexes,
+        std::vector<std::size_t>& rows) const override;
+    double estimated_cost() const override;
+    double estimated_selectivity() const override;
+    std::string describe() const override;
+    std::string key() const override;
+    std::size_t hash() const override;
+    bool equals(const Query& other) const override;
+
+private:
+    // Returns whether location starts with the prefix.
+    bool has_prefix(StringRef location) const;
+
+    std::string prefix_;
+};
+
+}  // namespace query
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_QUERY_LOCATION_PREFIX_QUERY_HH_
@@ -21,22 +21,188 @@
 #ifndef JLINKDB_QUERY_QUERY_HH_
 #define JLINKDB_QUERY_QUERY_HH_
 
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "entry_store.hh"
+#include "index_set.hh"
 #include "link_entry.hh"
+#include "query/string_search_options.hh"
+#include "row_bitmap.hh"
 
 namespace libjlinkdb {
 
 namespace query {
 
+// The estimates used for queries that don't provide their own.
+constexpr double DEFAULT_QUERY_COST = 16.0;
+constexpr double DEFAULT_QUERY_SELECTIVITY = 0.5;
+
 // An operation that either accepts or rejects a link.
 class Query {
 public:
     // Returns true if this query matches entry, false otherwise.
     virtual bool matches(const LinkEntry& entry) const = 0;
+    // Returns true if this query matches the entry stored in row of store.
+    // The default implementation calls matches on the entry itself. Queries
+    // that only look at the fields of an entry override this to read the
+    // columns of store instead.
+    virtual bool matches_row(const EntryStore& store, std::size_t row) const
+    {
+        return matches(*store.entry(row));
+    }
+    // Uses indexes to narrow down the rows this query can match. Returns
+    // false if the indexes don't help, in which case every row has to be
+    // checked. Otherwise, sets rows to a sorted list of rows that contains
+    // every row this query matches. The default implementation returns
+    // false.
+    virtual bool find_candidates(
+        const IndexSet& /* indexes */, std::vector<std::size_t>& /* rows */)
+        const
+    {
+        return false;
+    }
+    // Like find_candidates, but sets rows to a bitmap of the candidates, so
+    // that the candidates of subqueries can be combined as bitmaps. The
+    // default converts the rows found by find_candidates. Queries whose
+    // indexes hold bitmaps override this to copy them instead.
+    virtual bool find_candidate_bitmap(
+        const IndexSet& indexes, RowBitmap& rows) const
+    {
+        std::vector<std::size_t> candidates;
+        if (!find_candidates(indexes, candidates)) {
+            return false;
+        }
+        rows = RowBitmap{candidates};
+        return true;
+    }
+    // Returns whether the candidates found with indexes are exactly the rows
+    // this query matches, so that they don't have to be checked. Only
+    // called if find_candidates returns true. The default returns false.
+    virtual bool candidates_exact(const IndexSet& /* indexes */) const
+    {
+        return false;
+    }
+
+    // Returns an estimate of how long matches_row takes, in units of roughly
+    // one string comparison. Query plans use this to check cheap subqueries
+    // first.
+    virtual double estimated_cost() const
+    {
+        return DEFAULT_QUERY_COST;
+    }
+    // Returns an estimate of the fraction of entries this query matches.
+    virtual double estimated_selectivity() const
+    {
+        return DEFAULT_QUERY_SELECTIVITY;
+    }
+    // Returns a short description of the query, for query plans.
+    virtual std::string describe() const
+    {
+        return "Query";
+    }
+    // Returns a string that identifies what the query matches, for caching
+    // results. Queries with the same nonempty key match the same entries.
+    // The default returns the empty string, which means the query can't be
+    // identified and its results aren't cached.
+    //
+    // The key and hash and equals identify a query in the same way: two
+    // canonical queries with nonempty keys are equal exactly when their
+    // keys are. They differ
+    // in what holds them. hash and equals compare live queries, which is
+    // what collections and canonicalize need. A key is a value that outlives
+    // the query, which a cache needs, since searches take queries by
+    // reference and queries can't be copied.
+    virtual std::string key() const
+    {
+        return {};
+    }
+
+    // Returns a hash of the query's structure. Queries that are equal have
+    // the same hash. The default hashes the address of the query.
+    virtual std::size_t hash() const
+    {
+        return std::hash<const Query*>{}(this);
+    }
+    // Returns whether other has the same structure as this query, which
+    // means both match the same entries. Subqueries are compared in order,
+    // so compare canonical forms to ignore their order. The default only
+    // returns true if other is this query.
+    virtual bool equals(const Query& other) const
+    {
+        return this == &other;
+    }
+    // Returns an equivalent query in canonical form, or null if this query
+    // is already canonical, which the default assumes. Call canonicalize
+    // instead of calling this directly.
+    virtual std::shared_ptr<Query> canonical() const
+    {
+        return {};
+    }
+
     virtual ~Query()
     {
     }
 };
 
+// Returns query in canonical form, so that queries built differently that
+// match the same entries for the same reasons are equal. Nested Ands and
+// AndCollections are flattened into one AndCollection, and likewise for
+// Ors. The subqueries of collections are sorted and duplicates removed.
+// Constants are folded: an empty AndCollection matches every entry and an
+// empty OrCollection matches none, so a ContainsQuery with no terms becomes
+// an empty OrCollection. Searches that ignore case use terms in lower case.
+// Returns query itself if it is already canonical.
+std::shared_ptr<Query> canonicalize(const std::shared_ptr<Query>& query);
+
+// Mixes value into the hash seed, for hashing queries.
+inline std::size_t
+hash_combine(std::size_t seed, std::size_t value)
+{
+    return seed ^ (value + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+
+// Hashes and compares pointers to queries by structure, for containers of
+// queries.
+struct QueryHash {
+    std::size_t operator()(const std::shared_ptr<Query>& query) const
+    {
+        return query->hash();
+    }
+};
+
+struct QueryEqual {
+    bool operator()(const std::shared_ptr<Query>& query1,
+        const std::shared_ptr<Query>& query2) const
+    {
+        return query1->equals(*query2);
+    }
+};
+
+namespace detail {
+
+// Returns the canonical form of a collection of queries that matches if all
+// of them match, if conjunction is true, or if any of them match. Returns
+// null if queries is already canonical and held in a collection of that
+// kind, as given by is_collection.
+std::shared_ptr<Query> canonical_collection(bool conjunction,
+    const std::vector<std::shared_ptr<Query>>& queries, bool is_collection);
+
+// Returns term as it appears in the canonical form of a search with
+// options.
+std::string canonical_term(
+    const std::string& term, const StringSearchOptions& options);
+
+// Finds the candidates of query with find_candidate_bitmap and sets rows to
+// them, for queries that combine the candidates of subqueries as bitmaps.
+bool find_candidates_from_bitmap(const Query& query, const IndexSet& indexes,
+    std::vector<std::size_t>& rows);
+
+}  // namespace detail
+
 }  // namespace query
 
 }  // namespace libjlinkdb
@@ -0,0 +1,119 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_QUERY_QUERY_PLAN_HH_
+#define LIBJLINKDB_QUERY_QUERY_PLAN_HH_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "index_set.hh"
+#include "query/compiled_query.hh"
+#include "query/query.hh"
+
+namespace libjlinkdb {
+
+namespace query {
+
+// One node of a query plan, describing a query in the rewritten tree.
+struct PlanNode {
+    // The description of the query, from Query::describe.
+    std::string description;
+    // The estimated cost of checking one entry.
+    double estimated_cost = 0.0;
+    // The estimated fraction of entries that match.
+    double estimated_selectivity = 0.0;
+    // Whether indexes narrow down the rows the query can match.
+    bool uses_indexes = false;
+    // If uses_indexes is true, the number of rows the indexes left.
+    std::size_t candidate_count = 0;
+    // Whether the rows the indexes left are exactly the rows the query
+    // matches, so that they don't have to be checked.
+    bool exact = false;
+    // The plans of the subqueries, in the order they are checked.
+    std::vector<PlanNode> children;
+};
+
+// A plan for evaluating a query over a database. Planning flattens nested
+// And, Or and collection queries into single collections, orders the
+// subqueries of each collection so that cheap subqueries that are most
+// likely to decide the result are checked first, and looks up the rows that
+// indexes allow the query to match. The candidates of each subquery are
+// looked up once, and combined into the candidates of the plan.
+//
+// A plan can be kept and used for many searches of the same query, calling
+// update_candidates after the database changes, so that the query isn't
+// planned and compiled again each time.
+class QueryPlan {
+public:
+    // Plans query for a database whose entries are in store and whose
+    // indexes are indexes. The plan may refer to query, so query must
+    // outlive it.
+    QueryPlan(
+        const Query& query, const EntryStore& store, const IndexSet& indexes);
+
+    // Returns the rewritten query, which matches the same entries as the
+    // original.
+    const Query& query() const;
+    // Returns the query each row to be checked has to match. This is the
+    // rewritten query, unless it uses indexes and some of the subqueries
+    // that every row has to match have exact candidates. Those are left
+    // out, since every candidate matches them, and if none are left the
+    // result is an empty AndCollection, which matches every row.
+    const Query& residual() const;
+    // Returns whether only the candidate rows need to be checked.
+    bool uses_indexes() const;
+    // Returns the sorted rows that need to be checked if uses_indexes is
+    // true.
+    const std::vector<std::size_t>& candidates() const;
+    // Returns the residual query compiled for checking rows.
+    const CompiledQuery& compiled() const;
+    // Looks up the candidates again in indexes, which must be the indexes
+    // of the database the plan was made for, reusing the memory of the old
+    // ones. The rewritten query and its order are kept. The candidates of
+    // every node and whether they are exact are updated, and the residual
+    // query is rebuilt if that changes which subqueries it leaves out.
+    void update_candidates(const IndexSet& indexes);
+
+    // Returns the root of the plan.
+    const PlanNode& root() const;
+    // Returns a description of the plan with one line for each node.
+    std::string explain() const;
+
+private:
+    // Sets the residual query and compiles it, from the rewritten query and
+    // the root of the plan.
+    void build_residual();
+
+    std::shared_ptr<const Query> query_;
+    std::shared_ptr<const Query> residual_;
+    std::shared_ptr<const CompiledQuery> compiled_;
+    bool uses_indexes_ = false;
+    std::vector<std::size_t> candidates_;
+    PlanNode root_;
+};
+
+}  // namespace query
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_QUERY_QUERY_PLAN_HH_
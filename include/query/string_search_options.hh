@@ -32,6 +32,16 @@ struct StringSearchOptions {
     bool match_full_string;
     // If true, the search should ignore case entirely.
     bool ignore_case;
+
+    bool operator==(const StringSearchOptions& other) const
+    {
+        return match_full_string == other.match_full_string
+            && ignore_case == other.ignore_case;
+    }
+    bool operator!=(const StringSearchOptions& other) const
+    {
+        return !(*this == other);
+    }
 };
 
 }  // namespace query
@@ -0,0 +1,122 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_QUERY_CACHE_HH_
+#define LIBJLINKDB_QUERY_CACHE_HH_
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "entry_store.hh"
+#include "query/query.hh"
+
+namespace libjlinkdb {
+
+// The most changes a QueryCache remembers for patching its results.
+constexpr std::size_t QUERY_CACHE_JOURNAL_LIMIT = 4096;
+
+// A cache of the ids of the entries that match queries, keyed by the
+// Query::key of their canonical form. It holds results up to a number of
+// bytes and evicts the least recently used results first. Keying by
+// Query::hash and Query::equals instead would mean holding the queries, but
+// a search only borrows its query and can't copy it.
+//
+// Results aren't dropped when the database changes. Instead, the cache
+// remembers the ids of the entries that changed, and a result that is found
+// later is patched by checking only those entries against the query again.
+// Once more than QUERY_CACHE_JOURNAL_LIMIT changes pile up, the results
+// stored before them are dropped instead.
+//
+// Every method may be called from several threads at once.
+class QueryCache {
+public:
+    // Constructs an empty cache that holds at most capacity bytes.
+    explicit QueryCache(std::size_t capacity);
+
+    QueryCache(const QueryCache& other) = delete;
+    QueryCache& operator=(const QueryCache& other) = delete;
+
+    // If the results for key are cached, patches them to match store and
+    // sets ids to them. Query must be the query with that key. Returns
+    // whether the results were cached.
+    bool find(const std::string& key, const query::Query& query,
+        const EntryStore& store, std::vector<int>& ids);
+    // Caches ids, which must be sorted, as the results for key, evicting
+    // other results as needed.
+    void insert(const std::string& key, std::vector<int> ids);
+    // Records that the entry with the given id was added, deleted or
+    // changed.
+    void invalidate(int id);
+    // Drops every result.
+    void clear();
+
+    // Returns the most bytes the cache holds.
+    std::size_t capacity() const;
+    // Sets the most bytes the cache holds, evicting results as needed.
+    void set_capacity(std::size_t capacity);
+    // Returns roughly how many bytes the cached results take.
+    std::size_t size() const;
+    // Returns the number of results cached.
+    std::size_t results_count() const;
+    // Returns the number of calls to find that found results.
+    std::size_t hits() const;
+    // Returns the number of calls to find that didn't.
+    std::size_t misses() const;
+
+private:
+    struct Result {
+        std::string key;
+        std::vector<int> ids;
+        // The number of changes recorded before the ids were last correct.
+        std::size_t changes;
+    };
+    using ResultList = std::list<Result>;
+
+    // Returns roughly how many bytes result takes in the cache.
+    static std::size_t footprint(const Result& result);
+    // Checks the entries changed since result was last correct again.
+    void patch(
+        Result& result, const query::Query& query, const EntryStore& store);
+    // Drops the result at position.
+    void erase(ResultList::iterator position);
+    // Drops the least recently used results until the cache fits.
+    void evict();
+
+    mutable std::mutex mutex_;
+    std::size_t capacity_;
+    std::size_t size_ = 0;
+    std::size_t hits_ = 0;
+    std::size_t misses_ = 0;
+    // The results, most recently used first.
+    ResultList results_;
+    std::unordered_map<std::string, ResultList::iterator> positions_;
+    // The ids of the entries changed, oldest first.
+    std::vector<int> changes_;
+    // The number of changes recorded before the first in changes_.
+    std::size_t first_change_ = 0;
+};
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_QUERY_CACHE_HH_
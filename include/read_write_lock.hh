@@ -0,0 +1,73 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_READ_WRITE_LOCK_HH_
+#define LIBJLINKDB_READ_WRITE_LOCK_HH_
+
+#include <pthread.h>
+
+namespace libjlinkdb {
+
+// A lock that many readers can hold at once, or one writer. It meets the
+// requirements of std::unique_lock for writers, and SharedLock holds it for
+// readers.
+class ReadWriteLock {
+public:
+    ReadWriteLock();
+    ~ReadWriteLock();
+
+    ReadWriteLock(const ReadWriteLock& other) = delete;
+    ReadWriteLock& operator=(const ReadWriteLock& other) = delete;
+
+    // Waits until there are no readers or writers and locks for writing.
+    void lock();
+    void unlock();
+
+    // Waits until there are no writers and locks for reading.
+    void lock_shared();
+    void unlock_shared();
+
+private:
+    pthread_rwlock_t lock_;
+};
+
+// Holds a ReadWriteLock for reading for as long as it exists.
+class SharedLock {
+public:
+    explicit SharedLock(ReadWriteLock& lock) : lock_{lock}
+    {
+        lock_.lock_shared();
+    }
+
+    ~SharedLock()
+    {
+        lock_.unlock_shared();
+    }
+
+    SharedLock(const SharedLock& other) = delete;
+    SharedLock& operator=(const SharedLock& other) = delete;
+
+private:
+    ReadWriteLock& lock_;
+};
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_READ_WRITE_LOCK_HH_
@@ -0,0 +1,92 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_ROW_BITMAP_HH_
+#define LIBJLINKDB_ROW_BITMAP_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace libjlinkdb {
+
+namespace detail {
+
+// The rows of a RowBitmap that share their high bits, stored by their low
+// 16 bits. Sparse containers hold a sorted array of the low bits and dense
+// ones a bitmap of all 65536 of them.
+struct RowContainer {
+    // The high bits of the rows.
+    std::size_t key;
+    // The number of rows in the container.
+    std::uint32_t cardinality;
+    // The sorted low bits of the rows, if the container is sparse.
+    std::vector<std::uint16_t> values;
+    // The bitmap of the low bits of the rows, if the container is dense.
+    std::vector<std::uint64_t> words;
+};
+
+}  // namespace detail
+
+// A compressed set of rows, as in Roaring bitmaps. Rows are split into
+// containers of 65536 by their high bits. Containers with up to 4096 rows
+// keep their rows in a sorted array and fuller ones in a bitmap, so both
+// sparse and dense sets are small and intersections and unions of them are
+// fast. Bitmaps are combined a whole word at a time, with SSE2 or AVX2
+// when compiled for them.
+class RowBitmap {
+public:
+    // Constructs an empty bitmap.
+    RowBitmap() = default;
+    // Constructs a bitmap holding rows, which must be sorted.
+    explicit RowBitmap(const std::vector<std::size_t>& rows);
+
+    // Adds row to the bitmap if it isn't already present.
+    void add(std::size_t row);
+    // Removes row from the bitmap if it is present.
+    void remove(std::size_t row);
+    // Returns whether row is in the bitmap.
+    bool contains(std::size_t row) const;
+
+    // Returns the number of rows in the bitmap.
+    std::size_t size() const;
+    // Returns whether the bitmap has no rows.
+    bool empty() const;
+
+    // Replaces the rows with the rows that are also in other.
+    void intersect(const RowBitmap& other);
+    // Replaces the rows with the rows that are in either this or other.
+    void unite(const RowBitmap& other);
+
+    // Sets rows to the sorted rows in the bitmap.
+    void copy_rows(std::vector<std::size_t>& rows) const;
+
+private:
+    // Returns the container for the rows with the high bits key, adding it
+    // if there isn't one.
+    detail::RowContainer& container(std::size_t key);
+
+    // The containers in order of key. None are empty.
+    std::vector<detail::RowContainer> containers_;
+};
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_ROW_BITMAP_HH_
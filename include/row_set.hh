@@ -0,0 +1,46 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_ROW_SET_HH_
+#define LIBJLINKDB_ROW_SET_HH_
+
+#include <cstddef>
+#include <vector>
+
+namespace libjlinkdb {
+
+// Helpers for sorted lists of rows, as used by posting lists and search
+// candidates.
+
+// Adds row to rows if it isn't already present.
+void insert_row(std::vector<std::size_t>& rows, std::size_t row);
+// Removes row from rows if it is present.
+void erase_row(std::vector<std::size_t>& rows, std::size_t row);
+
+// Replaces rows with the rows that are also in other.
+void intersect_rows(
+    std::vector<std::size_t>& rows, const std::vector<std::size_t>& other);
+// Replaces rows with the rows that are in either rows or other.
+void unite_rows(
+    std::vector<std::size_t>& rows, const std::vector<std::size_t>& other);
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_ROW_SET_HH_
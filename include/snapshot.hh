@@ -0,0 +1,141 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_SNAPSHOT_HH_
+#define LIBJLINKDB_SNAPSHOT_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+
+#include "entry_store.hh"
+#include "link_entry.hh"
+#include "string_ref.hh"
+
+namespace libjlinkdb {
+
+// The version of the snapshot format written by Snapshot::write.
+constexpr std::uint32_t SNAPSHOT_VERSION = 3;
+
+// A read-only view of a binary snapshot of the entries of a database. The
+// file is mapped into memory and the fields are read straight from the
+// mapping, so opening a snapshot takes the same time however many entries
+// it holds. A LinkDatabase or EntryStore built from a snapshot reads from
+// the same mapping, which lives as long as any of them.
+//
+// A snapshot starts with a fixed size header giving the number of entries,
+// the id the next entry added will get and the offset of every section.
+// Every other section but the heap has a place for each id below the next
+// id, whether or not it is in use. The presence section holds a bit for
+// each id telling whether it is in use. The characters of every string are
+// kept in one heap. The location, name and description sections hold the
+// offset and size of the field of each id in the heap. The tag and
+// attribute sections hold the first string and number of strings of each
+// id, which index into a table of string offsets and sizes. The name and
+// value of each attribute are next to each other in that table. Ids that
+// aren't in use have empty fields. Numbers are stored in the byte order of
+// the machine that wrote the snapshot, and opening it on a machine with a
+// different byte order fails.
+class Snapshot {
+public:
+    // Opens the snapshot in the file at path. Throws a JLinkDbError if the
+    // file could not be opened or isn't a snapshot of a supported version.
+    explicit Snapshot(const std::string& path);
+
+    Snapshot(const Snapshot& other) = delete;
+    Snapshot& operator=(const Snapshot& other) = delete;
+
+    // Writes a snapshot of the entries in store to writer, which should be
+    // opened in binary mode.
+    static void write(std::ostream& writer, const EntryStore& store);
+
+    // Returns the number of entries in the snapshot.
+    std::size_t size() const;
+    // Returns the id the next entry added to the database will get. Every
+    // id in the snapshot is below it.
+    int next_id() const;
+    // Returns whether there is an entry with the given id.
+    bool has_entry(int id) const;
+
+    // The fields of the entry with the given id, which must be below
+    // next_id(). Every reference points into the mapping and lives as long
+    // as the snapshot. Throws a JLinkDbError if the snapshot refers to data
+    // outside of the file.
+    StringRef location(int id) const;
+    StringRef name(int id) const;
+    StringRef description(int id) const;
+    std::size_t tags_count(int id) const;
+    StringRef tag(int id, std::size_t tag_index) const;
+    std::size_t attributes_count(int id) const;
+    StringRef attribute_name(int id, std::size_t attribute_index) const;
+    StringRef attribute_value(int id, std::size_t attribute_index) const;
+
+    // Returns a new entry with the fields of the entry with the given id.
+    // Throws a JLinkDbError if its location isn't a valid URL.
+    std::shared_ptr<LinkEntry> entry(int id) const;
+
+private:
+    friend class EntryStore;
+
+    struct Header;
+
+    using Slice = StringColumn::Slice;
+    using Range = StringColumn::Range;
+
+    // Returns a pointer to the count elements of size element_size starting
+    // at offset in the mapping. Throws a JLinkDbError if they don't fit in
+    // the mapping.
+    const void* section(std::uint64_t offset, std::uint64_t count,
+        std::size_t element_size) const;
+    // Returns the string that slice refers to.
+    StringRef string_at(const Slice& slice) const;
+    // Returns the string at index in the table slices of count strings.
+    StringRef string_in(const Slice* slices, std::uint64_t count,
+        std::uint64_t index) const;
+    // Returns the range of the entry with the given id, checked against the
+    // number of strings, count, in its table.
+    Range range_at(const Range* ranges, std::uint64_t count, int id) const;
+
+    // Unmaps the file once the snapshot and every store reading from it are
+    // gone.
+    std::shared_ptr<const void> mapping_;
+    std::size_t mapping_size_ = 0;
+
+    std::size_t size_ = 0;
+    int next_id_ = 0;
+    const std::uint64_t* present_ = nullptr;
+    const char* heap_ = nullptr;
+    std::uint64_t heap_size_ = 0;
+    const Slice* locations_ = nullptr;
+    const Slice* names_ = nullptr;
+    const Slice* descriptions_ = nullptr;
+    const Range* tag_ranges_ = nullptr;
+    const Slice* tags_ = nullptr;
+    std::uint64_t tags_size_ = 0;
+    const Range* attribute_ranges_ = nullptr;
+    const Slice* attributes_ = nullptr;
+    std::uint64_t attributes_size_ = 0;
+};
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_SNAPSHOT_HH_
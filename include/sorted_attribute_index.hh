@@ -0,0 +1,137 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_SORTED_ATTRIBUTE_INDEX_HH_
+#define LIBJLINKDB_SORTED_ATTRIBUTE_INDEX_HH_
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "entry_store.hh"
+#include "string_ref.hh"
+
+namespace libjlinkdb {
+
+// How the values of an attribute are ordered.
+enum class AttributeOrder {
+    // Byte by byte, like strings.
+    LEXICOGRAPHIC,
+    // As signed 64-bit decimal integers. Values that aren't integers have no
+    // place in the order.
+    INTEGER
+};
+
+// Sets key to a string whose byte order is the order of value, so that keys
+// of any order compare the same way. Lexicographic values are their own
+// keys, and integers are stored in 8 bytes. Returns false if value isn't an
+// integer when order is INTEGER.
+bool attribute_sort_key(
+    StringRef value, AttributeOrder order, std::string& key);
+
+// One end of a range of attribute values. The index works with bounds whose
+// values are sort keys.
+struct AttributeBound {
+    // Returns a bound that leaves the range open at its end.
+    static AttributeBound none();
+    // Returns a bound at value that includes value.
+    static AttributeBound including(const std::string& value);
+    // Returns a bound at value that excludes value.
+    static AttributeBound excluding(const std::string& value);
+
+    // Whether the range ends at value. Otherwise the range is open at this
+    // end and the other fields are ignored.
+    bool bounded = false;
+    std::string value;
+    // Whether value itself is in the range.
+    bool inclusive = true;
+
+    // Returns whether other is on the inner side of this bound, if it is
+    // the lower bound of a range.
+    bool admits_from_below(StringRef other) const;
+    // Returns whether other is on the inner side of this bound, if it is
+    // the upper bound of a range.
+    bool admits_from_above(StringRef other) const;
+};
+
+// An index that keeps the sort keys of chosen attributes in order, so that
+// the rows with values in a range or with a prefix can be found without
+// checking every row.
+class SortedAttributeIndex {
+public:
+    // Starts keeping the values of the attribute called name in order,
+    // including the values of every entry in store. Replaces any index of
+    // the attribute in another order.
+    void add_attribute(const EntryStore& store, const std::string& name,
+        AttributeOrder order);
+    // Stops keeping the values of the attribute called name in order.
+    void remove_attribute(const std::string& name);
+    // Returns whether the attribute called name is kept in order.
+    bool has_attribute(const std::string& name) const;
+    // Returns whether no attribute is kept in order.
+    bool empty() const;
+
+    // Indexes the attributes of the entry in row of store.
+    void add(const EntryStore& store, std::size_t row);
+    // Removes the attributes of the entry in row of store from the index.
+    // The store must still hold the attributes that were added.
+    void remove(const EntryStore& store, std::size_t row);
+
+    // Sets rows to the sorted rows of the entries whose attribute called
+    // name has a sort key between the sort keys lower and upper. Returns
+    // false if the attribute isn't kept in the given order, in which case
+    // rows is unchanged.
+    bool find_range(const std::string& name, AttributeOrder order,
+        const AttributeBound& lower, const AttributeBound& upper,
+        std::vector<std::size_t>& rows) const;
+    // Sets rows to the sorted rows of the entries whose attribute called
+    // name has a value that starts with prefix. Returns false if the
+    // attribute isn't kept in lexicographic order, in which case rows is
+    // unchanged.
+    bool find_prefix(const std::string& name, const std::string& prefix,
+        std::vector<std::size_t>& rows) const;
+
+private:
+    // The sorted rows with each sort key of one attribute.
+    using PostingMap = std::map<std::string, std::vector<std::size_t>>;
+
+    struct Attribute {
+        std::string name;
+        AttributeOrder order;
+        PostingMap postings;
+    };
+
+    // Returns the attribute called name, or a null pointer if it isn't
+    // kept in order.
+    const Attribute* find_attribute(const std::string& name) const;
+    // Sets rows to the sorted rows in the postings from first up to last.
+    static void collect(PostingMap::const_iterator first,
+        PostingMap::const_iterator last, std::vector<std::size_t>& rows);
+    static void remove_posting(
+        PostingMap& postings, const std::string& key, std::size_t row);
+
+    // There are usually only a few of these, so they are searched in order.
+    std::vector<Attribute> attributes_;
+};
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_SORTED_ATTRIBUTE_INDEX_HH_
@@ -0,0 +1,114 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_STRING_REF_HH_
+#define LIBJLINKDB_STRING_REF_HH_
+
+#include <cstddef>
+#include <cstring>
+#include <string>
+
+namespace libjlinkdb {
+
+// A non-owning reference to a sequence of characters. The referenced
+// characters must outlive the reference.
+class StringRef {
+public:
+    // Constructs a reference to the empty string.
+    StringRef() = default;
+    // Constructs a reference to the size characters starting at data.
+    StringRef(const char* data, std::size_t size) : data_{data}, size_{size}
+    {
+    }
+    // Constructs a reference to the contents of str.
+    StringRef(const std::string& str)  // NOLINT(runtime/explicit)
+        : data_{str.data()}, size_{str.size()}
+    {
+    }
+
+    const char* data() const
+    {
+        return data_;
+    }
+
+    std::size_t size() const
+    {
+        return size_;
+    }
+
+    bool empty() const
+    {
+        return size_ == 0;
+    }
+
+    const char* begin() const
+    {
+        return data_;
+    }
+
+    const char* end() const
+    {
+        return data_ + size_;
+    }
+
+    char operator[](std::size_t index) const
+    {
+        return data_[index];
+    }
+
+    // Returns a copy of the referenced characters.
+    std::string str() const
+    {
+        return std::string(data_, size_);
+    }
+
+    // Returns true if and only if both references contain the same
+    // characters.
+    bool operator==(StringRef other) const
+    {
+        return size_ == other.size_
+            && (size_ == 0 || std::memcmp(data_, other.data_, size_) == 0);
+    }
+
+    bool operator!=(StringRef other) const
+    {
+        return !(*this == other);
+    }
+
+    // Returns a negative number, zero or a positive number if this reference
+    // comes before, is equal to or comes after other in byte order.
+    int compare(StringRef other) const
+    {
+        std::size_t size = size_ < other.size_ ? size_ : other.size_;
+        int result = size == 0 ? 0 : std::memcmp(data_, other.data_, size);
+        if (result != 0) {
+            return result;
+        }
+        return size_ < other.size_ ? -1 : (size_ > other.size_ ? 1 : 0);
+    }
+
+private:
+    const char* data_ = "";
+    std::size_t size_ = 0;
+};
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_STRING_REF_HH_
@@ -21,19 +21,74 @@
 #ifndef LIBJLINKDB_STRING_UTILS_HH_
 #define LIBJLINKDB_STRING_UTILS_HH_
 
+#include <cstddef>
 #include <string>
 
 #include "query/string_search_options.hh"
+#include "string_ref.hh"
 
 namespace libjlinkdb {
 
+// Functions for comparing strings. Ignoring case only applies to ASCII
+// letters, and other characters must match exactly. None of the functions
+// copy the strings they compare. When compiled for SSE2 or AVX2, they compare
+// many characters at once.
+
+// Returns c in lower case if it is an ASCII letter, and c otherwise.
+char to_lower(char c);
 // Replaces the contents of str so that it only contains lower case characters.
 void to_lower_in_place(std::string& str);
 
+// Returns whether str1 and str2 are equal, ignoring case.
+bool equals_ignore_case(StringRef str1, StringRef str2);
+// Returns whether str contains target. If ignore_case is true, the search
+// ignores case.
+bool contains_string(StringRef str, StringRef target, bool ignore_case);
+
 // Searchs str for target and return whether it was found. The search obeys the
 // parameters in options.
 bool search_string(const std::string& str, const std::string& target,
     const query::StringSearchOptions& options);
+// Same as above, but searches characters that are not held in a string.
+bool search_string(StringRef str, StringRef target,
+    const query::StringSearchOptions& options);
+
+// Searches strings for one target with fixed options. The target is prepared
+// once on construction instead of for every search.
+class StringMatcher {
+public:
+    // Constructs a matcher that searches for target, obeying options.
+    StringMatcher(
+        const std::string& target, const query::StringSearchOptions& options);
+
+    // Returns whether str contains the target, obeying the options.
+    bool matches(StringRef str) const;
+
+private:
+    // The target, in lower case if the options ignore case.
+    std::string target_;
+    query::StringSearchOptions options_;
+};
+
+// Returns an estimate of the cost of one call to search_string with options,
+// in the units of Query::estimated_cost.
+double estimated_search_cost(const query::StringSearchOptions& options);
+// Returns an estimate of the fraction of strings a search with options
+// matches.
+double estimated_search_selectivity(
+    const query::StringSearchOptions& options);
+// Returns a description of a search for term with options, such as
+// "abc" (full string, ignore case).
+std::string describe_search(
+    const std::string& term, const query::StringSearchOptions& options);
+// Returns a string that identifies a search for term with options, for the
+// keys of queries. Unlike describe_search, no two searches have the same
+// key.
+std::string search_key(
+    const std::string& term, const query::StringSearchOptions& options);
+// Returns a hash of a search for term with options, for hashing queries.
+std::size_t search_hash(
+    const std::string& term, const query::StringSearchOptions& options);
 
 }  // namespace libjlinkdb
 
@@ -0,0 +1,59 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_TAG_INDEX_HH_
+#define LIBJLINKDB_TAG_INDEX_HH_
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+#include "entry_store.hh"
+#include "row_bitmap.hh"
+
+namespace libjlinkdb {
+
+// An index from each tag to the bitmap of rows whose entries have that tag.
+// Tags are indexed both as they are and converted to lower case.
+class TagIndex {
+public:
+    // Indexes the tags of the entry in row of store.
+    void add(const EntryStore& store, std::size_t row);
+    // Removes the tags of the entry in row of store from the index. The
+    // store must still hold the tags that were added.
+    void remove(const EntryStore& store, std::size_t row);
+
+    // Returns the rows of the entries that have a tag equal to tag.
+    // If ignore_case is true, tags are compared ignoring case.
+    const RowBitmap& find(const std::string& tag, bool ignore_case) const;
+
+private:
+    using PostingMap = std::unordered_map<std::string, RowBitmap>;
+
+    static void remove_posting(
+        PostingMap& postings, const std::string& tag, std::size_t row);
+
+    PostingMap exact_;
+    PostingMap folded_;
+};
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_TAG_INDEX_HH_
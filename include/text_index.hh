@@ -0,0 +1,126 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_TEXT_INDEX_HH_
+#define LIBJLINKDB_TEXT_INDEX_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "entry_store.hh"
+#include "string_ref.hh"
+
+namespace libjlinkdb {
+
+// The weights and parameters of ranked searches. A field with a higher
+// weight counts for more, and a weight of zero ignores the field. k1 sets
+// how quickly repeating a word stops raising the score, and b how much long
+// fields are penalized, as in BM25.
+struct TextSearchOptions {
+    double name_weight = 3.0;
+    double description_weight = 1.0;
+    double tag_weight = 2.0;
+    double attribute_weight = 1.0;
+    double k1 = 1.2;
+    double b = 0.75;
+};
+
+// A row found by a ranked search and its score.
+struct TextMatch {
+    std::size_t row;
+    double score;
+};
+
+// Calls callback with each word of text in lower case. Words are runs of
+// ASCII letters and digits, and of bytes outside ASCII so that words in
+// UTF-8 stay whole. Everything else separates words.
+void tokenize(StringRef text, const std::function<void(StringRef)>& callback);
+
+// An inverted index from each word in the name, description, tags and
+// attribute values of entries to the rows that contain it, with the number
+// of times it appears in each field. It also keeps the number of words in
+// each field of each row, so that searches can rank rows by BM25F: the
+// frequencies of each word in the fields are weighted, normalized by the
+// lengths of the fields, and combined before they saturate.
+class TextIndex {
+public:
+    // The number of fields indexed.
+    static constexpr std::size_t FIELD_COUNT = 4;
+
+    // Indexes the fields of the entry in row of store.
+    void add(const EntryStore& store, std::size_t row);
+    // Removes the fields of the entry in row of store from the index. The
+    // store must still hold the fields that were added.
+    void remove(const EntryStore& store, std::size_t row);
+
+    // Returns the limit rows with the highest scores for the words of text,
+    // highest first and ties in order of row. Rows that contain none of the
+    // words aren't returned. Only rows that could still beat the last of
+    // the best rows found so far are scored, as in WAND, so most rows are
+    // skipped when limit is small.
+    std::vector<TextMatch> search(const std::string& text, std::size_t limit,
+        const TextSearchOptions& options = TextSearchOptions{}) const;
+    // Returns the number of rows indexed.
+    std::size_t rows_count() const;
+
+private:
+    // The occurrences of a word in one row.
+    struct Posting {
+        std::size_t row;
+        std::uint16_t frequencies[FIELD_COUNT];
+    };
+
+    // The rows that contain a word, in order, with bounds over them used
+    // to bound the score of the word. Removing rows doesn't tighten the
+    // bounds, which only makes them looser.
+    struct Term {
+        std::vector<Posting> postings;
+        // The most times the word appears in each field of a row.
+        std::uint16_t max_frequencies[FIELD_COUNT] = {};
+        // The fewest words in each field of a row where the word appears
+        // in that field.
+        std::uint32_t min_lengths[FIELD_COUNT] = {};
+    };
+
+    // The number of words in each field of a row.
+    struct Lengths {
+        std::uint32_t fields[FIELD_COUNT] = {};
+    };
+
+    // Calls callback with each field of the entry in row of store and each
+    // word in it.
+    static void for_each_word(const EntryStore& store, std::size_t row,
+        const std::function<void(std::size_t, StringRef)>& callback);
+
+    std::unordered_map<std::string, Term> terms_;
+    // The lengths of the fields of each row, indexed by row.
+    std::vector<Lengths> lengths_;
+    // The sum of the lengths of each field over every row.
+    std::uint64_t total_lengths_[FIELD_COUNT] = {};
+    std::size_t rows_count_ = 0;
+};
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_TEXT_INDEX_HH_
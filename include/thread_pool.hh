@@ -0,0 +1,69 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_THREAD_POOL_HH_
+#define LIBJLINKDB_THREAD_POOL_HH_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace libjlinkdb {
+
+// A fixed set of worker threads that run batches of tasks. Several threads
+// may run batches on the same pool at once.
+class ThreadPool {
+public:
+    // Starts a pool of the given number of threads, which must be at least
+    // one.
+    explicit ThreadPool(std::size_t threads);
+    // Waits for the tasks already queued and stops the threads.
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool& other) = delete;
+    ThreadPool& operator=(const ThreadPool& other) = delete;
+
+    // Returns the number of threads in the pool.
+    std::size_t size() const;
+
+    // Calls task with every index from 0 up to count on the pool's threads
+    // and waits for every call to return. If any call throws, the first
+    // exception is rethrown once all of them are done. This must not be
+    // called from within a task.
+    void run(std::size_t count, const std::function<void(std::size_t)>& task);
+
+private:
+    // Runs queued tasks until the pool is stopped.
+    void work();
+
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;
+    std::condition_variable ready_;
+    std::deque<std::function<void()>> tasks_;
+    bool stopping_ = false;
+};
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_THREAD_POOL_HH_
@@ -0,0 +1,87 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_TRIGRAM_INDEX_HH_
+#define LIBJLINKDB_TRIGRAM_INDEX_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "entry_store.hh"
+#include "string_ref.hh"
+
+namespace libjlinkdb {
+
+// The text fields of an entry that a TrigramIndex covers.
+enum class TextField {
+    LOCATION,
+    NAME,
+    DESCRIPTION,
+    TAGS,
+    // Both the names and the values of attributes.
+    ATTRIBUTES
+};
+
+// An index from every sequence of three characters, ignoring case, to the
+// sorted rows whose fields contain it. Any row whose field contains a term
+// must contain every trigram of the term, so intersecting their rows gives
+// the candidates for a substring search. The candidates still have to be
+// checked, since the trigrams may be spread out over the field or differ in
+// case.
+class TrigramIndex {
+public:
+    // The shortest term that can be looked up.
+    static constexpr std::size_t MIN_TERM_SIZE = 3;
+
+    // Indexes the fields of the entry in row of store.
+    void add(const EntryStore& store, std::size_t row);
+    // Removes the fields of the entry in row of store from the index. The
+    // store must still hold the fields that were added.
+    void remove(const EntryStore& store, std::size_t row);
+
+    // Sets rows to the sorted rows whose given field may contain term. The
+    // rows include every match regardless of case. Returns false if term is
+    // shorter than MIN_TERM_SIZE, in which case rows is unchanged.
+    bool find(TextField field, const std::string& term,
+        std::vector<std::size_t>& rows) const;
+
+private:
+    static constexpr std::size_t FIELD_COUNT = 5;
+
+    using PostingMap =
+        std::unordered_map<std::uint32_t, std::vector<std::size_t>>;
+
+    // Returns the sorted distinct trigrams of every string in field of the
+    // entry in row of store.
+    static std::vector<std::uint32_t> trigrams(
+        const EntryStore& store, std::size_t row, TextField field);
+    // Appends the trigrams of str to result.
+    static void append_trigrams(
+        StringRef str, std::vector<std::uint32_t>& result);
+
+    PostingMap postings_[FIELD_COUNT];
+};
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_TRIGRAM_INDEX_HH_
@@ -0,0 +1,93 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_URL_INDEX_HH_
+#define LIBJLINKDB_URL_INDEX_HH_
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "entry_store.hh"
+#include "string_ref.hh"
+
+namespace libjlinkdb {
+
+// An index of the locations of entries by their structure. It maps each
+// host, and each registrable domain, to the sorted rows whose locations
+// have it, and keeps a trie of the segments of the paths under each host.
+// Hosts and domains are stored in lower case. See split_url and
+// registrable_domain for how locations are taken apart.
+class UrlIndex {
+public:
+    // Indexes the location of the entry in row of store.
+    void add(const EntryStore& store, std::size_t row);
+    // Removes the location of the entry in row of store from the index. The
+    // store must still hold the location that was added.
+    void remove(const EntryStore& store, std::size_t row);
+
+    // Returns the sorted rows of the entries whose host is host, ignoring
+    // case.
+    const std::vector<std::size_t>& find_host(const std::string& host) const;
+    // Returns the sorted rows of the entries whose host has the registrable
+    // domain domain, ignoring case.
+    const std::vector<std::size_t>& find_domain(
+        const std::string& domain) const;
+    // Sets rows to the sorted rows whose locations may start with prefix.
+    // The rows include every location that does, ignoring the case of the
+    // host. Returns false if prefix doesn't reach the path of a URL, in
+    // which case rows is unchanged.
+    bool find_prefix(
+        const std::string& prefix, std::vector<std::size_t>& rows) const;
+
+private:
+    using PostingMap =
+        std::unordered_map<std::string, std::vector<std::size_t>>;
+
+    // A node of the trie of paths, for the path segments leading to it.
+    struct PathNode {
+        // The sorted rows whose paths start with the segments of the node.
+        std::vector<std::size_t> rows;
+        // The position in nodes_ of the node for each next segment.
+        std::map<std::string, std::size_t> children;
+    };
+
+    static void remove_posting(
+        PostingMap& postings, const std::string& key, std::size_t row);
+    // Returns the position of a new node in nodes_.
+    std::size_t new_node();
+    // Removes row from the node at position and the nodes below it that
+    // the segments of path lead to, and frees the nodes left empty.
+    void remove_path(std::size_t position, StringRef path, std::size_t row);
+
+    PostingMap hosts_;
+    PostingMap domains_;
+    // The root of the trie of paths under each host.
+    std::unordered_map<std::string, std::size_t> roots_;
+    std::vector<PathNode> nodes_;
+    // The positions of the nodes in nodes_ that are no longer used.
+    std::vector<std::size_t> free_nodes_;
+};
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_URL_INDEX_HH_
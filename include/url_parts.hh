@@ -0,0 +1,60 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#ifndef LIBJLINKDB_URL_PARTS_HH_
+#define LIBJLINKDB_URL_PARTS_HH_
+
+#include "string_ref.hh"
+
+namespace libjlinkdb {
+
+// The parts of a URL such as scheme://user@host:port/path?query#fragment.
+// Each part refers to the characters of the URL it was split from, without
+// its separators, except that the path keeps its leading '/'. Missing parts
+// are empty.
+struct UrlParts {
+    StringRef scheme;
+    StringRef host;
+    StringRef port;
+    StringRef path;
+    StringRef query;
+    StringRef fragment;
+};
+
+// Splits url into parts without copying it, so the parts of stored
+// locations are cheap to recompute. Returns false if url doesn't start with
+// a scheme, in which case parts is unchanged. Only URLs with "//" after the
+// scheme have a host. The parts aren't validated beyond that; entries are
+// validated when their location is set.
+bool split_url(StringRef url, UrlParts& parts);
+
+// Returns the registrable domain of host, the part that a single owner
+// registers, such as example.com for www.example.com. Without the public
+// suffix list this is approximated by the last two labels, or the last
+// three when the last is a country code and the one before it is a common
+// second level label, as in example.co.uk. Returns an empty reference if
+// host has too few labels, such as com or co.uk, or is an IP address.
+// Hosts that end in the same labels as the result share it, so every
+// subdomain of a host with a registrable domain has the same one.
+StringRef registrable_domain(StringRef host);
+
+}  // namespace libjlinkdb
+
+#endif  // LIBJLINKDB_URL_PARTS_HH_
@@ -0,0 +1,108 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "attribute_index.hh"
+
+#include <cstddef>
+#include <string>
+
+#include "entry_store.hh"
+#include "row_bitmap.hh"
+#include "string_utils.hh"
+
+namespace libjlinkdb {
+
+using std::size_t;
+using std::string;
+
+void
+AttributeIndex::add(const EntryStore& store, size_t row)
+{
+    size_t count = store.attributes_count(row);
+    for (size_t i = 0; i < count; ++i) {
+        string name{store.attribute_name(row, i).str()};
+        string value{store.attribute_value(row, i).str()};
+        exact_[name][value].add(row);
+        to_lower_in_place(value);
+        folded_[name][value].add(row);
+    }
+}
+
+void
+AttributeIndex::remove(const EntryStore& store, size_t row)
+{
+    size_t count = store.attributes_count(row);
+    for (size_t i = 0; i < count; ++i) {
+        string name{store.attribute_name(row, i).str()};
+        string value{store.attribute_value(row, i).str()};
+        remove_posting(exact_, name, value, row);
+        to_lower_in_place(value);
+        remove_posting(folded_, name, value, row);
+    }
+}
+
+const RowBitmap&
+AttributeIndex::find(
+    const string& name, const string& value, bool ignore_case) const
+{
+    static const RowBitmap empty;
+
+    const AttributeMap* attributes = &exact_;
+    string key{value};
+    if (ignore_case) {
+        attributes = &folded_;
+        to_lower_in_place(key);
+    }
+
+    auto values = attributes->find(name);
+    if (values == attributes->end()) {
+        return empty;
+    }
+    auto position = values->second.find(key);
+    if (position == values->second.end()) {
+        return empty;
+    }
+    return position->second;
+}
+
+void
+AttributeIndex::remove_posting(AttributeMap& attributes, const string& name,
+    const string& value, size_t row)
+{
+    auto values = attributes.find(name);
+    if (values == attributes.end()) {
+        return;
+    }
+    auto list = values->second.find(value);
+    if (list == values->second.end()) {
+        return;
+    }
+
+    RowBitmap& rows = list->second;
+    rows.remove(row);
+    if (rows.empty()) {
+        values->second.erase(list);
+        if (values->second.empty()) {
+            attributes.erase(values);
+        }
+    }
+}
+
+}  // namespace libjlinkdb
@@ -0,0 +1,279 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "concurrent_link_database.hh"
+
+#include <sigc++/sigc++.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "link_database.hh"
+#include "link_entry.hh"
+#include "query/query.hh"
+#include "read_write_lock.hh"
+
+namespace libjlinkdb {
+
+using std::shared_ptr;
+using std::size_t;
+using std::vector;
+
+ConcurrentLinkDatabase::ConcurrentLinkDatabase(size_t shards)
+{
+    if (shards == 0) {
+        shards = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    shards_.reserve(shards);
+    for (size_t i = 0; i < shards; ++i) {
+        shards_.emplace_back(new Shard);
+    }
+}
+
+size_t
+ConcurrentLinkDatabase::shards() const
+{
+    return shards_.size();
+}
+
+size_t
+ConcurrentLinkDatabase::links_count() const
+{
+    size_t result = 0;
+    for (const auto& shard : shards_) {
+        SharedLock lock{shard->lock};
+        result += shard->database.links_count();
+    }
+    return result;
+}
+
+bool
+ConcurrentLinkDatabase::has_entry(int id) const
+{
+    Shard* shard = shard_of(id);
+    if (shard == nullptr) {
+        return false;
+    }
+
+    SharedLock lock{shard->lock};
+    return shard->database.has_entry(local_id(id));
+}
+
+shared_ptr<LinkEntry>
+ConcurrentLinkDatabase::get_entry(int id) const
+{
+    Shard* shard = shard_of(id);
+    if (shard == nullptr) {
+        return {};
+    }
+
+    SharedLock lock{shard->lock};
+    return shard->database.get_entry(local_id(id));
+}
+
+int
+ConcurrentLinkDatabase::add_entry(shared_ptr<LinkEntry> entry)
+{
+    size_t index = next_shard_++ % shards_.size();
+    Shard& shard = *shards_[index];
+    int id;
+    {
+        std::lock_guard<ReadWriteLock> lock{shard.lock};
+        id = shard.database.add_entry(std::move(entry));
+    }
+
+    id = id * static_cast<int>(shards_.size()) + static_cast<int>(index);
+    emit(entry_added_, id);
+    return id;
+}
+
+void
+ConcurrentLinkDatabase::delete_entry(int id)
+{
+    Shard* shard = shard_of(id);
+    if (shard == nullptr) {
+        return;
+    }
+
+    {
+        std::lock_guard<ReadWriteLock> lock{shard->lock};
+        if (!shard->database.has_entry(local_id(id))) {
+            return;
+        }
+        shard->database.delete_entry(local_id(id));
+    }
+    emit(entry_deleted_, id);
+}
+
+void
+ConcurrentLinkDatabase::replace_entry(int id, shared_ptr<LinkEntry> entry)
+{
+    Shard* shard = shard_of(id);
+    if (shard == nullptr || entry == nullptr) {
+        return;
+    }
+
+    {
+        std::lock_guard<ReadWriteLock> lock{shard->lock};
+        if (!shard->database.has_entry(local_id(id))) {
+            return;
+        }
+        shard->database.replace_entry(local_id(id), std::move(entry));
+    }
+    emit(entry_changed_, id);
+}
+
+vector<std::pair<int, shared_ptr<LinkEntry>>>
+ConcurrentLinkDatabase::search(const query::Query& query) const
+{
+    vector<std::pair<int, shared_ptr<LinkEntry>>> result;
+    int count = static_cast<int>(shards_.size());
+    for (int i = 0; i < count; ++i) {
+        const Shard& shard = *shards_[i];
+        vector<std::pair<int, shared_ptr<LinkEntry>>> found;
+        {
+            SharedLock lock{shard.lock};
+            found = shard.database.search(query);
+        }
+        for (auto& link : found) {
+            result.emplace_back(
+                link.first * count + i, std::move(link.second));
+        }
+    }
+
+    std::sort(result.begin(), result.end(),
+        [](const std::pair<int, shared_ptr<LinkEntry>>& first,
+            const std::pair<int, shared_ptr<LinkEntry>>& second) {
+            return first.first < second.first;
+        });
+    return result;
+}
+
+void
+ConcurrentLinkDatabase::set_tag_index_enabled(bool enabled)
+{
+    for (auto& shard : shards_) {
+        std::lock_guard<ReadWriteLock> lock{shard->lock};
+        shard->database.set_tag_index_enabled(enabled);
+    }
+}
+
+void
+ConcurrentLinkDatabase::set_attribute_index_enabled(bool enabled)
+{
+    for (auto& shard : shards_) {
+        std::lock_guard<ReadWriteLock> lock{shard->lock};
+        shard->database.set_attribute_index_enabled(enabled);
+    }
+}
+
+void
+ConcurrentLinkDatabase::add_sorted_attribute_index(
+    const std::string& name, AttributeOrder order)
+{
+    for (auto& shard : shards_) {
+        std::lock_guard<ReadWriteLock> lock{shard->lock};
+        shard->database.add_sorted_attribute_index(name, order);
+    }
+}
+
+void
+ConcurrentLinkDatabase::remove_sorted_attribute_index(const std::string& name)
+{
+    for (auto& shard : shards_) {
+        std::lock_guard<ReadWriteLock> lock{shard->lock};
+        shard->database.remove_sorted_attribute_index(name);
+    }
+}
+
+void
+ConcurrentLinkDatabase::set_url_index_enabled(bool enabled)
+{
+    for (auto& shard : shards_) {
+        std::lock_guard<ReadWriteLock> lock{shard->lock};
+        shard->database.set_url_index_enabled(enabled);
+    }
+}
+
+void
+ConcurrentLinkDatabase::set_text_index_enabled(bool enabled)
+{
+    for (auto& shard : shards_) {
+        std::lock_guard<ReadWriteLock> lock{shard->lock};
+        shard->database.set_text_index_enabled(enabled);
+    }
+}
+
+void
+ConcurrentLinkDatabase::set_trigram_index_enabled(bool enabled)
+{
+    for (auto& shard : shards_) {
+        std::lock_guard<ReadWriteLock> lock{shard->lock};
+        shard->database.set_trigram_index_enabled(enabled);
+    }
+}
+
+sigc::signal<void, int>&
+ConcurrentLinkDatabase::signal_entry_added()
+{
+    return entry_added_;
+}
+
+sigc::signal<void, int>&
+ConcurrentLinkDatabase::signal_entry_deleted()
+{
+    return entry_deleted_;
+}
+
+sigc::signal<void, int>&
+ConcurrentLinkDatabase::signal_entry_changed()
+{
+    return entry_changed_;
+}
+
+ConcurrentLinkDatabase::Shard*
+ConcurrentLinkDatabase::shard_of(int id) const
+{
+    if (id < 0) {
+        return nullptr;
+    }
+    return shards_[static_cast<size_t>(id) % shards_.size()].get();
+}
+
+int
+ConcurrentLinkDatabase::local_id(int id) const
+{
+    return id / static_cast<int>(shards_.size());
+}
+
+void
+ConcurrentLinkDatabase::emit(sigc::signal<void, int>& signal, int id)
+{
+    std::lock_guard<std::recursive_mutex> lock{signals_mutex_};
+    signal(id);
+}
+
+}  // namespace libjlinkdb
@@ -0,0 +1,161 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "database_version.hh"
+
+#include <cstddef>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "entry_store.hh"
+#include "link_entry.hh"
+#include "query/compiled_query.hh"
+#include "query/query.hh"
+
+namespace libjlinkdb {
+
+using std::shared_ptr;
+using std::size_t;
+using std::vector;
+
+size_t
+DatabaseVersion::links_count() const
+{
+    return size_;
+}
+
+bool
+DatabaseVersion::has_entry(int id) const
+{
+    if (id < 0) {
+        return false;
+    }
+
+    size_t row = static_cast<size_t>(id);
+    size_t chunk = row / VERSION_CHUNK_ROWS;
+    return chunk < chunks_.size() && chunks_[chunk] != nullptr
+        && chunks_[chunk]->has_row(row % VERSION_CHUNK_ROWS);
+}
+
+DatabaseVersion::Entry
+DatabaseVersion::get_entry(int id) const
+{
+    if (!has_entry(id)) {
+        return {};
+    }
+
+    size_t row = static_cast<size_t>(id);
+    return chunks_[row / VERSION_CHUNK_ROWS]->entry(row % VERSION_CHUNK_ROWS);
+}
+
+vector<std::pair<int, DatabaseVersion::Entry>>
+DatabaseVersion::search(const query::Query& query) const
+{
+    query::CompiledQuery compiled{query};
+    vector<std::pair<int, Entry>> result;
+    for (size_t chunk = 0; chunk < chunks_.size(); ++chunk) {
+        if (chunks_[chunk] == nullptr) {
+            continue;
+        }
+
+        const EntryStore& store = *chunks_[chunk];
+        for (size_t row = 0; row < store.rows(); ++row) {
+            if (store.has_row(row) && compiled.matches_row(store, row)) {
+                result.emplace_back(
+                    static_cast<int>(chunk * VERSION_CHUNK_ROWS + row),
+                    store.entry(row));
+            }
+        }
+    }
+    return result;
+}
+
+void
+VersionBuilder::mark(size_t row)
+{
+    if (row >= marked_.size()) {
+        marked_.resize(row + 1);
+    }
+    if (!marked_[row]) {
+        marked_[row] = true;
+        marked_rows_.push_back(row);
+        last_.reset();
+    }
+}
+
+shared_ptr<const DatabaseVersion>
+VersionBuilder::build(const EntryStore& store)
+{
+    for (size_t row : marked_rows_) {
+        marked_[row] = false;
+        copy_row(store, row);
+    }
+    marked_rows_.clear();
+
+    if (last_ == nullptr) {
+        shared_ptr<DatabaseVersion> version{new DatabaseVersion};
+        version->chunks_.assign(chunks_.begin(), chunks_.end());
+        version->size_ = size_;
+        published_.assign(chunks_.size(), true);
+        last_ = std::move(version);
+    }
+    return last_;
+}
+
+void
+VersionBuilder::copy_row(const EntryStore& store, size_t row)
+{
+    bool present = store.has_row(row);
+    size_t index = row / VERSION_CHUNK_ROWS;
+    if (index >= chunks_.size()) {
+        if (!present) {
+            return;
+        }
+        chunks_.resize(index + 1);
+        published_.resize(index + 1);
+    }
+
+    shared_ptr<EntryStore>& chunk = chunks_[index];
+    if (chunk == nullptr) {
+        if (!present) {
+            return;
+        }
+        chunk = std::make_shared<EntryStore>();
+        published_[index] = false;
+    } else if (published_[index]) {
+        // A version may still be reading the chunk.
+        chunk = std::make_shared<EntryStore>(*chunk);
+        published_[index] = false;
+    }
+
+    size_t chunk_row = row % VERSION_CHUNK_ROWS;
+    if (present) {
+        if (!chunk->has_row(chunk_row)) {
+            ++size_;
+        }
+        chunk->insert(chunk_row, store, row);
+    } else if (chunk->has_row(chunk_row)) {
+        chunk->erase(chunk_row);
+        --size_;
+    }
+}
+
+}  // namespace libjlinkdb
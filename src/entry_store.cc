@@ -0,0 +1,837 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "entry_store.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "jlinkdb_error.hh"
+#include "link_entry.hh"
+#include "snapshot.hh"
+#include "string_ref.hh"
+
+namespace libjlinkdb {
+
+using std::shared_ptr;
+using std::size_t;
+using std::vector;
+
+// Columns are only compacted once they hold at least this many unreferenced
+// characters, so that small databases never bother.
+constexpr size_t MIN_COMPACT_GARBAGE = 4096;
+// The held entries are first cleared out once there are this many.
+constexpr size_t MIN_SWEEP_SIZE = 1024;
+
+size_t
+StringColumn::rows() const
+{
+    return mapped_rows_ + ranges_.size();
+}
+
+void
+StringColumn::resize(size_t rows)
+{
+    ranges_.resize(rows - mapped_rows_, Range{0, 0});
+}
+
+void
+StringColumn::reserve(size_t rows, size_t strings)
+{
+    if (rows > mapped_rows_) {
+        ranges_.reserve(rows - mapped_rows_);
+    }
+    slices_.reserve(strings);
+}
+
+void
+StringColumn::map(const char* chars, std::uint64_t chars_size,
+    const Slice* slices, std::uint64_t slices_size, const Range* ranges,
+    size_t rows)
+{
+    mapped_chars_ = chars;
+    mapped_chars_size_ = chars_size;
+    mapped_slices_ = slices;
+    mapped_slices_size_ = slices_size;
+    mapped_ranges_ = ranges;
+    mapped_rows_ = rows;
+}
+
+size_t
+StringColumn::count(size_t row) const
+{
+    if (is_mapped(row)) {
+        return static_cast<size_t>(mapped_range(row).count);
+    }
+    return static_cast<size_t>(own_range(row).count);
+}
+
+StringRef
+StringColumn::get(size_t row, size_t index) const
+{
+    if (is_mapped(row)) {
+        Range range = mapped_range(row);
+        if (index >= range.count) {
+            return {};
+        }
+        const Slice& slice = mapped_slices_[range.first + index];
+        if (slice.offset > mapped_chars_size_
+            || slice.size > mapped_chars_size_ - slice.offset) {
+            throw JLinkDbError{"corrupt snapshot"};
+        }
+        return {mapped_chars_ + slice.offset,
+            static_cast<size_t>(slice.size)};
+    }
+
+    const Range& range = own_range(row);
+    if (index >= range.count) {
+        return {};
+    }
+
+    const Slice& slice = slices_[range.first + index];
+    return {chars_.data() + slice.offset, static_cast<size_t>(slice.size)};
+}
+
+void
+StringColumn::assign(size_t row, const vector<StringRef>& values)
+{
+    clear(row);
+
+    Range& range = own_range(row);
+    range.first = slices_.size();
+    range.count = values.size();
+    for (const auto& value : values) {
+        slices_.push_back(Slice{chars_.size(), value.size()});
+        chars_.insert(chars_.end(), value.begin(), value.end());
+    }
+
+    maybe_compact();
+}
+
+void
+StringColumn::clear(size_t row)
+{
+    // The mapped strings of a row don't take up any of the buffers.
+    Range& range = own_range(row);
+    for (size_t i = 0; i < range.count; ++i) {
+        garbage_chars_ += slices_[range.first + i].size;
+    }
+    garbage_slices_ += range.count;
+    range = Range{0, 0};
+}
+
+bool
+StringColumn::is_mapped(size_t row) const
+{
+    return row < mapped_rows_ && (overridden_.empty() || !overridden_[row]);
+}
+
+StringColumn::Range
+StringColumn::mapped_range(size_t row) const
+{
+    if (mapped_ranges_ == nullptr) {
+        return {row, 1};
+    }
+
+    Range range = mapped_ranges_[row];
+    if (range.count > mapped_slices_size_
+        || range.first > mapped_slices_size_ - range.count) {
+        throw JLinkDbError{"corrupt snapshot"};
+    }
+    return range;
+}
+
+StringColumn::Range&
+StringColumn::own_range(size_t row)
+{
+    if (row >= mapped_rows_) {
+        return ranges_[row - mapped_rows_];
+    }
+
+    if (overridden_.empty()) {
+        overridden_.resize(mapped_rows_);
+    }
+    if (!overridden_[row]) {
+        overridden_[row] = true;
+        overrides_[row] = Range{0, 0};
+    }
+    return overrides_[row];
+}
+
+const StringColumn::Range&
+StringColumn::own_range(size_t row) const
+{
+    if (row >= mapped_rows_) {
+        return ranges_[row - mapped_rows_];
+    }
+    return overrides_.find(row)->second;
+}
+
+void
+StringColumn::maybe_compact()
+{
+    if (garbage_chars_ < MIN_COMPACT_GARBAGE
+        || garbage_chars_ < chars_.size() / 2) {
+        return;
+    }
+
+    vector<char> chars;
+    vector<Slice> slices;
+    chars.reserve(chars_.size() - garbage_chars_);
+    slices.reserve(slices_.size() - garbage_slices_);
+    auto move_range = [&](Range& range) {
+        std::uint64_t first = slices.size();
+        for (size_t i = 0; i < range.count; ++i) {
+            const Slice& slice = slices_[range.first + i];
+            slices.push_back(Slice{chars.size(), slice.size});
+            chars.insert(chars.end(), chars_.begin() + slice.offset,
+                chars_.begin() + slice.offset + slice.size);
+        }
+        range.first = first;
+    };
+    for (auto& override_range : overrides_) {
+        move_range(override_range.second);
+    }
+    for (auto& range : ranges_) {
+        move_range(range);
+    }
+
+    chars_.swap(chars);
+    slices_.swap(slices);
+    garbage_chars_ = 0;
+    garbage_slices_ = 0;
+}
+
+EntryStore::const_iterator::const_iterator(
+    const EntryStore* store, size_t row)
+    : store_{store}, row_{row}
+{
+    skip_empty();
+}
+
+EntryStore::const_iterator::reference
+EntryStore::const_iterator::operator*() const
+{
+    if (!current_.second) {
+        current_.first = static_cast<int>(row_);
+        current_.second = store_->entry(row_);
+    }
+    return current_;
+}
+
+EntryStore::const_iterator::pointer
+EntryStore::const_iterator::operator->() const
+{
+    return &**this;
+}
+
+EntryStore::const_iterator&
+EntryStore::const_iterator::operator++()
+{
+    current_.second.reset();
+    ++row_;
+    skip_empty();
+    return *this;
+}
+
+EntryStore::const_iterator
+EntryStore::const_iterator::operator++(int)
+{
+    const_iterator result{*this};
+    ++*this;
+    return result;
+}
+
+bool
+EntryStore::const_iterator::operator==(const const_iterator& other) const
+{
+    return store_ == other.store_ && row_ == other.row_;
+}
+
+bool
+EntryStore::const_iterator::operator!=(const const_iterator& other) const
+{
+    return !(*this == other);
+}
+
+void
+EntryStore::const_iterator::skip_empty()
+{
+    while (row_ < store_->rows() && !store_->has_row(row_)) {
+        ++row_;
+    }
+}
+
+EntryStore::EntryStore()
+    : sweep_size_{MIN_SWEEP_SIZE},
+      self_{std::make_shared<const EntryStore*>(this)}
+{
+}
+
+EntryStore::EntryStore(const Snapshot& snapshot) : EntryStore{}
+{
+    const char* heap = snapshot.heap_;
+    std::uint64_t heap_size = snapshot.heap_size_;
+    size_t rows = static_cast<size_t>(snapshot.next_id());
+    locations_.map(
+        heap, heap_size, snapshot.locations_, rows, nullptr, rows);
+    names_.map(heap, heap_size, snapshot.names_, rows, nullptr, rows);
+    descriptions_.map(
+        heap, heap_size, snapshot.descriptions_, rows, nullptr, rows);
+    tags_.map(heap, heap_size, snapshot.tags_, snapshot.tags_size_,
+        snapshot.tag_ranges_, rows);
+    attributes_.map(heap, heap_size, snapshot.attributes_,
+        snapshot.attributes_size_, snapshot.attribute_ranges_, rows);
+
+    mapped_present_ = snapshot.present_;
+    rows_ = rows;
+    size_ = snapshot.size();
+    mapping_ = snapshot.mapping_;
+}
+
+EntryStore::EntryStore(const EntryStore& other) : EntryStore{}
+{
+    *this = other;
+}
+
+EntryStore::EntryStore(EntryStore&& other) : EntryStore{}
+{
+    *this = std::move(other);
+}
+
+EntryStore&
+EntryStore::operator=(const EntryStore& other)
+{
+    if (this == &other) {
+        return *this;
+    }
+
+    present_ = other.present_;
+    mapped_present_ = other.mapped_present_;
+    rows_ = other.rows_;
+    size_ = other.size_;
+    mapping_ = other.mapping_;
+    locations_ = other.locations_;
+    names_ = other.names_;
+    descriptions_ = other.descriptions_;
+    tags_ = other.tags_;
+    attributes_ = other.attributes_;
+
+    std::lock_guard<std::mutex> lock{held_mutex_};
+    held_.clear();
+    std::lock_guard<std::mutex> other_lock{other.held_mutex_};
+    for (const auto& held : other.held_) {
+        if (!held.second.entry.expired()) {
+            held_[held.first] = held.second;
+        }
+    }
+    connect_held();
+    return *this;
+}
+
+EntryStore&
+EntryStore::operator=(EntryStore&& other)
+{
+    if (this == &other) {
+        return *this;
+    }
+
+    present_ = std::move(other.present_);
+    mapped_present_ = other.mapped_present_;
+    rows_ = other.rows_;
+    size_ = other.size_;
+    mapping_ = std::move(other.mapping_);
+    locations_ = std::move(other.locations_);
+    names_ = std::move(other.names_);
+    descriptions_ = std::move(other.descriptions_);
+    tags_ = std::move(other.tags_);
+    attributes_ = std::move(other.attributes_);
+    other.present_.clear();
+    other.mapped_present_ = nullptr;
+    other.rows_ = 0;
+    other.size_ = 0;
+
+    std::lock_guard<std::mutex> lock{held_mutex_};
+    std::lock_guard<std::mutex> other_lock{other.held_mutex_};
+    held_ = std::move(other.held_);
+    other.held_.clear();
+    connect_held();
+    return *this;
+}
+
+EntryStore::const_iterator
+EntryStore::begin() const
+{
+    return {this, 0};
+}
+
+EntryStore::const_iterator
+EntryStore::end() const
+{
+    return {this, rows()};
+}
+
+size_t
+EntryStore::rows() const
+{
+    return rows_;
+}
+
+size_t
+EntryStore::size() const
+{
+    return size_;
+}
+
+bool
+EntryStore::has_row(size_t row) const
+{
+    if (row >= rows_) {
+        return false;
+    }
+    const std::uint64_t* words =
+        present_.empty() ? mapped_present_ : present_.data();
+    return (words[row / 64] >> (row % 64)) & 1;
+}
+
+shared_ptr<LinkEntry>
+EntryStore::entry(size_t row) const
+{
+    if (!has_row(row)) {
+        return nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{held_mutex_};
+        shared_ptr<LinkEntry> held = find_held(row);
+        if (held != nullptr) {
+            return held;
+        }
+    }
+
+    // Build the entry without the lock, so that threads searching at once
+    // don't wait for each other, and keep the one another thread built in
+    // the meantime, if there is one.
+    shared_ptr<LinkEntry> result = build_entry(row);
+    std::lock_guard<std::mutex> lock{held_mutex_};
+    shared_ptr<LinkEntry> held = find_held(row);
+    if (held != nullptr) {
+        return held;
+    }
+    hold(row, result);
+    return result;
+}
+
+void
+EntryStore::set_change_handler(std::function<void(size_t)> handler)
+{
+    change_handler_ = std::move(handler);
+    std::lock_guard<std::mutex> lock{held_mutex_};
+    connect_held();
+}
+
+void
+EntryStore::reserve(size_t rows)
+{
+    present_.reserve((rows + 63) / 64);
+    // The fields that hold one string per entry.
+    locations_.reserve(rows, rows);
+    names_.reserve(rows, rows);
+    descriptions_.reserve(rows, rows);
+    tags_.reserve(rows, 0);
+    attributes_.reserve(rows, 0);
+}
+
+void
+EntryStore::insert(size_t row, const shared_ptr<LinkEntry>& entry)
+{
+    if (entry == nullptr) {
+        insert(row, LinkEntry{});
+        return;
+    }
+
+    insert(row, *entry);
+    std::lock_guard<std::mutex> lock{held_mutex_};
+    hold(row, entry);
+}
+
+void
+EntryStore::insert(size_t row, const LinkEntry& entry)
+{
+    grow(row + 1);
+    release(row);
+    if (!has_row(row)) {
+        set_present(row, true);
+        ++size_;
+    }
+    assign(row, entry);
+}
+
+void
+EntryStore::insert(size_t row, const EntryStore& other, size_t other_row)
+{
+    grow(row + 1);
+    release(row);
+    if (!has_row(row)) {
+        set_present(row, true);
+        ++size_;
+    }
+
+    locations_.assign(row, {other.location(other_row)});
+    names_.assign(row, {other.name(other_row)});
+    descriptions_.assign(row, {other.description(other_row)});
+
+    vector<StringRef> values;
+    for (size_t i = 0; i < other.tags_count(other_row); ++i) {
+        values.push_back(other.tag(other_row, i));
+    }
+    tags_.assign(row, values);
+
+    values.clear();
+    for (size_t i = 0; i < other.attributes_count(other_row); ++i) {
+        values.push_back(other.attribute_name(other_row, i));
+        values.push_back(other.attribute_value(other_row, i));
+    }
+    attributes_.assign(row, values);
+}
+
+void
+EntryStore::erase(size_t row)
+{
+    if (!has_row(row)) {
+        return;
+    }
+
+    release(row);
+    set_present(row, false);
+    --size_;
+    locations_.clear(row);
+    names_.clear(row);
+    descriptions_.clear(row);
+    tags_.clear(row);
+    attributes_.clear(row);
+}
+
+void
+EntryStore::update(size_t row)
+{
+    if (!has_row(row)) {
+        return;
+    }
+
+    shared_ptr<LinkEntry> held;
+    {
+        std::lock_guard<std::mutex> lock{held_mutex_};
+        held = find_held(row);
+    }
+    if (held != nullptr) {
+        assign(row, *held);
+    }
+}
+
+void
+EntryStore::release(size_t row)
+{
+    std::lock_guard<std::mutex> lock{held_mutex_};
+    held_.erase(row);
+}
+
+void
+EntryStore::set_location(size_t row, const std::string& location)
+{
+    release(row);
+    locations_.assign(row, {location});
+}
+
+void
+EntryStore::set_name(size_t row, const std::string& name)
+{
+    release(row);
+    names_.assign(row, {name});
+}
+
+void
+EntryStore::set_description(size_t row, const std::string& description)
+{
+    release(row);
+    descriptions_.assign(row, {description});
+}
+
+void
+EntryStore::add_tag(size_t row, const std::string& tag)
+{
+    release(row);
+    // The strings are copied out of the column, since assigning to it may
+    // move its buffers.
+    vector<std::string> tags;
+    for (size_t i = 0; i < tags_count(row); ++i) {
+        tags.push_back(this->tag(row, i).str());
+        if (tags.back() == tag) {
+            return;
+        }
+    }
+    tags.push_back(tag);
+    tags_.assign(row, vector<StringRef>{tags.begin(), tags.end()});
+}
+
+void
+EntryStore::remove_tag(size_t row, const std::string& tag)
+{
+    release(row);
+    vector<std::string> tags;
+    for (size_t i = 0; i < tags_count(row); ++i) {
+        if (this->tag(row, i) != tag) {
+            tags.push_back(this->tag(row, i).str());
+        }
+    }
+    if (tags.size() != tags_count(row)) {
+        tags_.assign(row, vector<StringRef>{tags.begin(), tags.end()});
+    }
+}
+
+void
+EntryStore::set_attribute(
+    size_t row, const std::string& attribute, const std::string& value)
+{
+    release(row);
+    vector<std::string> values;
+    for (size_t i = 0; i < attributes_count(row); ++i) {
+        if (attribute_name(row, i) != attribute) {
+            values.push_back(attribute_name(row, i).str());
+            values.push_back(attribute_value(row, i).str());
+        }
+    }
+    values.push_back(attribute);
+    values.push_back(value);
+    attributes_.assign(row, vector<StringRef>{values.begin(), values.end()});
+}
+
+void
+EntryStore::remove_attribute(size_t row, const std::string& attribute)
+{
+    release(row);
+    vector<std::string> values;
+    for (size_t i = 0; i < attributes_count(row); ++i) {
+        if (attribute_name(row, i) != attribute) {
+            values.push_back(attribute_name(row, i).str());
+            values.push_back(attribute_value(row, i).str());
+        }
+    }
+    if (values.size() != 2 * attributes_count(row)) {
+        attributes_.assign(
+            row, vector<StringRef>{values.begin(), values.end()});
+    }
+}
+
+StringRef
+EntryStore::location(size_t row) const
+{
+    return locations_.get(row);
+}
+
+StringRef
+EntryStore::name(size_t row) const
+{
+    return names_.get(row);
+}
+
+StringRef
+EntryStore::description(size_t row) const
+{
+    return descriptions_.get(row);
+}
+
+size_t
+EntryStore::tags_count(size_t row) const
+{
+    return tags_.count(row);
+}
+
+StringRef
+EntryStore::tag(size_t row, size_t index) const
+{
+    return tags_.get(row, index);
+}
+
+size_t
+EntryStore::attributes_count(size_t row) const
+{
+    return attributes_.count(row) / 2;
+}
+
+StringRef
+EntryStore::attribute_name(size_t row, size_t index) const
+{
+    return attributes_.get(row, 2 * index);
+}
+
+StringRef
+EntryStore::attribute_value(size_t row, size_t index) const
+{
+    return attributes_.get(row, 2 * index + 1);
+}
+
+shared_ptr<LinkEntry>
+EntryStore::find_held(size_t row) const
+{
+    auto held = held_.find(row);
+    if (held == held_.end()) {
+        return nullptr;
+    }
+    return held->second.entry.lock();
+}
+
+void
+EntryStore::hold(size_t row, const shared_ptr<LinkEntry>& entry) const
+{
+    if (held_.size() >= sweep_size_) {
+        for (auto held = held_.begin(); held != held_.end();) {
+            if (held->second.entry.expired()) {
+                held = held_.erase(held);
+            } else {
+                ++held;
+            }
+        }
+        sweep_size_ = std::max(MIN_SWEEP_SIZE, 2 * held_.size());
+    }
+
+    std::uint64_t generation = next_generation_++;
+    held_[row] = HeldEntry{entry, generation};
+    connect(row, *entry, generation);
+}
+
+void
+EntryStore::connect(
+    size_t row, LinkEntry& entry, std::uint64_t generation) const
+{
+    if (!change_handler_) {
+        return;
+    }
+
+    std::weak_ptr<const EntryStore*> self{self_};
+    entry.signal_changed().connect([self, row, generation]() {
+        shared_ptr<const EntryStore*> store = self.lock();
+        if (store != nullptr) {
+            (*store)->on_entry_changed(row, generation);
+        }
+    });
+}
+
+void
+EntryStore::connect_held()
+{
+    for (auto& held : held_) {
+        shared_ptr<LinkEntry> entry = held.second.entry.lock();
+        if (entry != nullptr) {
+            held.second.generation = next_generation_++;
+            connect(held.first, *entry, held.second.generation);
+        }
+    }
+}
+
+void
+EntryStore::on_entry_changed(size_t row, std::uint64_t generation) const
+{
+    {
+        std::lock_guard<std::mutex> lock{held_mutex_};
+        auto held = held_.find(row);
+        if (held == held_.end() || held->second.generation != generation) {
+            return;
+        }
+    }
+    change_handler_(row);
+}
+
+shared_ptr<LinkEntry>
+EntryStore::build_entry(size_t row) const
+{
+    auto result = std::make_shared<LinkEntry>(location(row).str());
+    result->set_name(name(row).str());
+    result->set_description(description(row).str());
+    for (size_t i = 0; i < tags_count(row); ++i) {
+        result->add_tag(tag(row, i).str());
+    }
+    for (size_t i = 0; i < attributes_count(row); ++i) {
+        result->set_attribute(
+            attribute_name(row, i).str(), attribute_value(row, i).str());
+    }
+    return result;
+}
+
+void
+EntryStore::assign(size_t row, const LinkEntry& entry)
+{
+    locations_.assign(row, {entry.location()});
+    names_.assign(row, {entry.name()});
+    descriptions_.assign(row, {entry.description()});
+
+    vector<StringRef> values{entry.tags().begin(), entry.tags().end()};
+    tags_.assign(row, values);
+
+    values.clear();
+    for (const auto& attribute : entry.attributes()) {
+        values.push_back(attribute.first);
+        values.push_back(attribute.second);
+    }
+    attributes_.assign(row, values);
+}
+
+void
+EntryStore::grow(size_t rows)
+{
+    if (rows <= rows_) {
+        return;
+    }
+
+    if (present_.empty() && mapped_present_ != nullptr) {
+        present_.assign(mapped_present_, mapped_present_ + (rows_ + 63) / 64);
+    }
+    present_.resize((rows + 63) / 64);
+    rows_ = rows;
+    locations_.resize(rows);
+    names_.resize(rows);
+    descriptions_.resize(rows);
+    tags_.resize(rows);
+    attributes_.resize(rows);
+}
+
+void
+EntryStore::set_present(size_t row, bool present)
+{
+    if (present_.empty() && mapped_present_ != nullptr) {
+        present_.assign(mapped_present_, mapped_present_ + (rows_ + 63) / 64);
+    }
+
+    std::uint64_t bit = std::uint64_t{1} << (row % 64);
+    if (present) {
+        present_[row / 64] |= bit;
+    } else {
+        present_[row / 64] &= ~bit;
+    }
+}
+
+}  // namespace libjlinkdb
@@ -0,0 +1,259 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "index_set.hh"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "attribute_index.hh"
+#include "entry_store.hh"
+#include "sorted_attribute_index.hh"
+#include "tag_index.hh"
+#include "text_index.hh"
+#include "trigram_index.hh"
+#include "url_index.hh"
+
+namespace libjlinkdb {
+
+using std::size_t;
+using std::unique_ptr;
+
+namespace {
+
+// Returns a copy of the object pointed to by pointer, or a null pointer if
+// there isn't one.
+template <typename T>
+unique_ptr<T>
+copy_index(const unique_ptr<T>& pointer)
+{
+    if (pointer) {
+        return unique_ptr<T>{new T{*pointer}};
+    }
+    return {};
+}
+
+// Returns a new index of type T holding every entry in store.
+template <typename T>
+unique_ptr<T>
+build_index(const EntryStore& store)
+{
+    unique_ptr<T> index{new T{}};
+    for (size_t row = 0; row < store.rows(); ++row) {
+        if (store.has_row(row)) {
+            index->add(store, row);
+        }
+    }
+    return index;
+}
+
+}  // namespace
+
+IndexSet::IndexSet(const IndexSet& other)
+    : tag_index_{copy_index(other.tag_index_)},
+      attribute_index_{copy_index(other.attribute_index_)},
+      sorted_attribute_index_{copy_index(other.sorted_attribute_index_)},
+      url_index_{copy_index(other.url_index_)},
+      text_index_{copy_index(other.text_index_)},
+      trigram_index_{copy_index(other.trigram_index_)}
+{
+}
+
+IndexSet&
+IndexSet::operator=(const IndexSet& other)
+{
+    if (this != &other) {
+        tag_index_ = copy_index(other.tag_index_);
+        attribute_index_ = copy_index(other.attribute_index_);
+        sorted_attribute_index_ = copy_index(other.sorted_attribute_index_);
+        url_index_ = copy_index(other.url_index_);
+        text_index_ = copy_index(other.text_index_);
+        trigram_index_ = copy_index(other.trigram_index_);
+    }
+    return *this;
+}
+
+const TagIndex*
+IndexSet::tag_index() const
+{
+    return tag_index_.get();
+}
+
+void
+IndexSet::enable_tag_index(const EntryStore& store)
+{
+    tag_index_ = build_index<TagIndex>(store);
+}
+
+void
+IndexSet::disable_tag_index()
+{
+    tag_index_.reset();
+}
+
+const AttributeIndex*
+IndexSet::attribute_index() const
+{
+    return attribute_index_.get();
+}
+
+void
+IndexSet::enable_attribute_index(const EntryStore& store)
+{
+    attribute_index_ = build_index<AttributeIndex>(store);
+}
+
+void
+IndexSet::disable_attribute_index()
+{
+    attribute_index_.reset();
+}
+
+const SortedAttributeIndex*
+IndexSet::sorted_attribute_index() const
+{
+    return sorted_attribute_index_.get();
+}
+
+void
+IndexSet::enable_sorted_attribute(const EntryStore& store,
+    const std::string& name, AttributeOrder order)
+{
+    if (!sorted_attribute_index_) {
+        sorted_attribute_index_.reset(new SortedAttributeIndex{});
+    }
+    sorted_attribute_index_->add_attribute(store, name, order);
+}
+
+void
+IndexSet::disable_sorted_attribute(const std::string& name)
+{
+    if (!sorted_attribute_index_) {
+        return;
+    }
+    sorted_attribute_index_->remove_attribute(name);
+    if (sorted_attribute_index_->empty()) {
+        sorted_attribute_index_.reset();
+    }
+}
+
+const UrlIndex*
+IndexSet::url_index() const
+{
+    return url_index_.get();
+}
+
+void
+IndexSet::enable_url_index(const EntryStore& store)
+{
+    url_index_ = build_index<UrlIndex>(store);
+}
+
+void
+IndexSet::disable_url_index()
+{
+    url_index_.reset();
+}
+
+const TextIndex*
+IndexSet::text_index() const
+{
+    return text_index_.get();
+}
+
+void
+IndexSet::enable_text_index(const EntryStore& store)
+{
+    text_index_ = build_index<TextIndex>(store);
+}
+
+void
+IndexSet::disable_text_index()
+{
+    text_index_.reset();
+}
+
+const TrigramIndex*
+IndexSet::trigram_index() const
+{
+    return trigram_index_.get();
+}
+
+void
+IndexSet::enable_trigram_index(const EntryStore& store)
+{
+    trigram_index_ = build_index<TrigramIndex>(store);
+}
+
+void
+IndexSet::disable_trigram_index()
+{
+    trigram_index_.reset();
+}
+
+void
+IndexSet::add(const EntryStore& store, size_t row)
+{
+    if (tag_index_) {
+        tag_index_->add(store, row);
+    }
+    if (attribute_index_) {
+        attribute_index_->add(store, row);
+    }
+    if (sorted_attribute_index_) {
+        sorted_attribute_index_->add(store, row);
+    }
+    if (url_index_) {
+        url_index_->add(store, row);
+    }
+    if (text_index_) {
+        text_index_->add(store, row);
+    }
+    if (trigram_index_) {
+        trigram_index_->add(store, row);
+    }
+}
+
+void
+IndexSet::remove(const EntryStore& store, size_t row)
+{
+    if (tag_index_) {
+        tag_index_->remove(store, row);
+    }
+    if (attribute_index_) {
+        attribute_index_->remove(store, row);
+    }
+    if (sorted_attribute_index_) {
+        sorted_attribute_index_->remove(store, row);
+    }
+    if (url_index_) {
+        url_index_->remove(store, row);
+    }
+    if (text_index_) {
+        text_index_->remove(store, row);
+    }
+    if (trigram_index_) {
+        trigram_index_->remove(store, row);
+    }
+}
+
+}  // namespace libjlinkdb
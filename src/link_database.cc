@@ -24,19 +24,37 @@
 
 #include <algorithm>
 #include <cstddef>
+#include <cstdio>
+#include <functional>
 #include <fstream>
 #include <istream>
 #include <iterator>
 #include <memory>
+#include <ostream>
 #include <sstream>
 #include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
 #include <nlohmann/json.hpp>
 
+#include "database_version.hh"
+#include "entry_store.hh"
+#include "index_set.hh"
 #include "jlinkdb_error.hh"
 #include "link_entry.hh"
+#include "operation_log.hh"
+#include "query/compiled_query.hh"
 #include "query/query.hh"
+#include "query/query_plan.hh"
+#include "query_cache.hh"
+#include "snapshot.hh"
+#include "sorted_attribute_index.hh"
+#include "text_index.hh"
+#include "thread_pool.hh"
 
 using nlohmann::json;
 using std::shared_ptr;
@@ -46,15 +64,547 @@ using std::vector;
 
 namespace libjlinkdb {
 
-// Conversions.
-void to_json(json& j, const LinkEntry& link);
-void from_json(const json& j, LinkEntry& link);
+namespace {
 
-void to_json(json& j, const LinkDatabase& database);
-void from_json(const json& j, LinkDatabase& database);
+// The number of bytes DatabaseWriter collects before writing them.
+constexpr std::size_t WRITE_BUFFER_SIZE = 1 << 16;
+
+// Keeps the limit best of the values offered to it in a heap, where
+// before(a, b) returns whether a is better than b.
+template <typename T, typename Before>
+class BoundedHeap {
+public:
+    BoundedHeap(std::size_t limit, Before before)
+        : limit_{limit}, before_{before}
+    {
+    }
+
+    void offer(const T& value)
+    {
+        if (values_.size() < limit_) {
+            values_.push_back(value);
+            std::push_heap(values_.begin(), values_.end(), before_);
+        } else if (limit_ != 0 && before_(value, values_.front())) {
+            // The front of the heap is the worst value kept.
+            std::pop_heap(values_.begin(), values_.end(), before_);
+            values_.back() = value;
+            std::push_heap(values_.begin(), values_.end(), before_);
+        }
+    }
+
+    // Returns the values kept, best first.
+    vector<T> take()
+    {
+        std::sort_heap(values_.begin(), values_.end(), before_);
+        return std::move(values_);
+    }
+
+private:
+    std::size_t limit_;
+    Before before_;
+    vector<T> values_;
+};
+
+template <typename T, typename Before>
+BoundedHeap<T, Before>
+make_bounded_heap(std::size_t limit, Before before)
+{
+    return BoundedHeap<T, Before>{limit, before};
+}
+
+// Returns the length of the valid UTF-8 sequence starting at position i of
+// str, whose first byte is outside ASCII, or 0 if it isn't valid. Overlong
+// forms, surrogates and code points past U+10FFFF aren't valid.
+std::size_t
+utf8_sequence_length(const string& str, std::size_t i)
+{
+    auto byte = [&](std::size_t j) {
+        return j < str.size() ? static_cast<unsigned char>(str[j]) : 0;
+    };
+
+    // The range of the second byte depends on the first, and the rest are
+    // continuation bytes.
+    unsigned char lead = byte(i);
+    unsigned char low = 0x80;
+    unsigned char high = 0xbf;
+    std::size_t length = 0;
+    if (lead >= 0xc2 && lead <= 0xdf) {
+        length = 2;
+    } else if (lead >= 0xe0 && lead <= 0xef) {
+        length = 3;
+        if (lead == 0xe0) {
+            low = 0xa0;
+        } else if (lead == 0xed) {
+            high = 0x9f;
+        }
+    } else if (lead >= 0xf0 && lead <= 0xf4) {
+        length = 4;
+        if (lead == 0xf0) {
+            low = 0x90;
+        } else if (lead == 0xf4) {
+            high = 0x8f;
+        }
+    } else {
+        return 0;
+    }
+
+    unsigned char second = byte(i + 1);
+    if (second < low || second > high) {
+        return 0;
+    }
+    for (std::size_t j = 2; j < length; ++j) {
+        unsigned char next = byte(i + j);
+        if (next < 0x80 || next > 0xbf) {
+            return 0;
+        }
+    }
+    return length;
+}
+
+// Writes a database as JSON one entry at a time, so that only the entry
+// being written is held in memory. The output is the same as dumping the
+// database as a json value with nlohmann::json: compact, with the fields of
+// each entry and its attributes sorted by name.
+class DatabaseWriter {
+public:
+    explicit DatabaseWriter(std::ostream& writer) : writer_{writer}
+    {
+        buffer_.reserve(WRITE_BUFFER_SIZE);
+    }
+
+    void write(const LinkDatabase& database)
+    {
+        buffer_ += "{\"links\":[";
+        bool first = true;
+        for (auto it = database.links_cbegin(); it != database.links_cend();
+             ++it) {
+            if (!first) {
+                buffer_ += ',';
+            }
+            first = false;
+            write_entry(*it->second);
+            if (buffer_.size() >= WRITE_BUFFER_SIZE) {
+                flush();
+            }
+        }
+        buffer_ += "]}";
+        flush();
+    }
+
+private:
+    void write_entry(const LinkEntry& entry)
+    {
+        attributes_.clear();
+        for (const auto& attribute : entry.attributes()) {
+            attributes_.push_back(&attribute);
+        }
+        std::sort(attributes_.begin(), attributes_.end(),
+            [](const Attribute* first, const Attribute* second) {
+                return first->first < second->first;
+            });
+
+        buffer_ += "{\"attributes\":{";
+        for (std::size_t i = 0; i < attributes_.size(); ++i) {
+            if (i > 0) {
+                buffer_ += ',';
+            }
+            write_string(attributes_[i]->first);
+            buffer_ += ':';
+            write_string(attributes_[i]->second);
+        }
+        buffer_ += "},\"description\":";
+        write_string(entry.description());
+        buffer_ += ",\"location\":";
+        write_string(entry.location());
+        buffer_ += ",\"name\":";
+        write_string(entry.name());
+        buffer_ += ",\"tags\":[";
+        bool first = true;
+        for (const auto& tag : entry.tags()) {
+            if (!first) {
+                buffer_ += ',';
+            }
+            first = false;
+            write_string(tag);
+        }
+        buffer_ += "]}";
+    }
+
+    // Appends str as a quoted JSON string, escaping the characters JSON
+    // requires. Other bytes are copied as they are. Throws a JLinkDbError
+    // if str isn't valid UTF-8, as dumping a json value does.
+    void write_string(const std::string& str)
+    {
+        static const char HEX_DIGITS[] = "0123456789abcdef";
+
+        buffer_ += '"';
+        std::size_t start = 0;
+        for (std::size_t i = 0; i < str.size(); ++i) {
+            auto c = static_cast<unsigned char>(str[i]);
+            if (c >= 0x80) {
+                std::size_t length = utf8_sequence_length(str, i);
+                if (length == 0) {
+                    std::ostringstream message;
+                    message << "invalid UTF-8 byte at index " << i
+                            << " of string";
+                    throw JLinkDbError{message.str()};
+                }
+                i += length - 1;
+                continue;
+            }
+            if (c >= 0x20 && c != '"' && c != '\\') {
+                continue;
+            }
+
+            buffer_.append(str, start, i - start);
+            start = i + 1;
+            buffer_ += '\\';
+            switch (c) {
+            case '"':
+                buffer_ += '"';
+                break;
+            case '\\':
+                buffer_ += '\\';
+                break;
+            case '\b':
+                buffer_ += 'b';
+                break;
+            case '\f':
+                buffer_ += 'f';
+                break;
+            case '\n':
+                buffer_ += 'n';
+                break;
+            case '\r':
+                buffer_ += 'r';
+                break;
+            case '\t':
+                buffer_ += 't';
+                break;
+            default:
+                buffer_ += "u00";
+                buffer_ += HEX_DIGITS[c >> 4];
+                buffer_ += HEX_DIGITS[c & 0xf];
+                break;
+            }
+        }
+        buffer_.append(str, start, string::npos);
+        buffer_ += '"';
+    }
+
+    void flush()
+    {
+        writer_.write(buffer_.data(), buffer_.size());
+        buffer_.clear();
+    }
+
+    using Attribute = std::pair<const string, string>;
+
+    std::ostream& writer_;
+    std::string buffer_;
+    // The attributes of the entry being written, sorted by name.
+    vector<const Attribute*> attributes_;
+};
+
+
+// The number of entries the reader collects before adding them to the
+// database together.
+constexpr std::size_t LOAD_BATCH_SIZE = 4096;
+
+// Adds the entries in a JSON document to a database in batches as the parser
+// reads them, without building the document in memory. The document must be
+// an object with a "links" field holding the entries. Other fields, and
+// fields of entries that aren't known, are skipped. This accepts what
+// reading the document into a json value did: every value in "links" that
+// isn't an object is read as an empty entry, a "links" value that isn't an
+// array or object is one such entry unless it is null, tags may be a single
+// string, and attributes may be an array, named by index, or a single
+// string with an empty name.
+class DatabaseReader {
+public:
+    explicit DatabaseReader(LinkDatabase& database) : database_{database}
+    {
+    }
+
+    // Adds the entries that haven't been added yet. Throws a JLinkDbError
+    // if the document had no "links" field.
+    void finish()
+    {
+        if (!found_links_) {
+            throw JLinkDbError{"no \"links\" field in database"};
+        }
+        flush();
+    }
+
+    // Handlers for the SAX interface of nlohmann::json.
+    bool null()
+    {
+        if (!skipping() && in(Context::ENTRY)) {
+            return field_null();
+        }
+        if (!skipping() && in(Context::ROOT)) {
+            // Null "links" hold no entries.
+            found_links_ = found_links_ || key_ == "links";
+            return true;
+        }
+        return scalar();
+    }
+
+    bool boolean(bool /* value */)
+    {
+        return scalar();
+    }
+
+    bool number_integer(json::number_integer_t /* value */)
+    {
+        return scalar();
+    }
+
+    bool number_unsigned(json::number_unsigned_t /* value */)
+    {
+        return scalar();
+    }
+
+    bool number_float(
+        json::number_float_t /* value */, const json::string_t& /* raw */)
+    {
+        return scalar();
+    }
+
+    bool string(json::string_t& value)
+    {
+        if (skipping()) {
+            return true;
+        }
+        if (in(Context::ENTRY)) {
+            return field_string(value);
+        }
+        if (in(Context::TAGS)) {
+            entry_->add_tag(value);
+            return true;
+        }
+        if (in(Context::ATTRIBUTES)) {
+            entry_->set_attribute(key_, value);
+            return true;
+        }
+        if (in(Context::ATTRIBUTE_ARRAY)) {
+            entry_->set_attribute(std::to_string(attribute_index_++), value);
+            return true;
+        }
+        return scalar();
+    }
+
+    bool start_object(std::size_t /* size */)
+    {
+        return start(true);
+    }
+
+    bool key(json::string_t& value)
+    {
+        key_.swap(value);
+        return true;
+    }
+
+    bool end_object()
+    {
+        return end();
+    }
+
+    bool start_array(std::size_t /* size */)
+    {
+        return start(false);
+    }
+
+    bool end_array()
+    {
+        return end();
+    }
+
+    bool parse_error(std::size_t position, const std::string& /* token */,
+        const nlohmann::detail::exception& e)
+    {
+        std::ostringstream message;
+        message << "failed to parse database file: \"";
+        message << e.what();
+        message << "\": at position ";
+        message << position;
+        throw JLinkDbError{message.str()};
+    }
+
+private:
+    // The containers the reader is in.
+    enum class Context {
+        SKIP,
+        ROOT,
+        LINKS,
+        ENTRY,
+        TAGS,
+        ATTRIBUTES,
+        // Attributes given as an array, named by their index.
+        ATTRIBUTE_ARRAY
+    };
+
+    bool skipping() const
+    {
+        return !contexts_.empty() && contexts_.back() == Context::SKIP;
+    }
+
+    bool in(Context context) const
+    {
+        return !contexts_.empty() && contexts_.back() == context;
+    }
+
+    // Handles the start of an object, if is_object is true, or an array.
+    bool start(bool is_object)
+    {
+        if (contexts_.empty()) {
+            contexts_.push_back(is_object ? Context::ROOT : Context::SKIP);
+        } else if (skipping()) {
+            contexts_.push_back(Context::SKIP);
+        } else if (in(Context::ROOT)) {
+            bool links = key_ == "links";
+            found_links_ = found_links_ || links;
+            contexts_.push_back(links ? Context::LINKS : Context::SKIP);
+        } else if (in(Context::LINKS)) {
+            if (is_object) {
+                entry_ = std::make_shared<LinkEntry>();
+                contexts_.push_back(Context::ENTRY);
+            } else {
+                add(std::make_shared<LinkEntry>());
+                contexts_.push_back(Context::SKIP);
+            }
+        } else if (in(Context::ENTRY)) {
+            contexts_.push_back(field_context(is_object));
+        } else {
+            throw_not_string();
+        }
+        return true;
+    }
+
+    void add(shared_ptr<LinkEntry> entry)
+    {
+        pending_.push_back(std::move(entry));
+        if (pending_.size() >= LOAD_BATCH_SIZE) {
+            flush();
+        }
+    }
+
+    void flush()
+    {
+        if (!pending_.empty()) {
+            database_.add_entries(pending_);
+            pending_.clear();
+        }
+    }
+
+    // Returns the context for an object or array in a field of an entry.
+    Context field_context(bool is_object)
+    {
+        if (key_ == "tags") {
+            return Context::TAGS;
+        }
+        if (key_ == "attributes") {
+            attribute_index_ = 0;
+            return is_object ? Context::ATTRIBUTES : Context::ATTRIBUTE_ARRAY;
+        }
+        if (is_known_field()) {
+            throw_not_string();
+        }
+        return Context::SKIP;
+    }
+
+    bool end()
+    {
+        Context context = contexts_.back();
+        contexts_.pop_back();
+        if (context == Context::ENTRY) {
+            add(std::move(entry_));
+        }
+        return true;
+    }
+
+    // Handles a value that isn't a string, object or array.
+    bool scalar()
+    {
+        if (skipping()) {
+            return true;
+        }
+        if (in(Context::ROOT)) {
+            if (key_ == "links") {
+                found_links_ = true;
+                add(std::make_shared<LinkEntry>());
+            }
+        } else if (in(Context::LINKS)) {
+            add(std::make_shared<LinkEntry>());
+        } else if (in(Context::ENTRY)) {
+            if (is_known_field()) {
+                throw_not_string();
+            }
+        } else if (in(Context::TAGS) || in(Context::ATTRIBUTES)
+            || in(Context::ATTRIBUTE_ARRAY)) {
+            throw_not_string();
+        }
+        return true;
+    }
+
+    // Handles a null field of an entry. A null list of tags or attributes
+    // is empty.
+    bool field_null()
+    {
+        if (key_ == "tags" || key_ == "attributes") {
+            return true;
+        }
+        return scalar();
+    }
+
+    // Handles a string field of an entry.
+    bool field_string(const std::string& value)
+    {
+        if (key_ == "location") {
+            entry_->set_location(value);
+        } else if (key_ == "name") {
+            entry_->set_name(value);
+        } else if (key_ == "description") {
+            entry_->set_description(value);
+        } else if (key_ == "tags") {
+            entry_->add_tag(value);
+        } else if (key_ == "attributes") {
+            entry_->set_attribute("", value);
+        }
+        return true;
+    }
+
+    bool is_known_field() const
+    {
+        return key_ == "location" || key_ == "name" || key_ == "description"
+            || key_ == "tags" || key_ == "attributes";
+    }
+
+    [[noreturn]] void throw_not_string() const
+    {
+        std::ostringstream message;
+        message << "expected a string for \"" << key_ << "\" in database";
+        throw JLinkDbError{message.str()};
+    }
+
+    LinkDatabase& database_;
+    std::vector<Context> contexts_;
+    // The last key read.
+    std::string key_;
+    // The entry being read, if the reader is in one.
+    shared_ptr<LinkEntry> entry_;
+    // The entries read but not added to the database yet.
+    vector<shared_ptr<LinkEntry>> pending_;
+    // The index of the next attribute in an array of attributes.
+    std::size_t attribute_index_ = 0;
+    bool found_links_ = false;
+};
+
+}  // namespace
 
 LinkDatabase::LinkDatabase()
 {
+    listen_to_entries();
 }
 
 LinkDatabase::LinkDatabase(std::istream& reader) : LinkDatabase{}
@@ -75,6 +625,98 @@ LinkDatabase::LinkDatabase(const string& path) : LinkDatabase{}
     load_from_stream(reader);
 }
 
+LinkDatabase::LinkDatabase(const Snapshot& snapshot) : LinkDatabase{}
+{
+    links_ = EntryStore{snapshot};
+    highest_id_ = snapshot.next_id();
+}
+
+LinkDatabase::LinkDatabase(const LinkDatabase& other)
+    : links_{other.links_},
+      indexes_{other.indexes_},
+      highest_id_{other.highest_id_},
+      search_pool_{other.search_pool_},
+      parallel_search_threshold_{other.parallel_search_threshold_},
+      entry_added_{other.entry_added_},
+      entry_deleted_{other.entry_deleted_},
+      entry_changed_{other.entry_changed_},
+      entries_added_{other.entries_added_},
+      entries_deleted_{other.entries_deleted_}
+{
+    if (other.query_cache_ != nullptr) {
+        set_query_cache_capacity(other.query_cache_->capacity());
+    }
+    listen_to_entries();
+}
+
+LinkDatabase::LinkDatabase(LinkDatabase&& other)
+    : links_{std::move(other.links_)},
+      indexes_{std::move(other.indexes_)},
+      highest_id_{other.highest_id_},
+      search_pool_{other.search_pool_},
+      parallel_search_threshold_{other.parallel_search_threshold_},
+      log_{std::move(other.log_)},
+      versions_{std::move(other.versions_)},
+      latest_version_{std::move(other.latest_version_)},
+      query_cache_{std::move(other.query_cache_)},
+      entry_added_{other.entry_added_},
+      entry_deleted_{other.entry_deleted_},
+      entry_changed_{other.entry_changed_},
+      entries_added_{other.entries_added_},
+      entries_deleted_{other.entries_deleted_}
+{
+    listen_to_entries();
+}
+
+LinkDatabase&
+LinkDatabase::operator=(const LinkDatabase& other)
+{
+    if (this != &other) {
+        close_log();
+        links_ = other.links_;
+        indexes_ = other.indexes_;
+        highest_id_ = other.highest_id_;
+        search_pool_ = other.search_pool_;
+        parallel_search_threshold_ = other.parallel_search_threshold_;
+        versions_.reset();
+        std::atomic_store(
+            &latest_version_, shared_ptr<const DatabaseVersion>{});
+        query_cache_.reset();
+        if (other.query_cache_ != nullptr) {
+            set_query_cache_capacity(other.query_cache_->capacity());
+        }
+        entry_added_ = other.entry_added_;
+        entry_deleted_ = other.entry_deleted_;
+        entry_changed_ = other.entry_changed_;
+        entries_added_ = other.entries_added_;
+        entries_deleted_ = other.entries_deleted_;
+    }
+    return *this;
+}
+
+LinkDatabase&
+LinkDatabase::operator=(LinkDatabase&& other)
+{
+    if (this != &other) {
+        links_ = std::move(other.links_);
+        indexes_ = std::move(other.indexes_);
+        highest_id_ = other.highest_id_;
+        search_pool_ = other.search_pool_;
+        parallel_search_threshold_ = other.parallel_search_threshold_;
+        log_ = std::move(other.log_);
+        versions_ = std::move(other.versions_);
+        std::atomic_store(
+            &latest_version_, std::move(other.latest_version_));
+        query_cache_ = std::move(other.query_cache_);
+        entry_added_ = other.entry_added_;
+        entry_deleted_ = other.entry_deleted_;
+        entry_changed_ = other.entry_changed_;
+        entries_added_ = other.entries_added_;
+        entries_deleted_ = other.entries_deleted_;
+    }
+    return *this;
+}
+
 LinkDatabase::LinkEntryIterator
 LinkDatabase::links_begin()
 {
@@ -90,13 +732,13 @@ LinkDatabase::links_end()
 LinkDatabase::ConstLinkEntryIterator
 LinkDatabase::links_cbegin() const
 {
-    return links_.cbegin();
+    return links_.begin();
 }
 
 LinkDatabase::ConstLinkEntryIterator
 LinkDatabase::links_cend() const
 {
-    return links_.cend();
+    return links_.end();
 }
 
 std::size_t
@@ -108,15 +750,14 @@ LinkDatabase::links_count() const
 bool
 LinkDatabase::has_entry(int id) const
 {
-    return links_.find(id) != links_.end();
+    return id >= 0 && links_.has_row(id);
 }
 
 shared_ptr<LinkEntry>
 LinkDatabase::get_entry(int id) const
 {
-    auto position = links_.find(id);
-    if (position != links_.end())
-        return position->second;
+    if (has_entry(id))
+        return links_.entry(id);
     else
         return {};
 }
@@ -125,35 +766,571 @@ int
 LinkDatabase::add_entry(shared_ptr<LinkEntry> entry)
 {
     int id = highest_id_;
-    links_[id] = entry;
-    ++highest_id_;
+    insert_entry(id, entry);
+    if (log_ != nullptr) {
+        log_->append({OperationLog::Operation::ADD, id, links_.entry(id), {},
+                         {}},
+            log_batch_depth_ == 0);
+    }
     entry_added_(id);
+    if (!entries_added_.empty()) {
+        entries_added_(id, id + 1);
+    }
     return id;
 }
 
+int
+LinkDatabase::add_entries(const vector<shared_ptr<LinkEntry>>& entries)
+{
+    int first = highest_id_;
+    std::size_t rows = first + entries.size();
+    links_.reserve(rows);
+
+    int id = first;
+    for (const auto& entry : entries) {
+        insert_entry(id, entry);
+        if (log_ != nullptr) {
+            log_->append({OperationLog::Operation::ADD, id, links_.entry(id),
+                             {}, {}},
+                false);
+        }
+        ++id;
+    }
+    if (log_ != nullptr && log_batch_depth_ == 0) {
+        log_->sync_if_due();
+    }
+
+    if (!entry_added_.empty()) {
+        for (int added = first; added < id; ++added) {
+            entry_added_(added);
+        }
+    }
+    if (id != first) {
+        entries_added_(first, id);
+    }
+    return first;
+}
+
 void
 LinkDatabase::delete_entry(int id)
 {
-    if (links_.erase(id) > 0)
-        entry_deleted_(id);
+    if (!has_entry(id))
+        return;
+
+    indexes_.remove(links_, id);
+    links_.erase(id);
+    record_change(id);
+    if (log_ != nullptr) {
+        log_->append({OperationLog::Operation::DELETE, id, nullptr, {}, {}},
+            log_batch_depth_ == 0);
+    }
+    entry_deleted_(id);
+    if (!entries_deleted_.empty()) {
+        entries_deleted_(vector<int>{id});
+    }
+}
+
+void
+LinkDatabase::delete_entries(const vector<int>& ids)
+{
+    vector<int> deleted;
+    deleted.reserve(ids.size());
+    for (int id : ids) {
+        if (!has_entry(id))
+            continue;
+
+        indexes_.remove(links_, id);
+        links_.erase(id);
+        record_change(id);
+        if (log_ != nullptr) {
+            log_->append(
+                {OperationLog::Operation::DELETE, id, nullptr, {}, {}}, false);
+        }
+        deleted.push_back(id);
+    }
+    if (log_ != nullptr && log_batch_depth_ == 0) {
+        log_->sync_if_due();
+    }
+
+    if (!entry_deleted_.empty()) {
+        for (int id : deleted) {
+            entry_deleted_(id);
+        }
+    }
+    if (!deleted.empty()) {
+        entries_deleted_(deleted);
+    }
+}
+
+void
+LinkDatabase::replace_entry(int id, shared_ptr<LinkEntry> entry)
+{
+    if (!has_entry(id) || entry == nullptr)
+        return;
+
+    indexes_.remove(links_, id);
+    links_.insert(id, entry);
+    indexes_.add(links_, id);
+    record_change(id);
+    if (log_ != nullptr) {
+        log_->append({OperationLog::Operation::ADD, id, entry, {}, {}},
+            log_batch_depth_ == 0);
+    }
+    entry_changed_(id);
 }
 
 vector<std::pair<int, shared_ptr<LinkEntry>>>
 LinkDatabase::search(const query::Query& query) const
 {
+    if (query_cache_ == nullptr) {
+        return run_search(query);
+    }
+    // Equivalent queries share results through the key of their canonical
+    // form.
+    shared_ptr<query::Query> canonical = query.canonical();
+    string key = canonical != nullptr ? canonical->key() : query.key();
+    if (key.empty()) {
+        return run_search(query);
+    }
+
+    vector<int> ids;
+    if (query_cache_->find(key, query, links_, ids)) {
+        vector<std::pair<int, shared_ptr<LinkEntry>>> result;
+        result.reserve(ids.size());
+        for (int id : ids) {
+            result.emplace_back(id, links_.entry(id));
+        }
+        return result;
+    }
+
+    auto result = run_search(query);
+    ids.reserve(result.size());
+    for (const auto& match : result) {
+        ids.push_back(match.first);
+    }
+    query_cache_->insert(key, std::move(ids));
+    return result;
+}
+
+vector<std::pair<int, shared_ptr<LinkEntry>>>
+LinkDatabase::search(
+    const query::Query& query, std::size_t limit, SearchOrder order) const
+{
+    vector<std::pair<int, shared_ptr<LinkEntry>>> result;
+    if (limit == 0) {
+        return result;
+    }
+
+    if (order == SearchOrder::ID) {
+        scan(plan(query), [&](std::size_t row) {
+            result.emplace_back(static_cast<int>(row), links_.entry(row));
+            return result.size() < limit;
+        });
+        return result;
+    }
+
+    auto field = order == SearchOrder::NAME ? &EntryStore::name
+                                            : &EntryStore::location;
+    auto heap = make_bounded_heap<std::size_t>(
+        limit, [&](std::size_t row1, std::size_t row2) {
+            int comparison =
+                (links_.*field)(row1).compare((links_.*field)(row2));
+            return comparison < 0 || (comparison == 0 && row1 < row2);
+        });
+    scan(plan(query), [&](std::size_t row) {
+        heap.offer(row);
+        return true;
+    });
+    for (std::size_t row : heap.take()) {
+        result.emplace_back(static_cast<int>(row), links_.entry(row));
+    }
+    return result;
+}
+
+vector<std::pair<int, shared_ptr<LinkEntry>>>
+LinkDatabase::search(const query::Query& query, std::size_t limit,
+    const std::function<double(const LinkEntry&)>& score) const
+{
+    using Scored = std::pair<double, std::size_t>;
+
     vector<std::pair<int, shared_ptr<LinkEntry>>> result;
-    std::copy_if(links_.begin(), links_.end(), std::back_inserter(result),
-        [&query](const std::pair<int, shared_ptr<LinkEntry>>& entry) {
-            return query.matches(*entry.second.get());
+    if (limit == 0) {
+        return result;
+    }
+
+    auto heap = make_bounded_heap<Scored>(
+        limit, [](const Scored& scored1, const Scored& scored2) {
+            if (scored1.first != scored2.first) {
+                return scored1.first > scored2.first;
+            }
+            return scored1.second < scored2.second;
         });
+    scan(plan(query), [&](std::size_t row) {
+        heap.offer(Scored{score(*links_.entry(row)), row});
+        return true;
+    });
+    for (const Scored& scored : heap.take()) {
+        result.emplace_back(
+            static_cast<int>(scored.second), links_.entry(scored.second));
+    }
+    return result;
+}
+
+void
+LinkDatabase::search_each(const query::Query& query,
+    const std::function<bool(int, const LinkEntry&)>& callback) const
+{
+    scan(plan(query), [&](std::size_t row) {
+        return callback(static_cast<int>(row), *links_.entry(row));
+    });
+}
+
+std::size_t
+LinkDatabase::count(const query::Query& query) const
+{
+    std::size_t result = 0;
+    scan(plan(query), [&](std::size_t) {
+        ++result;
+        return true;
+    });
+    return result;
+}
+
+bool
+LinkDatabase::exists(const query::Query& query) const
+{
+    bool result = false;
+    scan(plan(query), [&](std::size_t) {
+        result = true;
+        return false;
+    });
     return result;
 }
 
+void
+LinkDatabase::search_each(query::QueryPlan& query_plan,
+    const std::function<bool(int, const LinkEntry&)>& callback) const
+{
+    query_plan.update_candidates(indexes_);
+    scan(query_plan, [&](std::size_t row) {
+        return callback(static_cast<int>(row), *links_.entry(row));
+    });
+}
+
+std::size_t
+LinkDatabase::count(query::QueryPlan& query_plan) const
+{
+    query_plan.update_candidates(indexes_);
+    std::size_t result = 0;
+    scan(query_plan, [&](std::size_t) {
+        ++result;
+        return true;
+    });
+    return result;
+}
+
+bool
+LinkDatabase::exists(query::QueryPlan& query_plan) const
+{
+    query_plan.update_candidates(indexes_);
+    bool result = false;
+    scan(query_plan, [&](std::size_t) {
+        result = true;
+        return false;
+    });
+    return result;
+}
+
+vector<RankedEntry>
+LinkDatabase::ranked_search(const string& text, std::size_t limit,
+    const TextSearchOptions& options) const
+{
+    const TextIndex* index = indexes_.text_index();
+    if (index == nullptr) {
+        throw JLinkDbError{"ranked search without a text index"};
+    }
+
+    vector<RankedEntry> result;
+    for (const TextMatch& match : index->search(text, limit, options)) {
+        result.push_back(RankedEntry{static_cast<int>(match.row),
+            match.score, links_.entry(match.row)});
+    }
+    return result;
+}
+
+void
+LinkDatabase::scan(const query::QueryPlan& query_plan,
+    const std::function<bool(std::size_t)>& visit) const
+{
+    const query::CompiledQuery& compiled = query_plan.compiled();
+    const vector<std::size_t>* candidates =
+        query_plan.uses_indexes() ? &query_plan.candidates() : nullptr;
+    std::size_t count =
+        candidates != nullptr ? candidates->size() : links_.rows();
+
+    for (std::size_t i = 0; i < count; ++i) {
+        std::size_t row = candidates != nullptr ? (*candidates)[i] : i;
+        if (links_.has_row(row) && compiled.matches_row(links_, row)
+            && !visit(row)) {
+            return;
+        }
+    }
+}
+
+vector<std::pair<int, shared_ptr<LinkEntry>>>
+LinkDatabase::run_search(const query::Query& query) const
+{
+    using Result = vector<std::pair<int, shared_ptr<LinkEntry>>>;
+
+    query::QueryPlan query_plan{plan(query)};
+    const query::CompiledQuery& compiled = query_plan.compiled();
+    const vector<std::size_t>* candidates =
+        query_plan.uses_indexes() ? &query_plan.candidates() : nullptr;
+    std::size_t count =
+        candidates != nullptr ? candidates->size() : links_.rows();
+
+    // Checks the rows from position begin up to end, either in the
+    // candidates or in the store.
+    auto check_rows = [&](std::size_t begin, std::size_t end, Result& out) {
+        for (std::size_t i = begin; i < end; ++i) {
+            std::size_t row = candidates != nullptr ? (*candidates)[i] : i;
+            if (links_.has_row(row) && compiled.matches_row(links_, row)) {
+                out.emplace_back(static_cast<int>(row), links_.entry(row));
+            }
+        }
+    };
+
+    Result result;
+    if (search_pool_ == nullptr || count < parallel_search_threshold_) {
+        check_rows(0, count, result);
+        return result;
+    }
+
+    // Split the rows into contiguous partitions, a few per thread so that
+    // uneven partitions even out, and join them in order.
+    std::size_t partitions = std::min(count, search_pool_->size() * 4);
+    vector<Result> partial(partitions);
+    search_pool_->run(partitions, [&](std::size_t partition) {
+        check_rows(count * partition / partitions,
+            count * (partition + 1) / partitions, partial[partition]);
+    });
+
+    std::size_t total = 0;
+    for (const auto& part : partial) {
+        total += part.size();
+    }
+    result.reserve(total);
+    for (auto& part : partial) {
+        std::move(part.begin(), part.end(), std::back_inserter(result));
+    }
+    return result;
+}
+
+query::QueryPlan
+LinkDatabase::plan(const query::Query& query) const
+{
+    return query::QueryPlan{query, links_, indexes_};
+}
+
+shared_ptr<const DatabaseVersion>
+LinkDatabase::snapshot()
+{
+    if (versions_ == nullptr) {
+        versions_.reset(new VersionBuilder);
+        for (std::size_t row = 0; row < links_.rows(); ++row) {
+            versions_->mark(row);
+        }
+    }
+
+    auto version = versions_->build(links_);
+    std::atomic_store(&latest_version_, version);
+    return version;
+}
+
+shared_ptr<const DatabaseVersion>
+LinkDatabase::latest_snapshot() const
+{
+    return std::atomic_load(&latest_version_);
+}
+
+void
+LinkDatabase::set_search_threads(std::size_t threads)
+{
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (threads == search_threads()) {
+        return;
+    }
+
+    if (threads == 1) {
+        search_pool_.reset();
+    } else {
+        search_pool_ = std::make_shared<ThreadPool>(threads);
+    }
+}
+
+std::size_t
+LinkDatabase::search_threads() const
+{
+    return search_pool_ != nullptr ? search_pool_->size() : 1;
+}
+
+void
+LinkDatabase::set_parallel_search_threshold(std::size_t rows)
+{
+    parallel_search_threshold_ = rows;
+}
+
+std::size_t
+LinkDatabase::parallel_search_threshold() const
+{
+    return parallel_search_threshold_;
+}
+
+void
+LinkDatabase::set_query_cache_capacity(std::size_t bytes)
+{
+    if (bytes == 0) {
+        query_cache_.reset();
+    } else if (query_cache_ == nullptr) {
+        query_cache_.reset(new QueryCache{bytes});
+    } else {
+        query_cache_->set_capacity(bytes);
+    }
+}
+
+const QueryCache*
+LinkDatabase::query_cache() const
+{
+    return query_cache_.get();
+}
+
+void
+LinkDatabase::set_tag_index_enabled(bool enabled)
+{
+    if (enabled == tag_index_enabled()) {
+        return;
+    }
+
+    if (enabled) {
+        indexes_.enable_tag_index(links_);
+    } else {
+        indexes_.disable_tag_index();
+    }
+}
+
+bool
+LinkDatabase::tag_index_enabled() const
+{
+    return indexes_.tag_index() != nullptr;
+}
+
+void
+LinkDatabase::set_attribute_index_enabled(bool enabled)
+{
+    if (enabled == attribute_index_enabled()) {
+        return;
+    }
+
+    if (enabled) {
+        indexes_.enable_attribute_index(links_);
+    } else {
+        indexes_.disable_attribute_index();
+    }
+}
+
+bool
+LinkDatabase::attribute_index_enabled() const
+{
+    return indexes_.attribute_index() != nullptr;
+}
+
+void
+LinkDatabase::add_sorted_attribute_index(
+    const string& name, AttributeOrder order)
+{
+    indexes_.enable_sorted_attribute(links_, name, order);
+}
+
+void
+LinkDatabase::remove_sorted_attribute_index(const string& name)
+{
+    indexes_.disable_sorted_attribute(name);
+}
+
+bool
+LinkDatabase::has_sorted_attribute_index(const string& name) const
+{
+    const SortedAttributeIndex* index = indexes_.sorted_attribute_index();
+    return index != nullptr && index->has_attribute(name);
+}
+
+void
+LinkDatabase::set_url_index_enabled(bool enabled)
+{
+    if (enabled == url_index_enabled()) {
+        return;
+    }
+
+    if (enabled) {
+        indexes_.enable_url_index(links_);
+    } else {
+        indexes_.disable_url_index();
+    }
+}
+
+bool
+LinkDatabase::url_index_enabled() const
+{
+    return indexes_.url_index() != nullptr;
+}
+
+void
+LinkDatabase::set_text_index_enabled(bool enabled)
+{
+    if (enabled == text_index_enabled()) {
+        return;
+    }
+
+    if (enabled) {
+        indexes_.enable_text_index(links_);
+    } else {
+        indexes_.disable_text_index();
+    }
+}
+
+bool
+LinkDatabase::text_index_enabled() const
+{
+    return indexes_.text_index() != nullptr;
+}
+
+void
+LinkDatabase::set_trigram_index_enabled(bool enabled)
+{
+    if (enabled == trigram_index_enabled()) {
+        return;
+    }
+
+    if (enabled) {
+        indexes_.enable_trigram_index(links_);
+    } else {
+        indexes_.disable_trigram_index();
+    }
+}
+
+bool
+LinkDatabase::trigram_index_enabled() const
+{
+    return indexes_.trigram_index() != nullptr;
+}
+
 void
 LinkDatabase::write_to_stream(std::ostream& writer) const
 {
-    json data{*this};
-    writer << data;
+    DatabaseWriter database_writer{writer};
+    database_writer.write(*this);
 }
 
 void
@@ -170,6 +1347,105 @@ LinkDatabase::write_to_file(const string& path) const
     write_to_stream(writer);
 }
 
+void
+LinkDatabase::write_snapshot_to_stream(std::ostream& writer) const
+{
+    Snapshot::write(writer, links_);
+}
+
+void
+LinkDatabase::write_snapshot_to_file(const string& path) const
+{
+    std::ofstream writer{path, std::ios::binary};
+    if (!writer.is_open()) {
+        std::ostringstream message;
+        message << "failed to open file ";
+        message << path;
+        throw JLinkDbError{message.str()};
+    }
+
+    write_snapshot_to_stream(writer);
+}
+
+void
+LinkDatabase::open_log(const string& path)
+{
+    close_log();
+    unique_ptr<OperationLog> log{new OperationLog{path}};
+    log->replay(
+        [this](const OperationLog::Record& record) { replay(record); });
+    log_ = std::move(log);
+}
+
+void
+LinkDatabase::close_log()
+{
+    if (log_ != nullptr) {
+        log_->sync();
+        log_.reset();
+    }
+}
+
+bool
+LinkDatabase::has_log() const
+{
+    return log_ != nullptr;
+}
+
+void
+LinkDatabase::sync_log()
+{
+    if (log_ != nullptr) {
+        log_->sync();
+    }
+}
+
+void
+LinkDatabase::set_log_sync_interval(std::size_t records)
+{
+    if (log_ != nullptr) {
+        log_->set_sync_interval(records);
+    }
+}
+
+void
+LinkDatabase::begin_log_batch()
+{
+    ++log_batch_depth_;
+}
+
+void
+LinkDatabase::end_log_batch()
+{
+    if (log_batch_depth_ == 0) {
+        return;
+    }
+    --log_batch_depth_;
+    if (log_ != nullptr && log_batch_depth_ == 0) {
+        log_->sync_if_due();
+    }
+}
+
+void
+LinkDatabase::checkpoint(const string& path)
+{
+    // Write the snapshot beside the old one and rename it over the old one
+    // once it is on disk, so that a crash leaves one or the other.
+    string temporary_path{path + ".tmp"};
+    write_snapshot_to_file(temporary_path);
+    sync_file(temporary_path);
+    if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+        std::ostringstream message;
+        message << "failed to replace file ";
+        message << path;
+        throw JLinkDbError{message.str()};
+    }
+
+    if (log_ != nullptr) {
+        log_->clear();
+    }
+}
+
 sigc::signal<void, int>&
 LinkDatabase::signal_entry_added()
 {
@@ -182,90 +1458,189 @@ LinkDatabase::signal_entry_deleted()
     return entry_deleted_;
 }
 
+sigc::signal<void, int>&
+LinkDatabase::signal_entry_changed()
+{
+    return entry_changed_;
+}
+
+sigc::signal<void, int, int>&
+LinkDatabase::signal_entries_added()
+{
+    return entries_added_;
+}
+
+sigc::signal<void, const vector<int>&>&
+LinkDatabase::signal_entries_deleted()
+{
+    return entries_deleted_;
+}
+
 void
 LinkDatabase::load_from_stream(std::istream& reader)
 {
-    json data;
-    try {
-        reader >> data;
-    } catch (const json::parse_error& e) {
-        std::ostringstream message;
-        message << "failed to parse database file: \"";
-        message << e.what();
-        message << "\": at position ";
-        message << e.byte;
-        throw JLinkDbError{message.str()};
-    }
-    data.get_to(*this);
+    DatabaseReader database_reader{*this};
+    json::sax_parse(reader, &database_reader, json::input_format_t::json,
+        false);
+    database_reader.finish();
 }
 
 void
-to_json(json& j, const LinkEntry& link)
+LinkDatabase::insert_entry(int id, shared_ptr<LinkEntry> entry)
 {
-    j = {{"location", link.location()}, {"name", link.name()},
-        {"description", link.description()}, {"tags", link.tags()},
-        {"attributes", link.attributes()}};
+    links_.insert(id, entry);
+    indexes_.add(links_, id);
+    highest_id_ = std::max(highest_id_, id + 1);
+    record_change(id);
 }
 
 void
-from_json(const json& j, LinkEntry& link)
+LinkDatabase::replay(const OperationLog::Record& record)
 {
-    auto location = j.find("location");
-    if (location != j.end()) {
-        link.set_location(location->get<string>());
-    }
+    using Operation = OperationLog::Operation;
 
-    auto name = j.find("name");
-    if (name != j.end()) {
-        link.set_name(name->get<string>());
+    int id = record.id;
+    if (record.operation == Operation::ADD) {
+        if (has_entry(id)) {
+            indexes_.remove(links_, id);
+            links_.erase(id);
+        }
+        links_.insert(id, *record.entry);
+        indexes_.add(links_, id);
+        highest_id_ = std::max(highest_id_, id + 1);
+        record_change(id);
+        return;
     }
-
-    auto description = j.find("description");
-    if (description != j.end()) {
-        link.set_description(description->get<string>());
+    if (!has_entry(id)) {
+        return;
     }
 
-    auto tags = j.find("tags");
-    if (tags != j.end()) {
-        for (const auto& tag : *tags) {
-            link.add_tag(tag.get<string>());
-        }
+    indexes_.remove(links_, id);
+    switch (record.operation) {
+    case Operation::ADD:
+        break;
+    case Operation::DELETE:
+        links_.erase(id);
+        break;
+    case Operation::SET_LOCATION:
+        links_.set_location(id, record.value);
+        break;
+    case Operation::SET_NAME:
+        links_.set_name(id, record.value);
+        break;
+    case Operation::SET_DESCRIPTION:
+        links_.set_description(id, record.value);
+        break;
+    case Operation::ADD_TAG:
+        links_.add_tag(id, record.value);
+        break;
+    case Operation::REMOVE_TAG:
+        links_.remove_tag(id, record.value);
+        break;
+    case Operation::SET_ATTRIBUTE:
+        links_.set_attribute(id, record.name, record.value);
+        break;
+    case Operation::REMOVE_ATTRIBUTE:
+        links_.remove_attribute(id, record.name);
+        break;
     }
+    if (links_.has_row(id)) {
+        indexes_.add(links_, id);
+    }
+    record_change(id);
+}
 
-    auto attributes = j.find("attributes");
-    if (attributes != j.end()) {
-        for (const auto& attribute : attributes->items()) {
-            link.set_attribute(
-                attribute.key(), attribute.value().get<string>());
-        }
+void
+LinkDatabase::record_change(int id)
+{
+    update_version(id);
+    if (query_cache_ != nullptr) {
+        query_cache_->invalidate(id);
     }
 }
 
 void
-to_json(json& j, const LinkDatabase& database)
+LinkDatabase::update_version(int id)
 {
-    auto links = json::array();
-    for (auto it = database.links_cbegin(); it != database.links_cend();
-         ++it) {
-        links.push_back(*it->second);
+    if (versions_ != nullptr) {
+        versions_->mark(id);
     }
+}
 
-    j = {"links", links};
+void
+LinkDatabase::listen_to_entries()
+{
+    links_.set_change_handler(
+        [this](std::size_t row) { on_entry_changed(static_cast<int>(row)); });
 }
 
 void
-from_json(const json& j, LinkDatabase& database)
+LinkDatabase::on_entry_changed(int id)
 {
-    auto links = j.find("links");
-    if (links == j.end()) {
-        throw JLinkDbError{"no \"links\" field in database"};
+    if (log_ != nullptr) {
+        log_field_changes(id, *links_.entry(id));
+        if (log_batch_depth_ == 0) {
+            log_->sync_if_due();
+        }
     }
+    indexes_.remove(links_, id);
+    links_.update(id);
+    indexes_.add(links_, id);
+    record_change(id);
+    entry_changed_(id);
+}
+
+void
+LinkDatabase::log_field_changes(int id, const LinkEntry& entry)
+{
+    using Operation = OperationLog::Operation;
 
-    for (const auto& link : *links) {
-        auto entry = std::make_shared<LinkEntry>();
-        /* link.get_to(*entry); */
-        from_json(link, *entry);
-        database.add_entry(entry);
+    auto append = [this, id](Operation operation, const string& name,
+                      const string& value) {
+        log_->append({operation, id, nullptr, name, value}, false);
+    };
+    if (links_.location(id) != entry.location()) {
+        append(Operation::SET_LOCATION, {}, entry.location());
+    }
+    if (links_.name(id) != entry.name()) {
+        append(Operation::SET_NAME, {}, entry.name());
+    }
+    if (links_.description(id) != entry.description()) {
+        append(Operation::SET_DESCRIPTION, {}, entry.description());
+    }
+
+    std::unordered_set<string> tags;
+    for (std::size_t i = 0; i < links_.tags_count(id); ++i) {
+        tags.insert(links_.tag(id, i).str());
+    }
+    for (const auto& tag : tags) {
+        if (!entry.has_tag(tag)) {
+            append(Operation::REMOVE_TAG, {}, tag);
+        }
+    }
+    for (const auto& tag : entry.tags()) {
+        if (tags.count(tag) == 0) {
+            append(Operation::ADD_TAG, {}, tag);
+        }
+    }
+
+    std::unordered_map<string, string> attributes;
+    for (std::size_t i = 0; i < links_.attributes_count(id); ++i) {
+        attributes.emplace(links_.attribute_name(id, i).str(),
+            links_.attribute_value(id, i).str());
+    }
+    for (const auto& attribute : attributes) {
+        if (!entry.has_attribute(attribute.first)) {
+            append(Operation::REMOVE_ATTRIBUTE, attribute.first, {});
+        }
+    }
+    for (const auto& attribute : entry.attributes()) {
+        auto stored = attributes.find(attribute.first);
+        if (stored == attributes.end()
+            || stored->second != attribute.second) {
+            append(Operation::SET_ATTRIBUTE, attribute.first,
+                attribute.second);
+        }
     }
 }
 
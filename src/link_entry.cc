@@ -20,9 +20,12 @@
 
 #include "link_entry.hh"
 
+#include <sigc++/sigc++.h>
+
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 
 #include <nlohmann/json.hpp>
 #include "LUrlParser.h"
@@ -48,6 +51,48 @@ LinkEntry::LinkEntry(const string& location) : location_{location}
     }
 }
 
+LinkEntry::LinkEntry(const LinkEntry& other)
+    : location_{other.location_},
+      name_{other.name_},
+      description_{other.description_},
+      tags_{other.tags_},
+      attributes_{other.attributes_}
+{
+}
+
+LinkEntry::LinkEntry(LinkEntry&& other)
+    : location_{std::move(other.location_)},
+      name_{std::move(other.name_)},
+      description_{std::move(other.description_)},
+      tags_{std::move(other.tags_)},
+      attributes_{std::move(other.attributes_)}
+{
+}
+
+LinkEntry&
+LinkEntry::operator=(const LinkEntry& other)
+{
+    location_ = other.location_;
+    name_ = other.name_;
+    description_ = other.description_;
+    tags_ = other.tags_;
+    attributes_ = other.attributes_;
+    changed_();
+    return *this;
+}
+
+LinkEntry&
+LinkEntry::operator=(LinkEntry&& other)
+{
+    location_ = std::move(other.location_);
+    name_ = std::move(other.name_);
+    description_ = std::move(other.description_);
+    tags_ = std::move(other.tags_);
+    attributes_ = std::move(other.attributes_);
+    changed_();
+    return *this;
+}
+
 bool
 LinkEntry::operator==(const LinkEntry& other) const
 {
@@ -79,6 +124,7 @@ LinkEntry::set_location(const string& location)
     }
 
     location_ = location;
+    changed_();
 }
 
 const string&
@@ -91,6 +137,7 @@ void
 LinkEntry::set_name(const string& name)
 {
     name_ = name;
+    changed_();
 }
 
 const string&
@@ -114,19 +161,26 @@ LinkEntry::has_tag(const string& tag) const
 void
 LinkEntry::add_tag(const string& tag)
 {
-    tags_.insert(tag);
+    if (tags_.insert(tag).second) {
+        changed_();
+    }
 }
 
 void
 LinkEntry::remove_tag(const string& tag)
 {
-    tags_.erase(tag);
+    if (tags_.erase(tag) > 0) {
+        changed_();
+    }
 }
 
 void
 LinkEntry::clear_tags()
 {
-    tags_.clear();
+    if (!tags_.empty()) {
+        tags_.clear();
+        changed_();
+    }
 }
 
 const unordered_map<string, string>&
@@ -145,6 +199,7 @@ void
 LinkEntry::set_description(const string& description)
 {
     description_ = description;
+    changed_();
 }
 
 const string
@@ -162,18 +217,30 @@ void
 LinkEntry::set_attribute(const string& attribute, const string& value)
 {
     attributes_[attribute] = value;
+    changed_();
 }
 
 void
 LinkEntry::remove_attribute(const string& attribute)
 {
-    attributes_.erase(attribute);
+    if (attributes_.erase(attribute) > 0) {
+        changed_();
+    }
 }
 
 void
 LinkEntry::clear_attributes()
 {
-    attributes_.clear();
+    if (!attributes_.empty()) {
+        attributes_.clear();
+        changed_();
+    }
+}
+
+sigc::signal<void>&
+LinkEntry::signal_changed()
+{
+    return changed_;
 }
 
 }  // namespace libjlinkdb
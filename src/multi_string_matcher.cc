@@ -0,0 +1,172 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "multi_string_matcher.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "query/string_search_options.hh"
+#include "string_ref.hh"
+#include "string_utils.hh"
+
+namespace libjlinkdb {
+
+using std::size_t;
+using std::string;
+using std::uint32_t;
+using std::vector;
+
+namespace {
+
+// Marks a missing transition while the trie is built.
+constexpr uint32_t NO_STATE = static_cast<uint32_t>(-1);
+
+}  // namespace
+
+MultiStringMatcher::MultiStringMatcher() : options_{false, false}
+{
+    classes_.fill(0);
+}
+
+MultiStringMatcher::MultiStringMatcher(
+    const vector<string>& targets, const query::StringSearchOptions& options)
+    : options_{options}, empty_{targets.empty()}
+{
+    vector<string> folded{targets};
+    if (options_.ignore_case) {
+        for (auto& target : folded) {
+            to_lower_in_place(target);
+        }
+    }
+
+    classes_.fill(0);
+    for (const auto& target : folded) {
+        for (char c : target) {
+            auto& column = classes_[static_cast<unsigned char>(c)];
+            if (column == 0) {
+                column = static_cast<std::uint16_t>(class_count_++);
+            }
+        }
+    }
+    if (options_.ignore_case) {
+        for (int c = 'A'; c <= 'Z'; ++c) {
+            classes_[c] = classes_[static_cast<unsigned char>(
+                to_lower(static_cast<char>(c)))];
+        }
+    }
+
+    // Build the trie of the targets.
+    transitions_.assign(class_count_, NO_STATE);
+    depths_.push_back(0);
+    outputs_.push_back(0);
+    ends_.push_back(0);
+    for (const auto& target : folded) {
+        uint32_t state = 0;
+        for (char c : target) {
+            size_t index = state * class_count_
+                + classes_[static_cast<unsigned char>(c)];
+            if (transitions_[index] == NO_STATE) {
+                transitions_[index] = static_cast<uint32_t>(depths_.size());
+                transitions_.resize(
+                    transitions_.size() + class_count_, NO_STATE);
+                depths_.push_back(depths_[state] + 1);
+                outputs_.push_back(0);
+                ends_.push_back(0);
+            }
+            state = transitions_[index];
+        }
+        outputs_[state] = 1;
+        ends_[state] = 1;
+    }
+
+    // Fill in the missing transitions in breadth first order, so that the
+    // failure state of each state, the state for its longest proper suffix,
+    // is complete before the state itself.
+    vector<uint32_t> failures(depths_.size(), 0);
+    std::queue<uint32_t> pending;
+    for (size_t column = 0; column < class_count_; ++column) {
+        uint32_t& next = transitions_[column];
+        if (next == NO_STATE) {
+            next = 0;
+        } else {
+            pending.push(next);
+        }
+    }
+    while (!pending.empty()) {
+        uint32_t state = pending.front();
+        pending.pop();
+        uint32_t failure = failures[state];
+        outputs_[state] = outputs_[state] || outputs_[failure];
+        for (size_t column = 0; column < class_count_; ++column) {
+            uint32_t& next = transitions_[state * class_count_ + column];
+            uint32_t fallback = transitions_[failure * class_count_ + column];
+            if (next == NO_STATE) {
+                next = fallback;
+            } else {
+                failures[next] = fallback;
+                pending.push(next);
+            }
+        }
+    }
+}
+
+bool
+MultiStringMatcher::matches(StringRef str) const
+{
+    if (empty_) {
+        return false;
+    }
+
+    uint32_t state = 0;
+    if (options_.match_full_string) {
+        // The state only stands for the whole string read so far while the
+        // string is a prefix of a target.
+        for (size_t i = 0; i < str.size(); ++i) {
+            state = step(state, str[i]);
+            if (depths_[state] != i + 1) {
+                return false;
+            }
+        }
+        return ends_[state] != 0;
+    }
+
+    if (outputs_[0]) {
+        return true;
+    }
+    for (size_t i = 0; i < str.size(); ++i) {
+        state = step(state, str[i]);
+        if (outputs_[state]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t
+MultiStringMatcher::states_count() const
+{
+    return depths_.size();
+}
+
+}  // namespace libjlinkdb
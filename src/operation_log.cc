@@ -0,0 +1,458 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "operation_log.hh"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "jlinkdb_error.hh"
+#include "link_entry.hh"
+
+namespace libjlinkdb {
+
+using std::size_t;
+using std::string;
+using std::uint32_t;
+
+namespace {
+
+constexpr char LOG_MAGIC[8] = {'J', 'L', 'D', 'B', 'O', 'L', 'O', 'G'};
+// Written as a number, so that a log from a machine with a different byte
+// order can be recognized.
+constexpr uint32_t LOG_BYTE_ORDER = 0x01020304;
+
+// The start of the file.
+struct LogHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+};
+
+// The size and checksum of the payload of each record come before it.
+constexpr size_t RECORD_HEADER_SIZE = 2 * sizeof(uint32_t);
+
+// Returns the 32 bit FNV-1a hash of the size bytes at data.
+uint32_t
+checksum(const char* data, size_t size)
+{
+    uint32_t result = 2166136261u;
+    for (size_t i = 0; i < size; ++i) {
+        result ^= static_cast<unsigned char>(data[i]);
+        result *= 16777619u;
+    }
+    return result;
+}
+
+[[noreturn]] void
+throw_error(const string& action, const string& path)
+{
+    std::ostringstream message;
+    message << "failed to " << action << " " << path << ": "
+            << std::strerror(errno);
+    throw JLinkDbError{message.str()};
+}
+
+// Writes the size bytes at data to fd, retrying after interruptions and
+// short writes.
+void
+write_all(int fd, const char* data, size_t size, const string& path)
+{
+    size_t written = 0;
+    while (written < size) {
+        ssize_t result = write(fd, data + written, size - written);
+        if (result == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw_error("write", path);
+        }
+        written += static_cast<size_t>(result);
+    }
+}
+
+// Checks the header at the start of the log in fd, or writes one if the
+// file is empty or a crash cut off its header.
+void
+prepare_header(int fd, const string& path)
+{
+    struct stat info;
+    if (fstat(fd, &info) == -1) {
+        throw_error("read", path);
+    }
+
+    LogHeader header;
+    if (static_cast<size_t>(info.st_size) >= sizeof(header)) {
+        if (pread(fd, &header, sizeof(header), 0)
+            != static_cast<ssize_t>(sizeof(header))) {
+            throw_error("read", path);
+        }
+        if (std::memcmp(header.magic, LOG_MAGIC, sizeof(LOG_MAGIC)) != 0
+            || header.byte_order != LOG_BYTE_ORDER) {
+            throw JLinkDbError{"not an operation log: " + path};
+        }
+        if (header.version != OPERATION_LOG_VERSION) {
+            std::ostringstream message;
+            message << "unsupported operation log version ";
+            message << header.version;
+            throw JLinkDbError{message.str()};
+        }
+        return;
+    }
+
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, LOG_MAGIC, sizeof(LOG_MAGIC));
+    header.version = OPERATION_LOG_VERSION;
+    header.byte_order = LOG_BYTE_ORDER;
+    if (ftruncate(fd, 0) == -1) {
+        throw_error("truncate", path);
+    }
+    write_all(fd, reinterpret_cast<const char*>(&header), sizeof(header),
+        path);
+    if (fdatasync(fd) == -1) {
+        throw_error("sync", path);
+    }
+}
+
+void
+append_number(string& buffer, uint32_t value)
+{
+    buffer.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void
+append_string(string& buffer, const string& str)
+{
+    append_number(buffer, static_cast<uint32_t>(str.size()));
+    buffer += str;
+}
+
+void
+append_entry(string& buffer, const LinkEntry& entry)
+{
+    append_string(buffer, entry.location());
+    append_string(buffer, entry.name());
+    append_string(buffer, entry.description());
+    append_number(buffer, static_cast<uint32_t>(entry.tags().size()));
+    for (const auto& tag : entry.tags()) {
+        append_string(buffer, tag);
+    }
+    append_number(buffer, static_cast<uint32_t>(entry.attributes().size()));
+    for (const auto& attribute : entry.attributes()) {
+        append_string(buffer, attribute.first);
+        append_string(buffer, attribute.second);
+    }
+}
+
+// Reads the fields of a record payload in order. Each method returns false
+// if the payload is too short.
+class PayloadReader {
+public:
+    PayloadReader(const char* data, size_t size) : data_{data}, size_{size}
+    {
+    }
+
+    bool read_number(uint32_t& value)
+    {
+        if (size_ - position_ < sizeof(value)) {
+            return false;
+        }
+        std::memcpy(&value, data_ + position_, sizeof(value));
+        position_ += sizeof(value);
+        return true;
+    }
+
+    bool read_string(string& str)
+    {
+        uint32_t size = 0;
+        if (!read_number(size) || size_ - position_ < size) {
+            return false;
+        }
+        str.assign(data_ + position_, size);
+        position_ += size;
+        return true;
+    }
+
+private:
+    const char* data_;
+    size_t size_;
+    size_t position_ = 0;
+};
+
+// Reads the fields of an entry from reader into a new entry. Returns null
+// if the payload is too short.
+std::shared_ptr<LinkEntry>
+read_entry(PayloadReader& reader)
+{
+    string location;
+    string name;
+    string description;
+    if (!reader.read_string(location) || !reader.read_string(name)
+        || !reader.read_string(description)) {
+        return nullptr;
+    }
+
+    auto entry = std::make_shared<LinkEntry>(location);
+    entry->set_name(name);
+    entry->set_description(description);
+
+    uint32_t count = 0;
+    if (!reader.read_number(count)) {
+        return nullptr;
+    }
+    string value;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (!reader.read_string(value)) {
+            return nullptr;
+        }
+        entry->add_tag(value);
+    }
+
+    if (!reader.read_number(count)) {
+        return nullptr;
+    }
+    string attribute;
+    for (uint32_t i = 0; i < count; ++i) {
+        if (!reader.read_string(attribute) || !reader.read_string(value)) {
+            return nullptr;
+        }
+        entry->set_attribute(attribute, value);
+    }
+    return entry;
+}
+
+}  // namespace
+
+OperationLog::OperationLog(const string& path) : path_{path}
+{
+    fd_ = open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd_ == -1) {
+        throw_error("open file", path);
+    }
+    try {
+        prepare_header(fd_, path);
+    } catch (const JLinkDbError&) {
+        close(fd_);
+        throw;
+    }
+}
+
+OperationLog::~OperationLog()
+{
+    try {
+        sync();
+    } catch (const JLinkDbError&) {
+        // There's no one left to report the error to.
+    }
+    close(fd_);
+}
+
+void
+OperationLog::replay(const std::function<void(const Record&)>& apply)
+{
+    sync();
+
+    struct stat info;
+    if (fstat(fd_, &info) == -1) {
+        throw_error("read", path_);
+    }
+    std::ifstream reader{path_, std::ios::binary};
+    if (!reader.is_open()) {
+        throw_error("open file", path_);
+    }
+
+    reader.seekg(sizeof(LogHeader));
+    std::vector<char> payload;
+    off_t good_size = sizeof(LogHeader);
+    while (true) {
+        uint32_t header[2];
+        if (!reader.read(reinterpret_cast<char*>(header), sizeof(header))
+            || header[0] > info.st_size - good_size - RECORD_HEADER_SIZE) {
+            break;
+        }
+        payload.resize(header[0]);
+        if (!reader.read(payload.data(), payload.size())
+            || checksum(payload.data(), payload.size()) != header[1]) {
+            break;
+        }
+
+        PayloadReader payload_reader{payload.data(), payload.size()};
+        uint32_t operation = 0;
+        uint32_t id = 0;
+        if (!payload_reader.read_number(operation)
+            || !payload_reader.read_number(id) || id > INT_MAX) {
+            break;
+        }
+
+        Record record{static_cast<Operation>(operation),
+            static_cast<int>(id), nullptr, {}, {}};
+        bool complete = true;
+        switch (record.operation) {
+        case Operation::ADD:
+            record.entry = read_entry(payload_reader);
+            complete = record.entry != nullptr;
+            break;
+        case Operation::DELETE:
+            break;
+        case Operation::SET_LOCATION:
+        case Operation::SET_NAME:
+        case Operation::SET_DESCRIPTION:
+        case Operation::ADD_TAG:
+        case Operation::REMOVE_TAG:
+            complete = payload_reader.read_string(record.value);
+            break;
+        case Operation::SET_ATTRIBUTE:
+            complete = payload_reader.read_string(record.name)
+                && payload_reader.read_string(record.value);
+            break;
+        case Operation::REMOVE_ATTRIBUTE:
+            complete = payload_reader.read_string(record.name);
+            break;
+        default:
+            complete = false;
+            break;
+        }
+        if (!complete) {
+            break;
+        }
+
+        apply(record);
+        good_size += RECORD_HEADER_SIZE + payload.size();
+    }
+
+    reader.close();
+    if (info.st_size > good_size && ftruncate(fd_, good_size) == -1) {
+        throw_error("truncate", path_);
+    }
+}
+
+void
+OperationLog::append(const Record& record, bool may_sync)
+{
+    size_t start = buffer_.size();
+    buffer_.append(RECORD_HEADER_SIZE, '\0');
+    append_number(buffer_, static_cast<uint32_t>(record.operation));
+    append_number(buffer_, static_cast<uint32_t>(record.id));
+    switch (record.operation) {
+    case Operation::ADD:
+        append_entry(buffer_, *record.entry);
+        break;
+    case Operation::DELETE:
+        break;
+    case Operation::SET_ATTRIBUTE:
+        append_string(buffer_, record.name);
+        append_string(buffer_, record.value);
+        break;
+    case Operation::REMOVE_ATTRIBUTE:
+        append_string(buffer_, record.name);
+        break;
+    default:
+        append_string(buffer_, record.value);
+        break;
+    }
+
+    size_t payload_start = start + RECORD_HEADER_SIZE;
+    size_t payload_size = buffer_.size() - payload_start;
+    uint32_t header[2] = {static_cast<uint32_t>(payload_size),
+        checksum(&buffer_[payload_start], payload_size)};
+    std::memcpy(&buffer_[start], header, sizeof(header));
+
+    ++unsynced_;
+    if (may_sync) {
+        sync_if_due();
+    }
+}
+
+void
+OperationLog::sync_if_due()
+{
+    if (sync_interval_ != 0 && unsynced_ >= sync_interval_) {
+        sync();
+    }
+}
+
+void
+OperationLog::sync()
+{
+    if (unsynced_ == 0) {
+        return;
+    }
+
+    write_all(fd_, buffer_.data(), buffer_.size(), path_);
+    buffer_.clear();
+    unsynced_ = 0;
+
+    if (fdatasync(fd_) == -1) {
+        throw_error("sync", path_);
+    }
+}
+
+void
+OperationLog::clear()
+{
+    buffer_.clear();
+    unsynced_ = 0;
+    if (ftruncate(fd_, sizeof(LogHeader)) == -1 || fdatasync(fd_) == -1) {
+        throw_error("truncate", path_);
+    }
+}
+
+void
+OperationLog::set_sync_interval(size_t records)
+{
+    sync_interval_ = records;
+}
+
+size_t
+OperationLog::sync_interval() const
+{
+    return sync_interval_;
+}
+
+void
+sync_file(const string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        throw_error("open file", path);
+    }
+    int result = fsync(fd);
+    int error = errno;
+    close(fd);
+    errno = error;
+    if (result == -1) {
+        throw_error("sync", path);
+    }
+}
+
+}  // namespace libjlinkdb
@@ -20,8 +20,14 @@
 
 #include "query/and.hh"
 
+#include <cstddef>
 #include <memory>
+#include <string>
+#include <typeinfo>
+#include <vector>
 
+#include "entry_store.hh"
+#include "index_set.hh"
 #include "link_entry.hh"
 #include "query/query.hh"
 
@@ -42,6 +48,95 @@ And::matches(const LinkEntry& entry) const
     return q1_->matches(entry) && q2_->matches(entry);
 }
 
+bool
+And::matches_row(const EntryStore& store, std::size_t row) const
+{
+    return q1_->matches_row(store, row) && q2_->matches_row(store, row);
+}
+
+bool
+And::find_candidates(
+    const IndexSet& indexes, std::vector<std::size_t>& rows) const
+{
+    return detail::find_candidates_from_bitmap(*this, indexes, rows);
+}
+
+bool
+And::find_candidate_bitmap(const IndexSet& indexes, RowBitmap& rows) const
+{
+    RowBitmap rows2;
+    bool found1 = q1_->find_candidate_bitmap(indexes, rows);
+    bool found2 = q2_->find_candidate_bitmap(indexes, found1 ? rows2 : rows);
+    if (found1 && found2) {
+        rows.intersect(rows2);
+    }
+    return found1 || found2;
+}
+
+const shared_ptr<Query>&
+And::q1() const
+{
+    return q1_;
+}
+
+const shared_ptr<Query>&
+And::q2() const
+{
+    return q2_;
+}
+
+double
+And::estimated_cost() const
+{
+    return q1_->estimated_cost() + q2_->estimated_cost();
+}
+
+double
+And::estimated_selectivity() const
+{
+    return q1_->estimated_selectivity() * q2_->estimated_selectivity();
+}
+
+std::string
+And::describe() const
+{
+    return "And";
+}
+
+std::string
+And::key() const
+{
+    std::string key1 = q1_->key();
+    std::string key2 = q2_->key();
+    if (key1.empty() || key2.empty()) {
+        return {};
+    }
+    return "and(" + key1 + "," + key2 + ")";
+}
+
+std::size_t
+And::hash() const
+{
+    return hash_combine(
+        hash_combine(typeid(And).hash_code(), q1_->hash()), q2_->hash());
+}
+
+bool
+And::equals(const Query& other) const
+{
+    if (typeid(other) != typeid(And)) {
+        return false;
+    }
+    const auto& query = static_cast<const And&>(other);
+    return q1_->equals(*query.q1_) && q2_->equals(*query.q2_);
+}
+
+shared_ptr<Query>
+And::canonical() const
+{
+    return detail::canonical_collection(true, {q1_, q2_}, false);
+}
+
 }  // namespace query
 
 }  // namespace libjlinkdb
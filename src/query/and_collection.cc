@@ -21,10 +21,15 @@
 #include "query/and_collection.hh"
 
 #include <algorithm>
+#include <cstddef>
 #include <iterator>
 #include <memory>
+#include <string>
+#include <typeinfo>
 #include <vector>
 
+#include "entry_store.hh"
+#include "index_set.hh"
 #include "link_entry.hh"
 #include "query/query.hh"
 
@@ -49,6 +54,124 @@ AndCollection::matches(const LinkEntry& entry) const
         [&](const shared_ptr<Query>& query) { return query->matches(entry); });
 }
 
+bool
+AndCollection::matches_row(const EntryStore& store, std::size_t row) const
+{
+    return std::all_of(begin(queries_), end(queries_),
+        [&](const shared_ptr<Query>& query) {
+            return query->matches_row(store, row);
+        });
+}
+
+bool
+AndCollection::find_candidates(
+    const IndexSet& indexes, vector<std::size_t>& rows) const
+{
+    return detail::find_candidates_from_bitmap(*this, indexes, rows);
+}
+
+bool
+AndCollection::find_candidate_bitmap(
+    const IndexSet& indexes, RowBitmap& rows) const
+{
+    bool found = false;
+    RowBitmap query_rows;
+    for (const auto& query : queries_) {
+        if (!query->find_candidate_bitmap(
+                indexes, found ? query_rows : rows)) {
+            continue;
+        }
+
+        if (found) {
+            rows.intersect(query_rows);
+        }
+        found = true;
+        if (rows.empty()) {
+            break;
+        }
+    }
+    return found;
+}
+
+const vector<shared_ptr<Query>>&
+AndCollection::queries() const
+{
+    return queries_;
+}
+
+double
+AndCollection::estimated_cost() const
+{
+    double result = 0.0;
+    for (const auto& query : queries_) {
+        result += query->estimated_cost();
+    }
+    return result;
+}
+
+double
+AndCollection::estimated_selectivity() const
+{
+    double result = 1.0;
+    for (const auto& query : queries_) {
+        result *= query->estimated_selectivity();
+    }
+    return result;
+}
+
+std::string
+AndCollection::describe() const
+{
+    return "AndCollection";
+}
+
+std::string
+AndCollection::key() const
+{
+    std::string result{"all("};
+    for (const auto& query : queries_) {
+        std::string query_key = query->key();
+        if (query_key.empty()) {
+            return {};
+        }
+        result += query_key;
+        result += ",";
+    }
+    result += ")";
+    return result;
+}
+
+std::size_t
+AndCollection::hash() const
+{
+    std::size_t result = typeid(AndCollection).hash_code();
+    for (const auto& query : queries_) {
+        result = hash_combine(result, query->hash());
+    }
+    return result;
+}
+
+bool
+AndCollection::equals(const Query& other) const
+{
+    if (typeid(other) != typeid(AndCollection)) {
+        return false;
+    }
+    const auto& queries = static_cast<const AndCollection&>(other).queries_;
+    return queries_.size() == queries.size()
+        && std::equal(begin(queries_), end(queries_), begin(queries),
+            [](const shared_ptr<Query>& query1,
+                const shared_ptr<Query>& query2) {
+                return query1->equals(*query2);
+            });
+}
+
+shared_ptr<Query>
+AndCollection::canonical() const
+{
+    return detail::canonical_collection(true, queries_, true);
+}
+
 }  // namespace query
 
 }  // namespace libjlinkdb
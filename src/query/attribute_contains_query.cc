@@ -21,12 +21,20 @@
 #include "query/attribute_contains_query.hh"
 
 #include <algorithm>
+#include <cstddef>
 #include <iterator>
+#include <memory>
+#include <string>
+#include <typeinfo>
 #include <utility>
+#include <vector>
 
+#include "entry_store.hh"
+#include "index_set.hh"
 #include "link_entry.hh"
 #include "query/string_search_options.hh"
 #include "string_utils.hh"
+#include "trigram_index.hh"
 
 namespace libjlinkdb {
 
@@ -36,21 +44,108 @@ using std::string;
 
 AttributeContainsQuery::AttributeContainsQuery(
     const string& term, const StringSearchOptions& options)
-    : term_{term}, options_{options}
+    : term_{term}, options_{options}, matcher_{term, options}
 {
 }
 
+const string&
+AttributeContainsQuery::term() const
+{
+    return term_;
+}
+
+const StringSearchOptions&
+AttributeContainsQuery::options() const
+{
+    return options_;
+}
+
 bool
 AttributeContainsQuery::matches(const LinkEntry& entry) const
 {
     auto matcher = [&](const std::pair<string, string>& attr) {
-        return search_string(attr.first, term_, options_)
-            || search_string(attr.second, term_, options_);
+        return matcher_.matches(attr.first) || matcher_.matches(attr.second);
     };
     return std::any_of(
         std::begin(entry.attributes()), std::end(entry.attributes()), matcher);
 }
 
+bool
+AttributeContainsQuery::matches_row(
+    const EntryStore& store, std::size_t row) const
+{
+    std::size_t count = store.attributes_count(row);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (matcher_.matches(store.attribute_name(row, i))
+            || matcher_.matches(store.attribute_value(row, i))) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool
+AttributeContainsQuery::find_candidates(
+    const IndexSet& indexes, std::vector<std::size_t>& rows) const
+{
+    const TrigramIndex* index = indexes.trigram_index();
+    return index != nullptr && index->find(TextField::ATTRIBUTES, term_, rows);
+}
+
+double
+AttributeContainsQuery::estimated_cost() const
+{
+    // Entries usually have a couple of attributes, and both the name and
+    // value are searched.
+    return 4.0 * estimated_search_cost(options_);
+}
+
+double
+AttributeContainsQuery::estimated_selectivity() const
+{
+    return estimated_search_selectivity(options_);
+}
+
+string
+AttributeContainsQuery::describe() const
+{
+    return "AttributeContainsQuery " + describe_search(term_, options_);
+}
+
+string
+AttributeContainsQuery::key() const
+{
+    return "attributes:" + search_key(term_, options_);
+}
+
+std::size_t
+AttributeContainsQuery::hash() const
+{
+    return hash_combine(typeid(AttributeContainsQuery).hash_code(),
+        search_hash(term_, options_));
+}
+
+bool
+AttributeContainsQuery::equals(const Query& other) const
+{
+    if (typeid(other) != typeid(AttributeContainsQuery)) {
+        return false;
+    }
+    const auto& query = static_cast<const AttributeContainsQuery&>(other);
+    return term_ == query.term_ && options_ == query.options_;
+}
+
+std::shared_ptr<Query>
+AttributeContainsQuery::canonical() const
+{
+    string term = detail::canonical_term(term_, options_);
+    if (term == term_) {
+        return {};
+    }
+    return std::make_shared<AttributeContainsQuery>(term, options_);
+}
+
 }  // namespace query
 
 }  // namespace libjlinkdb
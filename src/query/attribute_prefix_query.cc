@@ -0,0 +1,139 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "query/attribute_prefix_query.hh"
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "entry_store.hh"
+#include "index_set.hh"
+#include "link_entry.hh"
+#include "sorted_attribute_index.hh"
+#include "string_ref.hh"
+
+namespace libjlinkdb {
+
+namespace query {
+
+using std::string;
+
+AttributePrefixQuery::AttributePrefixQuery(
+    const string& attr_name, const string& prefix)
+    : attr_name_{attr_name}, prefix_{prefix}
+{
+}
+
+const string&
+AttributePrefixQuery::attr_name() const
+{
+    return attr_name_;
+}
+
+const string&
+AttributePrefixQuery::prefix() const
+{
+    return prefix_;
+}
+
+bool
+AttributePrefixQuery::matches(const LinkEntry& entry) const
+{
+    if (!entry.has_attribute(attr_name_)) {
+        return false;
+    }
+
+    return has_prefix(entry.get_attribute(attr_name_));
+}
+
+bool
+AttributePrefixQuery::matches_row(
+    const EntryStore& store, std::size_t row) const
+{
+    std::size_t count = store.attributes_count(row);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (store.attribute_name(row, i) == attr_name_) {
+            return has_prefix(store.attribute_value(row, i));
+        }
+    }
+
+    return false;
+}
+
+bool
+AttributePrefixQuery::find_candidates(
+    const IndexSet& indexes, std::vector<std::size_t>& rows) const
+{
+    const SortedAttributeIndex* index = indexes.sorted_attribute_index();
+    return index != nullptr && index->find_prefix(attr_name_, prefix_, rows);
+}
+
+double
+AttributePrefixQuery::estimated_cost() const
+{
+    // Finding the attribute, then one comparison.
+    return 2.0;
+}
+
+string
+AttributePrefixQuery::describe() const
+{
+    return "AttributePrefixQuery " + attr_name_ + " \"" + prefix_ + "\"";
+}
+
+string
+AttributePrefixQuery::key() const
+{
+    return "attribute_prefix(" + std::to_string(attr_name_.size()) + ":"
+        + attr_name_ + "):" + prefix_;
+}
+
+std::size_t
+AttributePrefixQuery::hash() const
+{
+    return hash_combine(hash_combine(typeid(AttributePrefixQuery).hash_code(),
+                            std::hash<string>{}(attr_name_)),
+        std::hash<string>{}(prefix_));
+}
+
+bool
+AttributePrefixQuery::equals(const Query& other) const
+{
+    if (typeid(other) != typeid(AttributePrefixQuery)) {
+        return false;
+    }
+    const auto& query = static_cast<const AttributePrefixQuery&>(other);
+    return attr_name_ == query.attr_name_ && prefix_ == query.prefix_;
+}
+
+bool
+AttributePrefixQuery::has_prefix(StringRef value) const
+{
+    return value.size() >= prefix_.size()
+        && std::memcmp(value.data(), prefix_.data(), prefix_.size()) == 0;
+}
+
+}  // namespace query
+
+}  // namespace libjlinkdb
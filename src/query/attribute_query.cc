@@ -20,11 +20,21 @@
 
 #include "query/attribute_query.hh"
 
+#include <cstddef>
+#include <functional>
+#include <memory>
 #include <string>
+#include <typeinfo>
+#include <vector>
 
+#include "attribute_index.hh"
+#include "entry_store.hh"
+#include "index_set.hh"
 #include "link_entry.hh"
 #include "query/string_search_options.hh"
+#include "row_bitmap.hh"
 #include "string_utils.hh"
+#include "trigram_index.hh"
 
 namespace libjlinkdb {
 
@@ -34,10 +44,31 @@ using std::string;
 
 AttributeQuery::AttributeQuery(const string& attr_name,
     const string& attr_value, const StringSearchOptions& options)
-    : attr_name_{attr_name}, attr_value_{attr_value}, options_{options}
+    : attr_name_{attr_name},
+      attr_value_{attr_value},
+      options_{options},
+      matcher_{attr_value, options}
 {
 }
 
+const string&
+AttributeQuery::attr_name() const
+{
+    return attr_name_;
+}
+
+const string&
+AttributeQuery::attr_value() const
+{
+    return attr_value_;
+}
+
+const StringSearchOptions&
+AttributeQuery::options() const
+{
+    return options_;
+}
+
 bool
 AttributeQuery::matches(const LinkEntry& entry) const
 {
@@ -45,8 +76,113 @@ AttributeQuery::matches(const LinkEntry& entry) const
         return false;
     }
 
-    return search_string(
-        entry.get_attribute(attr_name_), attr_value_, options_);
+    return matcher_.matches(entry.get_attribute(attr_name_));
+}
+
+bool
+AttributeQuery::matches_row(const EntryStore& store, std::size_t row) const
+{
+    std::size_t count = store.attributes_count(row);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (store.attribute_name(row, i) == attr_name_) {
+            return matcher_.matches(store.attribute_value(row, i));
+        }
+    }
+
+    return false;
+}
+
+bool
+AttributeQuery::find_candidates(
+    const IndexSet& indexes, std::vector<std::size_t>& rows) const
+{
+    const AttributeIndex* attribute_index = indexes.attribute_index();
+    if (attribute_index != nullptr && options_.match_full_string) {
+        attribute_index->find(attr_name_, attr_value_, options_.ignore_case)
+            .copy_rows(rows);
+        return true;
+    }
+
+    const TrigramIndex* trigram_index = indexes.trigram_index();
+    return trigram_index != nullptr
+        && trigram_index->find(TextField::ATTRIBUTES, attr_value_, rows);
+}
+
+bool
+AttributeQuery::find_candidate_bitmap(
+    const IndexSet& indexes, RowBitmap& rows) const
+{
+    const AttributeIndex* attribute_index = indexes.attribute_index();
+    if (attribute_index != nullptr && options_.match_full_string) {
+        rows = attribute_index->find(
+            attr_name_, attr_value_, options_.ignore_case);
+        return true;
+    }
+    return Query::find_candidate_bitmap(indexes, rows);
+}
+
+bool
+AttributeQuery::candidates_exact(const IndexSet& indexes) const
+{
+    // The index of attributes holds exactly the entries whose attribute
+    // has a value equal to the term, while trigrams only narrow them down.
+    return indexes.attribute_index() != nullptr
+        && options_.match_full_string;
+}
+
+double
+AttributeQuery::estimated_cost() const
+{
+    return 1.0 + estimated_search_cost(options_);
+}
+
+double
+AttributeQuery::estimated_selectivity() const
+{
+    return estimated_search_selectivity(options_);
+}
+
+string
+AttributeQuery::describe() const
+{
+    return "AttributeQuery " + attr_name_ + " "
+        + describe_search(attr_value_, options_);
+}
+
+string
+AttributeQuery::key() const
+{
+    return "attribute(" + std::to_string(attr_name_.size()) + ":"
+        + attr_name_ + "):" + search_key(attr_value_, options_);
+}
+
+std::size_t
+AttributeQuery::hash() const
+{
+    return hash_combine(hash_combine(typeid(AttributeQuery).hash_code(),
+                            std::hash<string>{}(attr_name_)),
+        search_hash(attr_value_, options_));
+}
+
+bool
+AttributeQuery::equals(const Query& other) const
+{
+    if (typeid(other) != typeid(AttributeQuery)) {
+        return false;
+    }
+    const auto& query = static_cast<const AttributeQuery&>(other);
+    return attr_name_ == query.attr_name_ && attr_value_ == query.attr_value_
+        && options_ == query.options_;
+}
+
+std::shared_ptr<Query>
+AttributeQuery::canonical() const
+{
+    string value = detail::canonical_term(attr_value_, options_);
+    if (value == attr_value_) {
+        return {};
+    }
+    return std::make_shared<AttributeQuery>(attr_name_, value, options_);
 }
 
 }  // namespace query
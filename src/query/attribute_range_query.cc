@@ -0,0 +1,232 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "query/attribute_range_query.hh"
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "entry_store.hh"
+#include "index_set.hh"
+#include "jlinkdb_error.hh"
+#include "link_entry.hh"
+#include "sorted_attribute_index.hh"
+#include "string_ref.hh"
+
+namespace libjlinkdb {
+
+namespace query {
+
+using std::string;
+
+namespace {
+
+// Returns bound with the sort key of its value in order in place of the
+// value. Throws a JLinkDbError if the value has no sort key.
+AttributeBound
+bound_key(const AttributeBound& bound, AttributeOrder order)
+{
+    AttributeBound result{bound};
+    if (bound.bounded
+        && !attribute_sort_key(bound.value, order, result.value)) {
+        throw JLinkDbError{"invalid integer bound: " + bound.value};
+    }
+    return result;
+}
+
+// Returns a description of bound for keys, which tells bounds apart.
+string
+bound_key_string(const AttributeBound& bound)
+{
+    if (!bound.bounded) {
+        return "*";
+    }
+    return (bound.inclusive ? "[" : "(") + std::to_string(bound.value.size())
+        + ":" + bound.value;
+}
+
+std::size_t
+bound_hash(const AttributeBound& bound)
+{
+    if (!bound.bounded) {
+        return 0;
+    }
+    return hash_combine(std::hash<string>{}(bound.value), bound.inclusive);
+}
+
+bool
+bounds_equal(const AttributeBound& bound1, const AttributeBound& bound2)
+{
+    if (bound1.bounded != bound2.bounded) {
+        return false;
+    }
+    return !bound1.bounded
+        || (bound1.value == bound2.value
+            && bound1.inclusive == bound2.inclusive);
+}
+
+}  // namespace
+
+AttributeRangeQuery::AttributeRangeQuery(const string& attr_name,
+    AttributeOrder order, const AttributeBound& lower,
+    const AttributeBound& upper)
+    : attr_name_{attr_name},
+      order_{order},
+      lower_{lower},
+      upper_{upper},
+      lower_key_{bound_key(lower, order)},
+      upper_key_{bound_key(upper, order)}
+{
+}
+
+const string&
+AttributeRangeQuery::attr_name() const
+{
+    return attr_name_;
+}
+
+AttributeOrder
+AttributeRangeQuery::order() const
+{
+    return order_;
+}
+
+const AttributeBound&
+AttributeRangeQuery::lower() const
+{
+    return lower_;
+}
+
+const AttributeBound&
+AttributeRangeQuery::upper() const
+{
+    return upper_;
+}
+
+bool
+AttributeRangeQuery::matches(const LinkEntry& entry) const
+{
+    if (!entry.has_attribute(attr_name_)) {
+        return false;
+    }
+
+    return in_range(entry.get_attribute(attr_name_));
+}
+
+bool
+AttributeRangeQuery::matches_row(
+    const EntryStore& store, std::size_t row) const
+{
+    std::size_t count = store.attributes_count(row);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (store.attribute_name(row, i) == attr_name_) {
+            return in_range(store.attribute_value(row, i));
+        }
+    }
+
+    return false;
+}
+
+bool
+AttributeRangeQuery::find_candidates(
+    const IndexSet& indexes, std::vector<std::size_t>& rows) const
+{
+    const SortedAttributeIndex* index = indexes.sorted_attribute_index();
+    return index != nullptr
+        && index->find_range(attr_name_, order_, lower_key_, upper_key_, rows);
+}
+
+double
+AttributeRangeQuery::estimated_cost() const
+{
+    // Finding the attribute, then one or two comparisons.
+    return 3.0;
+}
+
+string
+AttributeRangeQuery::describe() const
+{
+    string result{"AttributeRangeQuery " + attr_name_ + " "};
+    if (order_ == AttributeOrder::INTEGER) {
+        result += "integer ";
+    }
+    result += lower_.bounded ? (lower_.inclusive ? "[" : "(") + lower_.value
+                             : string{"(*"};
+    result += ", ";
+    result += upper_.bounded ? upper_.value + (upper_.inclusive ? "]" : ")")
+                             : string{"*)"};
+    return result;
+}
+
+string
+AttributeRangeQuery::key() const
+{
+    // The keys of the bounds are compared, so equal integers written
+    // differently give the same key.
+    return "attribute_range(" + std::to_string(attr_name_.size()) + ":"
+        + attr_name_ + ")"
+        + (order_ == AttributeOrder::INTEGER ? "integer" : "lexicographic")
+        + ":" + bound_key_string(lower_key_) + ","
+        + bound_key_string(upper_key_);
+}
+
+std::size_t
+AttributeRangeQuery::hash() const
+{
+    std::size_t result = hash_combine(typeid(AttributeRangeQuery).hash_code(),
+        std::hash<string>{}(attr_name_));
+    result = hash_combine(result, static_cast<std::size_t>(order_));
+    result = hash_combine(result, bound_hash(lower_key_));
+    return hash_combine(result, bound_hash(upper_key_));
+}
+
+bool
+AttributeRangeQuery::equals(const Query& other) const
+{
+    if (typeid(other) != typeid(AttributeRangeQuery)) {
+        return false;
+    }
+    const auto& query = static_cast<const AttributeRangeQuery&>(other);
+    return attr_name_ == query.attr_name_ && order_ == query.order_
+        && bounds_equal(lower_key_, query.lower_key_)
+        && bounds_equal(upper_key_, query.upper_key_);
+}
+
+bool
+AttributeRangeQuery::in_range(StringRef value) const
+{
+    if (order_ == AttributeOrder::LEXICOGRAPHIC) {
+        return lower_key_.admits_from_below(value)
+            && upper_key_.admits_from_above(value);
+    }
+
+    // Integer keys are short enough not to allocate.
+    string key;
+    return attribute_sort_key(value, order_, key)
+        && lower_key_.admits_from_below(key)
+        && upper_key_.admits_from_above(key);
+}
+
+}  // namespace query
+
+}  // namespace libjlinkdb
@@ -0,0 +1,297 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "query/compiled_query.hh"
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "entry_store.hh"
+#include "query/and.hh"
+#include "query/and_collection.hh"
+#include "query/attribute_contains_query.hh"
+#include "query/attribute_query.hh"
+#include "query/contains_query.hh"
+#include "query/description_extractor.hh"
+#include "query/field_query.hh"
+#include "query/location_extractor.hh"
+#include "query/name_extractor.hh"
+#include "query/or.hh"
+#include "query/or_collection.hh"
+#include "query/query.hh"
+#include "query/string_search_options.hh"
+#include "query/tag_query.hh"
+#include "string_utils.hh"
+
+namespace libjlinkdb {
+
+namespace query {
+
+using std::shared_ptr;
+using std::size_t;
+using std::uint32_t;
+using std::vector;
+
+// Emits the instructions for a tree. Jumps go to labels, which are bound to
+// instructions as they are emitted and resolved at the end.
+class CompiledQuery::Compiler {
+public:
+    explicit Compiler(CompiledQuery& compiled) : compiled_{compiled}
+    {
+    }
+
+    void compile(const Query& query)
+    {
+        uint32_t accept = label();
+        uint32_t reject = label();
+        compile(query, accept, reject);
+
+        auto& program = compiled_.program_;
+        labels_[accept] = static_cast<uint32_t>(program.size());
+        labels_[reject] = static_cast<uint32_t>(program.size() + 1);
+        for (auto& instruction : program) {
+            instruction.if_true = labels_[instruction.if_true];
+            instruction.if_false = labels_[instruction.if_false];
+        }
+    }
+
+private:
+    static constexpr uint32_t UNBOUND = std::numeric_limits<uint32_t>::max();
+
+    uint32_t label()
+    {
+        labels_.push_back(UNBOUND);
+        return static_cast<uint32_t>(labels_.size() - 1);
+    }
+
+    void bind(uint32_t label)
+    {
+        labels_[label] = static_cast<uint32_t>(compiled_.program_.size());
+    }
+
+    // Emits query so that it continues at if_true if it matches and at
+    // if_false otherwise.
+    void compile(const Query& query, uint32_t if_true, uint32_t if_false)
+    {
+        vector<shared_ptr<Query>> subqueries;
+        bool conjunction = false;
+        if (combines(query, subqueries, conjunction)) {
+            compile_combination(conjunction, subqueries, if_true, if_false);
+        } else {
+            compile_leaf(query, if_true, if_false);
+        }
+    }
+
+    // Returns whether query combines subqueries, which are appended to
+    // subqueries. Sets conjunction to whether all of them have to match.
+    static bool combines(const Query& query,
+        vector<shared_ptr<Query>>& subqueries, bool& conjunction)
+    {
+        if (auto and_query = dynamic_cast<const And*>(&query)) {
+            subqueries = {and_query->q1(), and_query->q2()};
+            conjunction = true;
+        } else if (auto collection = dynamic_cast<const AndCollection*>(
+                       &query)) {
+            subqueries = collection->queries();
+            conjunction = true;
+        } else if (auto or_query = dynamic_cast<const Or*>(&query)) {
+            subqueries = {or_query->q1(), or_query->q2()};
+        } else if (auto collection = dynamic_cast<const OrCollection*>(
+                       &query)) {
+            subqueries = collection->queries();
+        } else if (auto contains = dynamic_cast<const ContainsQuery*>(
+                       &query)) {
+            // A query that scans for all of its terms at once is kept
+            // whole.
+            if (contains->uses_automaton()) {
+                return false;
+            }
+            subqueries = contains->underlying_query().queries();
+        } else {
+            return false;
+        }
+        return true;
+    }
+
+    void compile_combination(bool conjunction,
+        const vector<shared_ptr<Query>>& subqueries, uint32_t if_true,
+        uint32_t if_false)
+    {
+        if (subqueries.empty()) {
+            emit(Op::CONSTANT, conjunction ? 1 : 0, 0, if_true, if_false);
+            return;
+        }
+
+        for (size_t i = 0; i + 1 < subqueries.size(); ++i) {
+            uint32_t next = label();
+            if (conjunction) {
+                compile(*subqueries[i], next, if_false);
+            } else {
+                compile(*subqueries[i], if_true, next);
+            }
+            bind(next);
+        }
+        compile(*subqueries.back(), if_true, if_false);
+    }
+
+    void compile_leaf(const Query& query, uint32_t if_true, uint32_t if_false)
+    {
+        if (auto field = dynamic_cast<const FieldQuery<LocationExtractor>*>(
+                &query)) {
+            emit(Op::LOCATION, matcher(field->term(), field->options()), 0,
+                if_true, if_false);
+        } else if (auto field =
+                       dynamic_cast<const FieldQuery<NameExtractor>*>(
+                           &query)) {
+            emit(Op::NAME, matcher(field->term(), field->options()), 0,
+                if_true, if_false);
+        } else if (auto field =
+                       dynamic_cast<const FieldQuery<DescriptionExtractor>*>(
+                           &query)) {
+            emit(Op::DESCRIPTION, matcher(field->term(), field->options()), 0,
+                if_true, if_false);
+        } else if (auto tag = dynamic_cast<const TagQuery*>(&query)) {
+            emit(Op::TAGS, matcher(tag->term(), tag->options()), 0, if_true,
+                if_false);
+        } else if (auto attributes =
+                       dynamic_cast<const AttributeContainsQuery*>(&query)) {
+            emit(Op::ATTRIBUTES,
+                matcher(attributes->term(), attributes->options()), 0,
+                if_true, if_false);
+        } else if (auto attribute =
+                       dynamic_cast<const AttributeQuery*>(&query)) {
+            auto& names = compiled_.attribute_names_;
+            names.push_back(attribute->attr_name());
+            emit(Op::ATTRIBUTE,
+                matcher(attribute->attr_value(), attribute->options()),
+                static_cast<uint32_t>(names.size() - 1), if_true, if_false);
+        } else {
+            auto& queries = compiled_.queries_;
+            queries.push_back(&query);
+            emit(Op::QUERY, static_cast<uint32_t>(queries.size() - 1), 0,
+                if_true, if_false);
+        }
+    }
+
+    uint32_t matcher(
+        const std::string& term, const StringSearchOptions& options)
+    {
+        auto& matchers = compiled_.matchers_;
+        matchers.emplace_back(term, options);
+        return static_cast<uint32_t>(matchers.size() - 1);
+    }
+
+    void emit(Op op, uint32_t argument, uint32_t name, uint32_t if_true,
+        uint32_t if_false)
+    {
+        compiled_.program_.push_back(
+            Instruction{op, argument, name, if_true, if_false});
+    }
+
+    CompiledQuery& compiled_;
+    // The instruction each label is bound to.
+    vector<uint32_t> labels_;
+};
+
+constexpr uint32_t CompiledQuery::Compiler::UNBOUND;
+
+CompiledQuery::CompiledQuery(const Query& query)
+{
+    Compiler{*this}.compile(query);
+}
+
+bool
+CompiledQuery::matches_row(const EntryStore& store, size_t row) const
+{
+    const size_t accept = program_.size();
+    size_t next = 0;
+    while (next < accept) {
+        const Instruction& instruction = program_[next];
+        next = run(instruction, store, row) ? instruction.if_true
+                                            : instruction.if_false;
+    }
+    return next == accept;
+}
+
+size_t
+CompiledQuery::size() const
+{
+    return program_.size();
+}
+
+bool
+CompiledQuery::run(
+    const Instruction& instruction, const EntryStore& store, size_t row) const
+{
+    switch (instruction.op) {
+    case Op::CONSTANT:
+        return instruction.argument != 0;
+    case Op::LOCATION:
+        return matchers_[instruction.argument].matches(store.location(row));
+    case Op::NAME:
+        return matchers_[instruction.argument].matches(store.name(row));
+    case Op::DESCRIPTION:
+        return matchers_[instruction.argument].matches(
+            store.description(row));
+    case Op::TAGS: {
+        const StringMatcher& matcher = matchers_[instruction.argument];
+        size_t count = store.tags_count(row);
+        for (size_t i = 0; i < count; ++i) {
+            if (matcher.matches(store.tag(row, i))) {
+                return true;
+            }
+        }
+        return false;
+    }
+    case Op::ATTRIBUTES: {
+        const StringMatcher& matcher = matchers_[instruction.argument];
+        size_t count = store.attributes_count(row);
+        for (size_t i = 0; i < count; ++i) {
+            if (matcher.matches(store.attribute_name(row, i))
+                || matcher.matches(store.attribute_value(row, i))) {
+                return true;
+            }
+        }
+        return false;
+    }
+    case Op::ATTRIBUTE: {
+        const std::string& name = attribute_names_[instruction.name];
+        size_t count = store.attributes_count(row);
+        for (size_t i = 0; i < count; ++i) {
+            if (store.attribute_name(row, i) == name) {
+                return matchers_[instruction.argument].matches(
+                    store.attribute_value(row, i));
+            }
+        }
+        return false;
+    }
+    case Op::QUERY:
+        return queries_[instruction.argument]->matches_row(store, row);
+    }
+    return false;
+}
+
+}  // namespace query
+
+}  // namespace libjlinkdb
@@ -21,12 +21,17 @@
 #include "query/contains_query.hh"
 
 #include <algorithm>
+#include <cstddef>
 #include <iterator>
 #include <memory>
 #include <string>
+#include <typeinfo>
 #include <vector>
 
+#include "entry_store.hh"
+#include "index_set.hh"
 #include "link_entry.hh"
+#include "multi_string_matcher.hh"
 #include "query/attribute_contains_query.hh"
 #include "query/description_extractor.hh"
 #include "query/field_query.hh"
@@ -56,12 +61,70 @@ ContainsQuery::ContainsQuery(
     std::transform(begin(terms), end(terms), std::back_inserter(queries),
         [&](const string& term) { return query_for_term(term, options); });
     underlying_query_ = OrCollection{queries};
+    if (terms.size() >= CONTAINS_AUTOMATON_THRESHOLD) {
+        uses_automaton_ = true;
+        matcher_ = MultiStringMatcher{terms, options};
+    }
 }
 
 bool
 ContainsQuery::matches(const LinkEntry& entry) const
 {
-    return underlying_query_.matches(entry);
+    if (!uses_automaton_) {
+        return underlying_query_.matches(entry);
+    }
+
+    if (matcher_.matches(entry.location()) || matcher_.matches(entry.name())
+        || matcher_.matches(entry.description())) {
+        return true;
+    }
+    for (const auto& tag : entry.tags()) {
+        if (matcher_.matches(tag)) {
+            return true;
+        }
+    }
+    for (const auto& attribute : entry.attributes()) {
+        if (matcher_.matches(attribute.first)
+            || matcher_.matches(attribute.second)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+ContainsQuery::matches_row(const EntryStore& store, std::size_t row) const
+{
+    if (!uses_automaton_) {
+        return underlying_query_.matches_row(store, row);
+    }
+
+    if (matcher_.matches(store.location(row))
+        || matcher_.matches(store.name(row))
+        || matcher_.matches(store.description(row))) {
+        return true;
+    }
+    std::size_t count = store.tags_count(row);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (matcher_.matches(store.tag(row, i))) {
+            return true;
+        }
+    }
+    count = store.attributes_count(row);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (matcher_.matches(store.attribute_name(row, i))
+            || matcher_.matches(store.attribute_value(row, i))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool
+ContainsQuery::find_candidates(
+    const IndexSet& indexes, vector<std::size_t>& rows) const
+{
+    return underlying_query_.find_candidates(indexes, rows);
 }
 
 std::shared_ptr<Query>
@@ -80,6 +143,73 @@ ContainsQuery::query_for_term(
     return make_shared<OrCollection>(queries);
 }
 
+const OrCollection&
+ContainsQuery::underlying_query() const
+{
+    return underlying_query_;
+}
+
+bool
+ContainsQuery::uses_automaton() const
+{
+    return uses_automaton_;
+}
+
+double
+ContainsQuery::estimated_cost() const
+{
+    if (!uses_automaton_) {
+        return underlying_query_.estimated_cost();
+    }
+    // Scanning every field once costs about as much as searching them for
+    // one term.
+    return underlying_query_.queries().front()->estimated_cost();
+}
+
+double
+ContainsQuery::estimated_selectivity() const
+{
+    return underlying_query_.estimated_selectivity();
+}
+
+string
+ContainsQuery::describe() const
+{
+    return "ContainsQuery";
+}
+
+string
+ContainsQuery::key() const
+{
+    // The query is just the collection for its terms.
+    return underlying_query_.key();
+}
+
+std::size_t
+ContainsQuery::hash() const
+{
+    return hash_combine(
+        typeid(ContainsQuery).hash_code(), underlying_query_.hash());
+}
+
+bool
+ContainsQuery::equals(const Query& other) const
+{
+    return typeid(other) == typeid(ContainsQuery)
+        && underlying_query_.equals(
+            static_cast<const ContainsQuery&>(other).underlying_query_);
+}
+
+shared_ptr<Query>
+ContainsQuery::canonical() const
+{
+    shared_ptr<Query> result = underlying_query_.canonical();
+    if (result != nullptr) {
+        return result;
+    }
+    return make_shared<OrCollection>(underlying_query_);
+}
+
 }  // namespace query
 
 }  // namespace libjlinkdb
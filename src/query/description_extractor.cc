@@ -20,18 +20,48 @@
 
 #include "query/description_extractor.hh"
 
+#include <cstddef>
 #include <string>
+#include <vector>
+
+#include "entry_store.hh"
+#include "index_set.hh"
+#include "query/string_search_options.hh"
+#include "string_ref.hh"
+#include "trigram_index.hh"
 
 namespace libjlinkdb {
 
 namespace query {
 
-std::string
+const std::string&
 DescriptionExtractor::operator()(const LinkEntry& entry) const
 {
     return entry.description();
 }
 
+StringRef
+DescriptionExtractor::operator()(
+    const EntryStore& store, std::size_t row) const
+{
+    return store.description(row);
+}
+
+bool
+DescriptionExtractor::find_candidates(const IndexSet& indexes,
+    const std::string& term, const StringSearchOptions& /* options */,
+    std::vector<std::size_t>& rows) const
+{
+    const TrigramIndex* index = indexes.trigram_index();
+    return index != nullptr && index->find(TextField::DESCRIPTION, term, rows);
+}
+
+std::string
+DescriptionExtractor::describe() const
+{
+    return "description";
+}
+
 }  // namespace query
 
 }  // namespace libjlinkdb
@@ -0,0 +1,165 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "query/host_query.hh"
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "entry_store.hh"
+#include "index_set.hh"
+#include "link_entry.hh"
+#include "string_ref.hh"
+#include "string_utils.hh"
+#include "trigram_index.hh"
+#include "url_index.hh"
+#include "url_parts.hh"
+
+namespace libjlinkdb {
+
+namespace query {
+
+using std::string;
+
+HostQuery::HostQuery(const string& host, bool include_subdomains)
+    : host_{host}, include_subdomains_{include_subdomains}
+{
+    to_lower_in_place(host_);
+}
+
+const string&
+HostQuery::host() const
+{
+    return host_;
+}
+
+bool
+HostQuery::include_subdomains() const
+{
+    return include_subdomains_;
+}
+
+bool
+HostQuery::matches(const LinkEntry& entry) const
+{
+    return matches_location(entry.location());
+}
+
+bool
+HostQuery::matches_row(const EntryStore& store, std::size_t row) const
+{
+    return matches_location(store.location(row));
+}
+
+bool
+HostQuery::find_candidates(
+    const IndexSet& indexes, std::vector<std::size_t>& rows) const
+{
+    const UrlIndex* url_index = indexes.url_index();
+    if (url_index != nullptr && !include_subdomains_) {
+        rows = url_index->find_host(host_);
+        return true;
+    }
+    // Every subdomain has the registrable domain of the host, if it has one.
+    StringRef domain = registrable_domain(host_);
+    if (url_index != nullptr && !domain.empty()) {
+        rows = url_index->find_domain(domain.str());
+        return true;
+    }
+
+    const TrigramIndex* trigram_index = indexes.trigram_index();
+    return trigram_index != nullptr
+        && trigram_index->find(TextField::LOCATION, host_, rows);
+}
+
+double
+HostQuery::estimated_cost() const
+{
+    // Splitting the location, then comparing the host.
+    return 3.0;
+}
+
+double
+HostQuery::estimated_selectivity() const
+{
+    // Few links share a host.
+    return 0.05;
+}
+
+string
+HostQuery::describe() const
+{
+    return "HostQuery " + host_
+        + (include_subdomains_ ? " (include subdomains)" : "");
+}
+
+string
+HostQuery::key() const
+{
+    return string{include_subdomains_ ? "domain:" : "host:"} + host_;
+}
+
+std::size_t
+HostQuery::hash() const
+{
+    return hash_combine(hash_combine(typeid(HostQuery).hash_code(),
+                            std::hash<string>{}(host_)),
+        include_subdomains_);
+}
+
+bool
+HostQuery::equals(const Query& other) const
+{
+    if (typeid(other) != typeid(HostQuery)) {
+        return false;
+    }
+    const auto& query = static_cast<const HostQuery&>(other);
+    return host_ == query.host_
+        && include_subdomains_ == query.include_subdomains_;
+}
+
+bool
+HostQuery::matches_location(StringRef location) const
+{
+    UrlParts parts;
+    if (!split_url(location, parts)) {
+        return false;
+    }
+
+    StringRef host = parts.host;
+    if (host.size() == host_.size()) {
+        return equals_ignore_case(host, host_);
+    }
+    // A subdomain ends with a dot followed by the host.
+    if (!include_subdomains_ || host.size() <= host_.size()) {
+        return false;
+    }
+    std::size_t start = host.size() - host_.size();
+    return host[start - 1] == '.'
+        && equals_ignore_case(
+            StringRef{host.data() + start, host_.size()}, host_);
+}
+
+}  // namespace query
+
+}  // namespace libjlinkdb
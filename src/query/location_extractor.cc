@@ -20,18 +20,47 @@
 
 #include "query/location_extractor.hh"
 
+#include <cstddef>
 #include <string>
+#include <vector>
+
+#include "entry_store.hh"
+#include "index_set.hh"
+#include "query/string_search_options.hh"
+#include "string_ref.hh"
+#include "trigram_index.hh"
 
 namespace libjlinkdb {
 
 namespace query {
 
-std::string
+const std::string&
 LocationExtractor::operator()(const LinkEntry& entry) const
 {
     return entry.location();
 }
 
+StringRef
+LocationExtractor::operator()(const EntryStore& store, std::size_t row) const
+{
+    return store.location(row);
+}
+
+bool
+LocationExtractor::find_candidates(const IndexSet& indexes,
+    const std::string& term, const StringSearchOptions& /* options */,
+    std::vector<std::size_t>& rows) const
+{
+    const TrigramIndex* index = indexes.trigram_index();
+    return index != nullptr && index->find(TextField::LOCATION, term, rows);
+}
+
+std::string
+LocationExtractor::describe() const
+{
+    return "location";
+}
+
 }  // namespace query
 
 }  // namespace libjlinkdb
@@ -0,0 +1,130 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "query/location_prefix_query.hh"
+
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "entry_store.hh"
+#include "index_set.hh"
+#include "link_entry.hh"
+#include "string_ref.hh"
+#include "trigram_index.hh"
+#include "url_index.hh"
+
+namespace libjlinkdb {
+
+namespace query {
+
+using std::string;
+
+LocationPrefixQuery::LocationPrefixQuery(const string& prefix)
+    : prefix_{prefix}
+{
+}
+
+const string&
+LocationPrefixQuery::prefix() const
+{
+    return prefix_;
+}
+
+bool
+LocationPrefixQuery::matches(const LinkEntry& entry) const
+{
+    return has_prefix(entry.location());
+}
+
+bool
+LocationPrefixQuery::matches_row(
+    const EntryStore& store, std::size_t row) const
+{
+    return has_prefix(store.location(row));
+}
+
+bool
+LocationPrefixQuery::find_candidates(
+    const IndexSet& indexes, std::vector<std::size_t>& rows) const
+{
+    const UrlIndex* url_index = indexes.url_index();
+    if (url_index != nullptr && url_index->find_prefix(prefix_, rows)) {
+        return true;
+    }
+
+    const TrigramIndex* trigram_index = indexes.trigram_index();
+    return trigram_index != nullptr
+        && trigram_index->find(TextField::LOCATION, prefix_, rows);
+}
+
+double
+LocationPrefixQuery::estimated_cost() const
+{
+    return 1.0;
+}
+
+double
+LocationPrefixQuery::estimated_selectivity() const
+{
+    return 0.1;
+}
+
+string
+LocationPrefixQuery::describe() const
+{
+    return "LocationPrefixQuery \"" + prefix_ + "\"";
+}
+
+string
+LocationPrefixQuery::key() const
+{
+    return "location_prefix:" + prefix_;
+}
+
+std::size_t
+LocationPrefixQuery::hash() const
+{
+    return hash_combine(typeid(LocationPrefixQuery).hash_code(),
+        std::hash<string>{}(prefix_));
+}
+
+bool
+LocationPrefixQuery::equals(const Query& other) const
+{
+    if (typeid(other) != typeid(LocationPrefixQuery)) {
+        return false;
+    }
+    return prefix_ == static_cast<const LocationPrefixQuery&>(other).prefix_;
+}
+
+bool
+LocationPrefixQuery::has_prefix(StringRef location) const
+{
+    return location.size() >= prefix_.size()
+        && std::memcmp(location.data(), prefix_.data(), prefix_.size()) == 0;
+}
+
+}  // namespace query
+
+}  // namespace libjlinkdb
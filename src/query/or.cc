@@ -20,8 +20,14 @@
 
 #include "query/or.hh"
 
+#include <cstddef>
 #include <memory>
+#include <string>
+#include <typeinfo>
+#include <vector>
 
+#include "entry_store.hh"
+#include "index_set.hh"
 #include "link_entry.hh"
 #include "query/query.hh"
 
@@ -42,6 +48,98 @@ Or::matches(const LinkEntry& entry) const
     return q1_->matches(entry) || q2_->matches(entry);
 }
 
+bool
+Or::matches_row(const EntryStore& store, std::size_t row) const
+{
+    return q1_->matches_row(store, row) || q2_->matches_row(store, row);
+}
+
+bool
+Or::find_candidates(
+    const IndexSet& indexes, std::vector<std::size_t>& rows) const
+{
+    return detail::find_candidates_from_bitmap(*this, indexes, rows);
+}
+
+bool
+Or::find_candidate_bitmap(const IndexSet& indexes, RowBitmap& rows) const
+{
+    RowBitmap rows2;
+    if (!q1_->find_candidate_bitmap(indexes, rows)
+        || !q2_->find_candidate_bitmap(indexes, rows2)) {
+        return false;
+    }
+
+    rows.unite(rows2);
+    return true;
+}
+
+const shared_ptr<Query>&
+Or::q1() const
+{
+    return q1_;
+}
+
+const shared_ptr<Query>&
+Or::q2() const
+{
+    return q2_;
+}
+
+double
+Or::estimated_cost() const
+{
+    return q1_->estimated_cost() + q2_->estimated_cost();
+}
+
+double
+Or::estimated_selectivity() const
+{
+    return 1.0
+        - (1.0 - q1_->estimated_selectivity())
+        * (1.0 - q2_->estimated_selectivity());
+}
+
+std::string
+Or::describe() const
+{
+    return "Or";
+}
+
+std::string
+Or::key() const
+{
+    std::string key1 = q1_->key();
+    std::string key2 = q2_->key();
+    if (key1.empty() || key2.empty()) {
+        return {};
+    }
+    return "or(" + key1 + "," + key2 + ")";
+}
+
+std::size_t
+Or::hash() const
+{
+    return hash_combine(
+        hash_combine(typeid(Or).hash_code(), q1_->hash()), q2_->hash());
+}
+
+bool
+Or::equals(const Query& other) const
+{
+    if (typeid(other) != typeid(Or)) {
+        return false;
+    }
+    const auto& query = static_cast<const Or&>(other);
+    return q1_->equals(*query.q1_) && q2_->equals(*query.q2_);
+}
+
+shared_ptr<Query>
+Or::canonical() const
+{
+    return detail::canonical_collection(false, {q1_, q2_}, false);
+}
+
 }  // namespace query
 
 }  // namespace libjlinkdb
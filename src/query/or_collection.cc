@@ -21,10 +21,15 @@
 #include "query/or_collection.hh"
 
 #include <algorithm>
+#include <cstddef>
 #include <iterator>
 #include <memory>
+#include <string>
+#include <typeinfo>
 #include <vector>
 
+#include "entry_store.hh"
+#include "index_set.hh"
 #include "link_entry.hh"
 #include "query/query.hh"
 
@@ -49,6 +54,116 @@ OrCollection::matches(const LinkEntry& entry) const
         [&](const shared_ptr<Query>& query) { return query->matches(entry); });
 }
 
+bool
+OrCollection::matches_row(const EntryStore& store, std::size_t row) const
+{
+    return std::any_of(begin(queries_), end(queries_),
+        [&](const shared_ptr<Query>& query) {
+            return query->matches_row(store, row);
+        });
+}
+
+bool
+OrCollection::find_candidates(
+    const IndexSet& indexes, vector<std::size_t>& rows) const
+{
+    return detail::find_candidates_from_bitmap(*this, indexes, rows);
+}
+
+bool
+OrCollection::find_candidate_bitmap(
+    const IndexSet& indexes, RowBitmap& rows) const
+{
+    rows = RowBitmap{};
+    RowBitmap query_rows;
+    for (const auto& query : queries_) {
+        if (!query->find_candidate_bitmap(indexes, query_rows)) {
+            return false;
+        }
+        rows.unite(query_rows);
+    }
+    return true;
+}
+
+const vector<shared_ptr<Query>>&
+OrCollection::queries() const
+{
+    return queries_;
+}
+
+double
+OrCollection::estimated_cost() const
+{
+    double result = 0.0;
+    for (const auto& query : queries_) {
+        result += query->estimated_cost();
+    }
+    return result;
+}
+
+double
+OrCollection::estimated_selectivity() const
+{
+    double none = 1.0;
+    for (const auto& query : queries_) {
+        none *= 1.0 - query->estimated_selectivity();
+    }
+    return 1.0 - none;
+}
+
+std::string
+OrCollection::describe() const
+{
+    return "OrCollection";
+}
+
+std::string
+OrCollection::key() const
+{
+    std::string result{"any("};
+    for (const auto& query : queries_) {
+        std::string query_key = query->key();
+        if (query_key.empty()) {
+            return {};
+        }
+        result += query_key;
+        result += ",";
+    }
+    result += ")";
+    return result;
+}
+
+std::size_t
+OrCollection::hash() const
+{
+    std::size_t result = typeid(OrCollection).hash_code();
+    for (const auto& query : queries_) {
+        result = hash_combine(result, query->hash());
+    }
+    return result;
+}
+
+bool
+OrCollection::equals(const Query& other) const
+{
+    if (typeid(other) != typeid(OrCollection)) {
+        return false;
+    }
+    const auto& queries = static_cast<const OrCollection&>(other).queries_;
+    return queries_.size() == queries.size()
+        && std::equal(begin(queries_), end(queries_), begin(queries),
+            [](const shared_ptr<Query>& query1,
+                const shared_ptr<Query>& query2) {
+                return query1->equals(*query2);
+            });
+}
+
+shared_ptr<Query>
+OrCollection::canonical() const
+{
+    return detail::canonical_collection(false, queries_, true);
+}
+
 }  // namespace query
 
 }  // namespace libjlinkdb
@@ -0,0 +1,172 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "query/query.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <utility>
+#include <vector>
+
+#include "index_set.hh"
+#include "query/and_collection.hh"
+#include "query/or_collection.hh"
+#include "query/string_search_options.hh"
+#include "row_bitmap.hh"
+#include "string_utils.hh"
+
+namespace libjlinkdb {
+
+namespace query {
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+shared_ptr<Query>
+canonicalize(const shared_ptr<Query>& query)
+{
+    shared_ptr<Query> result = query->canonical();
+    return result != nullptr ? result : query;
+}
+
+namespace detail {
+
+namespace {
+
+// Returns the subqueries of query if it is a collection of the given kind,
+// and null otherwise.
+const vector<shared_ptr<Query>>*
+collection_queries(const Query& query, bool conjunction)
+{
+    if (conjunction && typeid(query) == typeid(AndCollection)) {
+        return &static_cast<const AndCollection&>(query).queries();
+    }
+    if (!conjunction && typeid(query) == typeid(OrCollection)) {
+        return &static_cast<const OrCollection&>(query).queries();
+    }
+    return nullptr;
+}
+
+// A subquery of a collection and the hash and key it is sorted by.
+struct SortedQuery {
+    std::size_t hash;
+    string key;
+    shared_ptr<Query> query;
+};
+
+}  // namespace
+
+shared_ptr<Query>
+canonical_collection(bool conjunction,
+    const vector<shared_ptr<Query>>& queries, bool is_collection)
+{
+    // Flatten collections of the same kind. Since an empty collection of
+    // the same kind is the identity, it disappears. An empty collection of
+    // the other kind absorbs the whole collection.
+    vector<SortedQuery> sorted;
+    for (const auto& query : queries) {
+        shared_ptr<Query> canonical = canonicalize(query);
+        if (const auto* nested = collection_queries(*canonical, conjunction)) {
+            for (const auto& nested_query : *nested) {
+                sorted.push_back(SortedQuery{nested_query->hash(),
+                    nested_query->key(), nested_query});
+            }
+            continue;
+        }
+        const auto* other = collection_queries(*canonical, !conjunction);
+        if (other != nullptr && other->empty()) {
+            return canonical;
+        }
+        sorted.push_back(
+            SortedQuery{canonical->hash(), canonical->key(), canonical});
+    }
+
+    // Sort by key, which is the same from run to run, and only fall back to
+    // the hash for queries without keys, whose hash may be their address.
+    std::stable_sort(sorted.begin(), sorted.end(),
+        [](const SortedQuery& query1, const SortedQuery& query2) {
+            if (query1.key != query2.key) {
+                return query1.key < query2.key;
+            }
+            return query1.hash < query2.hash;
+        });
+
+    // Equal queries have the same key and hash, so only compare each query
+    // to the ones before it with the same key and hash.
+    vector<shared_ptr<Query>> result;
+    std::size_t same_key = 0;
+    for (std::size_t i = 0; i < sorted.size(); ++i) {
+        if (i > 0
+            && (sorted[i].key != sorted[i - 1].key
+                || sorted[i].hash != sorted[i - 1].hash)) {
+            same_key = result.size();
+        }
+        bool duplicate = std::any_of(result.begin() + same_key, result.end(),
+            [&](const shared_ptr<Query>& query) {
+                return query->equals(*sorted[i].query);
+            });
+        if (!duplicate) {
+            result.push_back(std::move(sorted[i].query));
+        }
+    }
+
+    if (result.size() == 1) {
+        return result.front();
+    }
+    if (is_collection && result == queries) {
+        return {};
+    }
+    if (conjunction) {
+        return std::make_shared<AndCollection>(result);
+    }
+    return std::make_shared<OrCollection>(result);
+}
+
+string
+canonical_term(const string& term, const StringSearchOptions& options)
+{
+    string result{term};
+    if (options.ignore_case) {
+        to_lower_in_place(result);
+    }
+    return result;
+}
+
+bool
+find_candidates_from_bitmap(
+    const Query& query, const IndexSet& indexes, vector<std::size_t>& rows)
+{
+    RowBitmap bitmap;
+    if (!query.find_candidate_bitmap(indexes, bitmap)) {
+        return false;
+    }
+    bitmap.copy_rows(rows);
+    return true;
+}
+
+}  // namespace detail
+
+}  // namespace query
+
+}  // namespace libjlinkdb
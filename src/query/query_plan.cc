@@ -0,0 +1,478 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "query/query_plan.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "entry_store.hh"
+#include "index_set.hh"
+#include "query/and.hh"
+#include "query/and_collection.hh"
+#include "query/compiled_query.hh"
+#include "query/contains_query.hh"
+#include "query/or.hh"
+#include "query/or_collection.hh"
+#include "query/query.hh"
+#include "row_bitmap.hh"
+
+namespace libjlinkdb {
+
+namespace query {
+
+using std::make_shared;
+using std::shared_ptr;
+using std::size_t;
+using std::string;
+using std::vector;
+
+namespace {
+
+// How a query combines its subqueries.
+enum class Combination {
+    // The query doesn't have subqueries the planner knows about.
+    NONE,
+    // The query matches if every subquery matches.
+    ALL,
+    // The query matches if any subquery matches.
+    ANY
+};
+
+// Returns how query combines its subqueries, and appends those subqueries
+// to subqueries.
+Combination
+classify(const Query& query, vector<shared_ptr<Query>>& subqueries)
+{
+    if (auto and_query = dynamic_cast<const And*>(&query)) {
+        subqueries.push_back(and_query->q1());
+        subqueries.push_back(and_query->q2());
+        return Combination::ALL;
+    }
+    if (auto collection = dynamic_cast<const AndCollection*>(&query)) {
+        subqueries.insert(subqueries.end(), collection->queries().begin(),
+            collection->queries().end());
+        return Combination::ALL;
+    }
+    if (auto or_query = dynamic_cast<const Or*>(&query)) {
+        subqueries.push_back(or_query->q1());
+        subqueries.push_back(or_query->q2());
+        return Combination::ANY;
+    }
+    if (auto collection = dynamic_cast<const OrCollection*>(&query)) {
+        subqueries.insert(subqueries.end(), collection->queries().begin(),
+            collection->queries().end());
+        return Combination::ANY;
+    }
+    // A query that scans for all of its terms at once is cheaper as a
+    // whole than split into terms.
+    auto contains = dynamic_cast<const ContainsQuery*>(&query);
+    if (contains != nullptr && !contains->uses_automaton()) {
+        const auto& queries = contains->underlying_query().queries();
+        subqueries.insert(subqueries.end(), queries.begin(), queries.end());
+        return Combination::ANY;
+    }
+    return Combination::NONE;
+}
+
+// Appends the subqueries of queries that combine their own subqueries in the
+// same way to result, recursively, and the rest of queries as they are.
+void
+flatten(Combination combination, const vector<shared_ptr<Query>>& queries,
+    vector<shared_ptr<Query>>& result)
+{
+    for (const auto& query : queries) {
+        vector<shared_ptr<Query>> subqueries;
+        if (classify(*query, subqueries) == combination) {
+            flatten(combination, subqueries, result);
+        } else {
+            result.push_back(query);
+        }
+    }
+}
+
+// Looks up the candidates of a query that has no subqueries in indexes and
+// sets whether node uses indexes, how many candidates there are and whether
+// they are exact. If node.uses_indexes is set, rows is set to the
+// candidates.
+void
+find_leaf_candidates(const Query& query, const IndexSet& indexes,
+    PlanNode& node, RowBitmap& rows)
+{
+    node.uses_indexes = query.find_candidate_bitmap(indexes, rows);
+    node.candidate_count = node.uses_indexes ? rows.size() : 0;
+    node.exact = node.uses_indexes && query.candidates_exact(indexes);
+}
+
+// Sets whether node uses indexes, how many candidates there are and whether
+// they are exact from the children of node, which combine as combination.
+// children_rows holds the candidates of the children, which are moved from.
+// If node.uses_indexes is set, rows is set to the candidates.
+void
+combine_children(Combination combination, vector<RowBitmap>& children_rows,
+    PlanNode& node, RowBitmap& rows)
+{
+    node.uses_indexes = false;
+    node.candidate_count = 0;
+    if (combination == Combination::ALL) {
+        // The candidates are the rows left by every subquery that uses
+        // indexes.
+        node.exact = true;
+        for (size_t i = 0; i < node.children.size(); ++i) {
+            const PlanNode& child = node.children[i];
+            node.exact = node.exact && child.exact;
+            if (!child.uses_indexes) {
+                continue;
+            }
+            if (node.uses_indexes) {
+                rows.intersect(children_rows[i]);
+            } else {
+                rows = std::move(children_rows[i]);
+                node.uses_indexes = true;
+            }
+        }
+    } else {
+        // Indexes only help if every subquery uses them.
+        node.uses_indexes = std::all_of(node.children.begin(),
+            node.children.end(),
+            [](const PlanNode& child) { return child.uses_indexes; });
+        node.exact = std::all_of(node.children.begin(), node.children.end(),
+            [](const PlanNode& child) { return child.exact; });
+        // An empty collection matches nothing, so it has no candidates.
+        if (node.uses_indexes && !children_rows.empty()) {
+            rows = std::move(children_rows.front());
+            for (size_t i = 1; i < children_rows.size(); ++i) {
+                rows.unite(children_rows[i]);
+            }
+        }
+    }
+    if (node.uses_indexes) {
+        node.candidate_count = rows.size();
+    }
+}
+
+// Looks up the candidates of query, a query rewritten by planning that was
+// planned as node, again in indexes, and updates node and its children to
+// match. If node.uses_indexes is set, rows is set to the candidates.
+void
+refresh_node(const Query& query, const IndexSet& indexes, PlanNode& node,
+    RowBitmap& rows)
+{
+    // Planning turns every query with subqueries into a collection.
+    Combination combination = Combination::NONE;
+    const vector<shared_ptr<Query>>* queries = nullptr;
+    if (auto collection = dynamic_cast<const AndCollection*>(&query)) {
+        combination = Combination::ALL;
+        queries = &collection->queries();
+    } else if (auto collection = dynamic_cast<const OrCollection*>(&query)) {
+        combination = Combination::ANY;
+        queries = &collection->queries();
+    }
+    if (queries == nullptr) {
+        find_leaf_candidates(query, indexes, node, rows);
+        return;
+    }
+
+    vector<RowBitmap> children_rows(queries->size());
+    for (size_t i = 0; i < queries->size(); ++i) {
+        refresh_node(
+            *(*queries)[i], indexes, node.children[i], children_rows[i]);
+    }
+    combine_children(combination, children_rows, node, rows);
+}
+
+// Builds the rewritten queries and plan nodes for a database.
+class Planner {
+public:
+    Planner(const EntryStore& store, const IndexSet& indexes)
+        : store_{store}, indexes_{indexes}
+    {
+    }
+
+    // Returns the rewritten form of query and describes it in node. If
+    // node.uses_indexes is set, rows is set to the candidates.
+    shared_ptr<Query> plan(
+        const shared_ptr<Query>& query, PlanNode& node, RowBitmap& rows)
+    {
+        vector<shared_ptr<Query>> subqueries;
+        Combination combination = classify(*query, subqueries);
+        if (combination == Combination::NONE) {
+            plan_leaf(*query, node, rows);
+            return query;
+        }
+        return plan_combination(combination, subqueries, node, rows);
+    }
+
+    // Returns the rewritten form of a query that combines subqueries, and
+    // describes it in node. If node.uses_indexes is set, rows is set to the
+    // candidates, combined from those of the subqueries.
+    shared_ptr<Query> plan_combination(Combination combination,
+        const vector<shared_ptr<Query>>& subqueries, PlanNode& node,
+        RowBitmap& rows)
+    {
+        vector<shared_ptr<Query>> flattened;
+        flatten(combination, subqueries, flattened);
+
+        vector<Planned> planned(flattened.size());
+        for (size_t i = 0; i < flattened.size(); ++i) {
+            planned[i].query =
+                plan(flattened[i], planned[i].node, planned[i].rows);
+        }
+
+        // Order by cost per decided entry. A collection of all subqueries is
+        // decided by a subquery that doesn't match, and a collection of any
+        // subqueries by one that does.
+        auto rank = [combination](const PlanNode& plan) {
+            double deciding = combination == Combination::ALL
+                ? 1.0 - plan.estimated_selectivity
+                : plan.estimated_selectivity;
+            return plan.estimated_cost / std::max(deciding, MIN_FRACTION);
+        };
+        std::stable_sort(planned.begin(), planned.end(),
+            [&](const Planned& first, const Planned& second) {
+                return rank(first.node) < rank(second.node);
+            });
+
+        if (planned.size() == 1) {
+            node = std::move(planned.front().node);
+            rows = std::move(planned.front().rows);
+            return planned.front().query;
+        }
+
+        vector<shared_ptr<Query>> queries;
+        vector<RowBitmap> children_rows;
+        for (auto& query : planned) {
+            queries.push_back(query.query);
+            node.children.push_back(std::move(query.node));
+            children_rows.push_back(std::move(query.rows));
+        }
+        combine_children(combination, children_rows, node, rows);
+
+        shared_ptr<Query> result;
+        if (combination == Combination::ALL) {
+            result = make_shared<AndCollection>(queries);
+        } else {
+            result = make_shared<OrCollection>(queries);
+        }
+        node.description = result->describe();
+        node.estimated_cost = result->estimated_cost();
+        node.estimated_selectivity = result->estimated_selectivity();
+        return result;
+    }
+
+    // Describes a query that has no subqueries in node. If
+    // node.uses_indexes is set, rows is set to the candidates.
+    void plan_leaf(const Query& query, PlanNode& node, RowBitmap& rows)
+    {
+        node.description = query.describe();
+        node.estimated_cost = query.estimated_cost();
+        node.estimated_selectivity = query.estimated_selectivity();
+
+        find_leaf_candidates(query, indexes_, node, rows);
+        if (node.uses_indexes) {
+            node.estimated_selectivity = store_.size() == 0
+                ? 0.0
+                : static_cast<double>(rows.size()) / store_.size();
+        }
+    }
+
+private:
+    // A subquery of a collection as it was planned.
+    struct Planned {
+        shared_ptr<Query> query;
+        PlanNode node;
+        RowBitmap rows;
+    };
+
+    // The smallest fraction used when ranking subqueries, so that subqueries
+    // that are estimated to never decide the result still have a rank.
+    static constexpr double MIN_FRACTION = 1e-6;
+
+    const EntryStore& store_;
+    const IndexSet& indexes_;
+};
+
+constexpr double Planner::MIN_FRACTION;
+
+// Returns the part of query, planned as node, that the candidates of the
+// plan still have to be checked against, or null if they all match it.
+// Only subqueries that every row has to match can be left out.
+shared_ptr<const Query>
+find_residual(const shared_ptr<const Query>& query, const PlanNode& node)
+{
+    if (node.exact) {
+        return {};
+    }
+    auto collection = dynamic_cast<const AndCollection*>(query.get());
+    if (collection == nullptr) {
+        return query;
+    }
+
+    const auto& queries = collection->queries();
+    vector<shared_ptr<Query>> checked;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        if (!node.children[i].exact) {
+            checked.push_back(queries[i]);
+        }
+    }
+    if (checked.size() == queries.size()) {
+        return query;
+    }
+    if (checked.size() == 1) {
+        return checked.front();
+    }
+    return make_shared<AndCollection>(checked);
+}
+
+// Appends a line describing node and its children to out, indenting by
+// depth.
+void
+explain_node(const PlanNode& node, int depth, std::ostringstream& out)
+{
+    out << string(2 * depth, ' ') << node.description << " [cost "
+        << node.estimated_cost << ", selectivity "
+        << node.estimated_selectivity;
+    if (node.uses_indexes) {
+        out << ", " << node.candidate_count << " candidates from indexes";
+    }
+    if (node.exact) {
+        out << ", exact";
+    }
+    out << "]\n";
+
+    for (const auto& child : node.children) {
+        explain_node(child, depth + 1, out);
+    }
+}
+
+}  // namespace
+
+QueryPlan::QueryPlan(
+    const Query& query, const EntryStore& store, const IndexSet& indexes)
+{
+    Planner planner{store, indexes};
+    vector<shared_ptr<Query>> subqueries;
+    Combination combination = classify(query, subqueries);
+    RowBitmap rows;
+    if (combination == Combination::NONE) {
+        // The plan doesn't own the query it was given.
+        query_ = shared_ptr<const Query>{shared_ptr<const Query>{}, &query};
+        planner.plan_leaf(query, root_, rows);
+    } else {
+        query_ =
+            planner.plan_combination(combination, subqueries, root_, rows);
+    }
+
+    uses_indexes_ = root_.uses_indexes;
+    if (uses_indexes_) {
+        rows.copy_rows(candidates_);
+    }
+    build_residual();
+}
+
+const Query&
+QueryPlan::query() const
+{
+    return *query_;
+}
+
+const Query&
+QueryPlan::residual() const
+{
+    return *residual_;
+}
+
+bool
+QueryPlan::uses_indexes() const
+{
+    return uses_indexes_;
+}
+
+const vector<size_t>&
+QueryPlan::candidates() const
+{
+    return candidates_;
+}
+
+const CompiledQuery&
+QueryPlan::compiled() const
+{
+    return *compiled_;
+}
+
+void
+QueryPlan::update_candidates(const IndexSet& indexes)
+{
+    // The residual depends on which of the root and its children have
+    // exact candidates.
+    auto exact_nodes = [this]() {
+        vector<bool> result{root_.uses_indexes, root_.exact};
+        for (const auto& child : root_.children) {
+            result.push_back(child.exact);
+        }
+        return result;
+    };
+    vector<bool> exact_before = exact_nodes();
+
+    RowBitmap rows;
+    refresh_node(*query_, indexes, root_, rows);
+    uses_indexes_ = root_.uses_indexes;
+    if (uses_indexes_) {
+        rows.copy_rows(candidates_);
+    } else {
+        candidates_.clear();
+    }
+    if (exact_nodes() != exact_before) {
+        build_residual();
+    }
+}
+
+const PlanNode&
+QueryPlan::root() const
+{
+    return root_;
+}
+
+void
+QueryPlan::build_residual()
+{
+    residual_ = uses_indexes_ ? find_residual(query_, root_) : query_;
+    if (!residual_) {
+        residual_ = make_shared<AndCollection>();
+    }
+    compiled_ = make_shared<CompiledQuery>(*residual_);
+}
+
+string
+QueryPlan::explain() const
+{
+    std::ostringstream out;
+    explain_node(root_, 0, out);
+    return out.str();
+}
+
+}  // namespace query
+
+}  // namespace libjlinkdb
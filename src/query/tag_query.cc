@@ -21,13 +21,22 @@
 #include "query/tag_query.hh"
 
 #include <algorithm>
+#include <cstddef>
 #include <iterator>
+#include <memory>
 #include <string>
+#include <typeinfo>
+#include <vector>
 
+#include "entry_store.hh"
+#include "index_set.hh"
 #include "link_entry.hh"
 #include "query/query.hh"
 #include "query/string_search_options.hh"
+#include "row_bitmap.hh"
 #include "string_utils.hh"
+#include "tag_index.hh"
+#include "trigram_index.hh"
 
 namespace libjlinkdb {
 
@@ -36,21 +45,133 @@ namespace query {
 using std::begin;
 using std::end;
 using std::string;
+using std::vector;
 
 TagQuery::TagQuery(const string& term, const StringSearchOptions& options)
-    : term_{term}, options_{options}
+    : term_{term}, options_{options}, matcher_{term, options}
 {
 }
 
+const string&
+TagQuery::term() const
+{
+    return term_;
+}
+
+const StringSearchOptions&
+TagQuery::options() const
+{
+    return options_;
+}
+
 bool
 TagQuery::matches(const LinkEntry& entry) const
 {
     return std::any_of(
         begin(entry.tags()), end(entry.tags()), [&](const string& tag) {
-            return search_string(tag, term_, options_);
+            return matcher_.matches(tag);
         });
 }
 
+bool
+TagQuery::matches_row(const EntryStore& store, std::size_t row) const
+{
+    std::size_t count = store.tags_count(row);
+    for (std::size_t i = 0; i < count; ++i) {
+        if (matcher_.matches(store.tag(row, i))) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool
+TagQuery::find_candidates(
+    const IndexSet& indexes, vector<std::size_t>& rows) const
+{
+    const TagIndex* tag_index = indexes.tag_index();
+    if (tag_index != nullptr && options_.match_full_string) {
+        tag_index->find(term_, options_.ignore_case).copy_rows(rows);
+        return true;
+    }
+
+    const TrigramIndex* trigram_index = indexes.trigram_index();
+    return trigram_index != nullptr
+        && trigram_index->find(TextField::TAGS, term_, rows);
+}
+
+bool
+TagQuery::find_candidate_bitmap(const IndexSet& indexes, RowBitmap& rows) const
+{
+    const TagIndex* tag_index = indexes.tag_index();
+    if (tag_index != nullptr && options_.match_full_string) {
+        rows = tag_index->find(term_, options_.ignore_case);
+        return true;
+    }
+    return Query::find_candidate_bitmap(indexes, rows);
+}
+
+bool
+TagQuery::candidates_exact(const IndexSet& indexes) const
+{
+    // The index of tags holds exactly the entries with a tag equal to the
+    // term, while trigrams only narrow them down.
+    return indexes.tag_index() != nullptr && options_.match_full_string;
+}
+
+double
+TagQuery::estimated_cost() const
+{
+    // Entries usually have a few tags.
+    return 2.0 * estimated_search_cost(options_);
+}
+
+double
+TagQuery::estimated_selectivity() const
+{
+    return estimated_search_selectivity(options_);
+}
+
+string
+TagQuery::describe() const
+{
+    return "TagQuery " + describe_search(term_, options_);
+}
+
+string
+TagQuery::key() const
+{
+    return "tag:" + search_key(term_, options_);
+}
+
+std::size_t
+TagQuery::hash() const
+{
+    return hash_combine(
+        typeid(TagQuery).hash_code(), search_hash(term_, options_));
+}
+
+bool
+TagQuery::equals(const Query& other) const
+{
+    if (typeid(other) != typeid(TagQuery)) {
+        return false;
+    }
+    const auto& query = static_cast<const TagQuery&>(other);
+    return term_ == query.term_ && options_ == query.options_;
+}
+
+std::shared_ptr<Query>
+TagQuery::canonical() const
+{
+    string term = detail::canonical_term(term_, options_);
+    if (term == term_) {
+        return {};
+    }
+    return std::make_shared<TagQuery>(term, options_);
+}
+
 }  // namespace query
 
 }  // namespace libjlinkdb
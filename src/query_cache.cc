@@ -0,0 +1,215 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "query_cache.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "entry_store.hh"
+#include "query/query.hh"
+
+namespace libjlinkdb {
+
+using std::size_t;
+using std::string;
+using std::vector;
+
+namespace {
+
+// A rough number of bytes each result takes besides its key and ids, for
+// the list and map nodes.
+constexpr size_t RESULT_OVERHEAD = 128;
+
+}  // namespace
+
+QueryCache::QueryCache(size_t capacity) : capacity_{capacity}
+{
+}
+
+bool
+QueryCache::find(const string& key, const query::Query& query,
+    const EntryStore& store, vector<int>& ids)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto position = positions_.find(key);
+    if (position == positions_.end()) {
+        ++misses_;
+        return false;
+    }
+
+    ++hits_;
+    auto result = position->second;
+    results_.splice(results_.begin(), results_, result);
+    size_ -= footprint(*result);
+    patch(*result, query, store);
+    size_ += footprint(*result);
+    ids = result->ids;
+    evict();
+    return true;
+}
+
+void
+QueryCache::insert(const string& key, vector<int> ids)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    auto position = positions_.find(key);
+    if (position != positions_.end()) {
+        erase(position->second);
+    }
+
+    ids.shrink_to_fit();
+    results_.push_front(
+        Result{key, std::move(ids), first_change_ + changes_.size()});
+    positions_[key] = results_.begin();
+    size_ += footprint(results_.front());
+    evict();
+}
+
+void
+QueryCache::invalidate(int id)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    if (results_.empty()) {
+        // Nothing needs patching, so there is no need to remember it.
+        first_change_ += changes_.size() + 1;
+        changes_.clear();
+        return;
+    }
+
+    changes_.push_back(id);
+    if (changes_.size() <= QUERY_CACHE_JOURNAL_LIMIT) {
+        return;
+    }
+
+    // Forget the changes and every result that would need them.
+    first_change_ += changes_.size();
+    changes_.clear();
+    for (auto result = results_.begin(); result != results_.end();) {
+        auto next = std::next(result);
+        if (result->changes < first_change_) {
+            erase(result);
+        }
+        result = next;
+    }
+}
+
+void
+QueryCache::clear()
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    results_.clear();
+    positions_.clear();
+    size_ = 0;
+}
+
+size_t
+QueryCache::capacity() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return capacity_;
+}
+
+void
+QueryCache::set_capacity(size_t capacity)
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    capacity_ = capacity;
+    evict();
+}
+
+size_t
+QueryCache::size() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return size_;
+}
+
+size_t
+QueryCache::results_count() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return results_.size();
+}
+
+size_t
+QueryCache::hits() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return hits_;
+}
+
+size_t
+QueryCache::misses() const
+{
+    std::lock_guard<std::mutex> lock{mutex_};
+    return misses_;
+}
+
+size_t
+QueryCache::footprint(const Result& result)
+{
+    // The key is stored in the map too.
+    return 2 * result.key.size() + result.ids.capacity() * sizeof(int)
+        + RESULT_OVERHEAD;
+}
+
+void
+QueryCache::patch(
+    Result& result, const query::Query& query, const EntryStore& store)
+{
+    for (size_t i = result.changes - first_change_; i < changes_.size();
+         ++i) {
+        int id = changes_[i];
+        auto position =
+            std::lower_bound(result.ids.begin(), result.ids.end(), id);
+        bool cached = position != result.ids.end() && *position == id;
+        bool matches = store.has_row(id) && query.matches_row(store, id);
+        if (cached && !matches) {
+            result.ids.erase(position);
+        } else if (!cached && matches) {
+            result.ids.insert(position, id);
+        }
+    }
+    result.changes = first_change_ + changes_.size();
+}
+
+void
+QueryCache::erase(ResultList::iterator position)
+{
+    size_ -= footprint(*position);
+    positions_.erase(position->key);
+    results_.erase(position);
+}
+
+void
+QueryCache::evict()
+{
+    while (size_ > capacity_ && !results_.empty()) {
+        erase(std::prev(results_.end()));
+    }
+}
+
+}  // namespace libjlinkdb
@@ -0,0 +1,83 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "read_write_lock.hh"
+
+#include <pthread.h>
+
+#include <system_error>
+
+namespace libjlinkdb {
+
+namespace {
+
+void
+check(int result)
+{
+    if (result != 0) {
+        throw std::system_error{result, std::system_category()};
+    }
+}
+
+}  // namespace
+
+ReadWriteLock::ReadWriteLock()
+{
+    // Prefer writers, so that a steady stream of searches can't keep changes
+    // waiting forever.
+    pthread_rwlockattr_t attributes;
+    check(pthread_rwlockattr_init(&attributes));
+    pthread_rwlockattr_setkind_np(
+        &attributes, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    int result = pthread_rwlock_init(&lock_, &attributes);
+    pthread_rwlockattr_destroy(&attributes);
+    check(result);
+}
+
+ReadWriteLock::~ReadWriteLock()
+{
+    pthread_rwlock_destroy(&lock_);
+}
+
+void
+ReadWriteLock::lock()
+{
+    check(pthread_rwlock_wrlock(&lock_));
+}
+
+void
+ReadWriteLock::unlock()
+{
+    pthread_rwlock_unlock(&lock_);
+}
+
+void
+ReadWriteLock::lock_shared()
+{
+    check(pthread_rwlock_rdlock(&lock_));
+}
+
+void
+ReadWriteLock::unlock_shared()
+{
+    pthread_rwlock_unlock(&lock_);
+}
+
+}  // namespace libjlinkdb
@@ -0,0 +1,530 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "row_bitmap.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace libjlinkdb {
+
+using detail::RowContainer;
+using std::size_t;
+using std::uint16_t;
+using std::uint32_t;
+using std::uint64_t;
+using std::vector;
+
+namespace {
+
+// The number of low bits of a row kept in its container.
+constexpr unsigned LOW_BITS = 16;
+constexpr size_t LOW_MASK = (size_t{1} << LOW_BITS) - 1;
+// The number of words in the bitmap of a dense container.
+constexpr size_t WORD_COUNT = (size_t{1} << LOW_BITS) / 64;
+// The most rows a sparse container holds. At this size, its array takes as
+// much space as a bitmap.
+constexpr uint32_t MAX_SPARSE_SIZE = 4096;
+
+bool
+is_dense(const RowContainer& container)
+{
+    return !container.words.empty();
+}
+
+bool
+test_bit(const vector<uint64_t>& words, uint16_t value)
+{
+    return (words[value >> 6] >> (value & 63)) & 1;
+}
+
+// Sets the bit for value and returns whether it wasn't already set.
+bool
+set_bit(vector<uint64_t>& words, uint16_t value)
+{
+    uint64_t bit = uint64_t{1} << (value & 63);
+    uint64_t& word = words[value >> 6];
+    bool added = (word & bit) == 0;
+    word |= bit;
+    return added;
+}
+
+uint32_t
+count_bits(const vector<uint64_t>& words)
+{
+    uint32_t result = 0;
+    for (uint64_t word : words) {
+        result += static_cast<uint32_t>(__builtin_popcountll(word));
+    }
+    return result;
+}
+
+// Converts a sparse container to a dense one.
+void
+make_dense(RowContainer& container)
+{
+    container.words.assign(WORD_COUNT, 0);
+    for (uint16_t value : container.values) {
+        set_bit(container.words, value);
+    }
+    vector<uint16_t>{}.swap(container.values);
+}
+
+// Converts a dense container to a sparse one.
+void
+make_sparse(RowContainer& container)
+{
+    container.values.clear();
+    container.values.reserve(container.cardinality);
+    for (size_t i = 0; i < WORD_COUNT; ++i) {
+        for (uint64_t word = container.words[i]; word != 0;
+             word &= word - 1) {
+            container.values.push_back(
+                static_cast<uint16_t>(i * 64 + __builtin_ctzll(word)));
+        }
+    }
+    vector<uint64_t>{}.swap(container.words);
+}
+
+// Converts container to the kind that suits the number of rows in it.
+void
+fit_container(RowContainer& container)
+{
+    if (is_dense(container) && container.cardinality <= MAX_SPARSE_SIZE) {
+        make_sparse(container);
+    } else if (!is_dense(container)
+        && container.cardinality > MAX_SPARSE_SIZE) {
+        make_dense(container);
+    }
+}
+
+// The operations that combine the words of two bitmaps, for combine_words.
+struct AndWords {
+    static uint64_t apply(uint64_t word1, uint64_t word2)
+    {
+        return word1 & word2;
+    }
+#if defined(__SSE2__)
+    static __m128i apply(__m128i block1, __m128i block2)
+    {
+        return _mm_and_si128(block1, block2);
+    }
+#endif
+#if defined(__AVX2__)
+    static __m256i apply(__m256i block1, __m256i block2)
+    {
+        return _mm256_and_si256(block1, block2);
+    }
+#endif
+};
+
+struct OrWords {
+    static uint64_t apply(uint64_t word1, uint64_t word2)
+    {
+        return word1 | word2;
+    }
+#if defined(__SSE2__)
+    static __m128i apply(__m128i block1, __m128i block2)
+    {
+        return _mm_or_si128(block1, block2);
+    }
+#endif
+#if defined(__AVX2__)
+    static __m256i apply(__m256i block1, __m256i block2)
+    {
+        return _mm256_or_si256(block1, block2);
+    }
+#endif
+};
+
+// Replaces each word of words with Op::apply of it and the word of other,
+// as many words at once as the instructions allow.
+template <typename Op>
+void
+combine_words(vector<uint64_t>& words, const vector<uint64_t>& other)
+{
+    uint64_t* data = words.data();
+    const uint64_t* other_data = other.data();
+    size_t i = 0;
+#if defined(__AVX2__)
+    for (; i + 4 <= WORD_COUNT; i += 4) {
+        __m256i block1 =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i block2 = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(other_data + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i),
+            Op::apply(block1, block2));
+    }
+#endif
+#if defined(__SSE2__)
+    for (; i + 2 <= WORD_COUNT; i += 2) {
+        __m128i block1 =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i block2 =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(other_data + i));
+        _mm_storeu_si128(
+            reinterpret_cast<__m128i*>(data + i), Op::apply(block1, block2));
+    }
+#endif
+    for (; i < WORD_COUNT; ++i) {
+        data[i] = Op::apply(data[i], other_data[i]);
+    }
+}
+
+// Replaces values with the values that are also in other. Both are sorted.
+// When one is much shorter, its values are searched for in the other
+// instead of merging them.
+void
+intersect_values(vector<uint16_t>& values, const vector<uint16_t>& other)
+{
+    constexpr size_t SEARCH_RATIO = 32;
+
+    auto out = values.begin();
+    if (values.size() * SEARCH_RATIO < other.size()) {
+        auto position = other.begin();
+        for (uint16_t value : values) {
+            position = std::lower_bound(position, other.end(), value);
+            if (position == other.end()) {
+                break;
+            }
+            if (*position == value) {
+                *out++ = value;
+            }
+        }
+    } else if (other.size() * SEARCH_RATIO < values.size()) {
+        // Values are found in order, so out never passes position.
+        auto position = values.begin();
+        for (uint16_t value : other) {
+            position = std::lower_bound(position, values.end(), value);
+            if (position == values.end()) {
+                break;
+            }
+            if (*position == value) {
+                *out++ = value;
+            }
+        }
+    } else {
+        auto it = values.begin();
+        auto jt = other.begin();
+        while (it != values.end() && jt != other.end()) {
+            if (*it < *jt) {
+                ++it;
+            } else if (*jt < *it) {
+                ++jt;
+            } else {
+                *out++ = *it;
+                ++it;
+                ++jt;
+            }
+        }
+    }
+    values.erase(out, values.end());
+}
+
+// Replaces the rows of container with the rows that are also in other.
+void
+intersect_containers(RowContainer& container, const RowContainer& other)
+{
+    if (is_dense(container) && is_dense(other)) {
+        combine_words<AndWords>(container.words, other.words);
+        container.cardinality = count_bits(container.words);
+        fit_container(container);
+        return;
+    }
+
+    if (is_dense(container)) {
+        vector<uint16_t> values;
+        values.reserve(other.values.size());
+        for (uint16_t value : other.values) {
+            if (test_bit(container.words, value)) {
+                values.push_back(value);
+            }
+        }
+        vector<uint64_t>{}.swap(container.words);
+        container.values.swap(values);
+    } else if (is_dense(other)) {
+        auto& values = container.values;
+        values.erase(std::remove_if(values.begin(), values.end(),
+                         [&](uint16_t value) {
+                             return !test_bit(other.words, value);
+                         }),
+            values.end());
+    } else {
+        intersect_values(container.values, other.values);
+    }
+    container.cardinality = static_cast<uint32_t>(container.values.size());
+}
+
+// Replaces the rows of container with the rows that are in either container
+// or other.
+void
+unite_containers(RowContainer& container, const RowContainer& other)
+{
+    if (is_dense(container) && is_dense(other)) {
+        combine_words<OrWords>(container.words, other.words);
+        container.cardinality = count_bits(container.words);
+        return;
+    }
+
+    if (!is_dense(container) && !is_dense(other)) {
+        vector<uint16_t> values;
+        values.reserve(container.values.size() + other.values.size());
+        std::set_union(container.values.begin(), container.values.end(),
+            other.values.begin(), other.values.end(),
+            std::back_inserter(values));
+        container.values.swap(values);
+        container.cardinality =
+            static_cast<uint32_t>(container.values.size());
+        fit_container(container);
+        return;
+    }
+
+    if (!is_dense(container)) {
+        vector<uint16_t> values;
+        values.swap(container.values);
+        container.words = other.words;
+        container.cardinality = other.cardinality;
+        for (uint16_t value : values) {
+            container.cardinality += set_bit(container.words, value);
+        }
+        return;
+    }
+    for (uint16_t value : other.values) {
+        container.cardinality += set_bit(container.words, value);
+    }
+}
+
+}  // namespace
+
+RowBitmap::RowBitmap(const vector<size_t>& rows)
+{
+    for (size_t i = 0; i < rows.size();) {
+        size_t key = rows[i] >> LOW_BITS;
+        size_t end = i;
+        while (end < rows.size() && rows[end] >> LOW_BITS == key) {
+            ++end;
+        }
+
+        RowContainer container{key, static_cast<uint32_t>(end - i), {}, {}};
+        container.values.reserve(end - i);
+        for (; i < end; ++i) {
+            container.values.push_back(
+                static_cast<uint16_t>(rows[i] & LOW_MASK));
+        }
+        fit_container(container);
+        containers_.push_back(std::move(container));
+    }
+}
+
+void
+RowBitmap::add(size_t row)
+{
+    RowContainer& row_container = container(row >> LOW_BITS);
+    auto value = static_cast<uint16_t>(row & LOW_MASK);
+    if (is_dense(row_container)) {
+        row_container.cardinality += set_bit(row_container.words, value);
+        return;
+    }
+
+    auto& values = row_container.values;
+    // Rows are usually added in increasing order, so check the end first.
+    if (values.empty() || values.back() < value) {
+        values.push_back(value);
+    } else {
+        auto position = std::lower_bound(values.begin(), values.end(), value);
+        if (*position == value) {
+            return;
+        }
+        values.insert(position, value);
+    }
+    ++row_container.cardinality;
+    fit_container(row_container);
+}
+
+void
+RowBitmap::remove(size_t row)
+{
+    size_t key = row >> LOW_BITS;
+    auto position = std::lower_bound(containers_.begin(), containers_.end(),
+        key, [](const RowContainer& container, size_t value) {
+            return container.key < value;
+        });
+    if (position == containers_.end() || position->key != key) {
+        return;
+    }
+
+    auto value = static_cast<uint16_t>(row & LOW_MASK);
+    if (is_dense(*position)) {
+        if (!test_bit(position->words, value)) {
+            return;
+        }
+        position->words[value >> 6] &= ~(uint64_t{1} << (value & 63));
+    } else {
+        auto& values = position->values;
+        auto found = std::lower_bound(values.begin(), values.end(), value);
+        if (found == values.end() || *found != value) {
+            return;
+        }
+        values.erase(found);
+    }
+
+    if (--position->cardinality == 0) {
+        containers_.erase(position);
+    } else {
+        fit_container(*position);
+    }
+}
+
+bool
+RowBitmap::contains(size_t row) const
+{
+    size_t key = row >> LOW_BITS;
+    auto position = std::lower_bound(containers_.begin(), containers_.end(),
+        key, [](const RowContainer& container, size_t value) {
+            return container.key < value;
+        });
+    if (position == containers_.end() || position->key != key) {
+        return false;
+    }
+
+    auto value = static_cast<uint16_t>(row & LOW_MASK);
+    if (is_dense(*position)) {
+        return test_bit(position->words, value);
+    }
+    return std::binary_search(
+        position->values.begin(), position->values.end(), value);
+}
+
+size_t
+RowBitmap::size() const
+{
+    size_t result = 0;
+    for (const auto& container : containers_) {
+        result += container.cardinality;
+    }
+    return result;
+}
+
+bool
+RowBitmap::empty() const
+{
+    return containers_.empty();
+}
+
+void
+RowBitmap::intersect(const RowBitmap& other)
+{
+    auto out = containers_.begin();
+    auto position = other.containers_.begin();
+    for (auto it = containers_.begin(); it != containers_.end(); ++it) {
+        while (position != other.containers_.end()
+            && position->key < it->key) {
+            ++position;
+        }
+        if (position == other.containers_.end()) {
+            break;
+        }
+        if (position->key != it->key) {
+            continue;
+        }
+
+        intersect_containers(*it, *position);
+        if (it->cardinality != 0) {
+            if (out != it) {
+                *out = std::move(*it);
+            }
+            ++out;
+        }
+    }
+    containers_.erase(out, containers_.end());
+}
+
+void
+RowBitmap::unite(const RowBitmap& other)
+{
+    vector<RowContainer> result;
+    result.reserve(containers_.size() + other.containers_.size());
+    auto it = containers_.begin();
+    auto jt = other.containers_.begin();
+    while (it != containers_.end() && jt != other.containers_.end()) {
+        if (it->key < jt->key) {
+            result.push_back(std::move(*it++));
+        } else if (jt->key < it->key) {
+            result.push_back(*jt++);
+        } else {
+            unite_containers(*it, *jt++);
+            result.push_back(std::move(*it++));
+        }
+    }
+    std::move(it, containers_.end(), std::back_inserter(result));
+    result.insert(result.end(), jt, other.containers_.end());
+    containers_.swap(result);
+}
+
+void
+RowBitmap::copy_rows(vector<size_t>& rows) const
+{
+    rows.clear();
+    rows.reserve(size());
+    for (const auto& container : containers_) {
+        size_t base = container.key << LOW_BITS;
+        if (!is_dense(container)) {
+            for (uint16_t value : container.values) {
+                rows.push_back(base + value);
+            }
+            continue;
+        }
+        for (size_t i = 0; i < WORD_COUNT; ++i) {
+            for (uint64_t word = container.words[i]; word != 0;
+                 word &= word - 1) {
+                rows.push_back(base + i * 64 + __builtin_ctzll(word));
+            }
+        }
+    }
+}
+
+RowContainer&
+RowBitmap::container(size_t key)
+{
+    // Rows are usually added in increasing order, so check the end first.
+    if (containers_.empty() || containers_.back().key < key) {
+        containers_.push_back(RowContainer{key, 0, {}, {}});
+        return containers_.back();
+    }
+
+    auto position = std::lower_bound(containers_.begin(), containers_.end(),
+        key, [](const RowContainer& container, size_t value) {
+            return container.key < value;
+        });
+    if (position == containers_.end() || position->key != key) {
+        position = containers_.insert(position, RowContainer{key, 0, {}, {}});
+    }
+    return *position;
+}
+
+}  // namespace libjlinkdb
@@ -0,0 +1,84 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "row_set.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+namespace libjlinkdb {
+
+using std::size_t;
+using std::vector;
+
+void
+insert_row(vector<size_t>& rows, size_t row)
+{
+    // Rows are usually added in increasing order, so check the end first.
+    if (rows.empty() || rows.back() < row) {
+        rows.push_back(row);
+        return;
+    }
+
+    auto position = std::lower_bound(rows.begin(), rows.end(), row);
+    if (*position != row) {
+        rows.insert(position, row);
+    }
+}
+
+void
+erase_row(vector<size_t>& rows, size_t row)
+{
+    auto position = std::lower_bound(rows.begin(), rows.end(), row);
+    if (position != rows.end() && *position == row) {
+        rows.erase(position);
+    }
+}
+
+void
+intersect_rows(vector<size_t>& rows, const vector<size_t>& other)
+{
+    auto out = rows.begin();
+    auto position = other.begin();
+    for (auto it = rows.begin(); it != rows.end(); ++it) {
+        position = std::lower_bound(position, other.end(), *it);
+        if (position == other.end()) {
+            break;
+        }
+        if (*position == *it) {
+            *out++ = *it;
+        }
+    }
+    rows.erase(out, rows.end());
+}
+
+void
+unite_rows(vector<size_t>& rows, const vector<size_t>& other)
+{
+    vector<size_t> result;
+    result.reserve(rows.size() + other.size());
+    std::set_union(rows.begin(), rows.end(), other.begin(), other.end(),
+        std::back_inserter(result));
+    rows.swap(result);
+}
+
+}  // namespace libjlinkdb
@@ -0,0 +1,443 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "snapshot.hh"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <climits>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+
+#include "entry_store.hh"
+#include "jlinkdb_error.hh"
+#include "link_entry.hh"
+#include "string_ref.hh"
+
+namespace libjlinkdb {
+
+using std::shared_ptr;
+using std::size_t;
+using std::string;
+using std::uint32_t;
+using std::uint64_t;
+
+namespace {
+
+constexpr char SNAPSHOT_MAGIC[8] = {'J', 'L', 'D', 'B', 'S', 'N', 'A', 'P'};
+// Written as a number, so that a snapshot from a machine with a different
+// byte order can be recognized.
+constexpr uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+template <typename T>
+void
+write_value(std::ostream& writer, const T& value)
+{
+    writer.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+[[noreturn]] void
+throw_corrupt()
+{
+    throw JLinkDbError{"corrupt snapshot"};
+}
+
+}  // namespace
+
+struct Snapshot::Header {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t size;
+    uint64_t next_id;
+    uint64_t present_offset;
+    uint64_t heap_offset;
+    uint64_t heap_size;
+    uint64_t locations_offset;
+    uint64_t names_offset;
+    uint64_t descriptions_offset;
+    uint64_t tag_ranges_offset;
+    uint64_t tags_offset;
+    uint64_t tags_size;
+    uint64_t attribute_ranges_offset;
+    uint64_t attributes_offset;
+    uint64_t attributes_size;
+};
+
+Snapshot::Snapshot(const string& path)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        std::ostringstream message;
+        message << "failed to open file ";
+        message << path;
+        throw JLinkDbError{message.str()};
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) == -1
+        || static_cast<uint64_t>(info.st_size) < sizeof(Header)) {
+        close(fd);
+        throw JLinkDbError{"not a snapshot: " + path};
+    }
+
+    mapping_size_ = static_cast<size_t>(info.st_size);
+    void* mapping =
+        mmap(nullptr, mapping_size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        throw JLinkDbError{"failed to map file " + path};
+    }
+    size_t mapping_size = mapping_size_;
+    mapping_.reset(mapping,
+        [mapping_size](const void* data) {
+            munmap(const_cast<void*>(data), mapping_size);
+        });
+
+    Header header;
+    std::memcpy(&header, mapping, sizeof(header));
+    if (std::memcmp(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0
+        || header.byte_order != SNAPSHOT_BYTE_ORDER) {
+        throw JLinkDbError{"not a snapshot: " + path};
+    }
+    if (header.version != SNAPSHOT_VERSION) {
+        std::ostringstream message;
+        message << "unsupported snapshot version ";
+        message << header.version;
+        throw JLinkDbError{message.str()};
+    }
+
+    if (header.next_id > static_cast<uint64_t>(INT_MAX)
+        || header.size > header.next_id) {
+        throw_corrupt();
+    }
+    uint64_t rows = header.next_id;
+    size_ = static_cast<size_t>(header.size);
+    next_id_ = static_cast<int>(header.next_id);
+    present_ = static_cast<const uint64_t*>(section(
+        header.present_offset, (rows + 63) / 64, sizeof(uint64_t)));
+    heap_ = static_cast<const char*>(
+        section(header.heap_offset, header.heap_size, 1));
+    heap_size_ = header.heap_size;
+    locations_ = static_cast<const Slice*>(
+        section(header.locations_offset, rows, sizeof(Slice)));
+    names_ = static_cast<const Slice*>(
+        section(header.names_offset, rows, sizeof(Slice)));
+    descriptions_ = static_cast<const Slice*>(
+        section(header.descriptions_offset, rows, sizeof(Slice)));
+    tag_ranges_ = static_cast<const Range*>(
+        section(header.tag_ranges_offset, rows, sizeof(Range)));
+    tags_ = static_cast<const Slice*>(
+        section(header.tags_offset, header.tags_size, sizeof(Slice)));
+    tags_size_ = header.tags_size;
+    attribute_ranges_ = static_cast<const Range*>(
+        section(header.attribute_ranges_offset, rows, sizeof(Range)));
+    attributes_ = static_cast<const Slice*>(section(
+        header.attributes_offset, header.attributes_size, sizeof(Slice)));
+    attributes_size_ = header.attributes_size;
+}
+
+void
+Snapshot::write(std::ostream& writer, const EntryStore& store)
+{
+    // Lay out the file before writing it, so that the header can hold the
+    // offset of every section. Empty rows have empty fields, so they can be
+    // written like any other.
+    uint64_t rows = store.rows();
+    uint64_t location_chars = 0;
+    uint64_t name_chars = 0;
+    uint64_t description_chars = 0;
+    uint64_t tag_chars = 0;
+    uint64_t attribute_chars = 0;
+    uint64_t tags_size = 0;
+    uint64_t attributes_size = 0;
+    for (size_t row = 0; row < rows; ++row) {
+        location_chars += store.location(row).size();
+        name_chars += store.name(row).size();
+        description_chars += store.description(row).size();
+        tags_size += store.tags_count(row);
+        for (size_t i = 0; i < store.tags_count(row); ++i) {
+            tag_chars += store.tag(row, i).size();
+        }
+        attributes_size += 2 * store.attributes_count(row);
+        for (size_t i = 0; i < store.attributes_count(row); ++i) {
+            attribute_chars += store.attribute_name(row, i).size()
+                + store.attribute_value(row, i).size();
+        }
+    }
+
+    Header header;
+    uint64_t present_size = (rows + 63) / 64;
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.byte_order = SNAPSHOT_BYTE_ORDER;
+    header.size = store.size();
+    header.next_id = rows;
+    header.present_offset = sizeof(Header);
+    header.locations_offset =
+        header.present_offset + present_size * sizeof(uint64_t);
+    header.names_offset = header.locations_offset + rows * sizeof(Slice);
+    header.descriptions_offset = header.names_offset + rows * sizeof(Slice);
+    header.tag_ranges_offset =
+        header.descriptions_offset + rows * sizeof(Slice);
+    header.tags_offset = header.tag_ranges_offset + rows * sizeof(Range);
+    header.tags_size = tags_size;
+    header.attribute_ranges_offset =
+        header.tags_offset + tags_size * sizeof(Slice);
+    header.attributes_offset =
+        header.attribute_ranges_offset + rows * sizeof(Range);
+    header.attributes_size = attributes_size;
+    header.heap_offset =
+        header.attributes_offset + attributes_size * sizeof(Slice);
+    header.heap_size = location_chars + name_chars + description_chars
+        + tag_chars + attribute_chars;
+    write_value(writer, header);
+
+    for (uint64_t word = 0; word < present_size; ++word) {
+        uint64_t bits = 0;
+        for (size_t bit = 0; bit < 64 && word * 64 + bit < rows; ++bit) {
+            if (store.has_row(word * 64 + bit)) {
+                bits |= uint64_t{1} << bit;
+            }
+        }
+        write_value(writer, bits);
+    }
+
+    // The heap holds every location, then every name, and so on, in the
+    // same order as the sections.
+    uint64_t offset = 0;
+    auto write_slice = [&](StringRef str) {
+        write_value(writer, Slice{offset, str.size()});
+        offset += str.size();
+    };
+    for (size_t row = 0; row < rows; ++row) {
+        write_slice(store.location(row));
+    }
+    for (size_t row = 0; row < rows; ++row) {
+        write_slice(store.name(row));
+    }
+    for (size_t row = 0; row < rows; ++row) {
+        write_slice(store.description(row));
+    }
+
+    uint64_t first = 0;
+    for (size_t row = 0; row < rows; ++row) {
+        uint64_t count = store.tags_count(row);
+        write_value(writer, Range{first, count});
+        first += count;
+    }
+    for (size_t row = 0; row < rows; ++row) {
+        for (size_t i = 0; i < store.tags_count(row); ++i) {
+            write_slice(store.tag(row, i));
+        }
+    }
+
+    first = 0;
+    for (size_t row = 0; row < rows; ++row) {
+        uint64_t count = 2 * store.attributes_count(row);
+        write_value(writer, Range{first, count});
+        first += count;
+    }
+    for (size_t row = 0; row < rows; ++row) {
+        for (size_t i = 0; i < store.attributes_count(row); ++i) {
+            write_slice(store.attribute_name(row, i));
+            write_slice(store.attribute_value(row, i));
+        }
+    }
+
+    auto write_string = [&](StringRef str) {
+        writer.write(str.data(), str.size());
+    };
+    for (size_t row = 0; row < rows; ++row) {
+        write_string(store.location(row));
+    }
+    for (size_t row = 0; row < rows; ++row) {
+        write_string(store.name(row));
+    }
+    for (size_t row = 0; row < rows; ++row) {
+        write_string(store.description(row));
+    }
+    for (size_t row = 0; row < rows; ++row) {
+        for (size_t i = 0; i < store.tags_count(row); ++i) {
+            write_string(store.tag(row, i));
+        }
+    }
+    for (size_t row = 0; row < rows; ++row) {
+        for (size_t i = 0; i < store.attributes_count(row); ++i) {
+            write_string(store.attribute_name(row, i));
+            write_string(store.attribute_value(row, i));
+        }
+    }
+
+    if (!writer) {
+        throw JLinkDbError{"failed to write snapshot"};
+    }
+}
+
+size_t
+Snapshot::size() const
+{
+    return size_;
+}
+
+int
+Snapshot::next_id() const
+{
+    return next_id_;
+}
+
+bool
+Snapshot::has_entry(int id) const
+{
+    if (id < 0 || id >= next_id_) {
+        return false;
+    }
+    size_t row = static_cast<size_t>(id);
+    return (present_[row / 64] >> (row % 64)) & 1;
+}
+
+StringRef
+Snapshot::location(int id) const
+{
+    return string_at(locations_[id]);
+}
+
+StringRef
+Snapshot::name(int id) const
+{
+    return string_at(names_[id]);
+}
+
+StringRef
+Snapshot::description(int id) const
+{
+    return string_at(descriptions_[id]);
+}
+
+size_t
+Snapshot::tags_count(int id) const
+{
+    return static_cast<size_t>(range_at(tag_ranges_, tags_size_, id).count);
+}
+
+StringRef
+Snapshot::tag(int id, size_t tag_index) const
+{
+    Range range = range_at(tag_ranges_, tags_size_, id);
+    if (tag_index >= range.count) {
+        return {};
+    }
+    return string_in(tags_, tags_size_, range.first + tag_index);
+}
+
+size_t
+Snapshot::attributes_count(int id) const
+{
+    return static_cast<size_t>(
+        range_at(attribute_ranges_, attributes_size_, id).count / 2);
+}
+
+StringRef
+Snapshot::attribute_name(int id, size_t attribute_index) const
+{
+    Range range = range_at(attribute_ranges_, attributes_size_, id);
+    if (2 * attribute_index >= range.count) {
+        return {};
+    }
+    return string_in(
+        attributes_, attributes_size_, range.first + 2 * attribute_index);
+}
+
+StringRef
+Snapshot::attribute_value(int id, size_t attribute_index) const
+{
+    Range range = range_at(attribute_ranges_, attributes_size_, id);
+    if (2 * attribute_index + 1 >= range.count) {
+        return {};
+    }
+    return string_in(attributes_, attributes_size_,
+        range.first + 2 * attribute_index + 1);
+}
+
+shared_ptr<LinkEntry>
+Snapshot::entry(int id) const
+{
+    auto result = std::make_shared<LinkEntry>(location(id).str());
+    result->set_name(name(id).str());
+    result->set_description(description(id).str());
+    for (size_t i = 0; i < tags_count(id); ++i) {
+        result->add_tag(tag(id, i).str());
+    }
+    for (size_t i = 0; i < attributes_count(id); ++i) {
+        result->set_attribute(
+            attribute_name(id, i).str(), attribute_value(id, i).str());
+    }
+    return result;
+}
+
+const void*
+Snapshot::section(
+    uint64_t offset, uint64_t count, size_t element_size) const
+{
+    if (offset % alignof(uint64_t) != 0 || offset > mapping_size_
+        || count > (mapping_size_ - offset) / element_size) {
+        throw_corrupt();
+    }
+    return static_cast<const char*>(mapping_.get()) + offset;
+}
+
+StringRef
+Snapshot::string_at(const Slice& slice) const
+{
+    if (slice.offset > heap_size_ || slice.size > heap_size_ - slice.offset) {
+        throw_corrupt();
+    }
+    return {heap_ + slice.offset, static_cast<size_t>(slice.size)};
+}
+
+StringRef
+Snapshot::string_in(
+    const Slice* slices, uint64_t count, uint64_t index) const
+{
+    if (index >= count) {
+        throw_corrupt();
+    }
+    return string_at(slices[index]);
+}
+
+Snapshot::Range
+Snapshot::range_at(const Range* ranges, uint64_t count, int id) const
+{
+    const Range& range = ranges[id];
+    if (range.first > count || range.count > count - range.first) {
+        throw_corrupt();
+    }
+    return range;
+}
+
+}  // namespace libjlinkdb
@@ -0,0 +1,331 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "sorted_attribute_index.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "entry_store.hh"
+#include "row_set.hh"
+#include "string_ref.hh"
+
+namespace libjlinkdb {
+
+using std::size_t;
+using std::string;
+using std::vector;
+
+bool
+attribute_sort_key(StringRef value, AttributeOrder order, string& key)
+{
+    if (order == AttributeOrder::LEXICOGRAPHIC) {
+        key.assign(value.data(), value.size());
+        return true;
+    }
+
+    size_t i = 0;
+    bool negative = false;
+    if (i < value.size() && (value[i] == '-' || value[i] == '+')) {
+        negative = value[i] == '-';
+        ++i;
+    }
+    if (i == value.size()) {
+        return false;
+    }
+
+    // The magnitude of the smallest integer is one more than that of the
+    // largest.
+    const uint64_t limit = negative
+        ? uint64_t{1} << 63
+        : static_cast<uint64_t>(std::numeric_limits<int64_t>::max());
+    uint64_t magnitude = 0;
+    for (; i < value.size(); ++i) {
+        char c = value[i];
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        uint64_t digit = static_cast<uint64_t>(c - '0');
+        if (magnitude > (limit - digit) / 10) {
+            return false;
+        }
+        magnitude = magnitude * 10 + digit;
+    }
+
+    // Flipping the sign bit of the two's complement puts negative numbers
+    // before positive ones when the bytes are compared from the top.
+    uint64_t bits = negative ? ~magnitude + 1 : magnitude;
+    bits ^= uint64_t{1} << 63;
+    key.resize(8);
+    for (int byte = 7; byte >= 0; --byte) {
+        key[byte] = static_cast<char>(bits & 0xff);
+        bits >>= 8;
+    }
+    return true;
+}
+
+AttributeBound
+AttributeBound::none()
+{
+    return AttributeBound{};
+}
+
+AttributeBound
+AttributeBound::including(const string& value)
+{
+    AttributeBound result;
+    result.bounded = true;
+    result.value = value;
+    return result;
+}
+
+AttributeBound
+AttributeBound::excluding(const string& value)
+{
+    AttributeBound result{including(value)};
+    result.inclusive = false;
+    return result;
+}
+
+bool
+AttributeBound::admits_from_below(StringRef other) const
+{
+    if (!bounded) {
+        return true;
+    }
+    int comparison = other.compare(value);
+    return comparison > 0 || (comparison == 0 && inclusive);
+}
+
+bool
+AttributeBound::admits_from_above(StringRef other) const
+{
+    if (!bounded) {
+        return true;
+    }
+    int comparison = other.compare(value);
+    return comparison < 0 || (comparison == 0 && inclusive);
+}
+
+void
+SortedAttributeIndex::add_attribute(
+    const EntryStore& store, const string& name, AttributeOrder order)
+{
+    remove_attribute(name);
+    attributes_.push_back(Attribute{name, order, {}});
+    Attribute& attribute = attributes_.back();
+
+    string key;
+    for (size_t row = 0; row < store.rows(); ++row) {
+        if (!store.has_row(row)) {
+            continue;
+        }
+        size_t count = store.attributes_count(row);
+        for (size_t i = 0; i < count; ++i) {
+            if (store.attribute_name(row, i) == name
+                && attribute_sort_key(
+                    store.attribute_value(row, i), order, key)) {
+                insert_row(attribute.postings[key], row);
+            }
+        }
+    }
+}
+
+void
+SortedAttributeIndex::remove_attribute(const string& name)
+{
+    attributes_.erase(std::remove_if(attributes_.begin(), attributes_.end(),
+                          [&](const Attribute& attribute) {
+                              return attribute.name == name;
+                          }),
+        attributes_.end());
+}
+
+bool
+SortedAttributeIndex::has_attribute(const string& name) const
+{
+    return find_attribute(name) != nullptr;
+}
+
+bool
+SortedAttributeIndex::empty() const
+{
+    return attributes_.empty();
+}
+
+void
+SortedAttributeIndex::add(const EntryStore& store, size_t row)
+{
+    string key;
+    size_t count = store.attributes_count(row);
+    for (size_t i = 0; i < count; ++i) {
+        StringRef name = store.attribute_name(row, i);
+        for (Attribute& attribute : attributes_) {
+            if (name == attribute.name
+                && attribute_sort_key(
+                    store.attribute_value(row, i), attribute.order, key)) {
+                insert_row(attribute.postings[key], row);
+            }
+        }
+    }
+}
+
+void
+SortedAttributeIndex::remove(const EntryStore& store, size_t row)
+{
+    string key;
+    size_t count = store.attributes_count(row);
+    for (size_t i = 0; i < count; ++i) {
+        StringRef name = store.attribute_name(row, i);
+        for (Attribute& attribute : attributes_) {
+            if (name == attribute.name
+                && attribute_sort_key(
+                    store.attribute_value(row, i), attribute.order, key)) {
+                remove_posting(attribute.postings, key, row);
+            }
+        }
+    }
+}
+
+bool
+SortedAttributeIndex::find_range(const string& name, AttributeOrder order,
+    const AttributeBound& lower, const AttributeBound& upper,
+    vector<size_t>& rows) const
+{
+    const Attribute* attribute = find_attribute(name);
+    if (attribute == nullptr || attribute->order != order) {
+        return false;
+    }
+
+    const PostingMap& postings = attribute->postings;
+    auto first = postings.begin();
+    if (lower.bounded) {
+        first = lower.inclusive ? postings.lower_bound(lower.value)
+                                : postings.upper_bound(lower.value);
+    }
+    auto last = postings.end();
+    if (upper.bounded) {
+        last = upper.inclusive ? postings.upper_bound(upper.value)
+                               : postings.lower_bound(upper.value);
+    }
+    // An empty range can end before it starts.
+    if (first == postings.end()
+        || (last != postings.end() && last->first <= first->first)) {
+        last = first;
+    }
+    collect(first, last, rows);
+    return true;
+}
+
+bool
+SortedAttributeIndex::find_prefix(
+    const string& name, const string& prefix, vector<size_t>& rows) const
+{
+    const Attribute* attribute = find_attribute(name);
+    if (attribute == nullptr
+        || attribute->order != AttributeOrder::LEXICOGRAPHIC) {
+        return false;
+    }
+
+    const PostingMap& postings = attribute->postings;
+    auto first = postings.lower_bound(prefix);
+    auto last = first;
+    while (last != postings.end()
+        && last->first.compare(0, prefix.size(), prefix) == 0) {
+        ++last;
+    }
+    collect(first, last, rows);
+    return true;
+}
+
+const SortedAttributeIndex::Attribute*
+SortedAttributeIndex::find_attribute(const string& name) const
+{
+    for (const Attribute& attribute : attributes_) {
+        if (attribute.name == name) {
+            return &attribute;
+        }
+    }
+    return nullptr;
+}
+
+void
+SortedAttributeIndex::collect(PostingMap::const_iterator first,
+    PostingMap::const_iterator last, vector<size_t>& rows)
+{
+    rows.clear();
+    size_t total = 0;
+    size_t end = 0;
+    for (auto position = first; position != last; ++position) {
+        total += position->second.size();
+        end = std::max(end, position->second.back() + 1);
+    }
+    if (first != last && std::next(first) == last) {
+        rows = first->second;
+        return;
+    }
+
+    rows.reserve(total);
+    if (total < end / 16) {
+        for (auto position = first; position != last; ++position) {
+            rows.insert(
+                rows.end(), position->second.begin(), position->second.end());
+        }
+        std::sort(rows.begin(), rows.end());
+        return;
+    }
+
+    // Many rows match, so marking them all and reading them back in order
+    // is cheaper than sorting.
+    vector<bool> marked(end);
+    for (auto position = first; position != last; ++position) {
+        for (size_t row : position->second) {
+            marked[row] = true;
+        }
+    }
+    for (size_t row = 0; row < end; ++row) {
+        if (marked[row]) {
+            rows.push_back(row);
+        }
+    }
+}
+
+void
+SortedAttributeIndex::remove_posting(
+    PostingMap& postings, const string& key, size_t row)
+{
+    auto list = postings.find(key);
+    if (list == postings.end()) {
+        return;
+    }
+
+    vector<size_t>& rows = list->second;
+    erase_row(rows, row);
+    if (rows.empty()) {
+        postings.erase(list);
+    }
+}
+
+}  // namespace libjlinkdb
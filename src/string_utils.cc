@@ -22,42 +22,294 @@
 #include "string_utils.hh"
 
 #include <algorithm>
-#include <cctype>
-#include <iterator>
+#include <cstddef>
+#include <cstring>
+#include <functional>
 #include <string>
 
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 #include "query/string_search_options.hh"
+#include "string_ref.hh"
 
 namespace libjlinkdb {
 
+using std::size_t;
 using std::string;
 
+namespace {
+
+// Returns c converted to lower case if it is an ASCII letter, and c
+// otherwise.
+inline unsigned char
+fold(char c)
+{
+    auto byte = static_cast<unsigned char>(c);
+    return static_cast<unsigned>(byte - 'A') < 26u ? byte | 0x20 : byte;
+}
+
+#if defined(__SSE2__)
+// Converts the ASCII letters in block to lower case. Bytes outside of ASCII
+// are negative as signed chars, so they are never in the range of letters.
+inline __m128i
+fold_block(__m128i block)
+{
+    __m128i above = _mm_cmpgt_epi8(block, _mm_set1_epi8('A' - 1));
+    __m128i below = _mm_cmplt_epi8(block, _mm_set1_epi8('Z' + 1));
+    __m128i letters = _mm_and_si128(above, below);
+    return _mm_or_si128(block, _mm_and_si128(letters, _mm_set1_epi8(0x20)));
+}
+#endif
+
+#if defined(__AVX2__)
+// Converts the ASCII letters in block to lower case.
+inline __m256i
+fold_block(__m256i block)
+{
+    __m256i above = _mm256_cmpgt_epi8(block, _mm256_set1_epi8('A' - 1));
+    __m256i below = _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), block);
+    __m256i letters = _mm256_and_si256(above, below);
+    return _mm256_or_si256(
+        block, _mm256_and_si256(letters, _mm256_set1_epi8(0x20)));
+}
+#endif
+
+// Returns whether the size characters at str1 and str2 are equal. If
+// ignore_case is true, ASCII letters are compared ignoring case.
+bool
+equal_chars(const char* str1, const char* str2, size_t size, bool ignore_case)
+{
+    if (!ignore_case) {
+        return std::memcmp(str1, str2, size) == 0;
+    }
+
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= size; i += 16) {
+        __m128i block1 = fold_block(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(str1 + i)));
+        __m128i block2 = fold_block(
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(str2 + i)));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(block1, block2)) != 0xFFFF) {
+            return false;
+        }
+    }
+#endif
+    for (; i < size; ++i) {
+        if (fold(str1[i]) != fold(str2[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns whether the target matches str at position, given that the first
+// and last characters are already known to match.
+inline bool
+matches_at(const char* str, size_t position, StringRef target,
+    bool ignore_case)
+{
+    return target.size() <= 2
+        || equal_chars(str + position + 1, target.data() + 1,
+            target.size() - 2, ignore_case);
+}
+
+}  // namespace
+
+char
+to_lower(char c)
+{
+    return static_cast<char>(fold(c));
+}
+
 void
 to_lower_in_place(string& str)
 {
     std::transform(str.begin(), str.end(), str.begin(),
-        [](unsigned char c) { return std::tolower(c); });
+        [](char c) { return static_cast<char>(fold(c)); });
+}
+
+bool
+equals_ignore_case(StringRef str1, StringRef str2)
+{
+    return str1.size() == str2.size()
+        && equal_chars(str1.data(), str2.data(), str1.size(), true);
+}
+
+bool
+contains_string(StringRef str, StringRef target, bool ignore_case)
+{
+    if (target.empty()) {
+        return true;
+    }
+    if (target.size() > str.size()) {
+        return false;
+    }
+
+    // Compare the first and last characters of the target against many
+    // positions at once, and only compare the rest of the target at the
+    // positions where both match.
+    const char* data = str.data();
+    size_t positions = str.size() - target.size() + 1;
+    size_t last_offset = target.size() - 1;
+    char first = target[0];
+    char last = target[last_offset];
+    if (ignore_case) {
+        first = static_cast<char>(fold(first));
+        last = static_cast<char>(fold(last));
+    }
+
+    size_t i = 0;
+#if defined(__AVX2__)
+    __m256i first_wide = _mm256_set1_epi8(first);
+    __m256i last_wide = _mm256_set1_epi8(last);
+    for (; i + 32 <= positions; i += 32) {
+        __m256i firsts =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        __m256i lasts = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(data + i + last_offset));
+        if (ignore_case) {
+            firsts = fold_block(firsts);
+            lasts = fold_block(lasts);
+        }
+
+        auto mask = static_cast<unsigned>(
+            _mm256_movemask_epi8(_mm256_and_si256(
+                _mm256_cmpeq_epi8(firsts, first_wide),
+                _mm256_cmpeq_epi8(lasts, last_wide))));
+        while (mask != 0) {
+            if (matches_at(data, i + __builtin_ctz(mask), target,
+                    ignore_case)) {
+                return true;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+#if defined(__SSE2__)
+    __m128i first_block = _mm_set1_epi8(first);
+    __m128i last_block = _mm_set1_epi8(last);
+    for (; i + 16 <= positions; i += 16) {
+        __m128i firsts =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        __m128i lasts = _mm_loadu_si128(
+            reinterpret_cast<const __m128i*>(data + i + last_offset));
+        if (ignore_case) {
+            firsts = fold_block(firsts);
+            lasts = fold_block(lasts);
+        }
+
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(firsts, first_block),
+                _mm_cmpeq_epi8(lasts, last_block))));
+        while (mask != 0) {
+            if (matches_at(data, i + __builtin_ctz(mask), target,
+                    ignore_case)) {
+                return true;
+            }
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i < positions; ++i) {
+        char start = ignore_case ? static_cast<char>(fold(data[i])) : data[i];
+        char end = ignore_case ? static_cast<char>(fold(data[i + last_offset]))
+                               : data[i + last_offset];
+        if (start == first && end == last
+            && matches_at(data, i, target, ignore_case)) {
+            return true;
+        }
+    }
+    return false;
 }
 
 bool
 search_string(const string& str, const string& target,
     const query::StringSearchOptions& options)
 {
-    // TODO(jwaataja): Optimize in particular cases to avoid copying. For
-    // example, use an equals_ignore_case_method.
-    string str_copy{str};
-    string target_copy{target};
+    return search_string(StringRef{str}, StringRef{target}, options);
+}
+
+bool
+search_string(StringRef str, StringRef target,
+    const query::StringSearchOptions& options)
+{
+    if (options.match_full_string) {
+        return options.ignore_case ? equals_ignore_case(str, target)
+                                   : str == target;
+    }
+    return contains_string(str, target, options.ignore_case);
+}
+
+StringMatcher::StringMatcher(
+    const string& target, const query::StringSearchOptions& options)
+    : target_{target}, options_{options}
+{
+    if (options_.ignore_case) {
+        to_lower_in_place(target_);
+    }
+}
+
+bool
+StringMatcher::matches(StringRef str) const
+{
+    return search_string(str, target_, options_);
+}
+
+double
+estimated_search_cost(const query::StringSearchOptions& options)
+{
+    return options.match_full_string ? 1.0 : 2.0;
+}
 
+double
+estimated_search_selectivity(const query::StringSearchOptions& options)
+{
+    return options.match_full_string ? 0.05 : 0.2;
+}
+
+string
+describe_search(const string& term, const query::StringSearchOptions& options)
+{
+    string result{"\""};
+    result += term;
+    result += "\" (";
+    result += options.match_full_string ? "full string" : "substring";
     if (options.ignore_case) {
-        to_lower_in_place(str_copy);
-        to_lower_in_place(target_copy);
+        result += ", ignore case";
     }
+    result += ")";
+    return result;
+}
 
+string
+search_key(const string& term, const query::StringSearchOptions& options)
+{
+    string result{options.match_full_string ? "full" : "substring"};
+    if (options.ignore_case) {
+        result += "-icase";
+    }
+    result += "(";
+    result += std::to_string(term.size());
+    result += ":";
+    result += term;
+    result += ")";
+    return result;
+}
+
+size_t
+search_hash(const string& term, const query::StringSearchOptions& options)
+{
+    size_t result = std::hash<string>{}(term);
     if (options.match_full_string) {
-        return str_copy == target_copy;
-    } else {
-        return str_copy.find(target_copy) != string::npos;
+        result ^= 0x9e3779b9;
+    }
+    if (options.ignore_case) {
+        result ^= 0x7f4a7c15;
     }
+    return result;
 }
 
 }  // namespace libjlinkdb
@@ -0,0 +1,93 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "tag_index.hh"
+
+#include <cstddef>
+#include <string>
+
+#include "entry_store.hh"
+#include "row_bitmap.hh"
+#include "string_utils.hh"
+
+namespace libjlinkdb {
+
+using std::size_t;
+using std::string;
+
+void
+TagIndex::add(const EntryStore& store, size_t row)
+{
+    size_t count = store.tags_count(row);
+    for (size_t i = 0; i < count; ++i) {
+        string tag{store.tag(row, i).str()};
+        exact_[tag].add(row);
+        to_lower_in_place(tag);
+        folded_[tag].add(row);
+    }
+}
+
+void
+TagIndex::remove(const EntryStore& store, size_t row)
+{
+    size_t count = store.tags_count(row);
+    for (size_t i = 0; i < count; ++i) {
+        string tag{store.tag(row, i).str()};
+        remove_posting(exact_, tag, row);
+        to_lower_in_place(tag);
+        remove_posting(folded_, tag, row);
+    }
+}
+
+const RowBitmap&
+TagIndex::find(const string& tag, bool ignore_case) const
+{
+    static const RowBitmap empty;
+
+    const PostingMap* postings = &exact_;
+    string key{tag};
+    if (ignore_case) {
+        postings = &folded_;
+        to_lower_in_place(key);
+    }
+
+    auto position = postings->find(key);
+    if (position == postings->end()) {
+        return empty;
+    }
+    return position->second;
+}
+
+void
+TagIndex::remove_posting(PostingMap& postings, const string& tag, size_t row)
+{
+    auto list = postings.find(tag);
+    if (list == postings.end()) {
+        return;
+    }
+
+    RowBitmap& rows = list->second;
+    rows.remove(row);
+    if (rows.empty()) {
+        postings.erase(list);
+    }
+}
+
+}  // namespace libjlinkdb
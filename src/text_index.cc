@@ -0,0 +1,365 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "text_index.hh"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "entry_store.hh"
+#include "string_ref.hh"
+#include "string_utils.hh"
+
+namespace libjlinkdb {
+
+using std::size_t;
+using std::string;
+using std::uint16_t;
+using std::uint32_t;
+using std::vector;
+
+constexpr size_t TextIndex::FIELD_COUNT;
+
+namespace {
+
+// The most times a word is counted in one field of a row.
+constexpr uint16_t MAX_FREQUENCY = 0xffff;
+
+// Bounds on scores are raised by this fraction, so that rounding can't
+// make them fall below a score they bound.
+constexpr double BOUND_SLACK = 1e-9;
+
+bool
+is_word_char(char c)
+{
+    auto byte = static_cast<unsigned char>(c);
+    return byte >= 0x80 || (byte >= '0' && byte <= '9')
+        || (byte >= 'a' && byte <= 'z') || (byte >= 'A' && byte <= 'Z');
+}
+
+// Returns the part of the score of BM25 that saturates, for a weighted and
+// normalized frequency.
+double
+saturate(double frequency, double k1)
+{
+    return frequency * (k1 + 1.0) / (frequency + k1);
+}
+
+}  // namespace
+
+void
+tokenize(StringRef text, const std::function<void(StringRef)>& callback)
+{
+    string word;
+    for (char c : text) {
+        if (is_word_char(c)) {
+            word += to_lower(c);
+        } else if (!word.empty()) {
+            callback(word);
+            word.clear();
+        }
+    }
+    if (!word.empty()) {
+        callback(word);
+    }
+}
+
+void
+TextIndex::add(const EntryStore& store, size_t row)
+{
+    std::unordered_map<string, std::array<uint16_t, FIELD_COUNT>> counts;
+    Lengths lengths;
+    for_each_word(store, row, [&](size_t field, StringRef word) {
+        auto inserted = counts.emplace(
+            word.str(), std::array<uint16_t, FIELD_COUNT>{});
+        uint16_t& count = inserted.first->second[field];
+        if (count < MAX_FREQUENCY) {
+            ++count;
+        }
+        ++lengths.fields[field];
+    });
+
+    if (lengths_.size() <= row) {
+        lengths_.resize(row + 1);
+    }
+    lengths_[row] = lengths;
+    for (size_t field = 0; field < FIELD_COUNT; ++field) {
+        total_lengths_[field] += lengths.fields[field];
+    }
+    ++rows_count_;
+
+    for (const auto& count : counts) {
+        Term& term = terms_[count.first];
+        Posting posting;
+        posting.row = row;
+        for (size_t field = 0; field < FIELD_COUNT; ++field) {
+            uint16_t frequency = count.second[field];
+            posting.frequencies[field] = frequency;
+            if (frequency == 0) {
+                continue;
+            }
+            term.max_frequencies[field] =
+                std::max(term.max_frequencies[field], frequency);
+            uint32_t length = lengths.fields[field];
+            if (term.min_lengths[field] == 0
+                || length < term.min_lengths[field]) {
+                term.min_lengths[field] = length;
+            }
+        }
+
+        // New entries usually get the last row.
+        auto& postings = term.postings;
+        if (postings.empty() || postings.back().row < row) {
+            postings.push_back(posting);
+            continue;
+        }
+        auto position = std::lower_bound(postings.begin(), postings.end(),
+            row, [](const Posting& other, size_t value) {
+                return other.row < value;
+            });
+        if (position != postings.end() && position->row == row) {
+            *position = posting;
+        } else {
+            postings.insert(position, posting);
+        }
+    }
+}
+
+void
+TextIndex::remove(const EntryStore& store, size_t row)
+{
+    std::unordered_set<string> words;
+    for_each_word(store, row,
+        [&](size_t, StringRef word) { words.insert(word.str()); });
+
+    for (const auto& word : words) {
+        auto term = terms_.find(word);
+        if (term == terms_.end()) {
+            continue;
+        }
+        auto& postings = term->second.postings;
+        auto position = std::lower_bound(postings.begin(), postings.end(),
+            row, [](const Posting& other, size_t value) {
+                return other.row < value;
+            });
+        if (position != postings.end() && position->row == row) {
+            postings.erase(position);
+        }
+        if (postings.empty()) {
+            terms_.erase(term);
+        }
+    }
+
+    if (row < lengths_.size()) {
+        for (size_t field = 0; field < FIELD_COUNT; ++field) {
+            total_lengths_[field] -= lengths_[row].fields[field];
+        }
+        lengths_[row] = Lengths{};
+    }
+    --rows_count_;
+}
+
+vector<TextMatch>
+TextIndex::search(const string& text, size_t limit,
+    const TextSearchOptions& options) const
+{
+    // The position in the postings of one word of the search.
+    struct Cursor {
+        const vector<Posting>* postings;
+        size_t position;
+        double idf;
+        // The highest score the word can add to a row.
+        double bound;
+
+        size_t row() const
+        {
+            return (*postings)[position].row;
+        }
+    };
+
+    vector<TextMatch> result;
+    if (limit == 0 || rows_count_ == 0) {
+        return result;
+    }
+
+    const double weights[FIELD_COUNT] = {options.name_weight,
+        options.description_weight, options.tag_weight,
+        options.attribute_weight};
+    double average_lengths[FIELD_COUNT];
+    for (size_t field = 0; field < FIELD_COUNT; ++field) {
+        average_lengths[field] = total_lengths_[field] == 0
+            ? 1.0
+            : static_cast<double>(total_lengths_[field]) / rows_count_;
+    }
+    // Returns the frequency of a word in a field normalized by the length
+    // of the field.
+    auto normalize = [&](size_t field, double frequency, double length) {
+        return weights[field] * frequency
+            / (1.0 - options.b
+                + options.b * length / average_lengths[field]);
+    };
+
+    vector<string> words;
+    tokenize(text, [&](StringRef word) { words.push_back(word.str()); });
+    std::sort(words.begin(), words.end());
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+
+    vector<Cursor> cursors;
+    double rows_count = static_cast<double>(rows_count_);
+    for (const auto& word : words) {
+        auto position = terms_.find(word);
+        if (position == terms_.end()) {
+            continue;
+        }
+        const Term& term = position->second;
+        double matching = static_cast<double>(term.postings.size());
+        double idf = std::log(
+            1.0 + (rows_count - matching + 0.5) / (matching + 0.5));
+        double frequency = 0.0;
+        for (size_t field = 0; field < FIELD_COUNT; ++field) {
+            if (term.max_frequencies[field] != 0) {
+                frequency += normalize(field, term.max_frequencies[field],
+                    term.min_lengths[field]);
+            }
+        }
+        double bound =
+            idf * saturate(frequency, options.k1) * (1.0 + BOUND_SLACK);
+        if (bound > 0.0) {
+            cursors.push_back(Cursor{&term.postings, 0, idf, bound});
+        }
+    }
+
+    // The best rows so far, with the worst at the front.
+    auto better = [](const TextMatch& match1, const TextMatch& match2) {
+        return match1.score > match2.score
+            || (match1.score == match2.score && match1.row < match2.row);
+    };
+    auto by_row = [](const Cursor& cursor1, const Cursor& cursor2) {
+        return cursor1.row() < cursor2.row();
+    };
+
+    while (true) {
+        cursors.erase(std::remove_if(cursors.begin(), cursors.end(),
+                          [](const Cursor& cursor) {
+                              return cursor.position
+                                  == cursor.postings->size();
+                          }),
+            cursors.end());
+        std::sort(cursors.begin(), cursors.end(), by_row);
+
+        // The pivot is the first cursor at which the bounds of the words
+        // so far could beat the worst of the best rows. No row before the
+        // pivot's can, since only the words before it reach them.
+        bool full = result.size() == limit;
+        double threshold = full ? result.front().score : 0.0;
+        double bounds = 0.0;
+        size_t pivot = 0;
+        for (; pivot < cursors.size(); ++pivot) {
+            bounds += cursors[pivot].bound;
+            if (!full || bounds > threshold) {
+                break;
+            }
+        }
+        if (pivot == cursors.size()) {
+            break;
+        }
+
+        size_t pivot_row = cursors[pivot].row();
+        if (cursors[0].row() != pivot_row) {
+            // Skip the words before the pivot ahead to its row.
+            for (size_t i = 0; i < pivot; ++i) {
+                Cursor& cursor = cursors[i];
+                auto begin = cursor.postings->begin() + cursor.position;
+                auto next = std::lower_bound(begin, cursor.postings->end(),
+                    pivot_row, [](const Posting& posting, size_t row) {
+                        return posting.row < row;
+                    });
+                cursor.position = next - cursor.postings->begin();
+            }
+            continue;
+        }
+
+        const Lengths& lengths = lengths_[pivot_row];
+        double score = 0.0;
+        for (Cursor& cursor : cursors) {
+            if (cursor.row() != pivot_row) {
+                break;
+            }
+            const Posting& posting = (*cursor.postings)[cursor.position];
+            double frequency = 0.0;
+            for (size_t field = 0; field < FIELD_COUNT; ++field) {
+                if (posting.frequencies[field] != 0) {
+                    frequency += normalize(field, posting.frequencies[field],
+                        lengths.fields[field]);
+                }
+            }
+            score += cursor.idf * saturate(frequency, options.k1);
+            ++cursor.position;
+        }
+
+        TextMatch match{pivot_row, score};
+        if (!full) {
+            result.push_back(match);
+            std::push_heap(result.begin(), result.end(), better);
+        } else if (better(match, result.front())) {
+            std::pop_heap(result.begin(), result.end(), better);
+            result.back() = match;
+            std::push_heap(result.begin(), result.end(), better);
+        }
+    }
+
+    std::sort_heap(result.begin(), result.end(), better);
+    return result;
+}
+
+size_t
+TextIndex::rows_count() const
+{
+    return rows_count_;
+}
+
+void
+TextIndex::for_each_word(const EntryStore& store, size_t row,
+    const std::function<void(size_t, StringRef)>& callback)
+{
+    auto field_callback = [&](size_t field) {
+        return [&callback, field](StringRef word) { callback(field, word); };
+    };
+    tokenize(store.name(row), field_callback(0));
+    tokenize(store.description(row), field_callback(1));
+    size_t tags = store.tags_count(row);
+    for (size_t i = 0; i < tags; ++i) {
+        tokenize(store.tag(row, i), field_callback(2));
+    }
+    size_t attributes = store.attributes_count(row);
+    for (size_t i = 0; i < attributes; ++i) {
+        tokenize(store.attribute_value(row, i), field_callback(3));
+    }
+}
+
+}  // namespace libjlinkdb
@@ -0,0 +1,133 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "thread_pool.hh"
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+namespace libjlinkdb {
+
+using std::size_t;
+
+namespace {
+
+// The progress of one call to ThreadPool::run.
+struct Batch {
+    std::mutex mutex;
+    std::condition_variable done;
+    size_t remaining = 0;
+    std::exception_ptr error;
+};
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t threads)
+{
+    threads_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        threads_.emplace_back([this]() { work(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        stopping_ = true;
+    }
+    ready_.notify_all();
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+size_t
+ThreadPool::size() const
+{
+    return threads_.size();
+}
+
+void
+ThreadPool::run(size_t count, const std::function<void(size_t)>& task)
+{
+    if (count == 0) {
+        return;
+    }
+
+    Batch batch;
+    batch.remaining = count;
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        for (size_t i = 0; i < count; ++i) {
+            tasks_.emplace_back([&batch, &task, i]() {
+                std::exception_ptr error;
+                try {
+                    task(i);
+                } catch (...) {
+                    error = std::current_exception();
+                }
+
+                // Notify while holding the lock, so that the batch can't be
+                // destroyed before this thread is done with it.
+                std::lock_guard<std::mutex> batch_lock{batch.mutex};
+                if (error && !batch.error) {
+                    batch.error = error;
+                }
+                if (--batch.remaining == 0) {
+                    batch.done.notify_all();
+                }
+            });
+        }
+    }
+    ready_.notify_all();
+
+    std::unique_lock<std::mutex> lock{batch.mutex};
+    batch.done.wait(lock, [&batch]() { return batch.remaining == 0; });
+    if (batch.error) {
+        std::rethrow_exception(batch.error);
+    }
+}
+
+void
+ThreadPool::work()
+{
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock{mutex_};
+            ready_.wait(
+                lock, [this]() { return stopping_ || !tasks_.empty(); });
+            if (tasks_.empty()) {
+                return;
+            }
+            task = std::move(tasks_.front());
+            tasks_.pop_front();
+        }
+        task();
+    }
+}
+
+}  // namespace libjlinkdb
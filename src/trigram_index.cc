@@ -0,0 +1,168 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "trigram_index.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "entry_store.hh"
+#include "row_set.hh"
+#include "string_ref.hh"
+#include "string_utils.hh"
+
+namespace libjlinkdb {
+
+using std::size_t;
+using std::string;
+using std::uint32_t;
+using std::vector;
+
+constexpr size_t TrigramIndex::MIN_TERM_SIZE;
+constexpr size_t TrigramIndex::FIELD_COUNT;
+
+namespace {
+
+const TextField ALL_FIELDS[] = {TextField::LOCATION, TextField::NAME,
+    TextField::DESCRIPTION, TextField::TAGS, TextField::ATTRIBUTES};
+
+}  // namespace
+
+void
+TrigramIndex::add(const EntryStore& store, size_t row)
+{
+    for (auto field : ALL_FIELDS) {
+        PostingMap& postings = postings_[static_cast<size_t>(field)];
+        for (auto trigram : trigrams(store, row, field)) {
+            insert_row(postings[trigram], row);
+        }
+    }
+}
+
+void
+TrigramIndex::remove(const EntryStore& store, size_t row)
+{
+    for (auto field : ALL_FIELDS) {
+        PostingMap& postings = postings_[static_cast<size_t>(field)];
+        for (auto trigram : trigrams(store, row, field)) {
+            auto list = postings.find(trigram);
+            if (list == postings.end()) {
+                continue;
+            }
+
+            erase_row(list->second, row);
+            if (list->second.empty()) {
+                postings.erase(list);
+            }
+        }
+    }
+}
+
+bool
+TrigramIndex::find(
+    TextField field, const string& term, vector<size_t>& rows) const
+{
+    if (term.size() < MIN_TERM_SIZE) {
+        return false;
+    }
+
+    vector<uint32_t> term_trigrams;
+    append_trigrams(term, term_trigrams);
+    std::sort(term_trigrams.begin(), term_trigrams.end());
+    term_trigrams.erase(
+        std::unique(term_trigrams.begin(), term_trigrams.end()),
+        term_trigrams.end());
+
+    // Intersect starting from the shortest list to keep the intermediate
+    // results small.
+    const PostingMap& postings = postings_[static_cast<size_t>(field)];
+    vector<const vector<size_t>*> lists;
+    for (auto trigram : term_trigrams) {
+        auto list = postings.find(trigram);
+        if (list == postings.end()) {
+            rows.clear();
+            return true;
+        }
+        lists.push_back(&list->second);
+    }
+    std::sort(lists.begin(), lists.end(),
+        [](const vector<size_t>* list1, const vector<size_t>* list2) {
+            return list1->size() < list2->size();
+        });
+
+    rows = *lists.front();
+    for (size_t i = 1; i < lists.size() && !rows.empty(); ++i) {
+        intersect_rows(rows, *lists[i]);
+    }
+    return true;
+}
+
+vector<uint32_t>
+TrigramIndex::trigrams(const EntryStore& store, size_t row, TextField field)
+{
+    vector<uint32_t> result;
+    switch (field) {
+    case TextField::LOCATION:
+        append_trigrams(store.location(row), result);
+        break;
+    case TextField::NAME:
+        append_trigrams(store.name(row), result);
+        break;
+    case TextField::DESCRIPTION:
+        append_trigrams(store.description(row), result);
+        break;
+    case TextField::TAGS:
+        for (size_t i = 0; i < store.tags_count(row); ++i) {
+            append_trigrams(store.tag(row, i), result);
+        }
+        break;
+    case TextField::ATTRIBUTES:
+        for (size_t i = 0; i < store.attributes_count(row); ++i) {
+            append_trigrams(store.attribute_name(row, i), result);
+            append_trigrams(store.attribute_value(row, i), result);
+        }
+        break;
+    }
+
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+void
+TrigramIndex::append_trigrams(StringRef str, vector<uint32_t>& result)
+{
+    if (str.size() < MIN_TERM_SIZE) {
+        return;
+    }
+
+    auto fold = [](char c) -> uint32_t {
+        return static_cast<unsigned char>(to_lower(c));
+    };
+    for (size_t i = 0; i + MIN_TERM_SIZE <= str.size(); ++i) {
+        result.push_back(
+            fold(str[i]) << 16 | fold(str[i + 1]) << 8 | fold(str[i + 2]));
+    }
+}
+
+}  // namespace libjlinkdb
@@ -0,0 +1,267 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "url_index.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "entry_store.hh"
+#include "row_set.hh"
+#include "string_ref.hh"
+#include "string_utils.hh"
+#include "url_parts.hh"
+
+namespace libjlinkdb {
+
+using std::size_t;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Splits the first segment of path, which starts with '/', into segment,
+// and sets rest to the path after it, starting with its '/'. Returns false
+// if path has no segments left.
+bool
+split_segment(StringRef path, StringRef& segment, StringRef& rest)
+{
+    if (path.empty() || path[0] != '/') {
+        return false;
+    }
+    size_t end = 1;
+    while (end < path.size() && path[end] != '/') {
+        ++end;
+    }
+    segment = StringRef{path.data() + 1, end - 1};
+    rest = StringRef{path.data() + end, path.size() - end};
+    return true;
+}
+
+// Returns str in lower case.
+string
+lower_case(StringRef str)
+{
+    string result{str.str()};
+    to_lower_in_place(result);
+    return result;
+}
+
+}  // namespace
+
+void
+UrlIndex::add(const EntryStore& store, size_t row)
+{
+    UrlParts parts;
+    if (!split_url(store.location(row), parts) || parts.host.empty()) {
+        return;
+    }
+
+    string host{lower_case(parts.host)};
+    insert_row(hosts_[host], row);
+    StringRef domain = registrable_domain(parts.host);
+    if (!domain.empty()) {
+        insert_row(domains_[lower_case(domain)], row);
+    }
+
+    size_t node;
+    auto root = roots_.find(host);
+    if (root != roots_.end()) {
+        node = root->second;
+    } else {
+        node = new_node();
+        roots_.emplace(host, node);
+    }
+    insert_row(nodes_[node].rows, row);
+
+    StringRef segment;
+    StringRef path = parts.path;
+    while (split_segment(path, segment, path)) {
+        string key{segment.str()};
+        auto child = nodes_[node].children.find(key);
+        if (child != nodes_[node].children.end()) {
+            node = child->second;
+        } else {
+            size_t created = new_node();
+            nodes_[node].children.emplace(key, created);
+            node = created;
+        }
+        insert_row(nodes_[node].rows, row);
+    }
+}
+
+void
+UrlIndex::remove(const EntryStore& store, size_t row)
+{
+    UrlParts parts;
+    if (!split_url(store.location(row), parts) || parts.host.empty()) {
+        return;
+    }
+
+    string host{lower_case(parts.host)};
+    remove_posting(hosts_, host, row);
+    StringRef domain = registrable_domain(parts.host);
+    if (!domain.empty()) {
+        remove_posting(domains_, lower_case(domain), row);
+    }
+
+    auto root = roots_.find(host);
+    if (root == roots_.end()) {
+        return;
+    }
+    size_t node = root->second;
+    remove_path(node, parts.path, row);
+    if (nodes_[node].rows.empty()) {
+        free_nodes_.push_back(node);
+        roots_.erase(root);
+    }
+}
+
+const vector<size_t>&
+UrlIndex::find_host(const string& host) const
+{
+    static const vector<size_t> empty;
+
+    auto position = hosts_.find(lower_case(host));
+    return position != hosts_.end() ? position->second : empty;
+}
+
+const vector<size_t>&
+UrlIndex::find_domain(const string& domain) const
+{
+    static const vector<size_t> empty;
+
+    auto position = domains_.find(lower_case(domain));
+    return position != domains_.end() ? position->second : empty;
+}
+
+bool
+UrlIndex::find_prefix(const string& prefix, vector<size_t>& rows) const
+{
+    // The host is only known to be complete if something follows it. A
+    // colon may still turn out to start a password rather than a port.
+    UrlParts parts;
+    if (!split_url(prefix, parts) || parts.host.empty()) {
+        return false;
+    }
+    const char* prefix_end = prefix.data() + prefix.size();
+    const char* authority_end =
+        parts.port.empty() ? parts.host.end() : parts.port.end();
+    if (authority_end == prefix_end
+        || (*authority_end != '/' && *authority_end != '?'
+            && *authority_end != '#')) {
+        return false;
+    }
+
+    rows.clear();
+    auto root = roots_.find(lower_case(parts.host));
+    if (root == roots_.end()) {
+        return true;
+    }
+
+    // Every segment is complete if a query or fragment follows the path.
+    // Otherwise the last segment may continue in the location.
+    bool complete = parts.path.end() != prefix_end;
+    size_t node = root->second;
+    StringRef segment;
+    StringRef path = parts.path;
+    while (split_segment(path, segment, path)) {
+        const auto& children = nodes_[node].children;
+        if (!complete && path.empty()) {
+            string partial{segment.str()};
+            if (partial.empty()) {
+                break;
+            }
+            for (auto child = children.lower_bound(partial);
+                 child != children.end()
+                 && child->first.compare(0, partial.size(), partial) == 0;
+                 ++child) {
+                const vector<size_t>& child_rows = nodes_[child->second].rows;
+                rows.insert(rows.end(), child_rows.begin(), child_rows.end());
+            }
+            // Each row is under one child, so there are no duplicates.
+            std::sort(rows.begin(), rows.end());
+            return true;
+        }
+
+        auto child = children.find(segment.str());
+        if (child == children.end()) {
+            return true;
+        }
+        node = child->second;
+    }
+    rows = nodes_[node].rows;
+    return true;
+}
+
+void
+UrlIndex::remove_posting(PostingMap& postings, const string& key, size_t row)
+{
+    auto list = postings.find(key);
+    if (list == postings.end()) {
+        return;
+    }
+
+    vector<size_t>& rows = list->second;
+    erase_row(rows, row);
+    if (rows.empty()) {
+        postings.erase(list);
+    }
+}
+
+size_t
+UrlIndex::new_node()
+{
+    if (free_nodes_.empty()) {
+        nodes_.emplace_back();
+        return nodes_.size() - 1;
+    }
+    size_t position = free_nodes_.back();
+    free_nodes_.pop_back();
+    return position;
+}
+
+void
+UrlIndex::remove_path(size_t position, StringRef path, size_t row)
+{
+    erase_row(nodes_[position].rows, row);
+    StringRef segment;
+    StringRef rest;
+    if (!split_segment(path, segment, rest)) {
+        return;
+    }
+
+    auto& children = nodes_[position].children;
+    auto child = children.find(segment.str());
+    if (child == children.end()) {
+        return;
+    }
+    size_t child_position = child->second;
+    remove_path(child_position, rest, row);
+    if (nodes_[child_position].rows.empty()) {
+        // A node holds every row below it, so its children are gone too.
+        free_nodes_.push_back(child_position);
+        children.erase(child);
+    }
+}
+
+}  // namespace libjlinkdb
@@ -0,0 +1,186 @@
+// Copyright (c) 2020 Jason Waataja
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to
+// deal in the Software without restriction, including without limitation the
+// rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+// sell copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+// FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+// IN THE SOFTWARE.
+
+#include "url_parts.hh"
+
+#include <cstddef>
+#include <cstring>
+
+#include "string_ref.hh"
+#include "string_utils.hh"
+
+namespace libjlinkdb {
+
+using std::size_t;
+
+namespace {
+
+// The labels that commonly come right before a country code in registered
+// domains, as in example.co.uk or example.com.au.
+const char* const SECOND_LEVEL_LABELS[] = {
+    "ac", "co", "com", "edu", "gov", "net", "org", "ne", "or", "go"};
+
+// Returns whether c may appear in the scheme of a URL after its first
+// character.
+bool
+is_scheme_char(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')
+        || (c >= '0' && c <= '9') || c == '+' || c == '-' || c == '.';
+}
+
+// Returns the position of the first of the characters in stops in str at or
+// after begin, or the size of str if there isn't one.
+size_t
+find_first(StringRef str, size_t begin, const char* stops)
+{
+    for (size_t i = begin; i < str.size(); ++i) {
+        for (const char* stop = stops; *stop != '\0'; ++stop) {
+            if (str[i] == *stop) {
+                return i;
+            }
+        }
+    }
+    return str.size();
+}
+
+StringRef
+slice(StringRef str, size_t begin, size_t end)
+{
+    return StringRef{str.data() + begin, end - begin};
+}
+
+}  // namespace
+
+bool
+split_url(StringRef url, UrlParts& parts)
+{
+    size_t colon = find_first(url, 0, ":/?#");
+    if (colon == 0 || colon == url.size() || url[colon] != ':') {
+        return false;
+    }
+    // Schemes start with a letter.
+    if (!is_scheme_char(url[0]) || to_lower(url[0]) < 'a'
+        || to_lower(url[0]) > 'z') {
+        return false;
+    }
+    for (size_t i = 1; i < colon; ++i) {
+        if (!is_scheme_char(url[i])) {
+            return false;
+        }
+    }
+
+    UrlParts result;
+    result.scheme = slice(url, 0, colon);
+    size_t position = colon + 1;
+    if (url.size() - position >= 2 && url[position] == '/'
+        && url[position + 1] == '/') {
+        size_t begin = position + 2;
+        size_t end = find_first(url, begin, "/?#");
+        // The user information ends at the last '@' of the authority.
+        for (size_t i = end; i > begin; --i) {
+            if (url[i - 1] == '@') {
+                begin = i;
+                break;
+            }
+        }
+        // A port follows the last ':', unless it is inside the brackets of
+        // an IPv6 address.
+        size_t host_end = end;
+        for (size_t i = end; i > begin; --i) {
+            if (url[i - 1] == ']') {
+                break;
+            }
+            if (url[i - 1] == ':') {
+                host_end = i - 1;
+                result.port = slice(url, i, end);
+                break;
+            }
+        }
+        result.host = slice(url, begin, host_end);
+        position = end;
+    }
+
+    size_t path_end = find_first(url, position, "?#");
+    result.path = slice(url, position, path_end);
+    position = path_end;
+    if (position < url.size() && url[position] == '?') {
+        size_t query_end = find_first(url, position + 1, "#");
+        result.query = slice(url, position + 1, query_end);
+        position = query_end;
+    }
+    if (position < url.size()) {
+        result.fragment = slice(url, position + 1, url.size());
+    }
+    parts = result;
+    return true;
+}
+
+StringRef
+registrable_domain(StringRef host)
+{
+    if (!host.empty() && host[host.size() - 1] == '.') {
+        // A fully qualified name ends in an empty label.
+        host = slice(host, 0, host.size() - 1);
+    }
+    if (host.empty() || host[0] == '[') {
+        return {};
+    }
+
+    // The positions just after the last three dots, from the end.
+    size_t starts[3] = {0, 0, 0};
+    size_t found = 0;
+    for (size_t i = host.size(); i > 0 && found < 3; --i) {
+        if (host[i - 1] == '.') {
+            starts[found++] = i;
+        }
+    }
+    if (found == 0) {
+        return {};
+    }
+
+    StringRef last = slice(host, starts[0], host.size());
+    char first = last.empty() ? '\0' : last[0];
+    if (first >= '0' && first <= '9') {
+        // Top level labels never start with a digit, so this is an IPv4
+        // address.
+        return {};
+    }
+
+    size_t labels = 2;
+    if (last.size() == 2) {
+        StringRef second = slice(host, found >= 2 ? starts[1] : 0,
+            starts[0] - 1);
+        for (const char* label : SECOND_LEVEL_LABELS) {
+            if (equals_ignore_case(
+                    second, StringRef{label, std::strlen(label)})) {
+                labels = 3;
+                break;
+            }
+        }
+    }
+    if (found < labels - 1) {
+        return {};
+    }
+    size_t begin = found >= labels ? starts[labels - 1] : 0;
+    return slice(host, begin, host.size());
+}
+
+}  // namespace libjlinkdb
@@ -20,11 +20,18 @@
 
 
 #include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <fstream>
 #include <functional>
 #include <iterator>
 #include <memory>
+#include <random>
+#include <set>
 #include <sstream>
+#include <stdexcept>
 #include <string>
+#include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -198,6 +205,155 @@ TEST(TestLinkEntry, TestGetAttributeNotExists)
     ASSERT_EQ(entry.get_attribute("fake"), "");
 }
 
+TEST(TestStringUtils, TestSearchString)
+{
+    using libjlinkdb::search_string;
+
+    EXPECT_TRUE(search_string("abc", "", {false, false}));
+    EXPECT_TRUE(search_string("", "", {true, false}));
+    EXPECT_FALSE(search_string("", "a", {false, false}));
+    EXPECT_TRUE(search_string("Hello World", "o w", {false, true}));
+    EXPECT_FALSE(search_string("Hello World", "o w", {false, false}));
+    EXPECT_TRUE(search_string("Hello World", "hello world", {true, true}));
+    EXPECT_FALSE(search_string("Hello World", "hello", {true, true}));
+    EXPECT_FALSE(search_string("\xc3\x84", "\xc3\xa4", {true, true}));
+}
+
+TEST(TestStringUtils, TestSearchStringMatchesReference)
+{
+    // Compare against copying and lowering the strings, for many lengths
+    // and positions so that every block size and tail is covered.
+    auto reference = [](string str, string target, bool ignore_case) {
+        if (ignore_case) {
+            libjlinkdb::to_lower_in_place(str);
+            libjlinkdb::to_lower_in_place(target);
+        }
+        return str.find(target) != string::npos;
+    };
+
+    const string alphabet{"aAbB-\xe9"};
+    unsigned seed = 1;
+    auto next = [&seed]() {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 16) & 0x7fff;
+    };
+    for (int trial = 0; trial < 2000; ++trial) {
+        string str(next() % 80, 'a');
+        for (auto& c : str) {
+            c = alphabet[next() % alphabet.size()];
+        }
+        string target{str.substr(next() % (str.size() + 1), next() % 6)};
+        if (next() % 2 == 0 && !target.empty()) {
+            target[next() % target.size()] = 'B';
+        }
+
+        for (bool ignore_case : {false, true}) {
+            libjlinkdb::StringMatcher matcher{target, {false, ignore_case}};
+            EXPECT_EQ(reference(str, target, ignore_case),
+                matcher.matches(str))
+                << str << " " << target << " " << ignore_case;
+        }
+    }
+}
+
+TEST(TestMultiStringMatcher, TestMatchesSearchString)
+{
+    using libjlinkdb::MultiStringMatcher;
+
+    vector<string> targets{"he", "she", "his", "hers", "Us", "a b"};
+    vector<string> strings{"", "h", "he", "ushers", "HIS", "us", "US",
+        "a  b", "xa by", "hershey", "sh", "uS"};
+    for (bool full : {false, true}) {
+        for (bool ignore_case : {false, true}) {
+            StringSearchOptions options{full, ignore_case};
+            MultiStringMatcher matcher{targets, options};
+            for (const auto& str : strings) {
+                bool expected = std::any_of(begin(targets), end(targets),
+                    [&](const string& target) {
+                        return libjlinkdb::search_string(
+                            str, target, options);
+                    });
+                EXPECT_EQ(expected, matcher.matches(str))
+                    << str << " " << full << " " << ignore_case;
+            }
+        }
+    }
+
+    const string empty;
+    const string abc{"abc"};
+    EXPECT_FALSE(MultiStringMatcher{}.matches(empty));
+    EXPECT_TRUE(MultiStringMatcher({""}, {false, false}).matches(empty));
+    EXPECT_TRUE(MultiStringMatcher({""}, {false, false}).matches(abc));
+    EXPECT_FALSE(MultiStringMatcher({""}, {true, false}).matches(abc));
+}
+
+TEST(TestFieldQuery, TestExtractors)
+{
+    using libjlinkdb::StringRef;
+    using libjlinkdb::query::FieldQuery;
+    using libjlinkdb::query::NameExtractor;
+    namespace detail = libjlinkdb::query::detail;
+
+    EXPECT_TRUE(detail::ReturnsReference<NameExtractor>::value);
+
+    LinkEntry entry;
+    entry.set_name("Gentoo Linux");
+
+    // A computed field is returned by value and searched as a copy.
+    auto upper = [](const LinkEntry& link) {
+        string result{link.name()};
+        std::transform(result.begin(), result.end(), result.begin(),
+            [](char c) { return c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c; });
+        return result;
+    };
+    EXPECT_FALSE(detail::ReturnsReference<decltype(upper)>::value);
+    FieldQuery<decltype(upper)> computed{upper, "LINUX", {false, false}};
+    EXPECT_TRUE(computed.matches(entry));
+
+    auto prefix = [](const LinkEntry& link) {
+        return StringRef{link.name().data(), 6};
+    };
+    EXPECT_TRUE(detail::ReturnsReference<decltype(prefix)>::value);
+    FieldQuery<decltype(prefix)> viewed{prefix, "gentoo", {true, true}};
+    EXPECT_TRUE(viewed.matches(entry));
+
+    FieldQuery<NameExtractor> stored{{}, "linux", {false, true}};
+    EXPECT_TRUE(stored.matches(entry));
+    EXPECT_LT(stored.estimated_cost(), computed.estimated_cost());
+}
+
+TEST(TestFieldQuery, TestDescribedExtractorEquality)
+{
+    using libjlinkdb::query::FieldQuery;
+
+    // An extractor with state that describes itself.
+    struct AttributeExtractor {
+        string name;
+
+        string operator()(const LinkEntry& link) const
+        {
+            auto attribute = link.attributes().find(name);
+            return attribute != link.attributes().end() ? attribute->second
+                                                        : string{};
+        }
+
+        string describe() const
+        {
+            return "attribute " + name;
+        }
+    };
+
+    StringSearchOptions options{true, false};
+    FieldQuery<AttributeExtractor> color1{{"color"}, "red", options};
+    FieldQuery<AttributeExtractor> color2{{"color"}, "red", options};
+    FieldQuery<AttributeExtractor> size{{"size"}, "red", options};
+    EXPECT_TRUE(color1.equals(color2));
+    EXPECT_EQ(color1.hash(), color2.hash());
+    EXPECT_EQ(color1.key(), color2.key());
+    EXPECT_FALSE(color1.equals(size));
+    EXPECT_NE(color1.key(), size.key());
+}
+
 namespace {
 
 class LinkDatabaseTest : public ::testing::Test {
@@ -256,6 +412,43 @@ TEST_F(LinkDatabaseTest, TestRemoveLink)
     EXPECT_FALSE(db.has_entry(id));
 }
 
+TEST_F(LinkDatabaseTest, TestBulkAddAndDelete)
+{
+    int first_added = -1;
+    int last_added = -1;
+    int batches = 0;
+    std::vector<int> deleted;
+    db_.signal_entries_added().connect([&](int first, int last) {
+        first_added = first;
+        last_added = last;
+        ++batches;
+    });
+    db_.signal_entries_deleted().connect(
+        [&](const std::vector<int>& ids) { deleted = ids; });
+
+    std::vector<std::shared_ptr<LinkEntry>> entries;
+    for (int i = 0; i < 100; ++i) {
+        entries.push_back(std::make_shared<LinkEntry>(BASIC_URL1));
+    }
+    int first = db_.add_entries(entries);
+    EXPECT_EQ(1, batches);
+    EXPECT_EQ(first, first_added);
+    EXPECT_EQ(first + 100, last_added);
+    EXPECT_EQ(100, db_.links_count());
+    EXPECT_EQ(entries[99], db_.get_entry(first + 99));
+
+    int single = db_.add_entry(std::make_shared<LinkEntry>(BASIC_URL2));
+    EXPECT_EQ(2, batches);
+    EXPECT_EQ(single, first_added);
+
+    int per_id = 0;
+    db_.signal_entry_deleted().connect([&](int) { ++per_id; });
+    db_.delete_entries({first, first + 1, first, single + 1});
+    EXPECT_EQ((std::vector<int>{first, first + 1}), deleted);
+    EXPECT_EQ(2, per_id);
+    EXPECT_EQ(99, db_.links_count());
+}
+
 TEST_F(LinkDatabaseTest, TestQueryNone)
 {
     EXPECT_TRUE(
@@ -316,6 +509,267 @@ TEST_F(LinkDatabaseTest, TestWriteFull)
     EXPECT_EQ(expected_entries_, links);
 }
 
+TEST_F(LinkDatabaseTest, TestWriteEscapes)
+{
+    auto entry = std::make_shared<LinkEntry>(BASIC_URL1);
+    entry->set_name("\"quoted\" \\ back\\slash");
+    entry->set_description(string{"tab\tnewline\ncontrol\x01\x1f"});
+    entry->add_tag("caf\xc3\xa9");
+    entry->set_attribute("key\"", "value\n");
+    db_.add_entry(entry);
+
+    std::ostringstream writer;
+    db_.write_to_stream(writer);
+    std::istringstream reader{writer.str()};
+    LinkDatabase db_copy{reader};
+    ASSERT_EQ(1, db_copy.links_count());
+    EXPECT_EQ(*entry, *db_copy.links_cbegin()->second);
+}
+
+TEST_F(LinkDatabaseTest, TestWriteInvalidUtf8)
+{
+    // A stray continuation byte, an overlong slash, a surrogate, a code
+    // point past U+10FFFF and a truncated sequence.
+    std::vector<string> invalid{"a\x80", "\xc0\xaf", "\xed\xa0\x80",
+        "\xf4\x90\x80\x80", "\xe2\x82"};
+    for (const auto& name : invalid) {
+        LinkDatabase db;
+        auto entry = std::make_shared<LinkEntry>();
+        entry->set_name(name);
+        db.add_entry(entry);
+        std::ostringstream writer;
+        EXPECT_THROW(db.write_to_stream(writer), libjlinkdb::JLinkDbError);
+    }
+
+    auto entry = std::make_shared<LinkEntry>();
+    entry->set_name("\xf0\x9f\x94\x97 \xe2\x82\xac");
+    db_.add_entry(entry);
+    std::ostringstream writer;
+    db_.write_to_stream(writer);
+    std::istringstream reader{writer.str()};
+    LinkDatabase db_copy{reader};
+    EXPECT_EQ(entry->name(), db_copy.links_cbegin()->second->name());
+}
+
+TEST_F(LinkDatabaseTest, TestSnapshot)
+{
+    constexpr const char path[] = "libjlinkdb_test_snapshot.bin";
+
+    auto db = database_from_string(WITH_ATTRIBUTES);
+    db.add_entry(std::make_shared<LinkEntry>(BASIC_URL2));
+    db.delete_entry(db.add_entry(std::make_shared<LinkEntry>(BASIC_URL1)));
+    db.write_snapshot_to_file(path);
+
+    {
+        libjlinkdb::Snapshot snapshot{path};
+        ASSERT_EQ(3, snapshot.size());
+        EXPECT_EQ("https://gentoo.org", snapshot.location(0).str());
+        EXPECT_EQ("MyName", snapshot.name(0).str());
+        EXPECT_EQ("My description.", snapshot.description(0).str());
+        EXPECT_EQ(2, snapshot.tags_count(0));
+        EXPECT_EQ(2, snapshot.attributes_count(0));
+        EXPECT_EQ(0, snapshot.tags_count(1));
+        EXPECT_EQ(BASIC_URL2, snapshot.location(2).str());
+        EXPECT_EQ(4, snapshot.next_id());
+        EXPECT_FALSE(snapshot.has_entry(3));
+        for (std::size_t i = 0; i < snapshot.size(); ++i) {
+            EXPECT_EQ(*db.get_entry(i), *snapshot.entry(i));
+        }
+
+        LinkDatabase db_copy{snapshot};
+        EXPECT_EQ(gather_links_ordered(db), gather_links_ordered(db_copy));
+    }
+
+    {
+        std::ofstream writer{path, std::ios::binary};
+        writer << "not a snapshot, but long enough to hold a header. "
+                  "not a snapshot, but long enough to hold a header.";
+    }
+    EXPECT_THROW(libjlinkdb::Snapshot{path}, libjlinkdb::JLinkDbError);
+    std::remove(path);
+    EXPECT_THROW(libjlinkdb::Snapshot{path}, libjlinkdb::JLinkDbError);
+}
+
+TEST_F(LinkDatabaseTest, TestChangeSnapshotDatabase)
+{
+    using libjlinkdb::query::TagQuery;
+    constexpr const char path[] = "libjlinkdb_test_snapshot.bin";
+
+    auto db = database_from_string(WITH_ATTRIBUTES);
+    int deleted = db.add_entry(std::make_shared<LinkEntry>(BASIC_URL1));
+    int id = db.add_entry(std::make_shared<LinkEntry>(BASIC_URL2));
+    db.delete_entry(deleted);
+    db.write_snapshot_to_file(path);
+
+    // The database keeps the mapping after the snapshot and the file are
+    // gone.
+    LinkDatabase mapped{libjlinkdb::Snapshot{path}};
+    std::remove(path);
+    EXPECT_EQ(db.links_count(), mapped.links_count());
+    EXPECT_FALSE(mapped.has_entry(deleted));
+    EXPECT_EQ(gather_links_ordered(db), gather_links_ordered(mapped));
+    EXPECT_EQ(1, mapped.count(TagQuery{"first tag", {true, false}}));
+
+    for (LinkDatabase* database : {&db, &mapped}) {
+        database->get_entry(0)->add_tag("changed");
+        database->delete_entry(id);
+        EXPECT_EQ(id + 1,
+            database->add_entry(std::make_shared<LinkEntry>(BASIC_URL1)));
+    }
+    EXPECT_EQ(gather_links_ordered(db), gather_links_ordered(mapped));
+    mapped.set_tag_index_enabled(true);
+    EXPECT_EQ(1, mapped.count(TagQuery{"changed", {true, false}}));
+    EXPECT_EQ(1, mapped.count(TagQuery{"first tag", {true, false}}));
+}
+
+TEST_F(LinkDatabaseTest, TestOperationLog)
+{
+    constexpr const char log_path[] = "libjlinkdb_test_log.bin";
+    constexpr const char snapshot_path[] = "libjlinkdb_test_checkpoint.bin";
+    std::remove(log_path);
+
+    vector<LinkEntry> expected;
+    {
+        LinkDatabase db;
+        db.open_log(log_path);
+        db.add_entry(std::make_shared<LinkEntry>(BASIC_URL1));
+        int id = db.add_entry(std::make_shared<LinkEntry>(BASIC_URL2));
+        db.get_entry(0)->add_tag("tag");
+        db.get_entry(0)->set_attribute("key", "value");
+        db.delete_entry(id);
+        db.checkpoint(snapshot_path);
+
+        db.add_entry(std::make_shared<LinkEntry>(BASIC_URL2));
+        db.get_entry(0)->set_name("name");
+        expected = gather_links_ordered(db);
+    }
+
+    LinkDatabase db{libjlinkdb::Snapshot{snapshot_path}};
+    EXPECT_EQ(1, db.links_count());
+    db.open_log(log_path);
+    EXPECT_EQ(expected, gather_links_ordered(db));
+    EXPECT_FALSE(db.has_entry(1));
+    EXPECT_EQ("name", db.get_entry(0)->name());
+    EXPECT_EQ(BASIC_URL2, db.get_entry(2)->location());
+    EXPECT_EQ(3, db.add_entry(std::make_shared<LinkEntry>()));
+    db.close_log();
+
+    // A record cut off by a crash is dropped.
+    {
+        std::ofstream writer{log_path, std::ios::binary | std::ios::app};
+        writer << "partial";
+    }
+    LinkDatabase recovered{libjlinkdb::Snapshot{snapshot_path}};
+    recovered.open_log(log_path);
+    EXPECT_EQ(gather_links_ordered(db), gather_links_ordered(recovered));
+
+    std::remove(log_path);
+    std::remove(snapshot_path);
+}
+
+TEST_F(LinkDatabaseTest, TestOperationLogBatch)
+{
+    constexpr const char log_path[] = "libjlinkdb_test_log.bin";
+    std::remove(log_path);
+
+    auto log_size = [&]() {
+        return std::ifstream{log_path, std::ios::binary | std::ios::ate}
+            .tellg();
+    };
+    {
+        LinkDatabase db;
+        db.open_log(log_path);
+        std::streamoff empty_size = log_size();
+        auto entry = std::make_shared<LinkEntry>(BASIC_URL1);
+        db.begin_log_batch();
+        db.add_entry(entry);
+        entry->set_name("name");
+        entry->set_description("description");
+        entry->add_tag("tag");
+        EXPECT_EQ(empty_size, log_size());
+        db.end_log_batch();
+        EXPECT_LT(empty_size, log_size());
+    }
+
+    LinkDatabase db;
+    db.open_log(log_path);
+    ASSERT_TRUE(db.has_entry(0));
+    EXPECT_EQ("name", db.get_entry(0)->name());
+    EXPECT_EQ("description", db.get_entry(0)->description());
+    EXPECT_TRUE(db.get_entry(0)->has_tag("tag"));
+    db.close_log();
+
+    // A file that isn't a log is rejected rather than truncated.
+    {
+        std::ofstream writer{log_path, std::ios::binary | std::ios::trunc};
+        writer << "not an operation log";
+    }
+    EXPECT_THROW(db.open_log(log_path), libjlinkdb::JLinkDbError);
+    EXPECT_FALSE(db.has_log());
+
+    std::remove(log_path);
+}
+
+TEST_F(LinkDatabaseTest, TestOperationLogFieldChanges)
+{
+    using libjlinkdb::query::TagQuery;
+
+    constexpr const char log_path[] = "libjlinkdb_test_log.bin";
+    std::remove(log_path);
+
+    auto log_size = [&]() {
+        return std::ifstream{log_path, std::ios::binary | std::ios::ate}
+            .tellg();
+    };
+    vector<LinkEntry> expected;
+    {
+        LinkDatabase db;
+        db.open_log(log_path);
+        auto entry = std::make_shared<LinkEntry>(BASIC_URL1);
+        entry->set_description(string(1000, 'd'));
+        entry->add_tag("kept");
+        entry->add_tag("removed");
+        entry->set_attribute("key", "value");
+        db.add_entry(entry);
+        db.add_entry(std::make_shared<LinkEntry>(BASIC_URL2));
+
+        // Changing a field records the field, not the whole entry.
+        std::streamoff before = log_size();
+        entry->add_tag("added");
+        EXPECT_LT(log_size() - before, 100);
+
+        entry->remove_tag("removed");
+        entry->set_attribute("key", "changed");
+        entry->set_attribute("other", "value");
+        entry->set_location(BASIC_URL2);
+        entry->set_name("name");
+        db.get_entry(1)->set_attribute("key", "value");
+        db.get_entry(1)->remove_attribute("key");
+        db.replace_entry(1, std::make_shared<LinkEntry>(BASIC_URL1));
+        db.get_entry(1)->set_description("description");
+        expected = gather_links_ordered(db);
+    }
+
+    // Replaying doesn't emit any signals.
+    LinkDatabase db;
+    int signals = 0;
+    db.signal_entry_added().connect([&](int) { ++signals; });
+    db.signal_entry_deleted().connect([&](int) { ++signals; });
+    db.signal_entry_changed().connect([&](int) { ++signals; });
+    db.signal_entries_added().connect([&](int, int) { ++signals; });
+    db.signal_entries_deleted().connect(
+        [&](const vector<int>&) { ++signals; });
+    db.open_log(log_path);
+    EXPECT_EQ(0, signals);
+    EXPECT_EQ(expected, gather_links_ordered(db));
+
+    db.set_tag_index_enabled(true);
+    EXPECT_EQ(1, db.count(TagQuery{"added", {true, false}}));
+    EXPECT_EQ(0, db.count(TagQuery{"removed", {true, false}}));
+
+    std::remove(log_path);
+}
+
 TEST_F(LinkDatabaseTest, TestReadEmptyStream)
 {
     ASSERT_THROW(database_from_string(""), libjlinkdb::JLinkDbError);
@@ -338,6 +792,43 @@ TEST_F(LinkDatabaseTest, TestExtraneousFieldsAllowed)
         "{ \"links\": { \"dummy1\": \"a\" }, \"dummy2\": \"b\" }"));
 }
 
+TEST_F(LinkDatabaseTest, TestNestedExtraneousFieldsAllowed)
+{
+    auto db = database_from_string(
+        "{ \"version\": { \"links\": [ 1, 2 ] }, \"links\": ["
+        "{ \"name\": \"MyName\", \"extra\": [ { \"name\": \"x\" } ] }"
+        "] }");
+    auto links = gather_links_ordered(db);
+    ASSERT_EQ(1, links.size());
+    EXPECT_EQ("MyName", links[0].name());
+}
+
+TEST_F(LinkDatabaseTest, TestLooseValues)
+{
+    // These are read as reading the document into a json value did.
+    EXPECT_EQ(1, database_from_string("{ \"links\": 1 }").links_count());
+    EXPECT_EQ(0, database_from_string("{ \"links\": null }").links_count());
+
+    auto db = database_from_string(
+        "{ \"links\": [ { \"tags\": \"tag\", \"attributes\": \"x\" },"
+        "{ \"attributes\": [ \"a\", \"b\" ] } ] }");
+    auto links = gather_links_ordered(db);
+    ASSERT_EQ(2, links.size());
+    EXPECT_EQ(1, links[0].tags().count("tag"));
+    EXPECT_EQ("x", links[0].get_attribute(""));
+    EXPECT_EQ("a", links[1].get_attribute("0"));
+    EXPECT_EQ("b", links[1].get_attribute("1"));
+}
+
+TEST_F(LinkDatabaseTest, TestFieldNotString)
+{
+    ASSERT_THROW(database_from_string("{ \"links\": [ { \"name\": 1 } ] }"),
+        libjlinkdb::JLinkDbError);
+    ASSERT_THROW(
+        database_from_string("{ \"links\": [ { \"tags\": [ {} ] } ] }"),
+        libjlinkdb::JLinkDbError);
+}
+
 TEST_F(LinkDatabaseTest, TestInvalidUrl)
 {
     ASSERT_THROW(database_from_string(INVALID_URL), libjlinkdb::JLinkDbError);
@@ -348,6 +839,1135 @@ TEST_F(LinkDatabaseTest, TestSearchBasic)
 {
 }
 
+TEST_F(LinkDatabaseTest, TestSearchSeesEntryChanges)
+{
+    int id = db_.add_entry(std::make_shared<LinkEntry>(BASIC_URL1));
+    ContainsQuery query{{"renamed"}, {false, true}};
+    EXPECT_TRUE(db_.search(query).empty());
+
+    db_.get_entry(id)->set_name("Renamed");
+    auto result = db_.search(query);
+    ASSERT_EQ(1, result.size());
+    EXPECT_EQ(id, result[0].first);
+
+    db_.get_entry(id)->set_name("");
+    EXPECT_TRUE(db_.search(query).empty());
+}
+
+TEST_F(LinkDatabaseTest, TestSearchSkipsDeleted)
+{
+    int id1 = db_.add_entry(std::make_shared<LinkEntry>(BASIC_URL1));
+    int id2 = db_.add_entry(std::make_shared<LinkEntry>(BASIC_URL2));
+    db_.delete_entry(id1);
+    auto result = db_.search(FuncQuery{[](const LinkEntry&) { return true; }});
+    ASSERT_EQ(1, result.size());
+    EXPECT_EQ(id2, result[0].first);
+    EXPECT_EQ(1, db_.links_count());
+}
+
+TEST_F(LinkDatabaseTest, TestCopyListensToEntries)
+{
+    auto entry = std::make_shared<LinkEntry>(BASIC_URL1);
+    int id = db_.add_entry(entry);
+    LinkDatabase copy{db_};
+    LinkDatabase moved{std::move(db_)};
+    entry->add_tag("tag");
+
+    ContainsQuery query{{"tag"}, {true, false}};
+    EXPECT_EQ(1, copy.search(query).size());
+    EXPECT_EQ(1, moved.search(query).size());
+    EXPECT_TRUE(moved.has_entry(id));
+}
+
+TEST_F(LinkDatabaseTest, TestEntriesBuiltOnDemand)
+{
+    int id = db_.add_entry(nullptr);
+    EXPECT_TRUE(db_.has_entry(id));
+    EXPECT_EQ(LinkEntry{}, *db_.get_entry(id));
+
+    auto entry = db_.get_entry(id);
+    EXPECT_EQ(entry, db_.get_entry(id));
+    EXPECT_EQ(entry, db_.links_cbegin()->second);
+    std::weak_ptr<LinkEntry> held{entry};
+    entry->set_name("name");
+    entry.reset();
+    // Only the fields are kept once nobody holds the entry.
+    EXPECT_TRUE(held.expired());
+    EXPECT_EQ("name", db_.get_entry(id)->name());
+
+    auto old_entry = db_.get_entry(id);
+    db_.replace_entry(id, std::make_shared<LinkEntry>(BASIC_URL1));
+    old_entry->set_name("old");
+    EXPECT_EQ("", db_.get_entry(id)->name());
+    EXPECT_TRUE(db_.search(ContainsQuery{{"old"}, {true, false}}).empty());
+}
+
+TEST_F(LinkDatabaseTest, TestManyChanges)
+{
+    int id = db_.add_entry(std::make_shared<LinkEntry>(BASIC_URL1));
+    auto entry = db_.get_entry(id);
+    for (int i = 0; i < 2000; ++i) {
+        entry->set_description(std::to_string(i) + " description");
+        entry->set_attribute("count", std::to_string(i));
+    }
+
+    ContainsQuery query{{"1999 desc"}, {false, false}};
+    EXPECT_EQ(1, db_.search(query).size());
+    libjlinkdb::query::AttributeQuery attribute_query{
+        "count", "1999", {true, false}};
+    EXPECT_EQ(1, db_.search(attribute_query).size());
+}
+
+TEST_F(LinkDatabaseTest, TestTagIndex)
+{
+    using libjlinkdb::query::And;
+    using libjlinkdb::query::TagQuery;
+
+    db_.set_tag_index_enabled(true);
+    auto entry1 = std::make_shared<LinkEntry>(BASIC_URL1);
+    entry1->add_tag("Linux");
+    auto entry2 = std::make_shared<LinkEntry>(BASIC_URL2);
+    entry2->add_tag("linux");
+    entry2->add_tag("arch");
+    int id1 = db_.add_entry(entry1);
+    int id2 = db_.add_entry(entry2);
+    db_.add_entry(std::make_shared<LinkEntry>());
+
+    EXPECT_EQ(1, db_.search(TagQuery{"linux", {true, false}}).size());
+    EXPECT_EQ(2, db_.search(TagQuery{"linux", {true, true}}).size());
+    EXPECT_TRUE(db_.search(TagQuery{"linu", {true, true}}).empty());
+    EXPECT_EQ(2, db_.search(TagQuery{"linu", {false, true}}).size());
+
+    // Only the entries with the tag should be checked by the other query.
+    int checked = 0;
+    auto counter = std::make_shared<FuncQuery>([&](const LinkEntry&) {
+        ++checked;
+        return true;
+    });
+    StringSearchOptions exact{true, false};
+    And query{std::make_shared<TagQuery>("arch", exact), counter};
+    auto result = db_.search(query);
+    ASSERT_EQ(1, result.size());
+    EXPECT_EQ(id2, result[0].first);
+    EXPECT_EQ(1, checked);
+
+    entry2->remove_tag("arch");
+    entry1->add_tag("arch");
+    result = db_.search(TagQuery{"arch", {true, false}});
+    ASSERT_EQ(1, result.size());
+    EXPECT_EQ(id1, result[0].first);
+
+    db_.delete_entry(id1);
+    EXPECT_TRUE(db_.search(TagQuery{"arch", {true, false}}).empty());
+    EXPECT_EQ(1, db_.search(TagQuery{"LINUX", {true, true}}).size());
+}
+
+TEST_F(LinkDatabaseTest, TestAttributeIndex)
+{
+    using libjlinkdb::query::And;
+    using libjlinkdb::query::AttributeQuery;
+
+    db_.set_attribute_index_enabled(true);
+    EXPECT_TRUE(db_.attribute_index_enabled());
+    auto entry1 = std::make_shared<LinkEntry>(BASIC_URL1);
+    entry1->set_attribute("source", "Import-1");
+    auto entry2 = std::make_shared<LinkEntry>(BASIC_URL2);
+    entry2->set_attribute("source", "import-1");
+    entry2->set_attribute("owner", "import-1");
+    int id1 = db_.add_entry(entry1);
+    int id2 = db_.add_entry(entry2);
+    db_.add_entry(std::make_shared<LinkEntry>());
+
+    StringSearchOptions exact{true, false};
+    StringSearchOptions folded{true, true};
+    EXPECT_EQ(1, db_.count(AttributeQuery{"source", "import-1", exact}));
+    EXPECT_EQ(2, db_.count(AttributeQuery{"source", "IMPORT-1", folded}));
+    EXPECT_EQ(0, db_.count(AttributeQuery{"Source", "import-1", exact}));
+    EXPECT_EQ(0, db_.count(AttributeQuery{"source", "import", exact}));
+    EXPECT_EQ(2, db_.count(AttributeQuery{"source", "import", {false, true}}));
+
+    // Only the entries with the attribute should be checked by the other
+    // query.
+    int checked = 0;
+    auto counter = std::make_shared<FuncQuery>([&](const LinkEntry&) {
+        ++checked;
+        return true;
+    });
+    And query{
+        std::make_shared<AttributeQuery>("owner", "import-1", exact), counter};
+    auto result = db_.search(query);
+    ASSERT_EQ(1, result.size());
+    EXPECT_EQ(id2, result[0].first);
+    EXPECT_EQ(1, checked);
+
+    entry2->remove_attribute("owner");
+    entry1->set_attribute("owner", "import-1");
+    result = db_.search(AttributeQuery{"owner", "import-1", exact});
+    ASSERT_EQ(1, result.size());
+    EXPECT_EQ(id1, result[0].first);
+
+    db_.delete_entry(id1);
+    EXPECT_EQ(0, db_.count(AttributeQuery{"owner", "import-1", exact}));
+    db_.set_attribute_index_enabled(false);
+    EXPECT_FALSE(db_.attribute_index_enabled());
+    EXPECT_EQ(1, db_.count(AttributeQuery{"source", "import-1", exact}));
+}
+
+TEST_F(LinkDatabaseTest, TestExactCandidates)
+{
+    using libjlinkdb::query::AndCollection;
+    using libjlinkdb::query::AttributeQuery;
+    using libjlinkdb::query::Or;
+    using libjlinkdb::query::Query;
+    using libjlinkdb::query::TagQuery;
+
+    for (int i = 0; i < 100; ++i) {
+        auto entry = std::make_shared<LinkEntry>();
+        entry->add_tag("three-" + std::to_string(i % 3));
+        entry->add_tag("five-" + std::to_string(i % 5));
+        entry->set_attribute("priority", std::to_string(i % 4));
+        db_.add_entry(entry);
+    }
+
+    StringSearchOptions exact{true, false};
+    auto three = std::make_shared<TagQuery>("three-0", exact);
+    auto five = std::make_shared<TagQuery>("five-1", exact);
+    auto priority = std::make_shared<AttributeQuery>("priority", "1", exact);
+    int checked = 0;
+    auto counter = std::make_shared<FuncQuery>([&](const LinkEntry&) {
+        ++checked;
+        return true;
+    });
+    AndCollection indexed{vector<shared_ptr<Query>>{three, priority}};
+    Or either{three, five};
+    AndCollection mixed{vector<shared_ptr<Query>>{three, priority, counter}};
+    auto counts = [&]() {
+        return vector<std::size_t>{
+            db_.count(indexed), db_.count(either), db_.count(mixed)};
+    };
+    EXPECT_EQ(vector<std::size_t>({8, 47, 8}), counts());
+
+    db_.set_tag_index_enabled(true);
+    db_.set_attribute_index_enabled(true);
+    checked = 0;
+    EXPECT_EQ(vector<std::size_t>({8, 47, 8}), counts());
+    // Only the query without an index checks the rows left by the others.
+    EXPECT_EQ(8, checked);
+
+    auto plan = db_.plan(indexed);
+    EXPECT_TRUE(plan.root().exact);
+    EXPECT_EQ(8, plan.candidates().size());
+    EXPECT_TRUE(db_.plan(either).root().exact);
+    auto mixed_plan = db_.plan(mixed);
+    EXPECT_FALSE(mixed_plan.root().exact);
+    EXPECT_EQ(
+        static_cast<const Query*>(counter.get()), &mixed_plan.residual());
+
+    // Searches for part of a tag can't be answered by the index of tags.
+    auto partial = std::make_shared<TagQuery>(
+        "three", StringSearchOptions{false, false});
+    AndCollection partial_and{vector<shared_ptr<Query>>{partial, priority}};
+    EXPECT_FALSE(db_.plan(partial_and).root().exact);
+    EXPECT_EQ(5, db_.count(AndCollection{vector<shared_ptr<Query>>{
+                     partial, priority, five}}));
+}
+
+TEST_F(LinkDatabaseTest, TestSortedAttributeIndex)
+{
+    using libjlinkdb::AttributeBound;
+    using libjlinkdb::AttributeOrder;
+    using libjlinkdb::query::AttributePrefixQuery;
+    using libjlinkdb::query::AttributeRangeQuery;
+
+    std::vector<std::string> priorities{"-3", "5", "10", "9", "+7", "x"};
+    std::vector<int> ids;
+    for (const auto& priority : priorities) {
+        auto link = std::make_shared<LinkEntry>();
+        link->set_attribute("priority", priority);
+        link->set_attribute("added", "2020-0" + std::to_string(ids.size()));
+        ids.push_back(db_.add_entry(link));
+    }
+    db_.add_entry(std::make_shared<LinkEntry>());
+
+    AttributeRangeQuery at_least_five{"priority", AttributeOrder::INTEGER,
+        AttributeBound::including("5"), AttributeBound::none()};
+    AttributeRangeQuery below_ten{"priority", AttributeOrder::INTEGER,
+        AttributeBound::none(), AttributeBound::excluding("10")};
+    AttributeRangeQuery text{"priority", AttributeOrder::LEXICOGRAPHIC,
+        AttributeBound::including("10"), AttributeBound::including("5")};
+    AttributeRangeQuery dates{"added", AttributeOrder::LEXICOGRAPHIC,
+        AttributeBound::excluding("2020-01"),
+        AttributeBound::including("2020-03")};
+    AttributePrefixQuery prefix{"added", "2020-0"};
+    auto check = [&]() {
+        auto found = db_.search(at_least_five);
+        ASSERT_EQ(4, found.size());
+        EXPECT_EQ(ids[1], found[0].first);
+        EXPECT_EQ(4, db_.count(below_ten));
+        EXPECT_EQ(2, db_.count(text));
+        EXPECT_EQ(2, db_.count(dates));
+        EXPECT_EQ(6, db_.count(prefix));
+    };
+    check();
+
+    db_.add_sorted_attribute_index("priority", AttributeOrder::INTEGER);
+    db_.add_sorted_attribute_index("added", AttributeOrder::LEXICOGRAPHIC);
+    EXPECT_TRUE(db_.has_sorted_attribute_index("priority"));
+    EXPECT_FALSE(db_.has_sorted_attribute_index("missing"));
+    check();
+    EXPECT_TRUE(db_.plan(at_least_five).uses_indexes());
+    EXPECT_EQ(4, db_.plan(at_least_five).candidates().size());
+    EXPECT_TRUE(db_.plan(prefix).uses_indexes());
+    // The index keeps priorities as integers.
+    EXPECT_FALSE(db_.plan(text).uses_indexes());
+
+    db_.get_entry(ids[1])->set_attribute("priority", "4");
+    db_.delete_entry(ids[2]);
+    EXPECT_EQ(2, db_.count(at_least_five));
+    EXPECT_EQ(4, db_.count(below_ten));
+
+    db_.remove_sorted_attribute_index("priority");
+    EXPECT_FALSE(db_.has_sorted_attribute_index("priority"));
+    EXPECT_FALSE(db_.plan(at_least_five).uses_indexes());
+    EXPECT_EQ(2, db_.count(at_least_five));
+
+    EXPECT_THROW(
+        AttributeRangeQuery("priority", AttributeOrder::INTEGER,
+            AttributeBound::including("five"), AttributeBound::none()),
+        libjlinkdb::JLinkDbError);
+    AttributeRangeQuery same{"priority", AttributeOrder::INTEGER,
+        AttributeBound::including("+05"), AttributeBound::none()};
+    EXPECT_TRUE(same.equals(at_least_five));
+    EXPECT_EQ(same.key(), at_least_five.key());
+}
+
+TEST_F(LinkDatabaseTest, TestUrlIndex)
+{
+    using libjlinkdb::query::HostQuery;
+    using libjlinkdb::query::LocationPrefixQuery;
+
+    std::vector<std::string> locations{"https://example.com/docs/api",
+        "https://www.Example.com/docs/guide?page=2",
+        "http://example.com:8080/docs", "https://example.org/docs/api",
+        "https://shop.example.co.uk/cart", "https://user@example.com/about"};
+    std::vector<int> ids;
+    for (const auto& location : locations) {
+        ids.push_back(db_.add_entry(std::make_shared<LinkEntry>(location)));
+    }
+    db_.add_entry(std::make_shared<LinkEntry>());
+
+    HostQuery host{"EXAMPLE.com"};
+    HostQuery domain{"example.com", true};
+    HostQuery uk{"example.co.uk", true};
+    LocationPrefixQuery docs{"https://example.com/docs/"};
+    LocationPrefixQuery partial{"https://www.Example.com/docs/gu"};
+    LocationPrefixQuery host_prefix{"https://example.co"};
+    auto check = [&]() {
+        EXPECT_EQ(3, db_.count(host));
+        EXPECT_EQ(4, db_.count(domain));
+        EXPECT_EQ(1, db_.count(uk));
+        EXPECT_EQ(1, db_.count(docs));
+        EXPECT_EQ(1, db_.count(partial));
+        EXPECT_EQ(1, db_.count(host_prefix));
+    };
+    check();
+
+    db_.set_url_index_enabled(true);
+    EXPECT_TRUE(db_.url_index_enabled());
+    check();
+    EXPECT_TRUE(db_.plan(domain).uses_indexes());
+    EXPECT_EQ(4, db_.plan(domain).candidates().size());
+    EXPECT_TRUE(db_.plan(partial).uses_indexes());
+    EXPECT_EQ(1, db_.plan(partial).candidates().size());
+    // The host of the prefix may continue, so the trie can't be used.
+    EXPECT_FALSE(db_.plan(host_prefix).uses_indexes());
+
+    db_.get_entry(ids[0])->set_location("https://example.com/docs/tutorial");
+    db_.delete_entry(ids[1]);
+    db_.add_entry(
+        std::make_shared<LinkEntry>("https://example.com/docs/api/v2"));
+    EXPECT_EQ(4, db_.count(host));
+    EXPECT_EQ(2, db_.count(docs));
+    EXPECT_EQ(0, db_.count(partial));
+    EXPECT_EQ(1, db_.count(LocationPrefixQuery{"https://example.com/docs/t"}));
+}
+
+TEST_F(LinkDatabaseTest, TestRankedSearch)
+{
+    using libjlinkdb::RankedEntry;
+
+    EXPECT_THROW(db_.ranked_search("wiki", 1), libjlinkdb::JLinkDbError);
+
+    auto entry1 = std::make_shared<LinkEntry>();
+    entry1->set_name("Gentoo Wiki");
+    entry1->set_description("Documentation for Gentoo");
+    auto entry2 = std::make_shared<LinkEntry>();
+    entry2->set_name("Arch Linux");
+    entry2->set_description("The Arch wiki covers Gentoo too");
+    auto entry3 = std::make_shared<LinkEntry>();
+    entry3->add_tag("wiki");
+    entry3->set_attribute("distro", "gentoo");
+    auto entry4 = std::make_shared<LinkEntry>();
+    entry4->set_name("Unrelated");
+    int id1 = db_.add_entry(entry1);
+    int id2 = db_.add_entry(entry2);
+    int id3 = db_.add_entry(entry3);
+    db_.add_entry(entry4);
+    db_.set_text_index_enabled(true);
+    EXPECT_TRUE(db_.text_index_enabled());
+
+    std::vector<RankedEntry> all = db_.ranked_search("GENTOO, wiki!", 10);
+    ASSERT_EQ(3, all.size());
+    // Both words are in the name of the first entry, which weighs the most.
+    EXPECT_EQ(id1, all[0].id);
+    EXPECT_EQ(entry1, all[0].entry);
+    for (std::size_t i = 1; i < all.size(); ++i) {
+        EXPECT_GE(all[i - 1].score, all[i].score);
+    }
+    // Pruning doesn't change the best results.
+    std::vector<RankedEntry> best = db_.ranked_search("gentoo wiki", 2);
+    ASSERT_EQ(2, best.size());
+    for (std::size_t i = 0; i < best.size(); ++i) {
+        EXPECT_EQ(all[i].id, best[i].id);
+        EXPECT_DOUBLE_EQ(all[i].score, best[i].score);
+    }
+    EXPECT_TRUE(db_.ranked_search("missing", 5).empty());
+    EXPECT_TRUE(db_.ranked_search("wiki", 0).empty());
+
+    // Only the name is weighed.
+    libjlinkdb::TextSearchOptions options;
+    options.description_weight = 0.0;
+    options.tag_weight = 0.0;
+    options.attribute_weight = 0.0;
+    std::vector<RankedEntry> names = db_.ranked_search("arch", 5, options);
+    ASSERT_EQ(1, names.size());
+    EXPECT_EQ(id2, names[0].id);
+
+    db_.get_entry(id3)->set_name("Gentoo Gentoo");
+    db_.delete_entry(id1);
+    std::vector<RankedEntry> changed = db_.ranked_search("gentoo", 10);
+    ASSERT_EQ(2, changed.size());
+    EXPECT_EQ(id3, changed[0].id);
+    EXPECT_EQ(id2, changed[1].id);
+}
+
+TEST_F(LinkDatabaseTest, TestTrigramIndex)
+{
+    auto entry1 = std::make_shared<LinkEntry>("https://Example.com/path");
+    entry1->set_name("Gentoo Wiki");
+    auto entry2 = std::make_shared<LinkEntry>();
+    entry2->set_description("Notes on the Arch wiki");
+    entry2->add_tag("distributions");
+    auto entry3 = std::make_shared<LinkEntry>();
+    entry3->set_attribute("source", "Import");
+    db_.add_entry(entry1);
+    int id2 = db_.add_entry(entry2);
+    db_.add_entry(entry3);
+
+    LinkDatabase indexed{db_};
+    indexed.set_trigram_index_enabled(true);
+    const vector<vector<string>> terms{{"wiki"}, {"WIKI"}, {"example"},
+        {"distrib"}, {"port"}, {"wi"}, {"iki", "sourc"}, {"missing"}};
+    for (bool ignore_case : {false, true}) {
+        for (const auto& query_terms : terms) {
+            ContainsQuery query{query_terms, {false, ignore_case}};
+            EXPECT_EQ(db_.search(query), indexed.search(query));
+        }
+    }
+
+    entry2->set_description("");
+    ContainsQuery query{{"arch"}, {false, true}};
+    EXPECT_TRUE(indexed.search(query).empty());
+    entry2->add_tag("arch");
+    auto result = indexed.search(query);
+    ASSERT_EQ(1, result.size());
+    EXPECT_EQ(id2, result[0].first);
+    indexed.delete_entry(id2);
+    EXPECT_TRUE(indexed.search(query).empty());
+}
+
+TEST_F(LinkDatabaseTest, TestParallelSearch)
+{
+    for (int i = 0; i < 1000; ++i) {
+        auto entry = std::make_shared<LinkEntry>();
+        entry->set_name("entry " + std::to_string(i));
+        if (i % 7 == 0) {
+            entry->add_tag("seventh");
+        }
+        db_.add_entry(entry);
+    }
+    for (int id = 0; id < 1000; id += 11) {
+        db_.delete_entry(id);
+    }
+
+    libjlinkdb::query::TagQuery query{"seventh", {true, false}};
+    auto expected = db_.search(query);
+    EXPECT_EQ(1, db_.search_threads());
+
+    db_.set_search_threads(4);
+    db_.set_parallel_search_threshold(100);
+    EXPECT_EQ(4, db_.search_threads());
+    EXPECT_EQ(expected, db_.search(query));
+    db_.set_tag_index_enabled(true);
+    EXPECT_EQ(expected, db_.search(query));
+
+    // Copies share the threads.
+    LinkDatabase copy{db_};
+    EXPECT_EQ(4, copy.search_threads());
+    EXPECT_EQ(expected, copy.search(query));
+
+    db_.set_search_threads(1);
+    EXPECT_EQ(expected, db_.search(query));
+}
+
+TEST_F(LinkDatabaseTest, TestSnapshotVersions)
+{
+    EXPECT_EQ(nullptr, db_.latest_snapshot());
+    int id1 = db_.add_entry(std::make_shared<LinkEntry>(BASIC_URL1));
+    int id2 = db_.add_entry(std::make_shared<LinkEntry>(BASIC_URL2));
+
+    auto first = db_.snapshot();
+    EXPECT_EQ(first, db_.snapshot());
+    EXPECT_EQ(first, db_.latest_snapshot());
+    EXPECT_EQ(2, first->links_count());
+
+    db_.get_entry(id1)->set_name("changed");
+    db_.delete_entry(id2);
+    int id3 = db_.add_entry(std::make_shared<LinkEntry>(BASIC_URL2));
+    auto second = db_.snapshot();
+    EXPECT_NE(first, second);
+
+    EXPECT_EQ("", first->get_entry(id1)->name());
+    EXPECT_TRUE(first->has_entry(id2));
+    EXPECT_FALSE(first->has_entry(id3));
+    EXPECT_EQ("changed", second->get_entry(id1)->name());
+    EXPECT_FALSE(second->has_entry(id2));
+    EXPECT_TRUE(second->has_entry(id3));
+
+    libjlinkdb::query::FieldQuery<libjlinkdb::query::LocationExtractor> query{
+        {}, BASIC_URL2, {true, false}};
+    auto found = first->search(query);
+    ASSERT_EQ(1, found.size());
+    EXPECT_EQ(id2, found[0].first);
+    found = second->search(query);
+    ASSERT_EQ(1, found.size());
+    EXPECT_EQ(id3, found[0].first);
+
+    // Queries that aren't compiled see entries built from the version.
+    FuncQuery named{
+        [](const LinkEntry& entry) { return entry.name() == "changed"; }};
+    EXPECT_TRUE(first->search(named).empty());
+    found = second->search(named);
+    ASSERT_EQ(1, found.size());
+    EXPECT_EQ(id1, found[0].first);
+
+    // Chunks handed to a version stay as they were after older versions are
+    // dropped.
+    first.reset();
+    db_.get_entry(id1)->set_name("changed again");
+    EXPECT_EQ("changed", second->get_entry(id1)->name());
+    EXPECT_EQ("changed again", db_.snapshot()->get_entry(id1)->name());
+}
+
+TEST_F(LinkDatabaseTest, TestSnapshotWhileWriting)
+{
+    for (int i = 0; i < 2000; ++i) {
+        db_.add_entry(std::make_shared<LinkEntry>());
+    }
+    db_.snapshot();
+
+    std::atomic<bool> writing{true};
+    std::atomic<int> bad_results{0};
+    std::thread reader{[&]() {
+        libjlinkdb::query::TagQuery query{"tag", {true, false}};
+        while (writing) {
+            auto version = db_.latest_snapshot();
+            auto found = version->search(query);
+            // Every version is taken after tagging a pair of entries.
+            if (found.size() % 2 != 0) {
+                ++bad_results;
+            }
+        }
+    }};
+
+    for (int i = 0; i < 2000; i += 2) {
+        db_.get_entry(i)->add_tag("tag");
+        db_.get_entry(i + 1)->add_tag("tag");
+        db_.snapshot();
+    }
+    writing = false;
+    reader.join();
+
+    EXPECT_EQ(0, bad_results);
+    EXPECT_EQ(2000, db_.latest_snapshot()->links_count());
+}
+
+TEST_F(LinkDatabaseTest, TestQueryCache)
+{
+    using libjlinkdb::query::TagQuery;
+    db_.set_query_cache_capacity(1 << 20);
+    for (int i = 0; i < 10; ++i) {
+        auto link = std::make_shared<LinkEntry>(BASIC_URL1);
+        link->add_tag(i % 2 == 0 ? "even" : "odd");
+        db_.add_entry(link);
+    }
+
+    ContainsQuery contains{{"even"}, {false, false}};
+    ContainsQuery same{{"even"}, {false, false}};
+    EXPECT_EQ(contains.key(), same.key());
+    EXPECT_NE(contains.key(), ContainsQuery({"odd"}, {false, false}).key());
+
+    EXPECT_EQ(5, db_.search(contains).size());
+    EXPECT_EQ(5, db_.search(same).size());
+    const libjlinkdb::QueryCache* cache = db_.query_cache();
+    ASSERT_NE(nullptr, cache);
+    EXPECT_EQ(1, cache->hits());
+    EXPECT_EQ(1, cache->misses());
+
+    // Changes are patched into the cached results.
+    db_.get_entry(1)->add_tag("even");
+    db_.delete_entry(0);
+    auto link = std::make_shared<LinkEntry>(BASIC_URL2);
+    link->add_tag("even");
+    int added = db_.add_entry(link);
+    auto result = db_.search(contains);
+    EXPECT_EQ(2, cache->hits());
+    ASSERT_EQ(6, result.size());
+    EXPECT_EQ(1, result.front().first);
+    EXPECT_EQ(added, result.back().first);
+    EXPECT_EQ(link, result.back().second);
+
+    // Only the most recently used results fit.
+    db_.set_query_cache_capacity(cache->size());
+    db_.search(TagQuery{"odd", {true, false}});
+    EXPECT_EQ(1, cache->results_count());
+    db_.search(contains);
+    EXPECT_EQ(3, cache->misses());
+
+    db_.set_query_cache_capacity(0);
+    EXPECT_EQ(nullptr, db_.query_cache());
+}
+
+TEST_F(LinkDatabaseTest, TestLimitedSearch)
+{
+    using libjlinkdb::SearchOrder;
+    for (int i = 0; i < 20; ++i) {
+        auto link = std::make_shared<LinkEntry>();
+        link->set_name("entry " + std::to_string(i % 5));
+        link->set_location("http://example.com/" + std::to_string(19 - i));
+        link->add_tag(i % 2 == 0 ? "even" : "odd");
+        db_.add_entry(link);
+    }
+    libjlinkdb::query::TagQuery query{"even", {true, false}};
+    auto all = db_.search(query);
+
+    auto first = db_.search(query, 3);
+    ASSERT_EQ(3, first.size());
+    EXPECT_TRUE(std::equal(first.begin(), first.end(), all.begin()));
+    EXPECT_EQ(all, db_.search(query, 100));
+    EXPECT_TRUE(db_.search(query, 0).empty());
+
+    // Ties in name are broken by id.
+    auto by_name = db_.search(query, 4, SearchOrder::NAME);
+    std::vector<int> ids;
+    for (const auto& match : by_name) {
+        ids.push_back(match.first);
+    }
+    EXPECT_EQ(std::vector<int>({0, 10, 6, 16}), ids);
+
+    auto by_location = db_.search(query, 2, SearchOrder::LOCATION);
+    ASSERT_EQ(2, by_location.size());
+    EXPECT_EQ(18, by_location[0].first);
+    EXPECT_EQ(8, by_location[1].first);
+
+    auto by_score = db_.search(query, 3, [](const LinkEntry& entry) {
+        return entry.location().size() * 1.0;
+    });
+    ASSERT_EQ(3, by_score.size());
+    EXPECT_EQ(0, by_score[0].first);
+    EXPECT_EQ(2, by_score[1].first);
+    EXPECT_EQ(4, by_score[2].first);
+}
+
+TEST_F(LinkDatabaseTest, TestSearchEach)
+{
+    for (int i = 0; i < 10; ++i) {
+        auto link = std::make_shared<LinkEntry>();
+        link->add_tag(i % 3 == 0 ? "third" : "other");
+        db_.add_entry(link);
+    }
+    db_.delete_entry(3);
+    libjlinkdb::query::TagQuery query{"third", {true, false}};
+
+    std::vector<int> ids;
+    db_.search_each(query, [&](int id, const LinkEntry& entry) {
+        EXPECT_EQ(db_.get_entry(id).get(), &entry);
+        ids.push_back(id);
+        return true;
+    });
+    EXPECT_EQ(std::vector<int>({0, 6, 9}), ids);
+
+    // Returning false stops the search.
+    ids.clear();
+    db_.search_each(query, [&](int id, const LinkEntry&) {
+        ids.push_back(id);
+        return ids.size() < 2;
+    });
+    EXPECT_EQ(std::vector<int>({0, 6}), ids);
+
+    EXPECT_EQ(3, db_.count(query));
+    EXPECT_TRUE(db_.exists(query));
+    libjlinkdb::query::TagQuery missing{"missing", {true, false}};
+    EXPECT_EQ(0, db_.count(missing));
+    EXPECT_FALSE(db_.exists(missing));
+
+    // A kept plan looks up its candidates again after changes, and checks
+    // every row once the index it was made with is gone.
+    db_.set_tag_index_enabled(true);
+    auto plan = db_.plan(query);
+    EXPECT_TRUE(plan.root().exact);
+    EXPECT_EQ(3, db_.count(plan));
+    auto link = std::make_shared<LinkEntry>();
+    link->add_tag("third");
+    int id = db_.add_entry(link);
+    ids.clear();
+    db_.search_each(plan, [&](int found, const LinkEntry&) {
+        ids.push_back(found);
+        return true;
+    });
+    EXPECT_EQ(std::vector<int>({0, 6, 9, id}), ids);
+    db_.set_tag_index_enabled(false);
+    db_.get_entry(0)->remove_tag("third");
+    EXPECT_EQ(3, db_.count(plan));
+    EXPECT_TRUE(db_.exists(plan));
+}
+
+TEST_F(LinkDatabaseTest, TestKeptPlanIndexChanges)
+{
+    using libjlinkdb::query::AndCollection;
+    using libjlinkdb::query::AttributeQuery;
+    using libjlinkdb::query::Query;
+    using libjlinkdb::query::TagQuery;
+
+    for (int i = 0; i < 10; ++i) {
+        auto link = std::make_shared<LinkEntry>();
+        link->add_tag("t");
+        if (i % 2 == 0) {
+            link->set_attribute("a", "x");
+        }
+        db_.add_entry(link);
+    }
+    db_.set_tag_index_enabled(true);
+    db_.set_attribute_index_enabled(true);
+    StringSearchOptions options{true, false};
+    AndCollection query{vector<shared_ptr<Query>>{
+        std::make_shared<TagQuery>("t", options),
+        std::make_shared<AttributeQuery>("a", "x", options)}};
+    auto plan = db_.plan(query);
+    EXPECT_EQ(5, db_.count(plan));
+
+    // Once one index is gone, its subquery has to be checked again even
+    // though the other index still gives candidates.
+    db_.set_attribute_index_enabled(false);
+    EXPECT_EQ(5, db_.count(query));
+    EXPECT_EQ(5, db_.count(plan));
+    db_.set_tag_index_enabled(false);
+    EXPECT_EQ(5, db_.count(plan));
+    db_.set_attribute_index_enabled(true);
+    EXPECT_EQ(5, db_.count(plan));
+    EXPECT_TRUE(plan.uses_indexes());
+}
+
+TEST_F(LinkDatabaseTest, TestQueryPlan)
+{
+    using libjlinkdb::query::And;
+    using libjlinkdb::query::AttributeContainsQuery;
+    using libjlinkdb::query::AttributeQuery;
+    using libjlinkdb::query::Or;
+    using libjlinkdb::query::TagQuery;
+
+    auto entry = std::make_shared<LinkEntry>(BASIC_URL1);
+    entry->add_tag("linux");
+    entry->set_attribute("source", "import");
+    db_.add_entry(entry);
+    db_.add_entry(std::make_shared<LinkEntry>(BASIC_URL2));
+
+    auto custom = std::make_shared<FuncQuery>(
+        [](const LinkEntry& entry) { return !entry.tags().empty(); });
+    auto contains = std::make_shared<AttributeContainsQuery>(
+        "port", StringSearchOptions{false, false});
+    auto exact = std::make_shared<AttributeQuery>(
+        "source", "import", StringSearchOptions{true, false});
+    And query{contains, std::make_shared<And>(custom, exact)};
+
+    auto plan = db_.plan(query);
+    const auto& root = plan.root();
+    EXPECT_EQ("AndCollection", root.description);
+    ASSERT_EQ(3, root.children.size());
+    EXPECT_EQ(exact->describe(), root.children[0].description);
+    EXPECT_EQ(contains->describe(), root.children[1].description);
+    EXPECT_EQ("Query", root.children[2].description);
+    EXPECT_FALSE(plan.uses_indexes());
+    EXPECT_EQ(1, db_.search(query).size());
+
+    db_.set_tag_index_enabled(true);
+    auto tag = std::make_shared<TagQuery>(
+        "linux", StringSearchOptions{true, false});
+    And indexed{custom, std::make_shared<Or>(tag, tag)};
+    plan = db_.plan(indexed);
+    EXPECT_TRUE(plan.uses_indexes());
+    EXPECT_EQ(1, plan.candidates().size());
+    ASSERT_EQ(2, plan.root().children.size());
+    EXPECT_TRUE(plan.root().children[0].uses_indexes);
+    EXPECT_NE(std::string::npos, plan.explain().find("1 candidates"));
+    EXPECT_EQ(1, db_.search(indexed).size());
+}
+
+TEST(TestCanonicalQuery, TestEquality)
+{
+    using libjlinkdb::query::And;
+    using libjlinkdb::query::AndCollection;
+    using libjlinkdb::query::OrCollection;
+    using libjlinkdb::query::Query;
+    using libjlinkdb::query::TagQuery;
+    using libjlinkdb::query::canonicalize;
+
+    StringSearchOptions options{true, true};
+    auto tag1 = std::make_shared<TagQuery>("a", options);
+    auto tag2 = std::make_shared<TagQuery>("A", options);
+    auto tag3 = std::make_shared<TagQuery>("b", options);
+    EXPECT_FALSE(tag1->equals(*tag2));
+    EXPECT_TRUE(canonicalize(tag1)->equals(*canonicalize(tag2)));
+    EXPECT_EQ(canonicalize(tag1)->hash(), canonicalize(tag2)->hash());
+    // Keys agree with equality on canonical forms.
+    EXPECT_EQ(canonicalize(tag1)->key(), canonicalize(tag2)->key());
+    EXPECT_NE(canonicalize(tag1)->key(), canonicalize(tag3)->key());
+
+    // Nested conjunctions are flattened, sorted and deduplicated.
+    shared_ptr<Query> query1 = std::make_shared<And>(
+        tag1, std::make_shared<And>(tag3, tag2));
+    shared_ptr<Query> query2 = std::make_shared<AndCollection>(
+        vector<shared_ptr<Query>>{tag3, tag1});
+    EXPECT_FALSE(query1->equals(*query2));
+    auto canonical1 = canonicalize(query1);
+    auto canonical2 = canonicalize(query2);
+    EXPECT_TRUE(canonical1->equals(*canonical2));
+    EXPECT_EQ(canonical1->hash(), canonical2->hash());
+    EXPECT_EQ(canonical1->key(), canonical2->key());
+    EXPECT_EQ(canonical2, canonicalize(canonical2));
+
+    // A query that matches nothing absorbs a conjunction.
+    auto none = std::make_shared<ContainsQuery>();
+    auto folded = canonicalize(std::make_shared<And>(tag1, none));
+    EXPECT_TRUE(folded->equals(OrCollection{}));
+
+    ContainsQuery contains1{{"x", "y"}, {false, false}};
+    ContainsQuery contains2{{"y", "x", "y"}, {false, false}};
+    EXPECT_TRUE(contains1.canonical()->equals(*contains2.canonical()));
+    EXPECT_EQ(10, std::static_pointer_cast<OrCollection>(
+        contains2.canonical())->queries().size());
+}
+
+TEST(TestCompiledQuery, TestMatchesTree)
+{
+    using libjlinkdb::EntryStore;
+    using libjlinkdb::query::And;
+    using libjlinkdb::query::AndCollection;
+    using libjlinkdb::query::AttributeQuery;
+    using libjlinkdb::query::CompiledQuery;
+    using libjlinkdb::query::Or;
+    using libjlinkdb::query::OrCollection;
+    using libjlinkdb::query::Query;
+    using libjlinkdb::query::TagQuery;
+
+    EntryStore store;
+    for (std::size_t row = 0; row < 64; ++row) {
+        auto link = std::make_shared<LinkEntry>(
+            row % 3 == 0 ? BASIC_URL1 : BASIC_URL2);
+        link->set_name("name" + std::to_string(row));
+        link->add_tag(row % 2 == 0 ? "even" : "odd");
+        link->set_attribute("mod", std::to_string(row % 5));
+        store.insert(row, link);
+    }
+
+    StringSearchOptions exact{true, false};
+    auto odd = std::make_shared<FuncQuery>(
+        [](const LinkEntry& entry) { return entry.has_tag("odd"); });
+    vector<shared_ptr<Query>> queries{
+        std::make_shared<ContainsQuery>(vector<string>{"name1", "GENTOO"},
+            StringSearchOptions{false, true}),
+        std::make_shared<And>(std::make_shared<TagQuery>("even", exact),
+            std::make_shared<Or>(std::make_shared<AttributeQuery>(
+                                     "mod", "3", exact),
+                odd)),
+        std::make_shared<AndCollection>(),
+        std::make_shared<OrCollection>(),
+        std::make_shared<ContainsQuery>(),
+    };
+    for (const auto& query : queries) {
+        CompiledQuery compiled{*query};
+        for (std::size_t row = 0; row < store.rows(); ++row) {
+            EXPECT_EQ(query->matches_row(store, row),
+                compiled.matches_row(store, row))
+                << query->describe() << " row " << row;
+        }
+    }
+}
+
+TEST(TestContainsQuery, TestAutomatonMatchesTerms)
+{
+    using libjlinkdb::EntryStore;
+
+    EntryStore store;
+    for (std::size_t row = 0; row < 64; ++row) {
+        auto link = std::make_shared<LinkEntry>(
+            row % 3 == 0 ? BASIC_URL1 : BASIC_URL2);
+        link->set_name("Name" + std::to_string(row));
+        link->set_description(row % 4 == 0 ? "" : "A description");
+        link->add_tag("tag" + std::to_string(row % 7));
+        link->set_attribute("key" + std::to_string(row % 5), "value");
+        store.insert(row, link);
+    }
+
+    vector<string> terms{"name1", "TAG3", "key4", "scription", "gentoo.org",
+        "name5"};
+    for (bool full : {false, true}) {
+        for (bool ignore_case : {false, true}) {
+            ContainsQuery query{terms, {full, ignore_case}};
+            ASSERT_TRUE(query.uses_automaton());
+            for (std::size_t row = 0; row < store.rows(); ++row) {
+                EXPECT_EQ(query.underlying_query().matches_row(store, row),
+                    query.matches_row(store, row));
+                EXPECT_EQ(query.underlying_query().matches(*store.entry(row)),
+                    query.matches(*store.entry(row)));
+            }
+        }
+    }
+}
+
+TEST(TestRowBitmap, TestMatchesSet)
+{
+    using libjlinkdb::RowBitmap;
+    using Rows = std::set<std::size_t>;
+
+    // Rows over a few containers, so that some containers are sparse and
+    // some dense.
+    constexpr std::size_t RANGE = 3 * 65536;
+    std::mt19937 engine{1};
+    std::uniform_int_distribution<std::size_t> distribution{0, RANGE - 1};
+    auto make_rows = [&](std::size_t count) {
+        Rows rows;
+        while (rows.size() < count) {
+            rows.insert(distribution(engine));
+        }
+        return rows;
+    };
+    auto make_bitmap = [](const Rows& rows) {
+        return RowBitmap{vector<std::size_t>(rows.begin(), rows.end())};
+    };
+    auto check = [](const RowBitmap& bitmap, const Rows& expected) {
+        vector<std::size_t> rows;
+        bitmap.copy_rows(rows);
+        EXPECT_EQ(vector<std::size_t>(expected.begin(), expected.end()), rows);
+        EXPECT_EQ(expected.size(), bitmap.size());
+    };
+
+    vector<Rows> sets{
+        make_rows(100), make_rows(12500), make_rows(60000), make_rows(150000)};
+    for (const auto& rows1 : sets) {
+        for (const auto& rows2 : sets) {
+            Rows both;
+            std::set_intersection(rows1.begin(), rows1.end(), rows2.begin(),
+                rows2.end(), std::inserter(both, both.end()));
+            Rows either;
+            std::set_union(rows1.begin(), rows1.end(), rows2.begin(),
+                rows2.end(), std::inserter(either, either.end()));
+
+            RowBitmap intersection{make_bitmap(rows1)};
+            intersection.intersect(make_bitmap(rows2));
+            check(intersection, both);
+            RowBitmap united{make_bitmap(rows1)};
+            united.unite(make_bitmap(rows2));
+            check(united, either);
+        }
+    }
+
+    // Adding and removing rows changes the kind of container.
+    RowBitmap bitmap;
+    Rows expected;
+    for (std::size_t row = 0; row < 10000; row += 2) {
+        bitmap.add(row);
+        expected.insert(row);
+    }
+    bitmap.add(70000);
+    expected.insert(70000);
+    bitmap.add(4);
+    check(bitmap, expected);
+    for (std::size_t row = 0; row < 10000; row += 4) {
+        bitmap.remove(row);
+        expected.erase(row);
+    }
+    bitmap.remove(1);
+    check(bitmap, expected);
+    EXPECT_TRUE(bitmap.contains(2));
+    EXPECT_FALSE(bitmap.contains(4));
+    bitmap.remove(70000);
+    EXPECT_FALSE(bitmap.contains(70000));
+    EXPECT_FALSE(bitmap.empty());
+    EXPECT_TRUE(RowBitmap{}.empty());
+}
+
+TEST(TestUrlParts, TestSplitUrl)
+{
+    using libjlinkdb::UrlParts;
+
+    // The parts refer to the characters of the URL.
+    std::string url{"https://user:pw@Example.com:8080/a/b?x=1#top"};
+    UrlParts parts;
+    ASSERT_TRUE(libjlinkdb::split_url(url, parts));
+    EXPECT_EQ("https", parts.scheme.str());
+    EXPECT_EQ("Example.com", parts.host.str());
+    EXPECT_EQ("8080", parts.port.str());
+    EXPECT_EQ("/a/b", parts.path.str());
+    EXPECT_EQ("x=1", parts.query.str());
+    EXPECT_EQ("top", parts.fragment.str());
+
+    url = "mailto:someone";
+    ASSERT_TRUE(libjlinkdb::split_url(url, parts));
+    EXPECT_EQ("mailto", parts.scheme.str());
+    EXPECT_TRUE(parts.host.empty());
+    EXPECT_EQ("someone", parts.path.str());
+    url = "http://[::1]:80/";
+    ASSERT_TRUE(libjlinkdb::split_url(url, parts));
+    EXPECT_EQ("[::1]", parts.host.str());
+    EXPECT_EQ("80", parts.port.str());
+    url = "/relative";
+    EXPECT_FALSE(libjlinkdb::split_url(url, parts));
+
+    auto domain = [](const std::string& host) {
+        return libjlinkdb::registrable_domain(host).str();
+    };
+    EXPECT_EQ("example.com", domain("a.b.example.com"));
+    EXPECT_EQ("example.com", domain("example.com"));
+    EXPECT_EQ("example.co.uk", domain("www.example.co.uk"));
+    EXPECT_EQ("", domain("co.uk"));
+    EXPECT_EQ("", domain("localhost"));
+    EXPECT_EQ("", domain("192.168.0.1"));
+}
+
+TEST(TestThreadPool, TestRun)
+{
+    libjlinkdb::ThreadPool pool{3};
+    vector<int> done(100, 0);
+    pool.run(done.size(), [&](std::size_t i) { done[i] = 1; });
+    EXPECT_EQ(100, std::count(done.begin(), done.end(), 1));
+
+    EXPECT_THROW(pool.run(10,
+                     [](std::size_t i) {
+                         if (i == 5) {
+                             throw std::runtime_error{"failed"};
+                         }
+                     }),
+        std::runtime_error);
+}
+
+TEST(TestConcurrentLinkDatabase, TestBasic)
+{
+    libjlinkdb::ConcurrentLinkDatabase db{3};
+    EXPECT_EQ(3, db.shards());
+
+    vector<int> ids;
+    for (int i = 0; i < 10; ++i) {
+        ids.push_back(db.add_entry(std::make_shared<LinkEntry>(BASIC_URL1)));
+    }
+    EXPECT_EQ(10, db.links_count());
+    EXPECT_EQ(10, unordered_set<int>(ids.begin(), ids.end()).size());
+
+    auto replacement = std::make_shared<LinkEntry>(BASIC_URL2);
+    db.replace_entry(ids[4], replacement);
+    EXPECT_EQ(replacement, db.get_entry(ids[4]));
+    db.delete_entry(ids[5]);
+    EXPECT_FALSE(db.has_entry(ids[5]));
+    EXPECT_FALSE(db.has_entry(-1));
+
+    libjlinkdb::query::FieldQuery<libjlinkdb::query::LocationExtractor> query{
+        {}, BASIC_URL1, {true, false}};
+    auto found = db.search(query);
+    ASSERT_EQ(8, found.size());
+    EXPECT_TRUE(std::is_sorted(found.begin(), found.end()));
+}
+
+TEST(TestConcurrentLinkDatabase, TestStress)
+{
+    constexpr int WRITERS = 4;
+    constexpr int READERS = 2;
+    constexpr int ADDS = 300;
+
+    libjlinkdb::ConcurrentLinkDatabase db{4};
+    db.set_tag_index_enabled(true);
+    std::atomic<int> added{0};
+    std::atomic<int> deleted{0};
+    std::atomic<int> changed{0};
+    db.signal_entry_added().connect([&](int) { ++added; });
+    db.signal_entry_deleted().connect([&](int) { ++deleted; });
+    db.signal_entry_changed().connect([&](int) { ++changed; });
+
+    std::atomic<bool> writing{true};
+    std::atomic<int> bad_results{0};
+    vector<std::thread> readers;
+    for (int i = 0; i < READERS; ++i) {
+        readers.emplace_back([&]() {
+            libjlinkdb::query::TagQuery query{"even", {true, false}};
+            while (writing) {
+                auto found = db.search(query);
+                for (const auto& link : found) {
+                    if (!link.second->has_tag("even")) {
+                        ++bad_results;
+                    }
+                }
+                if (!std::is_sorted(found.begin(), found.end())) {
+                    ++bad_results;
+                }
+            }
+        });
+    }
+
+    vector<std::thread> writers;
+    for (int i = 0; i < WRITERS; ++i) {
+        writers.emplace_back([&]() {
+            for (int j = 0; j < ADDS; ++j) {
+                auto entry = std::make_shared<LinkEntry>();
+                if (j % 2 == 0) {
+                    entry->add_tag("even");
+                }
+                int id = db.add_entry(entry);
+                if (j % 3 == 0) {
+                    db.delete_entry(id);
+                } else if (j % 3 == 1) {
+                    auto copy = std::make_shared<LinkEntry>(*db.get_entry(id));
+                    copy->set_name("changed");
+                    db.replace_entry(id, copy);
+                }
+            }
+        });
+    }
+    for (auto& writer : writers) {
+        writer.join();
+    }
+    writing = false;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_EQ(0, bad_results);
+    EXPECT_EQ(WRITERS * ADDS, added);
+    EXPECT_EQ(WRITERS * ADDS / 3, deleted);
+    EXPECT_EQ(WRITERS * ADDS / 3, changed);
+    EXPECT_EQ(WRITERS * ADDS * 2 / 3, db.links_count());
+    libjlinkdb::query::TagQuery query{"even", {true, false}};
+    EXPECT_EQ(WRITERS * ADDS / 3, db.search(query).size());
+}
+
 class ContainsQueryTest : public ::testing::Test {
 protected:
     void SetUp() override